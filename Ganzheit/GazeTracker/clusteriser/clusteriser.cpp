@@ -1,10 +1,26 @@
+
 #include "clusteriser.h"
+#include <algorithm>
 
 
 namespace gt {
 
 
-Clusteriser::Clusteriser() {}
+/*
+ * The neighbours of a pixel, counterclockwise on the screen starting
+ * from the right: E, NE, N, NW, W, SW, S, SE
+ */
+static const int DIR_X[8] = {1,  1,  0, -1, -1, -1, 0, 1};
+static const int DIR_Y[8] = {0, -1, -1, -1,  0,  1, 1, 1};
+
+
+Clusteriser::Clusteriser() {
+
+	min_boundary = 0;
+	max_boundary = INT_MAX;
+	min_area     = 0;
+
+}
 
 
 Clusteriser::~Clusteriser() {
@@ -25,53 +41,431 @@ void Clusteriser::clearClusters() {
 	ind_clusters.clear();
 	ind_holes.clear();
 
-	hierarchy.clear();
+	blobs.clear();
+	blobs_kept.clear();
+
+}
+
+
+void Clusteriser::setLimits(int _min_boundary, int _max_boundary, int _min_area) {
+
+	min_boundary = _min_boundary;
+	max_boundary = _max_boundary;
+	min_area     = _min_area;
+
+}
+
+
+int Clusteriser::newLabel(unsigned char _kind, int _enclosing) {
+
+	const int label = (int)parent.size();
+
+	parent.push_back(label);
+	kind.push_back(_kind);
+	enclosing.push_back(_enclosing);
+
+	return label;
+
+}
+
+
+int Clusteriser::join(int a, int b) {
+
+	while(parent[a] != a) {
+		a = parent[a];
+	}
+
+	while(parent[b] != b) {
+		b = parent[b];
+	}
+
+	// the smaller label is the root, so the root is the first label of the set
+	if(a < b) {
+		parent[b] = a;
+		return a;
+	}
+
+	parent[a] = b;
+	return b;
 
 }
 
 
-void Clusteriser::clusterise(const cv::Mat &image_binary, const cv::Rect &rect_search) {
+void Clusteriser::clusterise(cv::Mat &image_binary, const cv::Rect &rect_search) {
 
-    // clear previous clusters
+	// clear previous clusters
 	clearClusters();
 
+	const int w = rect_search.width;
+	const int h = rect_search.height;
+
+	// the edges are background, so there must be an inner pixel
+	if(w < 3 || h < 3) {
+		return;
+	}
+
+
+	/********************************************************************************************
+	 * First pass: give each pixel a label. The labels of the edges are
+	 * 0, the background connected to the edges.
+	 ********************************************************************************************/
+
+	// img_labels is reused if the size does not change
+	img_labels.create(h, w, CV_32SC1);
+
+	img_labels.row(0).setTo(cv::Scalar(0));
+	img_labels.row(h - 1).setTo(cv::Scalar(0));
+
+	parent.clear();
+	kind.clear();
+	enclosing.clear();
+
+	newLabel(LABEL_BACKGROUND, -1);
+
+	for(int y = 1; y < h - 1; ++y) {
+
+		const unsigned char *src = image_binary.ptr<unsigned char>(rect_search.y + y) + rect_search.x;
+
+		int *lab       = img_labels.ptr<int>(y);
+		const int *up  = img_labels.ptr<int>(y - 1);
+
+		lab[0]     = 0;
+		lab[w - 1] = 0;
+
+		for(int x = 1; x < w - 1; ++x) {
+
+			int label = -1;
+
+			if(src[x]) {
+
+				// 8-connected: W, NW, N and NE
+				const int neighbours[4] = {lab[x - 1], up[x - 1], up[x], up[x + 1]};
+
+				for(int i = 0; i < 4; ++i) {
+
+					const int n = neighbours[i];
+
+					if(kind[n] == LABEL_FOREGROUND) {
+						label = label < 0 ? n : join(label, n);
+					}
+
+				}
+
+				if(label < 0) {
+					label = newLabel(LABEL_FOREGROUND, -1);
+				}
+
+			}
+			else {
+
+				// 4-connected: W and N
+				if(kind[lab[x - 1]] == LABEL_BACKGROUND) {
+					label = lab[x - 1];
+				}
+
+				if(kind[up[x]] == LABEL_BACKGROUND) {
+					label = label < 0 ? up[x] : join(label, up[x]);
+				}
+
+				// E or S is an edge
+				if(x == w - 2 || y == h - 2) {
+					label = label < 0 ? 0 : join(label, 0);
+				}
+
+				// the pixel above is foreground, it encloses the background if this is a hole
+				if(label < 0) {
+					label = newLabel(LABEL_BACKGROUND, up[x]);
+				}
+
+			}
+
+			lab[x] = label;
+
+		}
+
+	}
+
+
+	/********************************************************************************************
+	 * Resolve the labels. The roots are the first labels of their sets,
+	 * so the blobs are numbered in raster order and the pixel above the
+	 * first pixel of a hole belongs to the enclosing blob.
+	 ********************************************************************************************/
+
+	const int nof_labels = (int)parent.size();
+
+	blob_of.resize(nof_labels);
+
+	int nof_blobs = 0;
+
+	for(int i = 0; i < nof_labels; ++i) {
+
+		// the parent is smaller, so it has been resolved already
+		parent[i] = parent[i] == i ? i : parent[parent[i]];
+
+		if(kind[i] == LABEL_FOREGROUND) {
+			blob_of[i] = parent[i] == i ? nof_blobs++ : blob_of[parent[i]];
+		}
+
+	}
+
+	for(int i = 0; i < nof_labels; ++i) {
+
+		if(kind[i] == LABEL_BACKGROUND) {
+
+			const int root = parent[i];
+
+			// connected to the edges
+			if(root == 0) {
+				blob_of[i] = -1;
+			}
+			else {
+				blob_of[i] = blob_of[enclosing[root]];
+			}
+
+		}
+
+	}
+
+
 	/********************************************************************************************
-	 * Based on finding the clusters and holes
+	 * Second pass: fill the holes and collect the sums of the blobs
 	 ********************************************************************************************/
 
-	// a matrix header to the image with the given ROI
-	const cv::Mat img_roi(image_binary, rect_search);
+	sums.resize(nof_blobs);
+	blobs.resize(nof_blobs);
 
-	// clone because findContours modifies the image
-	cv::Mat tmp = img_roi.clone();
+	for(int b = 0; b < nof_blobs; ++b) {
 
-	// find the contours
-	cv::findContours(tmp, this->clusters, hierarchy, CV_RETR_CCOMP, CV_CHAIN_APPROX_NONE, cv::Point(rect_search.x, rect_search.y));
+		Sums &s = sums[b];
 
-	if(clusters.size() == 0) {
+		s.area         = 0;
+		s.nof_boundary = 0;
+		s.x_min        = INT_MAX;
+		s.y_min        = INT_MAX;
+		s.x_max        = INT_MIN;
+		s.y_max        = INT_MIN;
+		s.x = s.y = s.xx = s.xy = s.yy = 0.0;
+
+	}
+
+	for(int y = 1; y < h - 1; ++y) {
+
+		unsigned char *dst = image_binary.ptr<unsigned char>(rect_search.y + y) + rect_search.x;
+
+		const int *lab  = img_labels.ptr<int>(y);
+		const int *up   = img_labels.ptr<int>(y - 1);
+		const int *down = img_labels.ptr<int>(y + 1);
+
+		const double yd = rect_search.y + y;
+
+		for(int x = 1; x < w - 1; ++x) {
+
+			const int b = blob_of[lab[x]];
+
+			if(b < 0) {
+				continue;
+			}
+
+			Sums &s = sums[b];
+
+			if(kind[lab[x]] == LABEL_BACKGROUND) {
+
+				// a hole
+				dst[x] = 255;
+
+			}
+			else {
+
+				if(s.area == 0) {
+					blobs[b].start = cv::Point(rect_search.x + x, rect_search.y + y);
+				}
+
+				// on the outer boundary, if a 4-neighbour is not a part of the blob
+				if(blob_of[lab[x - 1]] != b || blob_of[lab[x + 1]] != b ||
+				   blob_of[up[x]] != b      || blob_of[down[x]] != b) {
+					++s.nof_boundary;
+				}
+
+				s.x_min = std::min(s.x_min, x);
+				s.x_max = std::max(s.x_max, x);
+				s.y_min = std::min(s.y_min, y);
+				s.y_max = std::max(s.y_max, y);
+
+			}
+
+			const double xd = rect_search.x + x;
+
+			++s.area;
+			s.x  += xd;
+			s.y  += yd;
+			s.xx += xd * xd;
+			s.xy += xd * yd;
+			s.yy += yd * yd;
+
+		}
+
+	}
+
+
+	/********************************************************************************************
+	 * The statistics, and the contours of the blobs within the limits
+	 ********************************************************************************************/
+
+	for(int b = 0; b < nof_blobs; ++b) {
+
+		const Sums &s = sums[b];
+		Blob &blob = blobs[b];
+
+		blob.area         = s.area;
+		blob.nof_boundary = s.nof_boundary;
+
+		blob.bbox = cv::Rect(rect_search.x + s.x_min,
+		                     rect_search.y + s.y_min,
+		                     s.x_max - s.x_min + 1,
+		                     s.y_max - s.y_min + 1);
+
+		blob.centroid.x = s.x / s.area;
+		blob.centroid.y = s.y / s.area;
+
+		blob.mu20 = s.xx / s.area - blob.centroid.x * blob.centroid.x;
+		blob.mu11 = s.xy / s.area - blob.centroid.x * blob.centroid.y;
+		blob.mu02 = s.yy / s.area - blob.centroid.y * blob.centroid.y;
+
+		/*
+		 * The limits are of the length of the contour, as with
+		 * cv::findContours(). The contour visits each pixel of the outer
+		 * boundary at least once, and the pixels of one pixel wide parts
+		 * twice, so nof_boundary is a lower bound of the length.
+		 */
+		if(blob.nof_boundary > max_boundary ||
+		   blob.area <= min_area) {
+
+			continue;
+
+		}
+
+		clusters.push_back(Cluster());
+		traceContour(b, cv::Point(rect_search.x, rect_search.y), clusters.back());
+
+		const int nof_contour = (int)clusters.back().size();
+
+		if(nof_contour < min_boundary ||
+		   nof_contour > max_boundary) {
+
+			clusters.pop_back();
+			continue;
+
+		}
+
+		ind_clusters.push_back((int)clusters.size() - 1);
+
+		blobs_kept.push_back(blob);
+
+	}
+
+}
+
+
+/*
+ * The border following of Suzuki and Abe, "Topological Structural
+ * Analysis of Digitized Binary Images by Border Following", 1985,
+ * which cv::findContours() implements as well. The trace starts from
+ * the first pixel of the blob, whose left neighbour is background.
+ */
+void Clusteriser::traceContour(int b, const cv::Point &offset, Cluster &contour) const {
+
+	const cv::Point start = blobs[b].start - offset;
+
+	// a pixel of the blob, the edges of the labels are never a part of a blob
+	#define IN_BLOB(X, Y) (blob_of[img_labels.at<int>((Y), (X))] == b)
+
+	// look around the start pixel clockwise, beginning from W
+	int dir = -1;
+	for(int i = 0; i < 8; ++i) {
+
+		const int d = (4 - i) & 7;
+
+		if(IN_BLOB(start.x + DIR_X[d], start.y + DIR_Y[d])) {
+			dir = d;
+			break;
+		}
+
+	}
+
+	// a single pixel
+	if(dir < 0) {
+		contour.push_back(start + offset);
 		return;
 	}
 
-	std::vector<int> tmp_ind(clusters.size());
+	const cv::Point first(start.x + DIR_X[dir], start.y + DIR_Y[dir]);
+
+	cv::Point cur = start;
+
+	// the direction from the current pixel to the previous one
+	int dir_prev = dir;
+
+	while(true) {
+
+		// look around the current pixel counterclockwise, beginning after the previous pixel
+		int d = dir_prev;
+		for(int i = 0; i < 8; ++i) {
+
+			d = (d + 1) & 7;
+
+			if(IN_BLOB(cur.x + DIR_X[d], cur.y + DIR_Y[d])) {
+				break;
+			}
+
+		}
+
+		contour.push_back(cur + offset);
+
+		const cv::Point next(cur.x + DIR_X[d], cur.y + DIR_Y[d]);
+
+		if(next == start && cur == first) {
+			break;
+		}
+
+		cur      = next;
+		dir_prev = (d + 4) & 7;
 
-	for(size_t i = 0; i < tmp_ind.size(); ++i) {
-		tmp_ind[i] = i;
 	}
 
-	// populate the cluster indices
-	for(int idx = 0; idx >= 0; idx = hierarchy[idx][0]) {
-		ind_clusters.push_back(idx);
-		tmp_ind[idx] = -1;
+	#undef IN_BLOB
+
+}
+
+
+void Clusteriser::translate(const cv::Point &offset) {
+
+	if(offset.x == 0 && offset.y == 0) {
+		return;
 	}
 
+	std::vector<Cluster>::iterator it = clusters.begin();
 
-	ind_holes.resize(clusters.size() - ind_clusters.size());
+	for(; it != clusters.end(); ++it) {
 
-	int c = 0;
-	for(size_t i = 0; i < tmp_ind.size(); ++i) {
-		if(tmp_ind[i] != -1) {
-			ind_holes[c++] = tmp_ind[i];
+		Cluster::iterator itPoint = it->begin();
+
+		for(; itPoint != it->end(); ++itPoint) {
+			*itPoint += offset;
 		}
+
+	}
+
+	for(size_t i = 0; i < blobs_kept.size(); ++i) {
+
+		Blob &blob = blobs_kept[i];
+
+		blob.bbox.x     += offset.x;
+		blob.bbox.y     += offset.y;
+		blob.centroid.x += offset.x;
+		blob.centroid.y += offset.y;
+		blob.start      += offset;
+
 	}
 
 }
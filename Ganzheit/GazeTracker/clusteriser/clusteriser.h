@@ -3,6 +3,7 @@
 
 
 #include <string.h>
+#include <limits.h>
 #include <vector>
 
 #include <opencv2/highgui/highgui.hpp>
@@ -16,6 +17,46 @@ namespace gt {
 typedef std::vector<cv::Point> Cluster;
 
 
+/*
+ * The statistics of a blob, i.e. a connected set of non-zero pixels,
+ * in image coordinates. The holes of the blob are included.
+ */
+class Blob {
+
+	public:
+
+		/* The number of pixels */
+		int area;
+
+		/* The number of pixels on the outer boundary */
+		int nof_boundary;
+
+		cv::Rect bbox;
+
+		/* The centre of mass */
+		cv::Point2d centroid;
+
+		/* The second central moments divided by the area */
+		double mu20;
+		double mu11;
+		double mu02;
+
+		/* The first pixel of the blob in raster order, on the outer boundary */
+		cv::Point start;
+
+};
+
+
+/*
+ * Finds the blobs of a binary image with a two-pass union-find
+ * labeller. The blobs are 8-connected and the background 4-connected,
+ * as with cv::findContours(). The holes of the blobs are filled and the
+ * statistics of the blobs computed while resolving the labels.
+ *
+ * Only the blobs within the limits, see setLimits(), are kept and
+ * their outer contours traced. The contours are the same as the
+ * outer contours of cv::findContours() with CV_CHAIN_APPROX_NONE.
+ */
 class Clusteriser {
 
 	public:
@@ -23,26 +64,99 @@ class Clusteriser {
 		Clusteriser();
 		~Clusteriser();
 
-		void clusterise(const cv::Mat &image, const cv::Rect &rect_search);
-
+		/*
+		 * Find the blobs in the rectangle rect_search of the binary
+		 * image. The holes of the blobs are filled with 255 in image.
+		 * As with cv::findContours(), the pixels on the edges of the
+		 * rectangle are treated as background.
+		 */
+		void clusterise(cv::Mat &image, const cv::Rect &rect_search);
+
+		/*
+		 * Keep only the blobs whose outer contour has at least min_boundary
+		 * and at most max_boundary points, and area > min_area. By default
+		 * all blobs are kept.
+		 */
+		void setLimits(int min_boundary, int max_boundary, int min_area);
+
+		/* The outer contours of the blobs that were kept */
 		const std::vector<Cluster> &getClusters() const {
 			return this->clusters;
 		}
 
+		/* The statistics of the blobs that were kept, in the order of getClusters() */
+		const std::vector<Blob> &getBlobs() const {
+			return this->blobs_kept;
+		}
+
+		/* The number of blobs found, including the ones that were not kept */
+		int getNofBlobs() const {return (int)blobs.size();}
+
+		/*
+		 * The holes are filled by clusterise(), so there are no hole
+		 * contours and all clusters are outer contours.
+		 */
 		const std::vector<int> &getHoleIndices() const {return ind_holes;}
 		const std::vector<int> &getClusterIndices() const {return ind_clusters;}
 
-		std::vector<cv::Vec4i> &getHierarchy() {return hierarchy;}
-
 		void clearClusters();
 
+		/* Translate all clusters by the given offset */
+		void translate(const cv::Point &offset);
+
 	private:
 
+		enum {LABEL_BACKGROUND = 0, LABEL_FOREGROUND = 1};
+
+		/* The sums of a blob, collected while resolving the labels */
+		struct Sums {
+			int area;
+			int nof_boundary;
+			int x_min, y_min, x_max, y_max;
+			double x, y, xx, xy, yy;
+		};
+
+		/* Join the sets of the labels a and b, returns the root */
+		int join(int a, int b);
+
+		/* Make a new label of the given kind */
+		int newLabel(unsigned char kind, int enclosing);
+
+		/* Trace the outer contour of the blob b */
+		void traceContour(int b, const cv::Point &offset, Cluster &contour) const;
+
+		/* The label of each pixel of the search rectangle, reused */
+		cv::Mat img_labels;
+
+		/* The union-find forest of the labels */
+		std::vector<int> parent;
+
+		/* LABEL_BACKGROUND or LABEL_FOREGROUND */
+		std::vector<unsigned char> kind;
+
+		/* For background labels, the foreground label above the first pixel */
+		std::vector<int> enclosing;
+
+		/*
+		 * The blob of each label, -1 for the background connected to
+		 * the edges. The holes belong to the enclosing blob.
+		 */
+		std::vector<int> blob_of;
+
+		/* The sums of each blob, reused */
+		std::vector<Sums> sums;
+
+		/* All blobs and the blobs that were kept */
+		std::vector<Blob> blobs;
+		std::vector<Blob> blobs_kept;
+
 		std::vector<Cluster> clusters;
 		std::vector<int> ind_clusters;
 		std::vector<int> ind_holes;
 
-		std::vector<cv::Vec4i> hierarchy;
+		int min_boundary;
+		int max_boundary;
+		int min_area;
 };
 
 
@@ -0,0 +1,243 @@
+/*
+ * Benchmark for gt::Clusteriser.
+ *
+ * The frames of a recording are binarised as in PupilTracker and the
+ * blobs found with the Clusteriser and with the cv::findContours()
+ * based method it replaces: the contours with the holes, the holes
+ * filled with cv::drawContours() and the contours tested with their
+ * sizes and cv::contourArea(). The filled binary images must be
+ * identical. The numbers of the accepted clusters are printed, they
+ * may differ slightly, because the Clusteriser counts the pixels
+ * instead of the area inside the contour.
+ *
+ * Usage: cluster_bench [video] [pupil threshold] [nof frames]
+ *
+ * If no video is given, synthetic eye frames are used.
+ */
+
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+#include <vector>
+
+#include "clusteriser.h"
+#include "Preprocessor.h"
+#include "SyntheticEye.h"
+
+
+static const int FRAME_W            = 640;
+static const int FRAME_H            = 480;
+static const int NOF_FRAMES_DEFAULT = 300;
+static const int TH_PUPIL_DEFAULT   = 40;
+
+/* The defaults of MIN_CLUSTER_SIZE, MAX_CLUSTER_SIZE and MIN_PUPIL_AREA */
+static const int MIN_CLUSTER_SIZE   = 30;
+static const int MAX_CLUSTER_SIZE   = 800;
+static const int MIN_PUPIL_AREA     = 314;
+
+
+static double getMillis(const struct timeval &t1, const struct timeval &t2) {
+    return 1e3 * (t2.tv_sec - t1.tv_sec) + 1e-3 * (t2.tv_usec - t1.tv_usec);
+}
+
+
+/*
+ * Read the frames and binarise them as PupilTracker does
+ */
+static bool readFrames(const char *strVideo, int nFrames, int thPupil, std::vector<cv::Mat> &frames) {
+
+    cv::VideoCapture cap;
+    if(strVideo != NULL && !cap.open(strVideo)) {
+        printf("Could not open %s\n", strVideo);
+        return false;
+    }
+
+    gt::Preprocessor preprocessor;
+    cv::Mat imgCr;
+
+    // a noisy eye with glints in the pupil and some dark spots, moving from frame to frame
+    SyntheticEye eye(FRAME_W, FRAME_H);
+    eye.bgLow       = 130;
+    eye.bgHigh      = 200;
+    eye.ampX        = 60;
+    eye.ampY        = 30;
+    eye.freqY       = 0.7;
+    eye.irisLevel   = 100;
+    eye.pupilAxes   = cv::Size(35, 30);
+    eye.pupilLevel  = 20;
+    eye.nofLashes   = 12;
+    for(int i = 0; i < 6; ++i) {
+        eye.addGlint(cv::Point(-25 + 10 * i, -12 + 6 * (i % 2)), 2);
+    }
+
+    for(int i = 0; i < nFrames; ++i) {
+
+        cv::Mat imgGray;
+
+        if(strVideo != NULL) {
+
+            cv::Mat img;
+            if(!cap.read(img) || img.empty()) {
+                break;
+            }
+
+            if(img.channels() == 3) {
+                cv::cvtColor(img, imgGray, CV_BGR2GRAY);
+            }
+            else {
+                img.copyTo(imgGray);
+            }
+
+        }
+        else {
+            eye.draw(imgGray, i);
+        }
+
+        cv::Mat imgBinary;
+        preprocessor.process(imgGray, cv::Rect(0, 0, imgGray.cols, imgGray.rows), -1, imgCr, thPupil, imgBinary);
+
+        frames.push_back(imgBinary);
+
+    }
+
+    return !frames.empty();
+
+}
+
+
+/*
+ * The method that the Clusteriser replaces. Returns the centres of mass
+ * of the accepted clusters.
+ */
+static void clusteriseContours(cv::Mat &imgBinary, const cv::Rect &rect, cv::Mat &imgTmp, std::vector<cv::Point> &coms) {
+
+    std::vector<std::vector<cv::Point> > contours;
+    std::vector<cv::Vec4i> hierarchy;
+
+    cv::Mat(imgBinary, rect).copyTo(imgTmp);
+    cv::findContours(imgTmp, contours, hierarchy, CV_RETR_CCOMP, CV_CHAIN_APPROX_NONE, cv::Point(rect.x, rect.y));
+
+    coms.clear();
+
+    for(size_t i = 0; i < contours.size(); ++i) {
+
+        // a hole
+        if(hierarchy[i][3] >= 0) {
+            cv::drawContours(imgBinary, contours, (int)i, cv::Scalar(255), CV_FILLED, 8);
+        }
+
+    }
+
+    for(size_t i = 0; i < contours.size(); ++i) {
+
+        if(hierarchy[i][3] >= 0) {
+            continue;
+        }
+
+        const std::vector<cv::Point> &c = contours[i];
+        const int sz = (int)c.size();
+
+        if(sz < MIN_CLUSTER_SIZE || sz > MAX_CLUSTER_SIZE ||
+           cv::contourArea(c) <= MIN_PUPIL_AREA) {
+            continue;
+        }
+
+        // the centre of mass, as PupilTracker computed it
+        int sumX = 0;
+        int sumY = 0;
+        for(int k = 0; k < sz; ++k) {
+            sumX += c[k].x;
+            sumY += c[k].y;
+        }
+
+        coms.push_back(cv::Point((int)((double)sumX / sz + 0.5), (int)((double)sumY / sz + 0.5)));
+
+    }
+
+}
+
+
+static bool equalArea(const cv::Mat &a, const cv::Mat &b, const cv::Rect &rect) {
+
+    for(int y = rect.y; y < rect.y + rect.height; ++y) {
+        if(memcmp(a.ptr<unsigned char>(y) + rect.x, b.ptr<unsigned char>(y) + rect.x, rect.width) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+
+}
+
+
+int main(int argc, char **argv) {
+
+    const char *strVideo = argc > 1 ? argv[1] : NULL;
+    const int thPupil    = argc > 2 ? atoi(argv[2]) : TH_PUPIL_DEFAULT;
+    int nFrames          = argc > 3 ? atoi(argv[3]) : NOF_FRAMES_DEFAULT;
+
+    nFrames = std::max(nFrames, 1);
+
+    std::vector<cv::Mat> frames;
+    if(!readFrames(strVideo, nFrames, thPupil, frames)) {
+        printf("No frames\n");
+        return -1;
+    }
+
+    const cv::Rect rect(0, 0, frames[0].cols, frames[0].rows);
+
+    gt::Clusteriser clusteriser;
+    clusteriser.setLimits(MIN_CLUSTER_SIZE, MAX_CLUSTER_SIZE, MIN_PUPIL_AREA);
+
+    cv::Mat imgRef, imgNew, imgTmp;
+    std::vector<cv::Point> coms;
+
+    double dMillisRef = 0.0;
+    double dMillis    = 0.0;
+
+    int nAcceptedRef = 0;
+    int nAccepted    = 0;
+    int nBlobs       = 0;
+    int nDiffers     = 0;
+
+    for(size_t i = 0; i < frames.size(); ++i) {
+
+        struct timeval t1, t2;
+
+        frames[i].copyTo(imgRef);
+        gettimeofday(&t1, NULL);
+        clusteriseContours(imgRef, rect, imgTmp, coms);
+        gettimeofday(&t2, NULL);
+        dMillisRef += getMillis(t1, t2);
+
+        nAcceptedRef += (int)coms.size();
+
+        frames[i].copyTo(imgNew);
+        gettimeofday(&t1, NULL);
+        clusteriser.clusterise(imgNew, rect);
+        gettimeofday(&t2, NULL);
+        dMillis += getMillis(t1, t2);
+
+        nAccepted += (int)clusteriser.getClusters().size();
+        nBlobs    += clusteriser.getNofBlobs();
+
+        if(!equalArea(imgRef, imgNew, rect)) {
+            ++nDiffers;
+        }
+
+    }
+
+    const int n = (int)frames.size();
+
+    printf("%d frames %dx%d, %.1f blobs/frame\n", n, rect.width, rect.height, (double)nBlobs / n);
+    printf("findContours %7.3f ms/frame   accepted %d\n", dMillisRef / n, nAcceptedRef);
+    printf("Clusteriser  %7.3f ms/frame   accepted %d   x%4.2f\n", dMillis / n, nAccepted, dMillisRef / dMillis);
+    printf("filled images: %s (%d differ)\n", nDiffers == 0 ? "OK" : "DIFFER", nDiffers);
+
+    return nDiffers == 0 ? 0 : 1;
+
+}
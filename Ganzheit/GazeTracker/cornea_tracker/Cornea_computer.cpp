@@ -1,14 +1,20 @@
 #include <math.h>
 #include <stdlib.h>
 #include "Cornea_computer.h"
+#include "LevenbergMarquardt.h"
 #include "trackerSettings.h"
 #include <stdio.h>
+#include <algorithm>
+
+#include <gsl/gsl_vector.h>
+#include <gsl/gsl_matrix.h>
+#include <gsl/gsl_multifit_nlin.h>
 
 
 namespace gt {
 
 
-    static const unsigned int MAX_ITER = 1000;
+    static const int MAX_ITER          = 1000;
     static const double PRECISION      = 0.000000000001;
 
 
@@ -16,10 +22,15 @@ namespace gt {
     static double POW2(double x) {return x*x;}
 
 
-    // when using the solver
-    static int my_fdf(const gsl_vector *x, void *param, gsl_vector *ret_vec, gsl_matrix *ret_mat);
-    static int my_df(const gsl_vector *x, void *param, gsl_matrix *ret);
-    static int my_f(const gsl_vector *x, void *param, gsl_vector *ret);
+    Cornea::Cornea() {
+        m_dRho = trackerSettings.RHO;
+        m_bFixedSizeSolver = false;
+    }
+
+
+    void Cornea::setSettings(const TrackerSettings &settings) {
+        m_dRho = settings.RHO;
+    }
 
 
     inline int pairsOfTwo(int a) {
@@ -113,44 +124,103 @@ namespace gt {
     }
 
 
-    int Cornea::computeCentre(const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> > &led_pos, // LED locations
-                              const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> > &glint_pos,
-                              std::vector<double> &gx_guesses,
-                              Eigen::Vector3d &centre,
-                              double &err) {
+    template<int N>
+    int Cornea::solve(std::vector<double> &gx, double &err) const {
 
-        // initialise the cornea tracker
-        create(led_pos, glint_pos);
+        typedef LevenbergMarquardt<N, 3 * N * (N - 1) / 2> Solver;
 
-        /*
-         * Check out usage and more info about GSL:
-         * http://www.csse.uwa.edu.au/programming/gsl-1.0/gsl-ref_35.html
-         */
+        typename Solver::Params x;
+        for(int i = 0; i < N; ++i) {
+            x(i) = gx[i];
+        }
+
+        typename Solver::Square covar;
+        const int iter = Solver::solve(*this, x, PRECISION, MAX_ITER, covar);
+
+        if(iter == MAX_ITER) {
+            printf("Cornea::computeCentre(): iter = MAX_ITER\n");
+        }
+
+        for(int i = 0; i < N; ++i) {
+            gx[i] = x(i);
+        }
+
+        /***********************************************************************
+         * Compute the fit error
+         **********************************************************************/
+        err = std::sqrt(covar.trace());
 
-        const size_t n = 3 * pairsOfTwo(data.size());	// number of functions
-        const size_t p = gx_guesses.size();				// number of parameters
+        return iter;
 
-        // initial guesses
-        gsl_vector_const_view x = gsl_vector_const_view_array(gx_guesses.data(), p);
+    }
+
+
+    /*
+     * The callbacks of the GSL solver. The vectors and the matrix are
+     * allocated by the solver and contiguous, see solveGSL().
+     */
+    static int my_f(const gsl_vector *x, void *params, gsl_vector *F) {
+
+        const Cornea *c = (const Cornea *)params;
+        c->createF(x->data, F->data);
+
+        return GSL_SUCCESS;
+
+    }
+
+
+    static int my_df(const gsl_vector *x, void *params, gsl_matrix *J) {
+
+        const Cornea *c = (const Cornea *)params;
+        c->createJacobian(x->data, J->data);
+
+        return GSL_SUCCESS;
+
+    }
+
+
+    static int my_fdf(const gsl_vector *x, void *params, gsl_vector *F, gsl_matrix *J) {
+
+        my_f(x, params, F);
+        my_df(x, params, J);
+
+        return GSL_SUCCESS;
+
+    }
+
+
+    int Cornea::solveGSL(std::vector<double> &gx, double &err) const {
+
+        const size_t p = data.size();
+        const size_t n = 3 * pairsOfTwo(p);
+
+        gsl_vector_const_view x = gsl_vector_const_view_array(&gx[0], p);
 
         gsl_multifit_function_fdf f;
-        f.f			= &my_f;	// function
-        f.df		= &my_df;	// derivative
-        f.fdf		= &my_fdf;	// both
-        f.n			= n;		// number of functions
-        f.p			= p;		// number of parameters
-        f.params	= this;		// additional parameter
-
-        const gsl_multifit_fdfsolver_type *T = gsl_multifit_fdfsolver_lmsder;
-        gsl_multifit_fdfsolver *solver = gsl_multifit_fdfsolver_alloc(T, n, p);
+        f.f      = &my_f;
+        f.df     = &my_df;
+        f.fdf    = &my_fdf;
+        f.n      = n;
+        f.p      = p;
+        f.params = (void *)this;
+
+        gsl_multifit_fdfsolver *solver = gsl_multifit_fdfsolver_alloc(gsl_multifit_fdfsolver_lmsder, n, p);
         gsl_multifit_fdfsolver_set(solver, &f, &x.vector);
 
+        // createF() and createJacobian() write to the data pointers directly
+        if(solver->x->stride != 1 || solver->f->stride != 1 || solver->J->tda != p) {
+            printf("Cornea::solveGSL(): the solver's vectors are not contiguous\n");
+            gsl_multifit_fdfsolver_free(solver);
+            err = 0.0;
+            return -1;
+        }
 
         int status;
-        unsigned int iter = 0;
+        int iter = 0;
 
         do {
-            iter++;
+
+            ++iter;
             status = gsl_multifit_fdfsolver_iterate(solver);
 
             if(status) {
@@ -166,42 +236,96 @@ namespace gt {
             printf("Cornea::computeCentre(): iter = MAX_ITER\n");
         }
 
-
-        gsl_matrix *covar = gsl_matrix_alloc(p, p);
-        gsl_multifit_covar(solver->J, 0.0, covar);
-
-        // for(int row = 0; row < p; ++row) {
-        //     for(int col = 0; col < p; ++col) {
-        //         printf("%.2f ", covar->data[row * p + col]);
-        //     }
-        //     printf("\n");
-        // }
-        // printf("*****************************\n");
-
         /***********************************************************************
          * Compute the fit error
          **********************************************************************/
+        gsl_matrix *covar = gsl_matrix_alloc(p, p);
+        gsl_multifit_covar(solver->J, 0.0, covar);
 
-        err = 0;
-        for(size_t i = 0; i < p; i++) {
+        err = 0.0;
+        for(size_t i = 0; i < p; ++i) {
             err += gsl_matrix_get(covar, i, i);
+            gx[i] = gsl_vector_get(solver->x, i);
+        }
+        err = sqrt(err);
+
+        gsl_multifit_fdfsolver_free(solver);
+        gsl_matrix_free(covar);
+
+        return iter;
+
+    }
+
+
+    int Cornea::computeCentre(const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> > &led_pos, // LED locations
+                              const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> > &glint_pos,
+                              std::vector<double> &gx_guesses,
+                              Eigen::Vector3d &centre,
+                              double &err) {
+
+        // initialise the cornea tracker
+        create(led_pos, glint_pos);
+
+        if(data.size() < 2) {
+            printf("Cornea::computeCentre(): %d glints, must be at least 2\n", (int)data.size());
+            centre.setZero();
+            err = 0.0;
+            return -1;
+        }
+
+        int iter;
+
+        if(!m_bFixedSizeSolver) {
+
+            iter = solveGSL(gx_guesses, err);
+
+            if(iter < 0) {
+                centre.setZero();
+                return -1;
+            }
+
+            getCentre(gx_guesses, centre);
+
+            return iter;
+
         }
-        err = std::sqrt(err);
 
+        /*
+         * The number of glints is a template parameter of the solver, so
+         * that its matrices can be allocated from the stack
+         */
+        switch(data.size()) {
+            case 2: iter = solve<2>(gx_guesses, err); break;
+            case 3: iter = solve<3>(gx_guesses, err); break;
+            case 4: iter = solve<4>(gx_guesses, err); break;
+            case 5: iter = solve<5>(gx_guesses, err); break;
+            case 6: iter = solve<6>(gx_guesses, err); break;
+            default:
+                printf("Cornea::computeCentre(): %d glints, must be 2 - 6\n", (int)data.size());
+                centre.setZero();
+                err = 0.0;
+                return -1;
+        }
+
+        getCentre(gx_guesses, centre);
+
+        return iter;
+
+    }
+
+
+    void Cornea::getCentre(const std::vector<double> &gx, Eigen::Vector3d &centre) const {
 
         Eigen::Vector3d cw(0.0, 0.0, 0.0);
 
         // cornea sphere radius
-        const double RHO = trackerSettings.RHO;
-
-        // remove this
-        double dMaxX = -10.0;
+        const double RHO = m_dRho;
 
         for(size_t i = 0; i < data.size(); ++i) {
 
             const DATA_FOR_CORNEA_COMPUTATION &cur_data = data[i];
 
-            const double gx_guess = gsl_vector_get(solver->x, i);
+            const double gx_guess = gx[i];
 
             const double B_aux = atan2(gx_guess * tan(cur_data.alpha_aux), (cur_data.l_aux - gx_guess));
 
@@ -216,10 +340,6 @@ namespace gt {
             cw(1) += tmp(1);
             cw(2) += tmp(2);
 
-            if(tmp(0) > dMaxX) {
-                dMaxX = tmp(0);
-            }
-
             //        printf("%i: centre (mm): %.2f %.2f %.2f\n", (int)i, 1000.0*tmp(0), 1000.0*tmp(1), 1000.0*tmp(2));
 
         }
@@ -231,16 +351,11 @@ namespace gt {
         // printf("Avg: %.2f %.2f %.2f\n", 1000.0*centre(0), 1000.0*centre(1), 1000.0*centre(2));
         // printf("*********************************\n");
 
-        gsl_multifit_fdfsolver_free(solver);
-        gsl_matrix_free(covar);
-
-        return (int)iter;
-
     }
 
 
     // see "computation_of_the_gaze.odt"
-    void Cornea::createF(const gsl_vector *x, gsl_vector *F) const {
+    void Cornea::createF(const double *x, double *F) const {
 
         // number of LEDs
         const int nLEDs = data.size();
@@ -248,14 +363,14 @@ namespace gt {
         // index for F
         int index_f = 0;
 
-        const double RHO = trackerSettings.RHO;
+        const double RHO = m_dRho;
 
         /*
          * For each LED pair, there are 3 functions
          */
         for(int i = 0; i < nLEDs-1; ++i) {
 
-            const double gx_guess1 = gsl_vector_get(x, i);
+            const double gx_guess1 = x[i];
 
             const DATA_FOR_CORNEA_COMPUTATION &data1 = data[i];
 
@@ -275,7 +390,7 @@ namespace gt {
 
             for(int j = i + 1; j < nLEDs; ++j) {
 
-                const double gx_guess2 = gsl_vector_get(x, j);
+                const double gx_guess2 = x[j];
 
                 const DATA_FOR_CORNEA_COMPUTATION &data2 = data[j];
 
@@ -294,9 +409,9 @@ namespace gt {
                 const double D3 = data2.R(2, 2) * (gx_guess2 * tan_a2 + RHO * cos_res2);
 
                 // assign the values
-                gsl_vector_set(F, index_f,     A1 + B1 -C1 -D1);
-                gsl_vector_set(F, index_f + 1, A2 + B2 -C2 -D2);
-                gsl_vector_set(F, index_f + 2, A3 + B3 -C3 -D3);
+                F[index_f]     = A1 + B1 -C1 -D1;
+                F[index_f + 1] = A2 + B2 -C2 -D2;
+                F[index_f + 2] = A3 + B3 -C3 -D3;
 
                 index_f += 3;
 
@@ -307,10 +422,9 @@ namespace gt {
     }
 
 
-    void Cornea::createJacobian(const gsl_vector *gx,
-                                gsl_matrix *J) const { // x x y Jacobian matrix
+    void Cornea::createJacobian(const double *gx, double *J) const { // x x y Jacobian matrix, row-major
 
-        const double RHO = trackerSettings.RHO;
+        const double RHO = m_dRho;
 
         int ind_J = 0;
 
@@ -318,17 +432,13 @@ namespace gt {
         const size_t rows     = 3*pairsOfTwo(nLEDs);
 
         // zero the Jacobian matrix
-        for(size_t row = 0; row < rows; ++row) {
-            for(size_t col = 0; col < nLEDs; ++col) {
-                gsl_matrix_set(J, row, col, 0.0);
-            }
-        }
+        std::fill(J, J + rows * nLEDs, 0.0);
 
 
         for(size_t x = 0; x < nLEDs - 1; ++x) {
 
             const DATA_FOR_CORNEA_COMPUTATION &data1 = data[x];
-            const double gx_guess1 = gsl_vector_get(gx, x);
+            const double gx_guess1 = gx[x];
             const double tan_a1    = tan(data1.alpha_aux);
             const double a1        = gx_guess1 * tan_a1 / (data1.l_aux - gx_guess1);
             const double atan_res1 = atan2(gx_guess1 * tan_a1, data1.l_aux - gx_guess1);
@@ -365,7 +475,7 @@ namespace gt {
             for(size_t y = x + 1; y < nLEDs; ++y) {
 
                 const DATA_FOR_CORNEA_COMPUTATION &data2 = data[y];
-                const double gx_guess2 = gsl_vector_get(gx, y);
+                const double gx_guess2 = gx[y];
                 const double tan_a2    = tan(data2.alpha_aux);
                 const double a2        = gx_guess2 * tan_a2 / (data2.l_aux - gx_guess2);
                 const double atan_res2 = atan2(gx_guess2 * tan_a2, data2.l_aux - gx_guess2);
@@ -397,8 +507,8 @@ namespace gt {
                      * i.e. no other LED affects the jacobian in this row than
                      * one of the the LEDs in the pair in question.
                      */
-                    gsl_matrix_set(J, ind_J, x, dA_plus_dB[i]);
-                    gsl_matrix_set(J, ind_J, y, -dC - dD);
+                    J[ind_J * nLEDs + x] = dA_plus_dB[i];
+                    J[ind_J * nLEDs + y] = -dC - dD;
 
                     ++ind_J;
 
@@ -412,54 +522,5 @@ namespace gt {
 
 
 
-    /*************************************************************
-     * GLS callbacks
-     *************************************************************/
-
-    int my_f(const gsl_vector *x, void *param, gsl_vector *F) {
-
-        // get a pointer to the Cornea object
-        const Cornea *c = (const Cornea *)param;
-
-        c->createF(x, F);
-
-        return GSL_SUCCESS;
-    }
-
-
-    int my_df(const gsl_vector *x, void *param, gsl_matrix *J) {
-
-        // get a pointer to the Cornea object
-        const Cornea *c = (const Cornea *)param;
-
-        c->createJacobian(x, J);
-
-
-        return GSL_SUCCESS;
-    }
-
-
-    /* Compute both F and dF */
-    int my_fdf(const gsl_vector *x, void *param, gsl_vector *F, gsl_matrix *J) {
-
-        // get a pointer to the Cornea object
-        const Cornea *c = (const Cornea *)param;
-
-        /****************************************************
-         * F
-         ****************************************************/
-        c->createF(x, F);
-
-
-        /****************************************************
-         * dF
-         ****************************************************/
-        c->createJacobian(x, J);
-
-
-        return GSL_SUCCESS;
-    }
-
-
 }    // end of "namespace gt"
 
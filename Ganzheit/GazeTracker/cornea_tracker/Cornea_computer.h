@@ -18,20 +18,10 @@
 #include <stdlib.h>
 #include <math.h>
 
+#include <vector>
 
-#include <gsl/gsl_vector.h>
-#include <gsl/gsl_matrix.h>
-#include <gsl/gsl_test.h>
-#include <gsl/gsl_multiroots.h>
-#include <gsl/gsl_multimin.h>
-
-#include <gsl/gsl_rng.h>
-#include <gsl/gsl_randist.h>
-#include <gsl/gsl_vector.h>
-#include <gsl/gsl_blas.h>
-#include <gsl/gsl_multifit_nlin.h>
 
-#include <vector>
+class TrackerSettings;
 
 
 namespace gt {
@@ -68,17 +58,48 @@ namespace gt {
 
     public:
 
-        Cornea() {}
+        /* Uses the cornea radius of the global trackerSettings */
+        Cornea();
+
+        /* Use the cornea radius, RHO, of the given settings */
+        void setSettings(const TrackerSettings &settings);
+
+        /*
+         * Solve with the fixed-size Levenberg-Marquardt solver of
+         * LevenbergMarquardt.h instead of the GSL lmsder solver. The
+         * solver damps the step as Nielsen does, not with the scaled trust
+         * region of lmsder, so the iterations and the errors may differ.
+         * Off by default, until tests/cornea_lm has been run against GSL.
+         */
+        void setFixedSizeSolver(bool b) {m_bFixedSizeSolver = b;}
+
+        bool isFixedSizeSolver() const {return m_bFixedSizeSolver;}
 
+        /*
+         * Solve the cornea centre from 2 or more glints, at most 6 with the
+         * fixed-size solver. gx_guesses are the initial guesses of the
+         * unknowns, one for each glint, and they are replaced with the
+         * solution, so that the solution can be used as the guesses of the
+         * next frame. err is the square root of the trace of the
+         * covariance. Returns the number of iterations, or -1 if the number
+         * of glints is not supported.
+         */
         int computeCentre(const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> > &led_pos, // LED locations
                           const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> > &glint_pos,
                           std::vector<double> &gx_guesses,
                           Eigen::Vector3d &centre,
                           double &err);
 
+        /*
+         * The cornea centre for the unknowns gx of the glints given to the
+         * last computeCentre(). computeCentre() calls this with its solution.
+         */
+        void getCentre(const std::vector<double> &gx, Eigen::Vector3d &centre) const;
+
         /*
          * The number of LEDs determines the number of equations, i.e. the
-         * length of F vector. The LED pair count can be obtained by:
+         * length of F vector. x has an unknown for each LED. The LED pair
+         * count can be obtained by:
          *
          *     p = {i=1, 2, .., N-1} sum(N-i)
          *     where N is the LED count
@@ -89,7 +110,7 @@ namespace gt {
          * the length of F is 18.
          *
          */
-        void createF(const gsl_vector *x, gsl_vector *F) const;
+        void createF(const double *x, double *F) const;
 
         /*
          * The Jacobian matrix is matrix with the same number of rows as F has
@@ -100,9 +121,9 @@ namespace gt {
          *     rows = 3*p = 3*6 = 18
          *     columns = N = 4
          *
+         * J is stored in row-major order.
          */
-        void createJacobian(const gsl_vector *gx,
-                            gsl_matrix *J) const;
+        void createJacobian(const double *gx, double *J) const;
 
 
         size_t getNofData() const {return data.size();}
@@ -116,6 +137,16 @@ namespace gt {
         void operator=(const Cornea &other);
 
 
+        /*
+         * Solve the unknowns of N glints with LevenbergMarquardt, gx are
+         * the initial guesses and the solution
+         */
+        template<int N>
+        int solve(std::vector<double> &gx, double &err) const;
+
+        /* As solve(), with the GSL lmsder solver, for any number of glints */
+        int solveGSL(std::vector<double> &gx, double &err) const;
+
         void create(const std::vector<Eigen::Vector3d,
                     Eigen::aligned_allocator<Eigen::Vector3d> > &led_pos,    // LED locations
                     const std::vector<Eigen::Vector3d,
@@ -133,6 +164,11 @@ namespace gt {
 
         std::vector<DATA_FOR_CORNEA_COMPUTATION> data;
 
+        /* Cornea sphere radius */
+        double m_dRho;
+
+        bool m_bFixedSizeSolver;
+
     };
 
 }    // end of "namespace gt"
@@ -0,0 +1,168 @@
+#ifndef LEVENBERG_MARQUARDT_H
+#define LEVENBERG_MARQUARDT_H
+
+
+#include <Eigen/Core>
+#include <Eigen/Cholesky>
+#include <Eigen/LU>
+
+#include <math.h>
+#include <algorithm>
+
+
+namespace gt {
+
+    /*
+     * A Levenberg-Marquardt solver for NF functions of NP parameters. All
+     * matrices have fixed sizes, so nothing is allocated from the heap.
+     *
+     * The damping is updated as in
+     * H.B. Nielsen, "Damping Parameter in Marquardt's Method", 1999.
+     *
+     * The functor must have the members
+     *
+     *     void createF(const double *x, double *F) const;
+     *     void createJacobian(const double *x, double *J) const;
+     *
+     * where F has NF elements and J is NF x NP, in row-major order.
+     */
+    template<int NP, int NF>
+    class LevenbergMarquardt {
+
+    public:
+
+        typedef Eigen::Matrix<double, NP, 1>                  Params;
+        typedef Eigen::Matrix<double, NF, 1>                  Residuals;
+        typedef Eigen::Matrix<double, NF, NP, Eigen::RowMajor> Jacobian;
+        typedef Eigen::Matrix<double, NP, NP>                 Square;
+
+        /*
+         * Minimise |F(x)|^2 starting from x. An iteration ends with an
+         * accepted step. The solver stops when the step is smaller than
+         * precision + precision * |x| for all parameters, as with
+         * gsl_multifit_test_delta(), when no step decreases |F(x)| or
+         * after max_iter iterations.
+         *
+         * covar is the covariance (J^T J)^-1 at the solution.
+         *
+         * Returns the number of iterations.
+         */
+        template<class Functor>
+        static int solve(const Functor &f,
+                         Params &x,
+                         double precision,
+                         int max_iter,
+                         Square &covar) {
+
+            Residuals F;
+            Residuals F_new;
+            Jacobian J;
+
+            f.createF(x.data(), F.data());
+            f.createJacobian(x.data(), J.data());
+
+            Square A = J.transpose() * J;
+            Params g = J.transpose() * F;
+
+            double cost = F.squaredNorm();
+
+            double mu = INITIAL_DAMPING * A.diagonal().maxCoeff();
+            double nu = 2.0;
+
+            int iter = 0;
+
+            while(iter < max_iter) {
+
+                ++iter;
+
+                bool b_accepted  = false;
+                bool b_converged = false;
+
+                for(int i = 0; i < MAX_TRIES; ++i) {
+
+                    Square A_damped = A;
+                    A_damped.diagonal().array() += mu;
+
+                    const Params h = A_damped.ldlt().solve(-g);
+
+                    if(isSmall(h, x, precision)) {
+                        b_converged = true;
+                        break;
+                    }
+
+                    const Params x_new = x + h;
+                    f.createF(x_new.data(), F_new.data());
+
+                    const double cost_new = F_new.squaredNorm();
+
+                    // the decrease predicted by the linear model
+                    const double predicted = h.dot(mu * h - g);
+
+                    const double rho = (cost - cost_new) / predicted;
+
+                    if(predicted > 0.0 && rho > 0.0) {
+
+                        x    = x_new;
+                        F    = F_new;
+                        cost = cost_new;
+
+                        f.createJacobian(x.data(), J.data());
+
+                        A = J.transpose() * J;
+                        g = J.transpose() * F;
+
+                        const double t = 2.0 * rho - 1.0;
+                        mu *= std::max(1.0 / 3.0, 1.0 - t * t * t);
+                        nu = 2.0;
+
+                        b_accepted  = true;
+                        b_converged = isSmall(h, x, precision);
+                        break;
+
+                    }
+
+                    mu *= nu;
+                    nu *= 2.0;
+
+                }
+
+                if(b_converged || !b_accepted) {
+                    break;
+                }
+
+            }
+
+            covar = A.inverse();
+
+            return iter;
+
+        }
+
+    private:
+
+        enum {MAX_TRIES = 32};
+
+        static const double INITIAL_DAMPING;
+
+        static bool isSmall(const Params &h, const Params &x, double precision) {
+
+            for(int i = 0; i < NP; ++i) {
+                if(fabs(h(i)) >= precision + precision * fabs(x(i))) {
+                    return false;
+                }
+            }
+
+            return true;
+
+        }
+
+    };
+
+
+    template<int NP, int NF>
+    const double LevenbergMarquardt<NP, NF>::INITIAL_DAMPING = 1e-3;
+
+
+}    // end of "namespace gt"
+
+#endif
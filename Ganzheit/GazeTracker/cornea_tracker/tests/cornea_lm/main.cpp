@@ -0,0 +1,217 @@
+/*
+ * Test and benchmark for the Levenberg-Marquardt solver of
+ * gt::Cornea::computeCentre().
+ *
+ * The glints of six LEDs are computed for a moving cornea, some of the
+ * glints are dropped and noise is added. The cornea centre is solved
+ * with the fixed-size solver, see gt::Cornea::setFixedSizeSolver(), and
+ * with the GSL solver, which is the default. The centres and the errors
+ * must agree within MAX_CENTRE_DIFF and MAX_ERR_DIFF. The iteration
+ * counts are compared and the durations printed.
+ *
+ * Usage: cornea_lm [nof frames]
+ */
+
+#include <Eigen/StdVector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <sys/time.h>
+#include <vector>
+#include <algorithm>
+
+#include "Cornea_computer.h"
+#include "trackerSettings.h"
+
+
+typedef std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> > Vec3dVector;
+
+
+static const int NOF_FRAMES_DEFAULT    = 2000;
+static const int NOF_LEDS              = 6;
+static const double GLINT_NOISE        = 0.0002;
+
+/* The centres may differ this much, in metres */
+static const double MAX_CENTRE_DIFF    = 1e-6;
+
+/* The errors may differ this much, relative to the error of GSL */
+static const double MAX_ERR_DIFF       = 1e-3;
+
+
+static double getMillis(const struct timeval &t1, const struct timeval &t2) {
+    return 1e3 * (t2.tv_sec - t1.tv_sec) + 1e-3 * (t2.tv_usec - t1.tv_usec);
+}
+
+
+/*
+ * The glint direction of the LED on a cornea sphere. The normal at the
+ * glint halves the angle between the camera and the LED, the camera
+ * is at the origin.
+ */
+static Eigen::Vector3d makeGlint(const Eigen::Vector3d &centre, double rho, const Eigen::Vector3d &led) {
+
+    Eigen::Vector3d n(0.0, 0.0, -1.0);
+
+    for(int i = 0; i < 200; ++i) {
+
+        const Eigen::Vector3d g = centre + rho * n;
+        n = ((-g).normalized() + (led - g).normalized()).normalized();
+
+    }
+
+    return (centre + rho * n).normalized();
+
+}
+
+
+static double noise() {
+    return GLINT_NOISE * (2.0 * rand() / (double)RAND_MAX - 1.0);
+}
+
+
+int main(int argc, char **argv) {
+
+    int nFrames = argc > 1 ? atoi(argv[1]) : NOF_FRAMES_DEFAULT;
+    nFrames = nFrames > 0 ? nFrames : 1;
+
+    srand(1);
+
+    // the six-LED pattern in metres, around the camera
+    Vec3dVector leds(NOF_LEDS);
+    leds[0] = Eigen::Vector3d( 0.000, -0.020, 0.005);
+    leds[1] = Eigen::Vector3d(-0.018, -0.010, 0.005);
+    leds[2] = Eigen::Vector3d(-0.018,  0.010, 0.005);
+    leds[3] = Eigen::Vector3d( 0.000,  0.020, 0.005);
+    leds[4] = Eigen::Vector3d( 0.018,  0.010, 0.005);
+    leds[5] = Eigen::Vector3d( 0.018, -0.010, 0.005);
+
+    gt::Cornea cornea;
+    cornea.setFixedSizeSolver(true);
+
+    gt::Cornea corneaGSL;
+    const double rho = trackerSettings.RHO;
+
+    // the solution of the last frame for each LED, as GazeTracker keeps it
+    double gx_previous[NOF_LEDS] = {0.0};
+
+    double dMillisLM   = 0.0;
+    double dMillisWarm = 0.0;
+    double dMillisGSL  = 0.0;
+
+    long nIterLM   = 0;
+    long nIterWarm = 0;
+    long nIterGSL  = 0;
+
+    double dMaxDiff    = 0.0;
+    double dMaxErrDiff = 0.0;
+    double dMaxTruth   = 0.0;
+
+    int nMaxIterDiff   = 0;
+
+    for(int frame = 0; frame < nFrames; ++frame) {
+
+        const Eigen::Vector3d centre_true(0.004 * sin(frame * 0.05),
+                                          0.003 * cos(frame * 0.07),
+                                          0.035 + 0.002 * sin(frame * 0.03));
+
+        // drop some of the glints every third frame
+        Vec3dVector led_pos;
+        Vec3dVector glint_pos;
+        std::vector<int> labels;
+
+        for(int i = 0; i < NOF_LEDS; ++i) {
+
+            if(frame % 3 == 0 && rand() % 3 == 0 && (int)labels.size() + NOF_LEDS - i > 2) {
+                continue;
+            }
+
+            const Eigen::Vector3d g = makeGlint(centre_true, rho, leds[i]);
+
+            led_pos.push_back(leds[i]);
+            glint_pos.push_back(Eigen::Vector3d(g(0) + noise(), g(1) + noise(), g(2) + noise()));
+            labels.push_back(i);
+
+        }
+
+        const size_t nof_glints = labels.size();
+
+        struct timeval t1, t2;
+        Eigen::Vector3d centre_lm, centre_warm, centre_gsl;
+        double err_lm, err_warm, err_gsl;
+
+
+        /*************************************************************
+         * Warm start from the last frame
+         *************************************************************/
+        std::vector<double> gx_warm(nof_glints);
+        for(size_t i = 0; i < nof_glints; ++i) {
+            gx_warm[i] = gx_previous[labels[i]];
+        }
+
+        gettimeofday(&t1, NULL);
+        nIterWarm += cornea.computeCentre(led_pos, glint_pos, gx_warm, centre_warm, err_warm);
+        gettimeofday(&t2, NULL);
+        dMillisWarm += getMillis(t1, t2);
+
+        for(int i = 0; i < NOF_LEDS; ++i) {
+            gx_previous[i] = 0.0;
+        }
+        for(size_t i = 0; i < nof_glints; ++i) {
+            gx_previous[labels[i]] = gx_warm[i];
+        }
+
+
+        /*************************************************************
+         * The guesses 0, as the GSL solver is started
+         *************************************************************/
+        std::vector<double> gx_lm(nof_glints, 0.0);
+
+        gettimeofday(&t1, NULL);
+        const int nIter = cornea.computeCentre(led_pos, glint_pos, gx_lm, centre_lm, err_lm);
+        nIterLM += nIter;
+        gettimeofday(&t2, NULL);
+        dMillisLM += getMillis(t1, t2);
+
+
+        /*************************************************************
+         * GSL
+         *************************************************************/
+        std::vector<double> gx_gsl(nof_glints, 0.0);
+
+        gettimeofday(&t1, NULL);
+        const int nIterGSL1 = corneaGSL.computeCentre(led_pos, glint_pos, gx_gsl, centre_gsl, err_gsl);
+        nIterGSL += nIterGSL1;
+        gettimeofday(&t2, NULL);
+        dMillisGSL += getMillis(t1, t2);
+
+
+        const double dDiff = std::max((centre_lm - centre_gsl).norm(), (centre_warm - centre_gsl).norm());
+
+        if(dDiff > dMaxDiff) {
+            dMaxDiff = dDiff;
+        }
+
+        if(fabs(err_lm - err_gsl) / err_gsl > dMaxErrDiff) {
+            dMaxErrDiff = fabs(err_lm - err_gsl) / err_gsl;
+        }
+
+        nMaxIterDiff = std::max(nMaxIterDiff, abs(nIter - nIterGSL1));
+
+        if((centre_gsl - centre_true).norm() > dMaxTruth) {
+            dMaxTruth = (centre_gsl - centre_true).norm();
+        }
+
+    }
+
+    printf("%d frames, the largest error of the centre %.3f mm\n", nFrames, 1e3 * dMaxTruth);
+    printf("GSL solver    %8.4f ms/frame  %5.2f iterations/frame\n", dMillisGSL / nFrames, nIterGSL / (double)nFrames);
+    printf("LM            %8.4f ms/frame  %5.2f iterations/frame\n", dMillisLM / nFrames, nIterLM / (double)nFrames);
+    printf("LM warm start %8.4f ms/frame  %5.2f iterations/frame\n", dMillisWarm / nFrames, nIterWarm / (double)nFrames);
+    printf("centres differ at most %.3g mm, errors %.3g %%, iterations %d\n", 1e3 * dMaxDiff, 100.0 * dMaxErrDiff, nMaxIterDiff);
+
+    const bool bOk = dMaxDiff <= MAX_CENTRE_DIFF && dMaxErrDiff <= MAX_ERR_DIFF;
+    printf("%s\n", bOk ? "OK" : "FAILED");
+
+    return bOk ? 0 : 1;
+
+}
@@ -62,6 +62,7 @@ namespace gt {
         leds.resize(6);
         for(int i = 0; i < 6; ++i) {
             leds[i].setPos(positions[i]);
+            gx_previous[i] = 0.0;
         }
 
     }
@@ -158,6 +159,7 @@ namespace gt {
     void GazeTracker::SixLEDs::getCorneaCentre(Cornea *cornea, cv::Point3d &centreCornea) {
 
         std::vector<double> guesses;
+        std::vector<int> labels;
         std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> > glint_pos;
         std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> > led_pos;
 
@@ -168,7 +170,9 @@ namespace gt {
                 continue;
             }
 
-            guesses.push_back(0);
+            // warm start from the last frame
+            guesses.push_back(gx_previous[i]);
+            labels.push_back(i);
             Eigen::Vector3d eigGlint(gl->x, gl->y, gl->z);
             glint_pos.push_back(eigGlint);
 
@@ -179,7 +183,24 @@ namespace gt {
 
         double error;
         Eigen::Vector3d eigCentre;
-        cornea->computeCentre(led_pos, glint_pos, guesses, eigCentre, error);
+        const int iter = cornea->computeCentre(led_pos, glint_pos, guesses, eigCentre, error);
+
+        /*
+         * The solution is the guess of the next frame, if it is valid. The
+         * unknowns are distances towards the LEDs, so a valid one is between
+         * the camera and the LED, and NaN is not.
+         */
+        for(int i = 0; i < 6; ++i) {
+            gx_previous[i] = 0.0;
+        }
+
+        if(iter >= 0) {
+            for(size_t i = 0; i < labels.size(); ++i) {
+                if(guesses[i] > 0.0 && guesses[i] < led_pos[i].norm()) {
+                    gx_previous[labels[i]] = guesses[i];
+                }
+            }
+        }
 
         centreCornea.x = eigCentre(0);
         centreCornea.y = eigCentre(1);
@@ -225,11 +246,15 @@ namespace gt {
 
     GazeTracker::GazeTracker() {
 
+        // until init() is called, use the global settings
+        m_settings = trackerSettings;
+
         // create the pupil tracker
-        pupil_tracker = new PupilTracker();
+        pupil_tracker = new PupilTracker(m_settings);
 
         // create the cornea computer
         cornea = new Cornea();
+        cornea->setSettings(m_settings);
 
         centre_pupil[0] = 0.0;
         centre_pupil[1] = 0.0;
@@ -256,11 +281,17 @@ namespace gt {
 
 
     void GazeTracker::init(const Camera &camera,
-                           const std::vector<cv::Point3d> &vecLEDs) {
+                           const std::vector<cv::Point3d> &vecLEDs,
+                           const TrackerSettings &settings) {
 
         // copy the camera
         m_camera = camera;
 
+        // the frames of a mirrored camera are mirrored by the pupil tracker
+        pupil_tracker->setMirrored(m_camera.isMirrored());
+
+        setSettings(settings);
+
 
         if(m_pPattern != NULL) {
             delete m_pPattern;
@@ -274,6 +305,16 @@ namespace gt {
     }
 
 
+    void GazeTracker::setSettings(const TrackerSettings &settings) {
+
+        m_settings = settings;
+
+        pupil_tracker->setSettings(m_settings);
+        cornea->setSettings(m_settings);
+
+    }
+
+
     /*
      */
     bool GazeTracker::track(const cv::Mat &img) {
@@ -284,20 +325,41 @@ namespace gt {
         struct timeval t1, t2;
         gettimeofday(&t1, NULL);
 
+        // track the pupil and the glints
+        pupil_tracker->track(img);
+
+        if(!computeGaze(pupil_tracker->getFrame())) {
+            return false;
+        }
+
+        gettimeofday(&t2, NULL);
+
+        const long usec = t2.tv_usec - t1.tv_usec;
+        const long sec = t2.tv_sec - t1.tv_sec;
+        track_dur_micros = sec * 1000000 + usec;
+
+        return true;
+
+    }
+
+
+    bool GazeTracker::computeGaze(const PupilFrame &frame) {
+
         reset();
 
+        // the 2D stages of this frame
+        m_times = frame.getStageTimes();
+
         /*
          *================================================================================
-         *================== Track the pupil, the glints and the cornea ==================
+         *======================== Track the glints and the cornea =======================
          *================================================================================
          */
 
-        // track the pupil and the glints
-        pupil_tracker->track(img);
-
+        ScopedStage timer(m_times, StageTimes::STAGE_GLINTS);
 
         // get the glints
-        const std::vector<cv::Point2d> glints = pupil_tracker->getCornealReflections();
+        const std::vector<cv::Point2d> &glints = frame.getCornealReflections();
 
         if(glints.size() < 2) {return false;}
 
@@ -319,10 +381,13 @@ namespace gt {
         }
 
 
-        const cv::RotatedRect *ellipse_pupil = pupil_tracker->getEllipsePupil();
+        const cv::RotatedRect *ellipse_pupil = frame.getEllipsePupil();
         if(!m_pPattern->associateGlints(glints, ellipse_pupil->center, glints_3d)) {
             return false;
         }
+
+        timer.next(StageTimes::STAGE_CORNEA);
+
         cv::Point3d cw;
         m_pPattern->getCorneaCentre(cornea, cw);
 
@@ -337,7 +402,9 @@ namespace gt {
          *================================================================================
          */
 
-        const int NOF_PERIMETER_POINTS = trackerSettings.NOF_PERIMETER_POINTS;
+        timer.next(StageTimes::STAGE_PUPIL);
+
+        const int NOF_PERIMETER_POINTS = m_settings.NOF_PERIMETER_POINTS;
 
         /*
          * In order to find out the centre of the pupil, we compute the
@@ -357,13 +424,13 @@ namespace gt {
          *	Compute the distance rp, i.e. the distance between the pupil centre
          *	and max pupil perimeter.
          **************************************************************************/
-        const double rp = getRP(cw);
+        const double rp = getRP(*ellipse_pupil, cw);
         if(rp < 0.0) {
             return false;
         }
 
         // rd
-        const double rd = trackerSettings.rd;
+        const double rd = m_settings.rd;
 
         // rps squared
         const double rps2 = rd*rd + rp*rp;
@@ -433,12 +500,6 @@ namespace gt {
         // compute the pupil radius from the perimeter points
         computePupilRadius();
 
-        gettimeofday(&t2, NULL);
-
-        const long usec = t2.tv_usec - t1.tv_usec;
-        const long sec = t2.tv_sec - t1.tv_sec;
-        track_dur_micros = sec * 1000000 + usec;
-
         return true;
 
     }
@@ -493,9 +554,9 @@ namespace gt {
     }
 
 
-    double GazeTracker::getRP(const cv::Point3d &cw) {
+    double GazeTracker::getRP(const cv::RotatedRect &ellipse, const cv::Point3d &cw) {
 
-        const cv::RotatedRect *ellipse_pupil = pupil_tracker->getEllipsePupil();
+        const cv::RotatedRect *ellipse_pupil = &ellipse;
 
         double ang[2];
         if(ellipse_pupil->size.width > ellipse_pupil->size.height) {	// horisontal axis is the major axis
@@ -521,7 +582,7 @@ namespace gt {
         double c_z2 = POW2(c_z);
 
         // cornea ball radius squared
-        double rho2 = POW2(trackerSettings.RHO);
+        double rho2 = POW2(m_settings.RHO);
 
         for(int i = 0; i < 2; ++i) {
             //cv::Point2d p2D;
@@ -575,7 +636,7 @@ namespace gt {
 
         double rp = std::sqrt(x*x + y*y + z*z) / 2.0;
 
-        if(rp > trackerSettings.RHO) {
+        if(rp > m_settings.RHO) {
             printf("GazeTracker::getRP(): rp > RHO!!!\n");
             return -1.0;
         }
@@ -605,10 +666,10 @@ namespace gt {
         const double K_z2 = POW2(K_z);
 
         // cornea sphere radius
-        const double RHO = trackerSettings.RHO;
+        const double RHO = m_settings.RHO;
 
         // MYY = n_air / n_cornea ~= 0.75
-        const double MYY = trackerSettings.MYY;
+        const double MYY = m_settings.MYY;
 
         // cornea sphere radius squared
         const double rho2 = POW2(RHO);
@@ -149,8 +149,20 @@ namespace gt {
                                  cv::Point2f pc,
                                  const std::vector<cv::Point3d> &glints_3d);
 
+            /*
+             * The cornea centre is solved starting from the solution of the
+             * previous frame
+             */
             void getCorneaCentre(Cornea *cornea, cv::Point3d &centreCornea);
 
+        private:
+
+            /*
+             * The solution of the cornea computer for each LED in the last
+             * frame, 0 if the glint of the LED was not found
+             */
+            double gx_previous[6];
+
         };
 
 
@@ -164,15 +176,35 @@ namespace gt {
 
         /*
          * Must be called before starting to track. Can be called multiple times.
+         * The settings are copied, so each instance has its own settings and
+         * several instances can track in parallel. If the camera is mirrored,
+         * the frames are given as captured, see Camera::setMirrored().
          */
 		void init(const Camera &camera,
-                  const std::vector<cv::Point3d> &vecLEDPositions);
+                  const std::vector<cv::Point3d> &vecLEDPositions,
+                  const TrackerSettings &settings = trackerSettings);
+
+        /*
+         * Replace the settings of this instance and of the pupil tracker
+         * and the cornea computer owned by it. Must not be called while
+         * track() is running.
+         */
+        void setSettings(const TrackerSettings &settings);
 
 		/*
          * Track the gaze
          */
 		bool track(const cv::Mat &img);
 
+        /*
+         * The 3D part of track(): associate the glints of the given frame
+         * with the LEDs and compute the cornea and pupil centres. The frame
+         * must have been through PupilTracker::findGlints(). Uses only the
+         * state of this instance, not the pupil tracker's, so it can run
+         * in a pipeline stage of its own, see TrackerPipeline.
+         */
+        bool computeGaze(const PupilFrame &frame);
+
         /*
          * Accessors
          */
@@ -183,6 +215,7 @@ namespace gt {
 		const double *           getCentreCornea()   const {return centre_cornea;}
 		const Camera &           getCamera()         const {return m_camera;}
 		const std::vector<LED> & getLEDs()           const {return m_pPattern->getLEDs();}
+		const TrackerSettings &  getSettings()       const {return m_settings;}
 
         /*
          * Reset the parameters, called at the beginning of track().
@@ -193,6 +226,12 @@ namespace gt {
 		/* Get the duration in microseconds of the last track */
 		long getTrackDurationMicros() {return track_dur_micros;}
 
+        /*
+         * The times of the stages of the last frame given to
+         * computeGaze(), the 2D stages copied from the frame
+         */
+        const StageTimes &getStageTimes() const {return m_times;}
+
         /*
          * Get pupil radius
          */
@@ -231,7 +270,7 @@ namespace gt {
                                 cv::Point3d &pupil_point);	// the resulting point on the pupil perimeter
 
 
-		double getRP(const cv::Point3d &cw);
+		double getRP(const cv::RotatedRect &ellipse, const cv::Point3d &cw);
 
 		PupilTracker *pupil_tracker;
 		Cornea *cornea;
@@ -245,6 +284,9 @@ namespace gt {
 		/* Duration it took for the last track */
 		long track_dur_micros;
 
+        /* See getStageTimes() */
+        StageTimes m_times;
+
         /*
          * Ray traced 3D pupil perimeter points
          */
@@ -255,6 +297,11 @@ namespace gt {
          */
         double m_dPupilRadius;
 
+        /*
+         * The settings of this instance
+         */
+        TrackerSettings m_settings;
+
     };
 
 
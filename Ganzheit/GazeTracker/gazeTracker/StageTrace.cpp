@@ -0,0 +1,120 @@
+#include "StageTrace.h"
+
+
+
+namespace gt {
+
+    /* The threads of TrackerPipeline, see getThread() */
+    static const int NOF_THREADS = 4;
+
+    static const char *THREAD_NAMES[NOF_THREADS] = {"input", "pupil", "glints", "gaze"};
+
+
+    /* The thread of the pipeline that runs the stage */
+    static int getThread(int stage) {
+
+        switch(stage) {
+
+            case StageTimes::STAGE_PREPARE:     return 0;
+
+            case StageTimes::STAGE_STARBURST:
+            case StageTimes::STAGE_CLUSTERS:
+            case StageTimes::STAGE_ELLIPSE:     return 1;
+
+            case StageTimes::STAGE_EYELIDS:
+            case StageTimes::STAGE_CRS:         return 2;
+
+            default:                            return 3;
+
+        }
+
+    }
+
+
+
+    StageTrace::StageTrace() {
+
+        f  = NULL;
+        t0 = -1;
+
+    }
+
+
+    StageTrace::~StageTrace() {
+
+        close();
+
+    }
+
+
+    bool StageTrace::open(const std::string &fname) {
+
+        close();
+
+        f = fopen(fname.c_str(), "w");
+
+        if(f == NULL) {
+            printf("StageTrace::open(): Could not create %s\n", fname.c_str());
+            return false;
+        }
+
+        t0 = -1;
+
+        fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+        // the names of the threads, the ids begin from 1
+        for(int i = 0; i < NOF_THREADS; ++i) {
+
+            fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                    i == 0 ? "" : ",\n", i + 1, THREAD_NAMES[i]);
+
+        }
+
+        return true;
+
+    }
+
+
+    void StageTrace::close() {
+
+        if(f == NULL) {
+            return;
+        }
+
+        fprintf(f, "\n]}\n");
+        fclose(f);
+
+        f = NULL;
+
+    }
+
+
+    void StageTrace::add(unsigned long id, const StageTimes &times) {
+
+        if(f == NULL) {
+            return;
+        }
+
+        for(int i = 0; i < StageTimes::NOF_STAGES; ++i) {
+
+            const int64_t begin = times.getBegin(i);
+
+            // not run for this frame
+            if(begin < 0) {
+                continue;
+            }
+
+            if(t0 < 0) {
+                t0 = begin;
+            }
+
+            // in microseconds
+            fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%lu}}",
+                    StageTimes::getName(i), getThread(i) + 1,
+                    1e-3 * (begin - t0), 1e-3 * times.getDuration(i), id);
+
+        }
+
+    }
+
+} // end of namespace gt {
@@ -0,0 +1,63 @@
+#ifndef STAGETRACE_H
+#define STAGETRACE_H
+
+
+#include "StageTimes.h"
+#include <stdio.h>
+#include <string>
+
+
+
+namespace gt {
+
+    /*
+     * Writes the stage times of the tracked frames to a file in the
+     * Chrome trace event format, to be opened in chrome://tracing or
+     * Perfetto. Each stage is an event of the frame id, and the stages
+     * are shown in the threads of TrackerPipeline, so the overlapping
+     * of consecutive frames can be seen. The file is valid JSON after
+     * close().
+     */
+    class StageTrace {
+
+    public:
+
+        StageTrace();
+
+        /* Closes the file */
+        ~StageTrace();
+
+        /* Create the file, replacing an old one */
+        bool open(const std::string &fname);
+
+        /* Write the end of the file and close it */
+        void close();
+
+        bool isOpen() const {return f != NULL;}
+
+        /*
+         * Write the stages that were run. Must be called from a single
+         * thread, or from one thread at a time.
+         */
+        void add(unsigned long id, const StageTimes &times);
+
+    private:
+
+        /*
+         * Forbid the use of a copy constructor and the assignment operator.
+         */
+        StageTrace(const StageTrace &other);
+        StageTrace &operator=(const StageTrace &other);
+
+        FILE *f;
+
+        /* The first time written, the times of the events are relative to this */
+        int64_t t0;
+
+    };
+
+} // end of namespace gt {
+
+
+
+#endif
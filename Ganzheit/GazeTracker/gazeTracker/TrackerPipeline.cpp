@@ -0,0 +1,445 @@
+#include "TrackerPipeline.h"
+#include <sys/time.h>
+#include <stdio.h>
+
+
+
+namespace gt {
+
+    static void *pipeline_pupil(void *arg) {
+        ((TrackerPipeline *)arg)->runPupil();
+        pthread_exit(NULL);
+        return NULL;
+    }
+
+
+    static void *pipeline_glints(void *arg) {
+        ((TrackerPipeline *)arg)->runGlints();
+        pthread_exit(NULL);
+        return NULL;
+    }
+
+
+    static void *pipeline_gaze(void *arg) {
+        ((TrackerPipeline *)arg)->runGaze();
+        pthread_exit(NULL);
+        return NULL;
+    }
+
+
+
+    /********************************************************
+     * class PipelineFrame
+     ********************************************************/
+
+    PipelineFrame::PipelineFrame() {
+
+        bTrackSuccessfull = false;
+
+        for(int i = 0; i < 3; ++i) {
+            centrePupil[i]  = 0.0;
+            centreCornea[i] = 0.0;
+        }
+
+        dPupilRadius   = 0.0;
+        trackDurMicros = -1;
+        pUserData      = NULL;
+
+    }
+
+
+
+    /********************************************************
+     * class TrackerPipeline::FrameQueue
+     ********************************************************/
+
+    TrackerPipeline::FrameQueue::FrameQueue() {
+
+        pthread_mutex_init(&mutex, NULL);
+        pthread_cond_init(&cond, NULL);
+
+        bClosed = false;
+
+    }
+
+
+    TrackerPipeline::FrameQueue::~FrameQueue() {
+
+        pthread_mutex_destroy(&mutex);
+        pthread_cond_destroy(&cond);
+
+    }
+
+
+    void TrackerPipeline::FrameQueue::push(PipelineFrame *frame) {
+
+        pthread_mutex_lock(&mutex);
+
+            frames.push_back(frame);
+
+            pthread_cond_signal(&cond);
+
+        pthread_mutex_unlock(&mutex);
+
+    }
+
+
+    PipelineFrame *TrackerPipeline::FrameQueue::pop() {
+
+        PipelineFrame *frame = NULL;
+
+        pthread_mutex_lock(&mutex);
+
+            while(frames.empty() && !bClosed) {
+                pthread_cond_wait(&cond, &mutex);
+            }
+
+            if(!frames.empty()) {
+                frame = frames.front();
+                frames.pop_front();
+            }
+
+        pthread_mutex_unlock(&mutex);
+
+        return frame;
+
+    }
+
+
+    void TrackerPipeline::FrameQueue::close() {
+
+        pthread_mutex_lock(&mutex);
+
+            bClosed = true;
+
+            pthread_cond_broadcast(&cond);
+
+        pthread_mutex_unlock(&mutex);
+
+    }
+
+
+    void TrackerPipeline::FrameQueue::open() {
+
+        pthread_mutex_lock(&mutex);
+
+            bClosed = false;
+            frames.clear();
+
+        pthread_mutex_unlock(&mutex);
+
+    }
+
+
+    size_t TrackerPipeline::FrameQueue::size() {
+
+        pthread_mutex_lock(&mutex);
+
+            const size_t sz = frames.size();
+
+        pthread_mutex_unlock(&mutex);
+
+        return sz;
+
+    }
+
+
+
+    /********************************************************
+     * class TrackerPipeline
+     ********************************************************/
+
+    TrackerPipeline::TrackerPipeline() {
+
+        m_pTracker = NULL;
+        m_pHandler = NULL;
+
+        m_bRunning = false;
+
+        pthread_mutex_init(&m_mutexSettings, NULL);
+        m_bSettingsPending = false;
+
+    }
+
+
+    TrackerPipeline::~TrackerPipeline() {
+
+        end();
+
+        pthread_mutex_destroy(&m_mutexSettings);
+
+    }
+
+
+    bool TrackerPipeline::start(GazeTracker *tracker, PipelineHandler *handler, int nFrames) {
+
+        if(m_bRunning || tracker == NULL || handler == NULL || nFrames <= 0) {
+            return false;
+        }
+
+        m_pTracker = tracker;
+        m_pHandler = handler;
+
+        m_queueFree.open();
+        m_queuePupil.open();
+        m_queueGlints.open();
+        m_queueGaze.open();
+
+        m_vecFrames.resize(nFrames);
+        for(int i = 0; i < nFrames; ++i) {
+            m_vecFrames[i] = new PipelineFrame();
+            m_queueFree.push(m_vecFrames[i]);
+        }
+
+        if(pthread_create(&m_threadPupil, NULL, pipeline_pupil, this) != 0) {
+            printf("TrackerPipeline::start(): Could not create the pupil thread\n");
+            deleteFrames();
+            return false;
+        }
+
+        if(pthread_create(&m_threadGlints, NULL, pipeline_glints, this) != 0) {
+            printf("TrackerPipeline::start(): Could not create the glint thread\n");
+            m_queuePupil.close();
+            pthread_join(m_threadPupil, NULL);
+            deleteFrames();
+            return false;
+        }
+
+        if(pthread_create(&m_threadGaze, NULL, pipeline_gaze, this) != 0) {
+            printf("TrackerPipeline::start(): Could not create the gaze thread\n");
+            m_queuePupil.close();
+            pthread_join(m_threadPupil, NULL);
+            pthread_join(m_threadGlints, NULL);
+            deleteFrames();
+            return false;
+        }
+
+        m_bRunning = true;
+
+        return true;
+
+    }
+
+
+    void TrackerPipeline::end() {
+
+        if(!m_bRunning) {
+            return;
+        }
+
+        m_bRunning = false;
+
+        /*
+         * Closing the first queue lets the frames in the pipeline
+         * through. Each stage closes the queue of the next stage, when
+         * it has run out of frames.
+         */
+        m_queuePupil.close();
+
+        pthread_join(m_threadPupil, NULL);
+        pthread_join(m_threadGlints, NULL);
+        pthread_join(m_threadGaze, NULL);
+
+        deleteFrames();
+
+    }
+
+
+    void TrackerPipeline::deleteFrames() {
+
+        m_queueFree.open();
+
+        for(size_t i = 0; i < m_vecFrames.size(); ++i) {
+            delete m_vecFrames[i];
+        }
+
+        m_vecFrames.clear();
+
+    }
+
+
+    bool TrackerPipeline::add(const cv::Mat &imgGray, void *pUserData) {
+
+        if(!m_bRunning) {
+            return false;
+        }
+
+        applySettings();
+
+        // wait for a free frame
+        PipelineFrame *frame = m_queueFree.pop();
+        if(frame == NULL) {
+            return false;
+        }
+
+        struct timeval t1, t2;
+        gettimeofday(&t1, NULL);
+
+        m_pTracker->getPupilTracker()->prepare(imgGray, frame->pupil);
+
+        gettimeofday(&t2, NULL);
+
+        frame->trackDurMicros = getMicros(t1, t2);
+        frame->pUserData      = pUserData;
+
+        m_queuePupil.push(frame);
+
+        return true;
+
+    }
+
+
+    void TrackerPipeline::setSettings(const TrackerSettings &settings) {
+
+        pthread_mutex_lock(&m_mutexSettings);
+
+            m_settingsPending  = settings;
+            m_bSettingsPending = true;
+
+        pthread_mutex_unlock(&m_mutexSettings);
+
+    }
+
+
+    void TrackerPipeline::applySettings() {
+
+        TrackerSettings settings;
+
+        pthread_mutex_lock(&m_mutexSettings);
+
+            const bool bPending = m_bSettingsPending;
+
+            if(bPending) {
+                settings = m_settingsPending;
+                m_bSettingsPending = false;
+            }
+
+        pthread_mutex_unlock(&m_mutexSettings);
+
+        if(!bPending) {
+            return;
+        }
+
+        /*
+         * Take all frames out of the pipeline. Once they are all back,
+         * no stage is using the tracker.
+         */
+        const size_t nFrames = m_vecFrames.size();
+        for(size_t i = 0; i < nFrames; ++i) {
+            m_queueFree.pop();
+        }
+
+        m_pTracker->setSettings(settings);
+
+        for(size_t i = 0; i < nFrames; ++i) {
+            m_queueFree.push(m_vecFrames[i]);
+        }
+
+    }
+
+
+    int TrackerPipeline::getNofFramesInUse() {
+        return (int)(m_vecFrames.size() - m_queueFree.size());
+    }
+
+
+    void TrackerPipeline::runPupil() {
+
+        PupilTracker *pupilTracker = m_pTracker->getPupilTracker();
+
+        PipelineFrame *frame;
+        while((frame = m_queuePupil.pop()) != NULL) {
+
+            struct timeval t1, t2;
+            gettimeofday(&t1, NULL);
+
+            pupilTracker->findPupil(frame->pupil);
+
+            gettimeofday(&t2, NULL);
+            frame->trackDurMicros += getMicros(t1, t2);
+
+            m_queueGlints.push(frame);
+
+        }
+
+        m_queueGlints.close();
+
+    }
+
+
+    void TrackerPipeline::runGlints() {
+
+        PupilTracker *pupilTracker = m_pTracker->getPupilTracker();
+
+        PipelineFrame *frame;
+        while((frame = m_queueGlints.pop()) != NULL) {
+
+            struct timeval t1, t2;
+            gettimeofday(&t1, NULL);
+
+            pupilTracker->findGlints(frame->pupil);
+
+            gettimeofday(&t2, NULL);
+            frame->trackDurMicros += getMicros(t1, t2);
+
+            m_queueGaze.push(frame);
+
+        }
+
+        m_queueGaze.close();
+
+    }
+
+
+    void TrackerPipeline::runGaze() {
+
+        PipelineFrame *frame;
+        while((frame = m_queueGaze.pop()) != NULL) {
+
+            struct timeval t1, t2;
+            gettimeofday(&t1, NULL);
+
+            frame->bTrackSuccessfull = m_pTracker->computeGaze(frame->pupil);
+
+            // computeGaze() resets these, so they are valid also on failure
+            const double *c_pupil  = m_pTracker->getCentrePupil();
+            const double *c_cornea = m_pTracker->getCentreCornea();
+            for(int i = 0; i < 3; ++i) {
+                frame->centrePupil[i]  = c_pupil[i];
+                frame->centreCornea[i] = c_cornea[i];
+            }
+
+            frame->dPupilRadius = m_pTracker->getPupilRadius();
+
+            frame->times = m_pTracker->getStageTimes();
+
+            gettimeofday(&t2, NULL);
+
+            if(frame->bTrackSuccessfull) {
+                frame->trackDurMicros += getMicros(t1, t2);
+            }
+            else {
+                frame->trackDurMicros = -1;
+            }
+
+            m_pHandler->frameTracked(*frame);
+
+            frame->pUserData = NULL;
+
+            m_queueFree.push(frame);
+
+        }
+
+    }
+
+
+    long TrackerPipeline::getMicros(const struct timeval &t1, const struct timeval &t2) {
+
+        const long usec = t2.tv_usec - t1.tv_usec;
+        const long sec  = t2.tv_sec - t1.tv_sec;
+
+        return sec * 1000000 + usec;
+
+    }
+
+} // end of namespace gt {
@@ -0,0 +1,210 @@
+#ifndef TRACKERPIPELINE_H
+#define TRACKERPIPELINE_H
+
+
+#include "GazeTracker.h"
+#include <pthread.h>
+#include <sys/time.h>
+#include <deque>
+#include <vector>
+
+
+
+namespace gt {
+
+    /*
+     * A frame travelling through the pipeline: the work images of the
+     * pupil tracker, the results and the user's data.
+     */
+    class PipelineFrame {
+
+    public:
+
+        PipelineFrame();
+
+        /* Work images and the 2D results */
+        PupilFrame pupil;
+
+        /* The results of GazeTracker::computeGaze() */
+        bool bTrackSuccessfull;
+        double centrePupil[3];
+        double centreCornea[3];
+        double dPupilRadius;
+
+        /*
+         * The sum of the durations of the stages in microseconds,
+         * -1 if the tracking failed, as in GazeTracker::track().
+         */
+        long trackDurMicros;
+
+        /*
+         * The times of the stages, see GazeTracker::getStageTimes(). The
+         * stages of consecutive frames overlap in time.
+         */
+        StageTimes times;
+
+        /* Given to add(), not touched by the pipeline */
+        void *pUserData;
+
+    };
+
+
+    /*
+     * Implemented by the user of the pipeline. frameTracked() is called
+     * in the thread of the last stage, once per frame and in the order
+     * in which the frames were added. The frame is reused after the
+     * call returns.
+     */
+    class PipelineHandler {
+
+    public:
+
+        virtual void frameTracked(const PipelineFrame &frame) = 0;
+
+        virtual ~PipelineHandler() {}
+
+    };
+
+
+    /*
+     * Runs GazeTracker::track() as a pipeline, so that consecutive frames
+     * are tracked at the same time in different threads:
+     *
+     *   caller's thread : PupilTracker::prepare(), copy and preprocess
+     *   stage 1         : PupilTracker::findPupil(), starburst ROI,
+     *                     clusters and the ellipse fit
+     *   stage 2         : PupilTracker::findGlints(), eye lids and CRs
+     *   stage 3         : GazeTracker::computeGaze(), glint association,
+     *                     cornea and pupil in 3D, then the handler
+     *
+     * Each stage runs in a single thread and the frames are passed on in
+     * FIFO queues, so the state that is carried from frame to frame is
+     * updated in frame order and the results are identical to those of
+     * GazeTracker::track(). The starburst of a frame needs the ellipse of
+     * the previous frame, therefore stage 1 is not split any further.
+     *
+     * The tracker must not be used by anyone else while the pipeline is
+     * running.
+     */
+    class TrackerPipeline {
+
+    public:
+
+        TrackerPipeline();
+        ~TrackerPipeline();
+
+        /*
+         * Create nFrames frames and start the stage threads. At most
+         * nFrames frames are in the pipeline at a time.
+         */
+        bool start(GazeTracker *tracker, PipelineHandler *handler, int nFrames = 4);
+
+        /*
+         * Track the frames that are in the pipeline and join the
+         * threads. Must be called before destruction.
+         */
+        void end();
+
+        /*
+         * Prepare the frame in the caller's thread and pass it on to the
+         * stages. Blocks while all frames are in the pipeline. Must be
+         * called from a single thread.
+         */
+        bool add(const cv::Mat &imgGray, void *pUserData);
+
+        /*
+         * New settings for the tracker. These are applied by add() once
+         * the frames in the pipeline have been tracked, so every frame
+         * is tracked with a single set of settings.
+         */
+        void setSettings(const TrackerSettings &settings);
+
+        /*
+         * Apply the pending settings, if any. Called by add(), and may be
+         * called before it from the same thread when the frame depends
+         * on the settings of the tracker.
+         */
+        void applySettings();
+
+        /* The number of frames in the pipeline */
+        int getNofFramesInUse();
+
+        /* The thread functions, must not be called */
+        void runPupil();
+        void runGlints();
+        void runGaze();
+
+    private:
+
+        /*
+         * A FIFO of frames. pop() waits for a frame and returns NULL when
+         * the queue is empty and has been closed.
+         */
+        class FrameQueue {
+
+        public:
+
+            FrameQueue();
+            ~FrameQueue();
+
+            void push(PipelineFrame *frame);
+            PipelineFrame *pop();
+
+            void close();
+            void open();
+
+            size_t size();
+
+        private:
+
+            pthread_mutex_t mutex;
+            pthread_cond_t cond;
+
+            std::deque<PipelineFrame *> frames;
+
+            bool bClosed;
+
+        };
+
+
+        /*
+         * Forbid the use of a copy constructor and the assignment operator.
+         */
+        TrackerPipeline(const TrackerPipeline &other);
+        TrackerPipeline &operator=(const TrackerPipeline &other);
+
+        /* Delete all frames, the stage threads must not be running */
+        void deleteFrames();
+
+        static long getMicros(const struct timeval &t1, const struct timeval &t2);
+
+        GazeTracker *m_pTracker;
+        PipelineHandler *m_pHandler;
+
+        /* All frames, owned by this instance */
+        std::vector<PipelineFrame *> m_vecFrames;
+
+        /* The unused frames and the input queues of the stages */
+        FrameQueue m_queueFree;
+        FrameQueue m_queuePupil;
+        FrameQueue m_queueGlints;
+        FrameQueue m_queueGaze;
+
+        pthread_t m_threadPupil;
+        pthread_t m_threadGlints;
+        pthread_t m_threadGaze;
+
+        bool m_bRunning;
+
+        /* Settings given by setSettings(), waiting for add() */
+        pthread_mutex_t m_mutexSettings;
+        TrackerSettings m_settingsPending;
+        bool m_bSettingsPending;
+
+    };
+
+} // end of namespace gt {
+
+
+
+#endif
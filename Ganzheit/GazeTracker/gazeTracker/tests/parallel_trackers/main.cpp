@@ -0,0 +1,241 @@
+/*
+ * Stress test for running several gt::GazeTracker instances in parallel.
+ *
+ * Each tracker gets its own settings. First every tracker is run alone
+ * in the main thread to get the reference results. Then all trackers
+ * are run at the same time, each in its own thread, and the results
+ * must be identical to the reference results, bit by bit.
+ *
+ * Usage: parallel_trackers [nof trackers] [nof rounds]
+ *
+ * The number of trackers defaults to the number of cores.
+ */
+
+#include <opencv2/imgproc/imgproc.hpp>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <vector>
+
+#include "GazeTracker.h"
+#include "trackerSettings.h"
+#include "SyntheticEye.h"
+
+
+static const int FRAME_W     = 640;
+static const int FRAME_H     = 480;
+static const int NOF_FRAMES  = 60;
+
+
+/*
+ * The results of a single frame
+ */
+struct FrameResult {
+
+    bool            bTracked;
+    cv::RotatedRect ellipse;
+    double          centreCornea[3];
+    double          centrePupil[3];
+    double          dPupilRadius;
+    std::vector<cv::Point2d> glints;
+
+    bool operator==(const FrameResult &other) const {
+
+        return bTracked == other.bTracked                                           &&
+               memcmp(&ellipse, &other.ellipse, sizeof(ellipse)) == 0               &&
+               memcmp(centreCornea, other.centreCornea, sizeof(centreCornea)) == 0  &&
+               memcmp(centrePupil, other.centrePupil, sizeof(centrePupil)) == 0     &&
+               memcmp(&dPupilRadius, &other.dPupilRadius, sizeof(double)) == 0      &&
+               glints.size() == other.glints.size()                                 &&
+               (glints.empty() || memcmp(&glints[0], &other.glints[0],
+                                         glints.size() * sizeof(cv::Point2d)) == 0);
+
+    }
+
+};
+
+
+/*
+ * Everything a single tracker thread needs
+ */
+struct Job {
+
+    const std::vector<cv::Mat>     *frames;
+    const Camera                   *camera;
+    const std::vector<cv::Point3d> *leds;
+    TrackerSettings                 settings;
+    std::vector<FrameResult>        results;
+
+};
+
+
+/*
+ * Make the settings of the tracker n differ from the others
+ */
+static void makeSettings(int n, TrackerSettings &settings) {
+
+    settings = trackerSettings;
+
+    settings.AUTO_THRESHOLD         = n % 2;
+    settings.PUPIL_THRESHOLD        = 40 + 5 * (n % 4);
+    settings.CR_THRESHOLD           = 180 + 10 * (n % 3);
+    settings.NOF_RAYS               = 150 - 10 * (n % 3);
+    settings.STARBURST_BLOCK_COUNT  = 1 + n % 3;
+    settings.RHO                    = 0.0077 + 0.0002 * (n % 5);
+    settings.NOF_PERIMETER_POINTS   = 60 + 10 * (n % 2);
+
+}
+
+
+static void *runJob(void *arg) {
+
+    Job *job = (Job *)arg;
+
+    gt::GazeTracker tracker;
+    tracker.init(*job->camera, *job->leds, job->settings);
+
+    job->results.resize(job->frames->size());
+
+    for(size_t i = 0; i < job->frames->size(); ++i) {
+
+        FrameResult &res = job->results[i];
+
+        res.bTracked     = tracker.track((*job->frames)[i]);
+        res.ellipse      = *tracker.getPupilTracker()->getEllipsePupil();
+        res.glints       = tracker.getPupilTracker()->getCornealReflections();
+        res.dPupilRadius = tracker.getPupilRadius();
+
+        memcpy(res.centreCornea, tracker.getCentreCornea(), sizeof(res.centreCornea));
+        memcpy(res.centrePupil, tracker.getCentrePupil(), sizeof(res.centrePupil));
+
+    }
+
+    return NULL;
+
+}
+
+
+int main(int argc, char **argv) {
+
+    int nTrackers = argc > 1 ? atoi(argv[1]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int nRounds   = argc > 2 ? atoi(argv[2]) : 3;
+
+    nTrackers = std::max(nTrackers, 2);
+    nRounds   = std::max(nRounds, 1);
+
+
+    /**********************************************************************
+     * The input shared by all trackers
+     *********************************************************************/
+    SyntheticEye eye(FRAME_W, FRAME_H);
+    eye.bgLow       = eye.bgHigh = 170;
+    eye.ampX        = 30;
+    eye.ampY        = 15;
+    eye.irisRadius  = 80;
+    eye.irisLevel   = 100;
+    eye.pupilAxes   = cv::Size(30, 27);
+    eye.pupilLevel  = 20;
+    eye.addSixLEDGlints(2);
+
+    std::vector<cv::Mat> frames(NOF_FRAMES);
+    for(int i = 0; i < NOF_FRAMES; ++i) {
+        eye.draw(frames[i], i);
+    }
+
+    // column-major order
+    const double intr[9] = {800.0,   0.0, 0.0,
+                              0.0, 800.0, 0.0,
+                            320.0, 240.0, 1.0};
+    const double dist[5] = {0.0, 0.0, 0.0, 0.0, 0.0};
+
+    Camera camera;
+    camera.setIntrinsicMatrix(intr);
+    camera.setDistortion(dist);
+
+    // the LEDs around the camera, in metres
+    std::vector<cv::Point3d> leds(6);
+    leds[0] = cv::Point3d( 0.000, -0.015, 0.0);
+    leds[1] = cv::Point3d(-0.013, -0.007, 0.0);
+    leds[2] = cv::Point3d(-0.013,  0.007, 0.0);
+    leds[3] = cv::Point3d( 0.000,  0.015, 0.0);
+    leds[4] = cv::Point3d( 0.013,  0.007, 0.0);
+    leds[5] = cv::Point3d( 0.013, -0.007, 0.0);
+
+
+    /**********************************************************************
+     * The reference results, one tracker at a time
+     *********************************************************************/
+    std::vector<Job> reference(nTrackers);
+    for(int n = 0; n < nTrackers; ++n) {
+
+        reference[n].frames = &frames;
+        reference[n].camera = &camera;
+        reference[n].leds   = &leds;
+        makeSettings(n, reference[n].settings);
+
+        runJob(&reference[n]);
+
+    }
+
+
+    /**********************************************************************
+     * All trackers in parallel
+     *********************************************************************/
+    int nFailures = 0;
+
+    for(int r = 0; r < nRounds; ++r) {
+
+        std::vector<Job> jobs(reference.size());
+        std::vector<pthread_t> threads(nTrackers);
+
+        for(int n = 0; n < nTrackers; ++n) {
+
+            jobs[n].frames   = &frames;
+            jobs[n].camera   = &camera;
+            jobs[n].leds     = &leds;
+            jobs[n].settings = reference[n].settings;
+
+            if(pthread_create(&threads[n], NULL, runJob, &jobs[n]) != 0) {
+                printf("Could not create thread %d\n", n);
+                return -1;
+            }
+
+        }
+
+        for(int n = 0; n < nTrackers; ++n) {
+            pthread_join(threads[n], NULL);
+        }
+
+        for(int n = 0; n < nTrackers; ++n) {
+
+            int nTracked = 0;
+
+            for(int i = 0; i < NOF_FRAMES; ++i) {
+
+                if(!(jobs[n].results[i] == reference[n].results[i])) {
+                    printf("round %d, tracker %d, frame %d: the result differs from the single-threaded result\n", r, n, i);
+                    ++nFailures;
+                }
+
+                if(jobs[n].results[i].bTracked) {
+                    ++nTracked;
+                }
+
+            }
+
+            if(r == 0) {
+                printf("tracker %d: %d/%d frames tracked\n", n, nTracked, NOF_FRAMES);
+            }
+
+        }
+
+    }
+
+    printf("%d trackers, %d rounds: %s\n", nTrackers, nRounds, nFailures == 0 ? "OK" : "FAILED");
+
+    return nFailures == 0 ? 0 : 1;
+
+}
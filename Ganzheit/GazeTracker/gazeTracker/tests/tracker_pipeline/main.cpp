@@ -0,0 +1,235 @@
+/*
+ * Test for gt::TrackerPipeline.
+ *
+ * The same frames are tracked first with GazeTracker::track() and then
+ * with a TrackerPipeline on another tracker that has the same settings.
+ * The results must be identical, bit by bit, and arrive in order. The
+ * frame rates of both are printed.
+ *
+ * Usage: tracker_pipeline [nof pipeline frames] [nof rounds]
+ */
+
+#include <opencv2/imgproc/imgproc.hpp>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+#include <vector>
+
+#include "GazeTracker.h"
+#include "TrackerPipeline.h"
+#include "trackerSettings.h"
+#include "SyntheticEye.h"
+
+
+static const int FRAME_W     = 640;
+static const int FRAME_H     = 480;
+static const int NOF_FRAMES  = 200;
+
+
+/*
+ * The results of a single frame
+ */
+struct FrameResult {
+
+    bool            bTracked;
+    cv::RotatedRect ellipse;
+    double          centreCornea[3];
+    double          centrePupil[3];
+    double          dPupilRadius;
+    std::vector<cv::Point2d> glints;
+
+    bool operator==(const FrameResult &other) const {
+
+        return bTracked == other.bTracked                                           &&
+               memcmp(&ellipse, &other.ellipse, sizeof(ellipse)) == 0               &&
+               memcmp(centreCornea, other.centreCornea, sizeof(centreCornea)) == 0  &&
+               memcmp(centrePupil, other.centrePupil, sizeof(centrePupil)) == 0     &&
+               memcmp(&dPupilRadius, &other.dPupilRadius, sizeof(double)) == 0      &&
+               glints.size() == other.glints.size()                                 &&
+               (glints.empty() || memcmp(&glints[0], &other.glints[0],
+                                         glints.size() * sizeof(cv::Point2d)) == 0);
+
+    }
+
+};
+
+
+/*
+ * Collects the results of the pipeline. The user data of a frame
+ * is its index.
+ */
+class ResultCollector : public gt::PipelineHandler {
+
+public:
+
+    ResultCollector(int nFrames) : results(nFrames), nOutOfOrder(0), nNext(0) {}
+
+    void frameTracked(const gt::PipelineFrame &frame) {
+
+        const int n = (int)(size_t)frame.pUserData;
+
+        if(n != nNext) {
+            ++nOutOfOrder;
+        }
+        nNext = n + 1;
+
+        FrameResult &res = results[n];
+
+        res.bTracked     = frame.bTrackSuccessfull;
+        res.ellipse      = *frame.pupil.getEllipsePupil();
+        res.glints       = frame.pupil.getCornealReflections();
+        res.dPupilRadius = frame.dPupilRadius;
+
+        memcpy(res.centreCornea, frame.centreCornea, sizeof(res.centreCornea));
+        memcpy(res.centrePupil, frame.centrePupil, sizeof(res.centrePupil));
+
+    }
+
+    std::vector<FrameResult> results;
+    int nOutOfOrder;
+
+private:
+
+    int nNext;
+
+};
+
+
+static double getSeconds(const struct timeval &t1, const struct timeval &t2) {
+    return (t2.tv_sec - t1.tv_sec) + 1e-6 * (t2.tv_usec - t1.tv_usec);
+}
+
+
+int main(int argc, char **argv) {
+
+    int nPipelineFrames = argc > 1 ? atoi(argv[1]) : 4;
+    int nRounds         = argc > 2 ? atoi(argv[2]) : 3;
+
+    nPipelineFrames = std::max(nPipelineFrames, 1);
+    nRounds         = std::max(nRounds, 1);
+
+
+    /**********************************************************************
+     * The input
+     *********************************************************************/
+    SyntheticEye eye(FRAME_W, FRAME_H);
+    eye.bgLow       = eye.bgHigh = 170;
+    eye.ampX        = 30;
+    eye.ampY        = 15;
+    eye.irisRadius  = 80;
+    eye.irisLevel   = 100;
+    eye.pupilAxes   = cv::Size(30, 27);
+    eye.pupilLevel  = 20;
+    eye.addSixLEDGlints(2);
+
+    std::vector<cv::Mat> frames(NOF_FRAMES);
+    for(int i = 0; i < NOF_FRAMES; ++i) {
+        eye.draw(frames[i], i);
+    }
+
+    // column-major order
+    const double intr[9] = {800.0,   0.0, 0.0,
+                              0.0, 800.0, 0.0,
+                            320.0, 240.0, 1.0};
+    const double dist[5] = {0.0, 0.0, 0.0, 0.0, 0.0};
+
+    Camera camera;
+    camera.setIntrinsicMatrix(intr);
+    camera.setDistortion(dist);
+
+    // the LEDs around the camera, in metres
+    std::vector<cv::Point3d> leds(6);
+    leds[0] = cv::Point3d( 0.000, -0.015, 0.0);
+    leds[1] = cv::Point3d(-0.013, -0.007, 0.0);
+    leds[2] = cv::Point3d(-0.013,  0.007, 0.0);
+    leds[3] = cv::Point3d( 0.000,  0.015, 0.0);
+    leds[4] = cv::Point3d( 0.013,  0.007, 0.0);
+    leds[5] = cv::Point3d( 0.013, -0.007, 0.0);
+
+
+    int nFailures = 0;
+
+    for(int r = 0; r < nRounds; ++r) {
+
+        /******************************************************************
+         * The reference, GazeTracker::track()
+         *****************************************************************/
+        std::vector<FrameResult> reference(NOF_FRAMES);
+
+        gt::GazeTracker trackerRef;
+        trackerRef.init(camera, leds, trackerSettings);
+
+        struct timeval t1, t2;
+        gettimeofday(&t1, NULL);
+
+        for(int i = 0; i < NOF_FRAMES; ++i) {
+
+            FrameResult &res = reference[i];
+
+            res.bTracked     = trackerRef.track(frames[i]);
+            res.ellipse      = *trackerRef.getPupilTracker()->getEllipsePupil();
+            res.glints       = trackerRef.getPupilTracker()->getCornealReflections();
+            res.dPupilRadius = trackerRef.getPupilRadius();
+
+            memcpy(res.centreCornea, trackerRef.getCentreCornea(), sizeof(res.centreCornea));
+            memcpy(res.centrePupil, trackerRef.getCentrePupil(), sizeof(res.centrePupil));
+
+        }
+
+        gettimeofday(&t2, NULL);
+        const double dSecRef = getSeconds(t1, t2);
+
+
+        /******************************************************************
+         * The pipeline
+         *****************************************************************/
+        gt::GazeTracker tracker;
+        tracker.init(camera, leds, trackerSettings);
+
+        ResultCollector collector(NOF_FRAMES);
+        gt::TrackerPipeline pipeline;
+
+        if(!pipeline.start(&tracker, &collector, nPipelineFrames)) {
+            printf("Could not start the pipeline\n");
+            return -1;
+        }
+
+        gettimeofday(&t1, NULL);
+
+        for(int i = 0; i < NOF_FRAMES; ++i) {
+            pipeline.add(frames[i], (void *)(size_t)i);
+        }
+
+        pipeline.end();
+
+        gettimeofday(&t2, NULL);
+        const double dSecPipeline = getSeconds(t1, t2);
+
+
+        /******************************************************************
+         * Compare
+         *****************************************************************/
+        if(collector.nOutOfOrder != 0) {
+            printf("round %d: %d frames out of order\n", r, collector.nOutOfOrder);
+            ++nFailures;
+        }
+
+        for(int i = 0; i < NOF_FRAMES; ++i) {
+            if(!(collector.results[i] == reference[i])) {
+                printf("round %d, frame %d: the result differs from GazeTracker::track()\n", r, i);
+                ++nFailures;
+            }
+        }
+
+        printf("round %d: track() %.1f fps, pipeline %.1f fps\n",
+               r, NOF_FRAMES / dSecRef, NOF_FRAMES / dSecPipeline);
+
+    }
+
+    printf("%d pipeline frames, %d rounds: %s\n", nPipelineFrames, nRounds, nFailures == 0 ? "OK" : "FAILED");
+
+    return nFailures == 0 ? 0 : 1;
+
+}
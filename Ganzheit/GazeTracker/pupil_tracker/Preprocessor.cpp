@@ -0,0 +1,333 @@
+#include "Preprocessor.h"
+#include <opencv2/core/version.hpp>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+/*
+ * cv::equalizeHist() was rewritten in OpenCV 2.4.3, the two versions
+ * compute the look-up table differently.
+ */
+#if CV_MAJOR_VERSION > 2 || \
+    (CV_MAJOR_VERSION == 2 && (CV_MINOR_VERSION > 4 || (CV_MINOR_VERSION == 4 && CV_SUBMINOR_VERSION >= 3)))
+#define EQUALIZE_HIST_243
+#endif
+
+
+/*
+ * (s + 4) / 9 for the sums of nine 8-bit values, i.e. the rounded mean.
+ * Exact for s + 4 < 36000.
+ */
+static const unsigned short DIV9_MUL = 7282;
+#define DIV9(S)     ((((S) + 4) * DIV9_MUL) >> 16)
+
+
+namespace gt {
+
+
+    /*
+     * Sum each pixel of the work area with its left and right neighbours.
+     * src points to the beginning of the whole image row, the columns
+     * outside the image are reflected as with cv::BORDER_REFLECT_101.
+     */
+    static void rowSums(const unsigned char *src, int x0, int w, int nCols, unsigned short *dst) {
+
+        const int xl = x0 > 0 ? x0 - 1 : 1;
+        const int xr = x0 + w < nCols ? x0 + w : nCols - 2;
+
+        const unsigned char *p = src + x0;
+
+        dst[0]     = src[xl] + p[0] + p[1];
+        dst[w - 1] = p[w - 2] + p[w - 1] + src[xr];
+
+        int i = 1;
+
+#ifdef __SSE2__
+        const __m128i zero = _mm_setzero_si128();
+
+        for(; i + 16 <= w - 1; i += 16) {
+
+            const __m128i a = _mm_loadu_si128((const __m128i *)(p + i - 1));
+            const __m128i b = _mm_loadu_si128((const __m128i *)(p + i));
+            const __m128i c = _mm_loadu_si128((const __m128i *)(p + i + 1));
+
+            const __m128i lo = _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi8(a, zero),
+                                                           _mm_unpacklo_epi8(b, zero)),
+                                             _mm_unpacklo_epi8(c, zero));
+
+            const __m128i hi = _mm_add_epi16(_mm_add_epi16(_mm_unpackhi_epi8(a, zero),
+                                                           _mm_unpackhi_epi8(b, zero)),
+                                             _mm_unpackhi_epi8(c, zero));
+
+            _mm_storeu_si128((__m128i *)(dst + i), lo);
+            _mm_storeu_si128((__m128i *)(dst + i + 8), hi);
+
+        }
+#endif
+
+        for(; i < w - 1; ++i) {
+            dst[i] = p[i - 1] + p[i] + p[i + 1];
+        }
+
+    }
+
+
+    /*
+     * Sum the three rows of horizontal sums, divide by 9 and add the
+     * results to the histogram.
+     */
+    static void blurRow(const unsigned short *s0,
+                        const unsigned short *s1,
+                        const unsigned short *s2,
+                        int w,
+                        unsigned char *dst,
+                        int *hist) {
+
+        int i = 0;
+
+#ifdef __SSE2__
+        const __m128i four = _mm_set1_epi16(4);
+        const __m128i mul  = _mm_set1_epi16((short)DIV9_MUL);
+
+        for(; i + 16 <= w; i += 16) {
+
+            __m128i lo = _mm_add_epi16(_mm_loadu_si128((const __m128i *)(s0 + i)),
+                                       _mm_loadu_si128((const __m128i *)(s1 + i)));
+            lo = _mm_add_epi16(lo, _mm_loadu_si128((const __m128i *)(s2 + i)));
+            lo = _mm_mulhi_epu16(_mm_add_epi16(lo, four), mul);
+
+            __m128i hi = _mm_add_epi16(_mm_loadu_si128((const __m128i *)(s0 + i + 8)),
+                                       _mm_loadu_si128((const __m128i *)(s1 + i + 8)));
+            hi = _mm_add_epi16(hi, _mm_loadu_si128((const __m128i *)(s2 + i + 8)));
+            hi = _mm_mulhi_epu16(_mm_add_epi16(hi, four), mul);
+
+            _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(lo, hi));
+
+            for(int k = i; k < i + 16; ++k) {
+                ++hist[dst[k]];
+            }
+
+        }
+#endif
+
+        for(; i < w; ++i) {
+            const unsigned int s = s0[i] + s1[i] + s2[i];
+            dst[i] = (unsigned char)DIV9(s);
+            ++hist[dst[i]];
+        }
+
+    }
+
+
+    /*
+     * Threshold a row: 255 where src > th, otherwise 0. If bInverse is
+     * true, the other way round.
+     */
+    static void thresholdRow(const unsigned char *src, int w, int th, bool bInverse, unsigned char *dst) {
+
+        const unsigned char valAbove = bInverse ? 0 : 255;
+        const unsigned char valBelow = bInverse ? 255 : 0;
+
+        // nothing is above
+        if(th >= 255) {
+            memset(dst, valBelow, w);
+            return;
+        }
+
+        int i = 0;
+
+#ifdef __SSE2__
+        // unsigned comparison with the signed instruction
+        const __m128i sign   = _mm_set1_epi8((char)0x80);
+        const __m128i thresh = _mm_set1_epi8((char)(th ^ 0x80));
+
+        for(; i + 16 <= w; i += 16) {
+
+            const __m128i v     = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(src + i)), sign);
+            const __m128i above = _mm_cmpgt_epi8(v, thresh);
+
+            _mm_storeu_si128((__m128i *)(dst + i),
+                             bInverse ? _mm_andnot_si128(above, _mm_set1_epi8((char)0xff)) : above);
+
+        }
+#endif
+
+        for(; i < w; ++i) {
+            dst[i] = src[i] > th ? valAbove : valBelow;
+        }
+
+    }
+
+
+    void Preprocessor::process(cv::Mat &img,
+                               const cv::Rect &rectWork,
+                               int thCr,
+                               cv::Mat &imgCr,
+                               int thPupil,
+                               cv::Mat &imgPupil) {
+
+        const int w = rectWork.width;
+        const int h = rectWork.height;
+
+        /*
+         * cv::blur() shrinks the kernel for single row and column images,
+         * leave such corner cases to OpenCV.
+         */
+        if(w < 3 || h < 3 || img.type() != CV_8UC1) {
+            processOpenCV(img, rectWork, thCr, imgCr, thPupil, imgPupil);
+            return;
+        }
+
+        const int x0 = rectWork.x;
+        const int y0 = rectWork.y;
+
+
+        /**********************************************************************
+         * Blur and compute the histogram. The rows are blurred in place,
+         * so the horizontal sums of the previous, current and next row
+         * are kept in a ring of three rows.
+         *********************************************************************/
+        m_vecRowSums.resize(3 * w);
+
+        unsigned short *sums[3] = {&m_vecRowSums[0],
+                                   &m_vecRowSums[w],
+                                   &m_vecRowSums[2 * w]};
+
+        memset(m_hist, 0, sizeof(m_hist));
+
+        // the row above may be outside the image, reflect as cv::blur() does
+        const int yAbove = cv::borderInterpolate(y0 - 1, img.rows, cv::BORDER_REFLECT_101);
+
+        rowSums(img.ptr<unsigned char>(yAbove), x0, w, img.cols, sums[0]);
+        rowSums(img.ptr<unsigned char>(y0), x0, w, img.cols, sums[1]);
+
+        for(int y = y0; y < y0 + h; ++y) {
+
+            if(y + 1 < img.rows) {
+                rowSums(img.ptr<unsigned char>(y + 1), x0, w, img.cols, sums[2]);
+            }
+            else {
+                // the row below is the reflection of the row above, which is already overwritten
+                memcpy(sums[2], sums[0], w * sizeof(unsigned short));
+            }
+
+            blurRow(sums[0], sums[1], sums[2], w, img.ptr<unsigned char>(y) + x0, m_hist);
+
+            unsigned short *tmp = sums[0];
+            sums[0] = sums[1];
+            sums[1] = sums[2];
+            sums[2] = tmp;
+
+        }
+
+
+        /**********************************************************************
+         * Equalise and threshold, one row at a time while the row is in
+         * the cache.
+         *********************************************************************/
+        unsigned char lut[256];
+        makeEqualiseLut(w * h, lut);
+
+        if(thCr >= 0) {
+            imgCr.create(img.size(), CV_8UC1);
+        }
+
+        if(thPupil >= 0) {
+            imgPupil.create(img.size(), CV_8UC1);
+        }
+
+        for(int y = y0; y < y0 + h; ++y) {
+
+            unsigned char *row = img.ptr<unsigned char>(y) + x0;
+
+            for(int i = 0; i < w; ++i) {
+                row[i] = lut[row[i]];
+            }
+
+            if(thCr >= 0) {
+                thresholdRow(row, w, thCr, false, imgCr.ptr<unsigned char>(y) + x0);
+            }
+
+            if(thPupil >= 0) {
+                thresholdRow(row, w, thPupil, true, imgPupil.ptr<unsigned char>(y) + x0);
+            }
+
+        }
+
+    }
+
+
+    void Preprocessor::makeEqualiseLut(int nTotal, unsigned char *lut) const {
+
+        memset(lut, 0, 256);
+
+#ifdef EQUALIZE_HIST_243
+
+        int i = 0;
+        while(!m_hist[i]) {
+            ++i;
+        }
+
+        // a uniform image is left as it is
+        if(m_hist[i] == nTotal) {
+            lut[i] = (unsigned char)i;
+            return;
+        }
+
+        const float scale = 255.f / (nTotal - m_hist[i]);
+        int sum = 0;
+
+        for(lut[i++] = 0; i < 256; ++i) {
+            sum += m_hist[i];
+            lut[i] = cv::saturate_cast<unsigned char>(sum * scale);
+        }
+
+#else
+
+        const float scale = 255.f / nTotal;
+        int sum = 0;
+
+        for(int i = 0; i < 256; ++i) {
+            sum += m_hist[i];
+            const int val = cvRound(sum * scale);
+            lut[i] = (unsigned char)(val < 0 ? 0 : (val > 255 ? 255 : val));
+        }
+
+        lut[0] = 0;
+
+#endif
+
+    }
+
+
+    void Preprocessor::processOpenCV(cv::Mat &img,
+                                     const cv::Rect &rectWork,
+                                     int thCr,
+                                     cv::Mat &imgCr,
+                                     int thPupil,
+                                     cv::Mat &imgPupil) {
+
+        cv::Mat imgWork(img, rectWork);
+
+        cv::blur(imgWork, imgWork, cv::Size(3, 3));
+        cv::equalizeHist(imgWork, imgWork);
+
+        if(thCr >= 0) {
+            imgCr.create(img.size(), CV_8UC1);
+            cv::Mat imgCrWork(imgCr, rectWork);
+            cv::threshold(imgWork, imgCrWork, thCr, 255, cv::THRESH_BINARY);
+        }
+
+        if(thPupil >= 0) {
+            imgPupil.create(img.size(), CV_8UC1);
+            cv::Mat imgPupilWork(imgPupil, rectWork);
+            cv::threshold(imgWork, imgPupilWork, thPupil, 255, cv::THRESH_BINARY_INV);
+        }
+
+    }
+
+
+} // end of "namespace gt"
@@ -0,0 +1,77 @@
+#ifndef PREPROCESSOR_H
+#define PREPROCESSOR_H
+
+#include <vector>
+#include <opencv2/imgproc/imgproc.hpp>
+
+
+namespace gt {
+
+
+    /*****************************************************************************
+     * Preprocessing of the eye image
+     ****************************************************************************/
+
+    /*
+     * Does the preprocessing of PupilTracker, i.e. a 3x3 blur and the
+     * histogram equalisation, and makes the binary images for the pupil
+     * and the corneal reflections, in two sweeps over the image instead
+     * of four. The histogram is built while blurring, the second sweep
+     * equalises and thresholds the image one row at a time.
+     *
+     * The results are identical to those of processOpenCV(). The row
+     * loops use SSE2 when available.
+     */
+    class Preprocessor {
+
+    public:
+
+        /*
+         * Preprocess the area rectWork of img in place and make the
+         * binary images:
+         *
+         *   imgCr    : 255 where the result > thCr, 0 elsewhere
+         *   imgPupil : 0 where the result > thPupil, 255 elsewhere
+         *
+         * The binary images are allocated to the size of img, if
+         * necessary, and only the area rectWork is written. If a
+         * threshold is negative, the binary image is not made. The
+         * pixels around rectWork, if any, are used for blurring the
+         * edges, as cv::blur() does.
+         */
+        void process(cv::Mat &img,
+                     const cv::Rect &rectWork,
+                     int thCr,
+                     cv::Mat &imgCr,
+                     int thPupil,
+                     cv::Mat &imgPupil);
+
+        /*
+         * The same as process() with cv::blur(), cv::equalizeHist() and
+         * cv::threshold().
+         */
+        static void processOpenCV(cv::Mat &img,
+                                  const cv::Rect &rectWork,
+                                  int thCr,
+                                  cv::Mat &imgCr,
+                                  int thPupil,
+                                  cv::Mat &imgPupil);
+
+    private:
+
+        /* Build the look-up table of cv::equalizeHist() from m_hist */
+        void makeEqualiseLut(int nTotal, unsigned char *lut) const;
+
+        /* Three rows of horizontal sums, reused between frames */
+        std::vector<unsigned short> m_vecRowSums;
+
+        /* The histogram of the blurred work area */
+        int m_hist[256];
+
+    };
+
+
+} // end of "namespace gt"
+
+
+#endif // PREPROCESSOR_H
@@ -27,16 +27,31 @@ namespace gt {
 
 
     PupilTracker::PupilTracker() {
+        init(trackerSettings);
+    }
+
+
+    PupilTracker::PupilTracker(const TrackerSettings &settings) {
+        init(settings);
+    }
 
-        this->ellipse_pupil = cv::RotatedRect();
+
+    void PupilTracker::init(const TrackerSettings &settings) {
+
+        // the private copy of the settings, passed on to the starburst
+        m_settings = settings;
+        starburst.setSettings(m_settings);
+
+        m_ellipsePrevious = cv::RotatedRect();
+        m_bPreviousFound  = false;
 
         // initially there are 2 trackable CRs
-        crs.setMax(2);
+        m_nMaxCrs = 2;
 
 
         // thresholds, when adaptive th is being used th.pupil will be computed automatically
-        this->thresholds.pupil	= trackerSettings.PUPIL_THRESHOLD;
-        this->thresholds.cr		= trackerSettings.CR_THRESHOLD;
+        m_frame.thresholds.pupil = m_settings.PUPIL_THRESHOLD;
+        m_frame.thresholds.cr    = m_settings.CR_THRESHOLD;
 
         /*
          * Initialise the threshold averager with a buffer size, i.e. how many
@@ -53,32 +68,56 @@ namespace gt {
 
         this->failed_tracks = 0;
 
+        // by default the whole frame is copied
+        m_bCropOnly = false;
+
+        // and the frames are flipped by the caller
+        m_bMirrored = false;
+
+        // the CR template will be created on the first frame
+        m_nCrTemplateLen    = -1;
+        m_nCrTemplateRadius = -1;
+
         precomputeRays();
 
-        m_rectRoi.width  = trackerSettings.ROI_W_DEFAULT;
-        m_rectRoi.height = trackerSettings.ROI_H_DEFAULT;
+        m_frame.m_rectRoi.width  = m_settings.ROI_W_DEFAULT;
+        m_frame.m_rectRoi.height = m_settings.ROI_H_DEFAULT;
 
     }
 
 
     PupilTracker::~PupilTracker() {
 
-        this->crs.getCentres().clear();
-
         distX.clear();
         distY.clear();
 
     }
 
 
+    void PupilTracker::setSettings(const TrackerSettings &settings) {
+
+        const bool bRaysChanged = settings.NOF_RAYS         != m_settings.NOF_RAYS ||
+                                  settings.MAX_PUPIL_RADIUS != m_settings.MAX_PUPIL_RADIUS;
+
+        m_settings = settings;
+        starburst.setSettings(m_settings);
+
+        if(bRaysChanged) {
+            precomputeRays();
+        }
+
+    }
+
+
+    /* Affects only this instance */
     void PupilTracker::useAutoTh(bool t) {
-        trackerSettings.AUTO_THRESHOLD = t ? 1 : 0;
+        m_settings.AUTO_THRESHOLD = t ? 1 : 0;
     }
 
 
     void PupilTracker::precomputeRays() {
 
-        int n = trackerSettings.NOF_RAYS;
+        int n = m_settings.NOF_RAYS;
         if(n % 2 != 0) {
             printf("PupilTracker::precomputeRays(): NOF_RAYS is not even %d\n", n);
             ++n; // increase to achvieve even count
@@ -100,8 +139,8 @@ namespace gt {
         for(int i = 0; i < n2; ++i) {
 
             // right side
-            this->distX[i] = (int)ROUND(trackerSettings.MAX_PUPIL_RADIUS * cos(ang));
-            this->distY[i] = (int)ROUND(trackerSettings.MAX_PUPIL_RADIUS * sin(ang));
+            this->distX[i] = (int)ROUND(m_settings.MAX_PUPIL_RADIUS * cos(ang));
+            this->distY[i] = (int)ROUND(m_settings.MAX_PUPIL_RADIUS * sin(ang));
 
             // left side
             this->distX[n2 + i] = -this->distX[i];
@@ -129,31 +168,67 @@ namespace gt {
      */
     bool PupilTracker::track(const cv::Mat &_img, const cv::Point2f *suggestedStartPoint) {
 
-        // This does copy the data
-        m_imgGray = _img.clone();
+        prepare(_img, m_frame);
 
-        // check that the crop area is ok and adjust if necessary
-        checkCropArea();
+        const bool bPupilFound = findPupil(m_frame, suggestedStartPoint);
+
+        findGlints(m_frame);
+
+        return bPupilFound;
+
+    }
+
+
+    void PupilTracker::prepare(const cv::Mat &_img, PupilFrame &f) const {
+
+        // the stages of the previous frame
+        f.m_times.clear();
+
+        ScopedStage timer(f.m_times, StageTimes::STAGE_PREPARE);
+
+        /*
+         * This does copy the data, either the whole frame or only the
+         * crop area. From here on everything is in work coordinates,
+         * until toFrameCoordinates() is called.
+         */
+        copyInput(_img, f);
 
         /*
          * Preprocess, i.e. apply histogram equalisation etc.
          */
-        preprocessImage();
+        preprocessImage(f);
 
+    }
+
+
+    bool PupilTracker::findPupil(PupilFrame &f, const cv::Point2f *suggestedStartPoint) {
+
+        /*
+         * The starburst keeps its start point in work coordinates. If the
+         * work area has moved, the start point is not valid anymore.
+         */
+        if(f.m_pointOffset != m_pointOffsetPrevious) {
+            starburst.reset();
+        }
 
-        clusterLabels.clear();
+        m_pointOffsetPrevious = f.m_pointOffset;
+
+
+        f.clusterLabels.clear();
 
         /*
          * Clear previous clusters, so that when getting the clusters
          * the caller does not get the previously detected clusters.
          */
-        clusteriser.clearClusters();
+        f.clusteriser.clearClusters();
 
 
         /***********************************************************************
          * Perform starburst to define th ROI, if ROI was not given
          ***********************************************************************/
-        if(!define_ROI(suggestedStartPoint)) {
+        ScopedStage timer(f.m_times, StageTimes::STAGE_STARBURST);
+
+        if(!define_ROI(f, suggestedStartPoint)) {
 
             /***********************************************************************
              * Clear all temporary variables only here, because define_ROI()
@@ -172,74 +247,65 @@ namespace gt {
          * Clear all temporary variables only here, because define_ROI()
          * depends on these variables
          ***********************************************************************/
-        this->clearVars();
+        clearVars(f);
+
+        timer.next(StageTimes::STAGE_CLUSTERS);
 
 
         /***********************************************************************
          * Threshold the image. Use auto threshold if requested
          ***********************************************************************/
-        if(trackerSettings.AUTO_THRESHOLD) {
+        if(m_settings.AUTO_THRESHOLD) {
 
             unsigned char val = this->starburst.getThreshold();
             thresholdAverager.add(val);
-            thresholds.pupil = thresholdAverager.getAverage();
+            f.thresholds.pupil = thresholdAverager.getAverage();
 
         }
         else {
-            thresholds.pupil = trackerSettings.PUPIL_THRESHOLD;
+            f.thresholds.pupil = m_settings.PUPIL_THRESHOLD;
         }
 
-        this->thresholds.cr = trackerSettings.CR_THRESHOLD;
+        f.thresholds.cr = m_settings.CR_THRESHOLD;
 
-        // thresholding done only for the part defined by the ROI
-        thresholdImage(this->thresholds.pupil, m_rectRoi);
+        /*
+         * Threshold the whole work area, the edge points are searched
+         * also outside the ROI. With a fixed threshold this has been
+         * done already by preprocessImage().
+         */
+        thresholdImage(f, f.thresholds.pupil);
 
 
         /***********************************************************************
-         * Get clusters in the binary image within the ROI. Fill the holes so
-         * that they do not disturb the ellipse fitting.
+         * Get clusters in the binary image within the ROI. The clusteriser
+         * fills the holes with the pupil color, because some of them might
+         * be glints and might cause distortion if located inside the pupil.
+         * Only the clusters with a suitable size and area are kept.
          ***********************************************************************/
-        clusteriser.clusterise(m_imgBinary, m_rectRoi);
+        f.clusteriser.setLimits(m_settings.MIN_CLUSTER_SIZE,
+                                m_settings.MAX_CLUSTER_SIZE,
+                                m_settings.MIN_PUPIL_AREA);
 
-        {
-
-            /*
-             * Fill all holes with the pupil color because some of them might
-             * be glints and might cause distortion if located inside the pupil.
-             */
-            const std::vector<Cluster> &clusters = clusteriser.getClusters();
-            const std::vector<int> &ind_holes    = clusteriser.getHoleIndices();
-            const size_t nOfHoles                = ind_holes.size();
-            const cv::Scalar color(BINARY_BLACK);
-
-            for(size_t i = 0; i < nOfHoles; ++i) {
-                cv::drawContours(m_imgBinary, clusters, ind_holes[i], color, CV_FILLED, 8);
-            }
-
-        }
+        f.clusteriser.clusterise(f.m_imgBinary, f.m_rectRoi);
 
 
         /***********************************************************************
          * Determine which cluster is the pupil
          ***********************************************************************/
-        if(getPupilFromClusters()) {
+        timer.next(StageTimes::STAGE_ELLIPSE);
 
-            this->starburst.setStartPoint(ellipse_pupil.center);
-            this->failed_tracks = 0;
+        f.m_bPupilFound = getPupilFromClusters(f);
 
+        if(f.m_bPupilFound) {
 
-            /***********************************************************************
-             * Track the eye lid boundaries within an angle. If the tracking
-             * fails, it is not too serious, the corneal reflections will be
-             * looked for withing a default area.
-             ***********************************************************************/
-            m_crSearchEllipse = trackEyeLids();
+            this->starburst.setStartPoint(f.ellipse_pupil.center);
+            this->failed_tracks = 0;
 
-
-            /***********************************************************************
-             * Track the corneal reflections
-             ***********************************************************************/
-            findCornealReflections();
+            // the next frame needs the pupil in frame coordinates
+            m_ellipsePrevious = f.ellipse_pupil;
+            m_ellipsePrevious.center += cv::Point2f((float)f.m_pointOffset.x,
+                                                    (float)f.m_pointOffset.y);
+            m_bPreviousFound  = true;
 
             return true;
 
@@ -249,16 +315,19 @@ namespace gt {
         /***********************************************************************
          * The pupil was not found
          ***********************************************************************/
-        this->cluster_pupil.clear();
+        f.cluster_pupil.clear();
+
+        f.ellipse_pupil = cv::RotatedRect();
 
-        this->ellipse_pupil = cv::RotatedRect();
+        m_ellipsePrevious = cv::RotatedRect();
+        m_bPreviousFound  = false;
 
-        if(failed_tracks++ > trackerSettings.MAX_FAILED_TRACKS_BEFORE_RESET) {
+        if(failed_tracks++ > m_settings.MAX_FAILED_TRACKS_BEFORE_RESET) {
 
             failed_tracks = 0;
             this->starburst.reset();
-            lastValidSBPoint.x = m_rectCrop.x + (m_rectCrop.width >> 1);
-            lastValidSBPoint.x = m_rectCrop.y + (m_rectCrop.height >> 1);
+            lastValidSBPoint.x = f.m_rectCrop.x + (f.m_rectCrop.width >> 1);
+            lastValidSBPoint.y = f.m_rectCrop.y + (f.m_rectCrop.height >> 1);
 
         }
 
@@ -267,33 +336,61 @@ namespace gt {
     }
 
 
-    bool PupilTracker::define_ROI(const cv::Point2f *suggestedStartPoint) {
+    void PupilTracker::findGlints(PupilFrame &f) {
+
+        if(f.m_bPupilFound) {
+
+            /***********************************************************************
+             * Track the eye lid boundaries within an angle. If the tracking
+             * fails, it is not too serious, the corneal reflections will be
+             * looked for withing a default area.
+             ***********************************************************************/
+            ScopedStage timer(f.m_times, StageTimes::STAGE_EYELIDS);
+
+            f.m_crSearchEllipse = trackEyeLids(f);
+
+
+            /***********************************************************************
+             * Track the corneal reflections
+             ***********************************************************************/
+            timer.next(StageTimes::STAGE_CRS);
+
+            findCornealReflections(f);
+
+        }
+
+        toFrameCoordinates(f);
+
+    }
+
+
+    bool PupilTracker::define_ROI(PupilFrame &f, const cv::Point2f *suggestedStartPoint) {
 
         // default values
-        int roiW = trackerSettings.ROI_W_DEFAULT;
-        int roiH = trackerSettings.ROI_H_DEFAULT;
+        int roiW = m_settings.ROI_W_DEFAULT;
+        int roiH = m_settings.ROI_H_DEFAULT;
 
         /***********************************************************************
          * Suggest a size for the ROI based on the size of the previously
          * found pupil ellipse
          ***********************************************************************/
-        if(cluster_pupil.size() != 0) {
+        if(m_bPreviousFound) {
 
-            double ellipseMajorAxis = std::max(ellipse_pupil.size.width,
-                                               ellipse_pupil.size.height);
+            double ellipseMajorAxis = std::max(m_ellipsePrevious.size.width,
+                                               m_ellipsePrevious.size.height);
 
-            roiW = (int)(trackerSettings.ROI_MULTIPLIER * ellipseMajorAxis + 0.5);
+            roiW = (int)(m_settings.ROI_MULTIPLIER * ellipseMajorAxis + 0.5);
 
         }
 
         // restrict the width
-        roiW = std::max(roiW, trackerSettings.MIN_ROI_W);
-        roiW = std::min(roiW, m_rectCrop.width);
+        roiW = std::max(roiW, m_settings.MIN_ROI_W);
+        roiW = std::min(roiW, f.m_rectWork.width);
 
         roiH = roiW;
-        roiH = std::min(roiH, m_rectCrop.height);
+        roiH = std::min(roiH, f.m_rectWork.height);
 
-        // starburst start point
+        // starburst start point, in frame coordinates
         cv::Point2f sbsp = cv::Point2f(-1, -1);
 
         if(suggestedStartPoint != NULL) {
@@ -301,9 +398,9 @@ namespace gt {
             sbsp = *suggestedStartPoint;
 
         }
-        else if(ellipse_pupil.center.x > 0 && ellipse_pupil.center.y > 0) {
+        else if(m_ellipsePrevious.center.x > 0 && m_ellipsePrevious.center.y > 0) {
 
-            sbsp = ellipse_pupil.center;
+            sbsp = m_ellipsePrevious.center;
 
         }
         else if(lastValidSBPoint.x > 0 && lastValidSBPoint.y > 0) {
@@ -312,13 +409,20 @@ namespace gt {
 
         }
 
+        // the starburst works in work coordinates
+        cv::Point2f sbspWork = sbsp;
+        if(sbsp.x > 0 && sbsp.y > 0) {
+            sbspWork.x -= f.m_pointOffset.x;
+            sbspWork.y -= f.m_pointOffset.y;
+        }
+
         // perform starburst and use the results to define the ROI
-        if(!this->starburst.process(m_imgGray, m_rectCrop, sbsp)) {
+        if(!this->starburst.process(f.m_imgGray, f.m_rectWork, sbspWork)) {
 
-            m_rectRoi.x      = m_rectCrop.x;
-            m_rectRoi.y      = m_rectCrop.y;
-            m_rectRoi.width  = std::min(trackerSettings.ROI_W_DEFAULT, m_rectCrop.width);
-            m_rectRoi.height = std::min(trackerSettings.ROI_W_DEFAULT, m_rectCrop.height);
+            f.m_rectRoi.x      = f.m_rectWork.x;
+            f.m_rectRoi.y      = f.m_rectWork.y;
+            f.m_rectRoi.width  = std::min(m_settings.ROI_W_DEFAULT, f.m_rectWork.width);
+            f.m_rectRoi.height = std::min(m_settings.ROI_W_DEFAULT, f.m_rectWork.height);
 
             starburst.reset();
 
@@ -339,10 +443,10 @@ namespace gt {
 
             starburst.reset();
 
-            m_rectRoi.x      = m_rectCrop.x;
-            m_rectRoi.y      = m_rectCrop.y;
-            m_rectRoi.width  = std::min(trackerSettings.ROI_W_DEFAULT, m_rectCrop.width);
-            m_rectRoi.height = std::min(trackerSettings.ROI_W_DEFAULT, m_rectCrop.height);
+            f.m_rectRoi.x      = f.m_rectWork.x;
+            f.m_rectRoi.y      = f.m_rectWork.y;
+            f.m_rectRoi.width  = std::min(m_settings.ROI_W_DEFAULT, f.m_rectWork.width);
+            f.m_rectRoi.height = std::min(m_settings.ROI_W_DEFAULT, f.m_rectWork.height);
 
             sbVarianceAverager.init(-1);
 
@@ -357,11 +461,11 @@ namespace gt {
 
         cv::Point2f roiCentre = starburst.getROICenter();
 
-        m_rectRoi.x      = roiCentre.x - roiW2;
-        m_rectRoi.y      = roiCentre.y - roiH2;
-        m_rectRoi.width	 = roiW;
-        m_rectRoi.height = roiH;
-        fitRectIntoRect(m_rectCrop, m_rectRoi);
+        f.m_rectRoi.x      = roiCentre.x - roiW2;
+        f.m_rectRoi.y      = roiCentre.y - roiH2;
+        f.m_rectRoi.width	 = roiW;
+        f.m_rectRoi.height = roiH;
+        fitRectIntoRect(f.m_rectWork, f.m_rectRoi);
 
         /*
          * http://en.wikipedia.org/wiki/Variance
@@ -379,82 +483,174 @@ namespace gt {
     }
 
 
-    void PupilTracker::preprocessImage() {
+    void PupilTracker::preprocessImage(PupilFrame &f) const {
 
-        cv::Mat imgGrayCrop = cv::Mat(m_imgGray, m_rectCrop);
+        /*
+         * The CR threshold is always fixed. The auto threshold of the
+         * pupil is known only after the starburst, in that case
+         * thresholdImage() makes the pupil image.
+         */
+        f.m_nCrMaskThreshold    = m_settings.CR_THRESHOLD;
+        f.m_nPupilMaskThreshold = m_settings.AUTO_THRESHOLD ? -1 : m_settings.PUPIL_THRESHOLD;
 
         /*
+         * Blur, equalise the histogram and threshold in one go, see
+         * Preprocessor.
          * Note: If you remove the blur from here, add it to trackEyeLids().
          */
-        //cv::medianBlur(imgGrayCrop, imgGrayCrop, 5);
-        cv::blur(imgGrayCrop, imgGrayCrop, cv::Size(3, 3));
-        cv::equalizeHist(imgGrayCrop, imgGrayCrop);
+        f.m_preprocessor.process(f.m_imgGray,
+                                 f.m_rectWork,
+                                 f.m_nCrMaskThreshold,
+                                 f.m_imgBinaryCr,
+                                 f.m_nPupilMaskThreshold,
+                                 f.m_imgBinary);
+
+    }
+
+
+    void PupilTracker::copyInput(const cv::Mat &img, PupilFrame &f) const {
+
+        f.m_sizeFrame = img.size();
+
+        // check that the crop area is ok and adjust if necessary
+        checkCropArea(f.m_sizeFrame, f.m_rectCrop);
+
+        f.m_pointOffset = cv::Point(0, 0);
+        if(m_bCropOnly) {
+            f.m_pointOffset = f.m_rectCrop.tl();
+        }
+
+        f.m_rectWork = f.m_rectCrop - f.m_pointOffset;
+
+        /*
+         * copyTo() and flip() reallocate the work image only if the size
+         * has changed. A mirrored frame is flipped while copying, so the
+         * work image is the same as for a frame flipped by the caller.
+         */
+        if(m_bMirrored) {
+
+            if(m_bCropOnly) {
+
+                cv::Rect rectInput = f.m_rectCrop;
+                rectInput.x = f.m_sizeFrame.width - f.m_rectCrop.x - f.m_rectCrop.width;
+
+                cv::flip(cv::Mat(img, rectInput), f.m_imgGray, 1);
+
+            }
+            else {
+                cv::flip(img, f.m_imgGray, 1);
+            }
+
+        }
+        else if(m_bCropOnly) {
+            cv::Mat(img, f.m_rectCrop).copyTo(f.m_imgGray);
+        }
+        else {
+            img.copyTo(f.m_imgGray);
+        }
+
+    }
+
+
+    void PupilTracker::toFrameCoordinates(PupilFrame &f) {
+
+        const cv::Point &offset = f.m_pointOffset;
+
+        f.clusteriser.translate(offset);
+
+        if(offset.x == 0 && offset.y == 0) {
+            return;
+        }
+
+        f.m_rectRoi += offset;
+
+        if(!f.m_bPupilFound) {
+            return;
+        }
+
+        const cv::Point2f pointOffset((float)offset.x, (float)offset.y);
+
+        f.ellipse_pupil.center += pointOffset;
+
+        f.m_crSearchEllipse.center += pointOffset;
+
+        std::vector<cv::Point>::iterator itCluster = f.cluster_pupil.begin();
+        for(; itCluster != f.cluster_pupil.end(); ++itCluster) {
+            *itCluster += offset;
+        }
+
+        std::vector<cv::Point2d> &centres = f.crs.getCentres();
+        std::vector<cv::Point2d>::iterator itCr = centres.begin();
+        for(; itCr != centres.end(); ++itCr) {
+            itCr->x += offset.x;
+            itCr->y += offset.y;
+        }
 
     }
 
 
-    void PupilTracker::checkCropArea() {
+    void PupilTracker::checkCropArea(const cv::Size &sizeFrame, cv::Rect &rectCrop) const {
 
-        m_rectCrop.x      = trackerSettings.CROP_AREA_X;
-        m_rectCrop.y      = trackerSettings.CROP_AREA_Y;
-        m_rectCrop.width  = trackerSettings.CROP_AREA_W;
-        m_rectCrop.height = trackerSettings.CROP_AREA_H;
+        rectCrop.x      = m_settings.CROP_AREA_X;
+        rectCrop.y      = m_settings.CROP_AREA_Y;
+        rectCrop.width  = m_settings.CROP_AREA_W;
+        rectCrop.height = m_settings.CROP_AREA_H;
 
-        if(m_rectCrop.x < 0      ||
-           m_rectCrop.y < 0      ||
-           m_rectCrop.width <= 0 ||
-           m_rectCrop.height <= 0) {
+        if(rectCrop.x < 0      ||
+           rectCrop.y < 0      ||
+           rectCrop.width <= 0 ||
+           rectCrop.height <= 0) {
 
-            m_rectCrop = cv::Rect();
+            rectCrop = cv::Rect();
 
         }
 
-        int imgWidth  = m_imgGray.cols;
-        int imgHeight = m_imgGray.rows;
+        int imgWidth  = sizeFrame.width;
+        int imgHeight = sizeFrame.height;
 
 
-        if(m_rectCrop.width == 0 || m_rectCrop.height == 0 ||
-           m_rectCrop.x >= imgWidth || m_rectCrop.y >= imgHeight) {
+        if(rectCrop.width == 0 || rectCrop.height == 0 ||
+           rectCrop.x >= imgWidth || rectCrop.y >= imgHeight) {
 
-            m_rectCrop = cv::Rect(0, 0, m_imgGray.cols, m_imgGray.rows);
+            rectCrop = cv::Rect(0, 0, imgWidth, imgHeight);
             return;
         }
 
-        if(m_rectCrop.x + m_rectCrop.width - 1 >= imgWidth) {
+        if(rectCrop.x + rectCrop.width - 1 >= imgWidth) {
 
             printf("Restricting the width of the cropped area\n"
                    "  old: (%d, %d, %d, %d)\n",
-                   m_rectCrop.x,
-                   m_rectCrop.y,
-                   m_rectCrop.width,
-                   m_rectCrop.height);
+                   rectCrop.x,
+                   rectCrop.y,
+                   rectCrop.width,
+                   rectCrop.height);
 
-            m_rectCrop.width = imgWidth - m_rectCrop.x;
+            rectCrop.width = imgWidth - rectCrop.x;
 
             printf("  new: (%d, %d, %d, %d)\n",
-                   m_rectCrop.x,
-                   m_rectCrop.y,
-                   m_rectCrop.width,
-                   m_rectCrop.height);
+                   rectCrop.x,
+                   rectCrop.y,
+                   rectCrop.width,
+                   rectCrop.height);
 
         }
 
-        if(m_rectCrop.y + m_rectCrop.height - 1 >= imgHeight) {
+        if(rectCrop.y + rectCrop.height - 1 >= imgHeight) {
 
             printf("Restricting the height of the cropped area\n"
                    "  old: (%d, %d, %d, %d)\n",
-                   m_rectCrop.x,
-                   m_rectCrop.y,
-                   m_rectCrop.width,
-                   m_rectCrop.height);
+                   rectCrop.x,
+                   rectCrop.y,
+                   rectCrop.width,
+                   rectCrop.height);
 
-            m_rectCrop.height = imgHeight - m_rectCrop.y;
+            rectCrop.height = imgHeight - rectCrop.y;
 
             printf("  new: (%d, %d, %d, %d)\n",
-                   m_rectCrop.x,
-                   m_rectCrop.y,
-                   m_rectCrop.width,
-                   m_rectCrop.height);
+                   rectCrop.x,
+                   rectCrop.y,
+                   rectCrop.width,
+                   rectCrop.height);
 
         }
 
@@ -475,7 +671,7 @@ namespace gt {
      *
      *		3. Choose the best ellipse in terms of the fitting error
      */
-    bool PupilTracker::getPupilFromClusters() {
+    bool PupilTracker::getPupilFromClusters(PupilFrame &f) {
 
         double err = HUGE_ERROR_DBL, smallest_err = HUGE_ERROR_DBL;
 
@@ -498,8 +694,9 @@ namespace gt {
 
 
         // get the clusters from the clusteriser
-        const std::vector<Cluster> &clusters		 = clusteriser.getClusters();
-        const std::vector<int> &ind_clusters = clusteriser.getClusterIndices();
+        const std::vector<Cluster> &clusters		 = f.clusteriser.getClusters();
+        const std::vector<int> &ind_clusters = f.clusteriser.getClusterIndices();
+        const std::vector<Blob> &blobs       = f.clusteriser.getBlobs();
 
         // the number of pupil candidates
         unsigned int nCandidates = 0;
@@ -512,24 +709,16 @@ namespace gt {
         std::vector<int>::const_iterator it_ind_clusters = ind_clusters.begin();
         std::vector<int>::const_iterator itEndClusters	 = ind_clusters.end();
 
-        clusterLabels.resize(ind_clusters.size(), 0);
-        std::vector<int>::iterator itLabel = clusterLabels.begin();
+        f.clusterLabels.resize(ind_clusters.size(), 0);
+        std::vector<int>::iterator itLabel = f.clusterLabels.begin();
 
         for(; it_ind_clusters != itEndClusters; ++it_ind_clusters) {
 
             // get a reference to the current cluster
             const Cluster *curCluster = &(clusters[*it_ind_clusters]);
 
-
-            /****************************************************************
-             * Test the cluster
-             ****************************************************************/
-
-            if(!testCluster(*curCluster)) {
-                *itLabel = -1;
-                ++itLabel;
-                continue;
-            }
+            // the clusters have been tested by the clusteriser
+            const Blob &curBlob = blobs[*it_ind_clusters];
 
 
             /****************************************************************
@@ -543,7 +732,7 @@ namespace gt {
             cv::RotatedRect curEllipse;
 
             // fit
-            if(!doubleEllipseFit(*curCluster, curEllipse, edgePoints)) {
+            if(!doubleEllipseFit(f, curBlob, curEllipse, edgePoints)) {
                 *itLabel = -2;
                 ++itLabel;
                 continue;
@@ -556,7 +745,7 @@ namespace gt {
              ****************************************************************/
 
             double errCandidate;
-            if(!testPupilCandidate(curEllipse, edgePoints.size(), errCandidate)) {
+            if(!testPupilCandidate(f, curEllipse, edgePoints.size(), errCandidate)) {
                 *itLabel = -3;
                 ++itLabel;
                 continue;
@@ -574,7 +763,7 @@ namespace gt {
 
             if(errCandidate < err) {
 
-                if(isCoherent(curEllipse)) {
+                if(isCoherent(f, curEllipse)) {
 
                     ellipse_best_coherence	= curEllipse;
                     cluster_best_coherence	= curCluster;
@@ -613,19 +802,19 @@ namespace gt {
              */
             if(cluster_best_coherence == NULL) {
 
-                cluster_pupil = *cluster_with_smallest_err;
-                ellipse_pupil =  ellipse_with_smallest_err;
+                f.cluster_pupil = *cluster_with_smallest_err;
+                f.ellipse_pupil =  ellipse_with_smallest_err;
 
             }
             else {
 
-                cluster_pupil = *cluster_with_smallest_err;
-                ellipse_pupil =  ellipse_with_smallest_err;
+                f.cluster_pupil = *cluster_with_smallest_err;
+                f.ellipse_pupil =  ellipse_with_smallest_err;
 
             }
 
             // Delete the data of the first verification frame
-            if(this->previous_ellipses.size() == trackerSettings.NOF_VERIFICATION_FRAMES) {
+            if(this->previous_ellipses.size() == m_settings.NOF_VERIFICATION_FRAMES) {
                 this->previous_ellipses.erase(this->previous_ellipses.begin());
             }
 
@@ -651,10 +840,10 @@ namespace gt {
     }
 
 
-    bool PupilTracker::isCoherent(const cv::RotatedRect &ellipse) {
+    bool PupilTracker::isCoherent(const PupilFrame &f, const cv::RotatedRect &ellipse) {
 
-        // Magic number from Kiyama's paper.
-        double magicNumber = m_imgGray.cols / 120.0;
+        // Magic number from Kiyama's paper. Relative to the frame, not to the work image.
+        double magicNumber = f.m_sizeFrame.width / 120.0;
 
         /*
          * Check whether the last N pupils agree with the pupil candidate.
@@ -679,47 +868,13 @@ namespace gt {
         }
 
         // Did the previous frames agree with the current estimate?
-        return nBadFrames <= trackerSettings.MAX_NOF_BAD_FRAMES;
+        return nBadFrames <= m_settings.MAX_NOF_BAD_FRAMES;
 
     }
 
 
-    bool PupilTracker::testCluster(const Cluster &cluster) {
-
-        // consider only clusters containing a number of points within a certain range
-        int sz_cluster = (int)cluster.size();
-
-        if(sz_cluster < trackerSettings.MIN_CLUSTER_SIZE ||
-           sz_cluster > trackerSettings.MAX_CLUSTER_SIZE) {
-
-            return false;
-
-        }
-
-        // get the start and end points
-        int x_start	= cluster.front().x;
-        int y_start	= cluster.front().y;
-        int x_end	= cluster.back().x;
-        int y_end	= cluster.back().y;
-
-        /*
-         * See if the start and end points meet and that the area
-         * is greater than the minimum defined area.
-         */
-        if(std::abs(x_start - x_end) > 1 ||
-           std::abs(y_start - y_end) > 1 ||
-           cv::contourArea(cluster) <= trackerSettings.MIN_PUPIL_AREA) {
-
-            return false;
-
-        }
-
-        return true;
-
-    }
-
-
-    bool PupilTracker::doubleEllipseFit(const Cluster &curCluster,
+    bool PupilTracker::doubleEllipseFit(const PupilFrame &f,
+                                        const Blob &curBlob,
                                         cv::RotatedRect &ellipse,
                                         std::vector<cv::Point> &edgePoints) {
 
@@ -727,7 +882,7 @@ namespace gt {
         static const int nEllipseFits = 2;
 
         // the center of mass of the current cluster
-        cv::Point com = getCenterOfMass(curCluster);
+        cv::Point com((int)ROUND(curBlob.centroid.x), (int)ROUND(curBlob.centroid.y));
 
         for(int cFit = 0; cFit < nEllipseFits; ++cFit) {
 
@@ -739,10 +894,10 @@ namespace gt {
              * moving radially between -45 to 45 degrees towards the edges.
              *****************************************************************/
 
-            getEdgePoints(edgePoints, com.x, com.y);
+            getEdgePoints(f, edgePoints, com.x, com.y);
 
             // see that enough radiuses were found
-            if((int)edgePoints.size() < trackerSettings.MIN_NOF_RADIUSES) {
+            if((int)edgePoints.size() < m_settings.MIN_NOF_RADIUSES) {
 
                 edgePoints.clear();
 
@@ -763,9 +918,9 @@ namespace gt {
              */
             cv::Rect br = ellipse.boundingRect();
             if((br.x < 0)							||
-               (br.x + br.width > m_imgGray.cols)	||
+               (br.x + br.width > f.m_imgGray.cols)	||
                (br.y < 0)							||
-               (br.y + br.height > m_imgGray.rows)) {
+               (br.y + br.height > f.m_imgGray.rows)) {
 
                 edgePoints.clear();
 
@@ -784,31 +939,31 @@ namespace gt {
     }
 
 
-    void PupilTracker::getEdgePoints(std::vector<cv::Point> &pupil_points, const int xc, const int yc) {
+    void PupilTracker::getEdgePoints(const PupilFrame &f, std::vector<cv::Point> &pupil_points, const int xc, const int yc) {
 
         int sumx = 0;
         int sumy = 0;
 
         // if the user has changed the number of rays, precompute them again
-        if(distX.size() != (size_t)trackerSettings.NOF_RAYS) {
+        if(distX.size() != (size_t)m_settings.NOF_RAYS) {
             precomputeRays();
         }
 
 
         /* Get the edge points of the cluster by moving radially
            away from the center of mass and compute the mean as well */
-        for(int i = 0; i < trackerSettings.NOF_RAYS; ++i) {
+        for(int i = 0; i < m_settings.NOF_RAYS; ++i) {
 
             int x2;
             int y2;
 
             // distX and distY are pre-calculated arrays
-            setEndPoints(xc, yc, x2, y2, this->distX[i], this->distY[i]);
+            setEndPoints(f.m_rectWork, xc, yc, x2, y2, this->distX[i], this->distY[i]);
 
             cv::Point pointAtTH;
             cv::Point pointPriorToTH;
 
-            bool success = findFromLine(xc, yc, x2, y2,
+            bool success = findFromLine(f.m_imgBinary, xc, yc, x2, y2,
                                         BINARY_WHITE,
                                         pointAtTH,
                                         pointPriorToTH);
@@ -890,13 +1045,152 @@ namespace gt {
     }
 
 
+    /*
+     * The sum of saturate_cast<uchar>(0.5 * g + 128) over the gray levels g,
+     * i.e. of the gray image scaled as in the candidate comparison. cvRound()
+     * rounds halves to even, so an odd g rounds up if g / 2 is odd, and 255
+     * saturates. Branchless, so that the compiler can vectorise it.
+     */
+    static unsigned long sumHalfGray(const unsigned char *data, int n) {
+
+        unsigned long sum = 0;
+        for(int i = 0; i < n; ++i) {
+            const unsigned int g = data[i];
+            sum += 128 + ((g + ((g >> 1) & 1)) >> 1) - ((g + 1) >> 8);
+        }
+
+        return sum;
+
+    }
+
+
+    /*
+     * The template value, halved, of a pixel whose area is covered by the
+     * fraction c of the ellipse: 128 inside and 0 outside.
+     */
+    static inline int halfTemplate(double c) {
+
+        c = std::max(0.0, std::min(1.0, c));
+
+        return (int)(127.5 * c + 0.5);
+
+    }
+
+
+    /*
+     * The semi-axes of the ellipse that cv::ellipse() draws with CV_AA for e.
+     * It draws a polygon with a vertex every 90, 30, 18 or 5 degrees by the
+     * size of the ellipse, whose area is sin(step) / step of the ellipse, and
+     * the anti-aliased edge adds about 0.65 pixels to the axes.
+     */
+    static void getTemplateAxes(const cv::RotatedRect &e, double &a, double &b) {
+
+        a = 0.5 * e.size.width;
+        b = 0.5 * e.size.height;
+
+        const int r = (int)(std::max(a, b) + 0.5);
+        const double step = DEGTORAD(r < 3 ? 90 : r < 10 ? 30 : r < 15 ? 18 : 5);
+        const double k = sqrt(sin(step) / step);
+
+        a = k * a + 0.65;
+        b = k * b + 0.65;
+
+    }
+
+
+    /*
+     * The error is the mean of (0.5 * gray + 128) - template over the bounding
+     * rectangle br of the ellipse, where the template is 128 inside the ellipse
+     * and 0 outside. This used to be done with images, and the ellipse was
+     * drawn at its frame coordinates into the template of the size of br, so
+     * the template is empty unless the ellipse reaches the top left corner of
+     * the frame. The template is placed the same way here so that the
+     * candidates are scored as before.
+     *
+     * The error is computed row by row from the span of the ellipse on the
+     * row, the pixels of the span need not be visited. When the template is
+     * empty the error is the same as before, otherwise the anti-aliased edge
+     * is approximated, see tests/candidate_error for the tolerance.
+     */
+    double PupilTracker::getTemplateError(const cv::Mat &imgGray, const cv::RotatedRect &e, const cv::Rect &br) {
+
+        /**********************************************************************
+         * The ellipse as A*x^2 + 2*B*x*y + C*y^2 = 1 around its centre. On the
+         * row y the span is x = (-B*y +- sqrt(A - y^2 / (a*b)^2)) / A, since
+         * A*C - B^2 = 1 / (a*b)^2.
+         *********************************************************************/
+
+        double a, b;
+        getTemplateAxes(e, a, b);
+
+        // cv::ellipse() rounds the angle to degrees
+        const double ang    = DEGTORAD(cvRound(e.angle));
+        const double cs     = cos(ang);
+        const double sn     = sin(ang);
+        const double inv_a2 = 1.0 / (a * a);
+        const double inv_b2 = 1.0 / (b * b);
+
+        const double A       = cs * cs * inv_a2 + sn * sn * inv_b2;
+        const double B       = cs * sn * (inv_a2 - inv_b2);
+        const double inv_ab2 = inv_a2 * inv_b2;
+
+        unsigned long sumGray     = 0;
+        unsigned long sumTemplate = 0;
+
+        for(int row = 0; row < br.height; ++row) {
+
+            sumGray += sumHalfGray(imgGray.ptr<unsigned char>(br.y + row) + br.x, br.width);
+
+            // pixel centres are at integer coordinates of the template
+            const double dy   = row - e.center.y;
+            const double disc = A - dy * dy * inv_ab2;
+
+            // the row is outside the ellipse
+            if(disc <= 0.0) {
+                continue;
+            }
+
+            // the span in the template
+            const double half = sqrt(disc) / A;
+            const double mid  = e.center.x - B * dy / A;
+            const double xl   = mid - half;
+            const double xr   = mid + half;
+
+            // the pixels that contain the ends of the span, pixel x covers [x - 0.5, x + 0.5]
+            const int first = std::max((int)floor(xl + 0.5), 0);
+            const int last  = std::min((int)floor(xr + 0.5), br.width - 1);
+
+            if(first > last) {
+                continue;
+            }
+
+            // the pixels between the ends of the span are inside
+            if(last - first > 1) {
+                sumTemplate += 128 * (last - first - 1);
+            }
+
+            // the ends of the span
+            sumTemplate += halfTemplate(std::min(first + 0.5, xr) - std::max(first - 0.5, xl));
+            if(last != first) {
+                sumTemplate += halfTemplate(std::min(last + 0.5, xr) - std::max(last - 0.5, xl));
+            }
+
+        }
+
+        const int pixels = br.width * br.height;
+
+        return (double)(sumGray - sumTemplate) / (double)pixels;
+
+    }
+
+
     /* n = the number of edge points used in fitting the ellipse */
-    bool PupilTracker::testPupilCandidate(const cv::RotatedRect &e, int n, double &err) {
+    bool PupilTracker::testPupilCandidate(const PupilFrame &f, const cv::RotatedRect &e, int n, double &err) {
 
         err = HUGE_ERROR_DBL;
 
         //        if(e.size.width < 5.0 || e.size.height < 5.0) {
-        if(e.size.width < 2*trackerSettings.MIN_PUPIL_RADIUS || e.size.height < 2*trackerSettings.MIN_PUPIL_RADIUS) {
+        if(e.size.width < 2*m_settings.MIN_PUPIL_RADIUS || e.size.height < 2*m_settings.MIN_PUPIL_RADIUS) {
             //            printf("PupilTracker::testPupilCandidate(): ellipse too small\n");
             return false;
         }
@@ -910,46 +1204,16 @@ namespace gt {
         cv::Rect br = e.boundingRect();
 
         // Make sure that the ellipse is inside the ROI
-        if(br.x < m_rectRoi.x									||
-           br.x + br.width - 1 >= (m_rectRoi.x + m_rectRoi.width)	||
-           br.y < m_rectRoi.y									||
-           br.y + br.height - 1 >= (m_rectRoi.y + m_rectRoi.width)) {
+        if(br.x < f.m_rectRoi.x									||
+           br.x + br.width - 1 >= (f.m_rectRoi.x + f.m_rectRoi.width)	||
+           br.y < f.m_rectRoi.y									||
+           br.y + br.height - 1 >= (f.m_rectRoi.y + f.m_rectRoi.width)) {
 
             return false;
 
         }
 
-
-        // Get an image that has only the ellipse
-        cv::Mat roi_image(m_imgGray, br);
-
-        cv::Mat img_ellipse = roi_image.clone();
-
-        // Create an template image that should resemble the ellipse
-        cv::Mat img_template = cv::Mat(img_ellipse.size(), CV_8UC1);
-
-        // Create an ellipse inside the template image
-        cv::rectangle(img_template,
-                      cv::Point(0, 0),
-                      cv::Point(img_template.cols-1, img_template.rows-1),
-                      cv::Scalar(BINARY_WHITE),
-                      CV_FILLED);
-
-        cv::ellipse(img_template, e, cv::Scalar(BINARY_BLACK), CV_FILLED, CV_AA);
-
-        // Subtract the images.
-        img_ellipse.convertTo(img_ellipse, img_ellipse.type(), 0.5, 128);
-        img_template.convertTo(img_template, img_template.type(), 0.5, 0);
-        cv::Mat result_image = img_ellipse - img_template;
-
-        unsigned long sum = 0;
-        int pixels = result_image.rows * result_image.cols;
-        unsigned char *data = result_image.data;
-        for(int i = 0; i < pixels; ++i) {
-            sum += data[i];
-        }
-
-        err = ((double)sum / (double)pixels) * ((double)trackerSettings.NOF_RAYS / (double)n);
+        err = getTemplateError(f.m_imgGray, e, br) * ((double)m_settings.NOF_RAYS / (double)n);
 
         return true;
 
@@ -980,55 +1244,51 @@ namespace gt {
     }
 
 
-    cv::RotatedRect PupilTracker::trackEyeLids() {
+    cv::RotatedRect PupilTracker::trackEyeLids(const PupilFrame &f) {
 
         // define a roi based on the pupil size
-        const cv::Rect bb = ellipse_pupil.boundingRect();
+        const cv::Rect bb = f.ellipse_pupil.boundingRect();
         const int nMult = 6;
         const int nNewW = nMult * bb.width;
         const int nNewH = nMult * bb.height;
 
-        int xs = ellipse_pupil.center.x - (nNewW >> 1);
+        int xs = f.ellipse_pupil.center.x - (nNewW >> 1);
         int xe = xs + nNewW - 1;
-        int ys = ellipse_pupil.center.y - (nNewH >> 1);
+        int ys = f.ellipse_pupil.center.y - (nNewH >> 1);
         int ye = ys + nNewH - 1;
         cv::Rect roi(xs, ys, xe - xs + 1, ye - ys + 1);
 
-        // restrict the roi to be within m_rectCrop
-        fitRectIntoRect(m_rectCrop, roi);
-        cv::Mat imgGrayCrop = cv::Mat(m_imgGray, roi).clone();
+        // restrict the roi to be within the cropped area
+        fitRectIntoRect(f.m_rectWork, roi);
 
         /*
          * NOTE: Do not blur here, aready done in preprocessImage()
          */
-        // blur to get the iris smoother
-        //cv::blur(imgGrayCrop, imgGrayCrop, cv::Size(5, 5), cv::Point(-1, -1));
-        //cv::medianBlur(imgGrayCrop, imgGrayCrop, 27);
 
         /**********************************************************************
          * Burst
          **********************************************************************/
         double c = 1.4;
-        const cv::RotatedRect *pEll = getEllipsePupil();
+        const cv::RotatedRect *pEll = f.getEllipsePupil();
         cv::Size sz(c * pEll->size.width,
                     c * pEll->size.height);
 
         const cv::RotatedRect ell(pEll->center, sz, pEll->angle);
 
         std::vector<cv::Point2f> vecEdges;
-        bool bBurstOk = iris::burst(m_imgGray, roi, ell, vecEdges);
+        bool bBurstOk = iris::burst(f.m_imgGray, roi, ell, vecEdges, m_settings);
 
         if(!bBurstOk) {
 
-            const double ellipseMajorAxis = std::max(ellipse_pupil.size.width,
-                                                     ellipse_pupil.size.height);
+            const double ellipseMajorAxis = std::max(f.ellipse_pupil.size.width,
+                                                     f.ellipse_pupil.size.height);
 
             float fRoiW = 3.5 * ellipseMajorAxis;
 
             // search ellipse
-            return cv::RotatedRect(ellipse_pupil.center,
+            return cv::RotatedRect(f.ellipse_pupil.center,
                                    cv::Size2f(fRoiW, fRoiW),
-                                   ellipse_pupil.angle);
+                                   f.ellipse_pupil.angle);
 
         }
 
@@ -1099,18 +1359,25 @@ namespace gt {
      * An estimate for the pupil has to have been found, before a call to
      * this function.
      */
-    void PupilTracker::getCrCandidates(std::list<ERR> &listCrCandidates) {
+    void PupilTracker::getCrCandidates(PupilFrame &f, std::list<ERR> &listCrCandidates) {
 
-        cv::Rect crRoi = m_crSearchEllipse.boundingRect();
-        fitRectIntoRect(m_rectRoi, crRoi);
+        cv::Rect crRoi = f.m_crSearchEllipse.boundingRect();
+        fitRectIntoRect(f.m_rectRoi, crRoi);
 
         // copy the part of the gray-scale image where CRs are looked for
-        const cv::Mat imgGrayCR = cv::Mat(m_imgGray, crRoi);//.clone(); // deep copy
+        const cv::Mat imgGrayCR = cv::Mat(f.m_imgGray, crRoi);//.clone(); // deep copy
 
 
-        // threshold the sub-image
-        cv::Mat imgBinaryCrs;
-        cv::threshold(imgGrayCR, imgBinaryCrs, thresholds.cr, 255, cv::THRESH_BINARY);
+        // the binary image is made by preprocessImage(), unless the threshold has changed since
+        cv::Mat imgBinaryCr;
+        if(f.thresholds.cr != f.m_nCrMaskThreshold) {
+            f.m_imgBinaryCr.create(f.m_imgGray.size(), CV_8UC1);
+            imgBinaryCr = cv::Mat(f.m_imgBinaryCr, crRoi);
+            cv::threshold(imgGrayCR, imgBinaryCr, f.thresholds.cr, 255, cv::THRESH_BINARY);
+        }
+        else {
+            imgBinaryCr = cv::Mat(f.m_imgBinaryCr, crRoi);
+        }
 
         /************************************************************
          * Now find the contours and test them with a mask
@@ -1118,17 +1385,26 @@ namespace gt {
 
         std::vector<Cluster> crContours;
 
-        cv::findContours(imgBinaryCrs,
+        // modifies the binary image, which is not needed after this
+        cv::findContours(imgBinaryCr,
                          crContours,
                          CV_RETR_LIST,
                          CV_CHAIN_APPROX_NONE,
                          cv::Point(crRoi.x, crRoi.y));
 
-        // create a new CR template image
-        cv::Mat imgCrTemplate;
-        CRTemplate::makeTemplateImage(imgCrTemplate,
-                                      trackerSettings.CR_MASK_LEN,          // width and height
-                                      trackerSettings.MAX_CR_WIDTH * 0.5);  // cr radius
+        // create a new CR template image, if the settings have changed
+        const int nCrRadius = (int)(m_settings.MAX_CR_WIDTH * 0.5);
+        if(m_nCrTemplateLen    != m_settings.CR_MASK_LEN ||
+           m_nCrTemplateRadius != nCrRadius) {
+
+            CRTemplate::makeTemplateImage(m_imgCrTemplate,
+                                          m_settings.CR_MASK_LEN,  // width and height
+                                          nCrRadius);                   // cr radius
+
+            m_nCrTemplateLen    = m_settings.CR_MASK_LEN;
+            m_nCrTemplateRadius = nCrRadius;
+
+        }
 
         const int nContours = (int)crContours.size();
         for(int i = 0; i < nContours; ++i) {
@@ -1136,7 +1412,7 @@ namespace gt {
             // mass centre
             const cv::Point2f com = PupilTracker::computeComOfCluster(crContours[i]);
 
-            if(!ellipse::pointInsideEllipse(m_crSearchEllipse, com)) {
+            if(!ellipse::pointInsideEllipse(f.m_crSearchEllipse, com)) {
                 continue;
             }
 
@@ -1148,7 +1424,7 @@ namespace gt {
             // test with a mask
             error.err = CRTemplate::maskTests(imgGrayCR,
                                               error.point - cv::Point(crRoi.x, crRoi.y),
-                                              imgCrTemplate);
+                                              m_imgCrTemplate);
 
             // test circularity
             // error.err += CRTemplate::testCircularity(imgBinaryCrs,
@@ -1182,7 +1458,7 @@ namespace gt {
     }
 
 
-    void PupilTracker::selectBestCrCandidates(std::list<ERR> &listCrCandidates) {
+    void PupilTracker::selectBestCrCandidates(PupilFrame &f, std::list<ERR> &listCrCandidates) {
 
         // sort so that the smallest errors, i.e. the best candidates, are first
         listCrCandidates.sort(fnctSortStdList);
@@ -1197,25 +1473,25 @@ namespace gt {
          *   CR_MAX_ERR_MULTIPLIER *  curErr < errOfBest
          *   => maxErr = errOfBest / CR_MAX_ERR_MULTIPLIER
          */
-        const double maxAcceptableError = errOfBest / trackerSettings.CR_MAX_ERR_MULTIPLIER;
+        const double maxAcceptableError = errOfBest / m_settings.CR_MAX_ERR_MULTIPLIER;
 
         // define a minimum distance between the CRs
-        const unsigned int minAcceptableDist = 1.5*trackerSettings.MAX_CR_WIDTH;
+        const unsigned int minAcceptableDist = 1.5*m_settings.MAX_CR_WIDTH;
 
         // how many crs have been flooded
         int cFlooded = 0;
 
-        int max_nof_crs = crs.getMax();
-        std::vector<cv::Point2d> &cr_centres = crs.getCentres();
+        int max_nof_crs = m_nMaxCrs;
+        std::vector<cv::Point2d> &cr_centres = f.crs.getCentres();
         cr_centres.clear();
 
 
-        const int w = m_imgGray.cols;
-        const int h = m_imgGray.rows;
-        const int step = m_imgGray.step;
-        const unsigned char *data = m_imgGray.data;
+        const int w = f.m_imgGray.cols;
+        const int h = f.m_imgGray.rows;
+        const int step = f.m_imgGray.step;
+        const unsigned char *data = f.m_imgGray.data;
 
-        int half_len = trackerSettings.MAX_CR_WIDTH / 2;
+        int half_len = m_settings.MAX_CR_WIDTH / 2;
 
         // floodfill the best candidates and compute their mass centres
 
@@ -1284,9 +1560,9 @@ namespace gt {
                 if(minDist >= minAcceptableDist/* && data[index] > 0*/) {
 
                     unsigned char th = (unsigned char)(TH_FF * data[index] + 0.5);
-                    cv::Rect rect_com(x - half_len, y - half_len, trackerSettings.MAX_CR_WIDTH, trackerSettings.MAX_CR_WIDTH);
+                    cv::Rect rect_com(x - half_len, y - half_len, m_settings.MAX_CR_WIDTH, m_settings.MAX_CR_WIDTH);
                     cv::Point2d tmp;
-                    this->getCOM_nonrecursive(cv::Point(x, y), rect_com, tmp, th);
+                    getCOM_nonrecursive(f.m_imgGray, cv::Point(x, y), rect_com, tmp, th);
                     cr_centres.push_back(tmp);
                     ++cFlooded;
 
@@ -1298,13 +1574,13 @@ namespace gt {
 
 
         // sort CRs
-        std::vector<cv::Point2d> &centres = crs.getCentres();
+        std::vector<cv::Point2d> &centres = f.crs.getCentres();
         std::sort(centres.begin(), centres.end(), sort_crs);
 
     }
 
 
-    bool PupilTracker::findCornealReflections() {
+    bool PupilTracker::findCornealReflections(PupilFrame &f) {
 
         /*****************************************************************
          * First populate the list of candidates. List of CR candidates,
@@ -1313,7 +1589,7 @@ namespace gt {
 
         std::list<ERR> listCrCandidates;
 
-        getCrCandidates(listCrCandidates);
+        getCrCandidates(f, listCrCandidates);
 
         if(listCrCandidates.size() == 0) {
             return false;
@@ -1324,7 +1600,7 @@ namespace gt {
          * Now select the best candidates as the CRs
          *****************************************************************/
 
-        selectBestCrCandidates(listCrCandidates);
+        selectBestCrCandidates(f, listCrCandidates);
 
 
         return true;
@@ -1332,26 +1608,6 @@ namespace gt {
     }
 
 
-    cv::Point PupilTracker::getCenterOfMass(const std::vector<cv::Point> &cluster) {
-
-        int nOfPoints = (int)cluster.size();
-
-        unsigned int sumX = 0;
-        unsigned int sumY = 0;
-        for(int i = 0; i < nOfPoints; ++i) {
-            sumX += cluster[i].x;
-            sumY += cluster[i].y;
-        }
-
-        int cx = (int)((double)sumX / nOfPoints + 0.5);
-        int cy = (int)((double)sumY / nOfPoints + 0.5);
-
-        cv::Point ret(cx, cy);
-
-        return ret;
-    }
-
-
     /*
      * Looks for the value defined by threshold from the binary image.
      * x1 and y1 define the starting point and x2 any y2 define the
@@ -1359,7 +1615,8 @@ namespace gt {
      * returns the point prior to the thresohold value and the point
      * at the threhold value. Returns true or false.
      */
-    bool PupilTracker::findFromLine(int x0,
+    bool PupilTracker::findFromLine(const cv::Mat &imgBinary,
+                                    int x0,
                                     int y0,
                                     int x1,
                                     int y1,
@@ -1403,8 +1660,8 @@ namespace gt {
         }
 
 
-        const unsigned char * const pixels = m_imgBinary.data;
-        const int step = m_imgBinary.step;
+        const unsigned char * const pixels = imgBinary.data;
+        const int step = imgBinary.step;
 
         while(x != x1) {
 
@@ -1435,7 +1692,8 @@ namespace gt {
     }
 
 
-    void PupilTracker::setEndPoints(const int x1,
+    void PupilTracker::setEndPoints(const cv::Rect &rectWork,
+                                    const int x1,
                                     const int y1,
                                     int &x2,
                                     int &y2,
@@ -1443,10 +1701,10 @@ namespace gt {
                                     int distY) {
 
         // inclusive bounds
-        const int startX = m_rectCrop.x;
-        const int startY = m_rectCrop.y;
-        const int endX   = m_rectCrop.x + m_rectCrop.width - 1;
-        const int endY   = m_rectCrop.y + m_rectCrop.height - 1;
+        const int startX = rectWork.x;
+        const int startY = rectWork.y;
+        const int endX   = rectWork.x + rectWork.width - 1;
+        const int endY   = rectWork.y + rectWork.height - 1;
 
 
         // end points of the ray. Give a value for x2 and y2
@@ -1504,7 +1762,8 @@ namespace gt {
 
 
     // http://stackoverflow.com/questions/1257117/does-anyone-have-a-working-non-recursive-floodfill-algorithm-written-in-c
-    void PupilTracker::getCOM_nonrecursive(const cv::Point &point,
+    void PupilTracker::getCOM_nonrecursive(const cv::Mat &imgGray,
+                                           const cv::Point &point,
                                            const cv::Rect &rectROI,
                                            cv::Point2d &com,
                                            unsigned char th) {
@@ -1513,18 +1772,20 @@ namespace gt {
         uint64_t cumul_y	= 0;
         uint64_t count		= 0;
 
-        const cv::Mat imgGrayROI	= cv::Mat(m_imgGray, rectROI);
-        cv::Mat imgGrayROICopy		= imgGrayROI.clone();
-        unsigned char *dataGrayCopy	= imgGrayROICopy.data;
-        int step					= imgGrayROICopy.step;
+        // m_imgFloodFill is reused if the size does not change
+        const cv::Mat imgGrayROI	= cv::Mat(imgGray, rectROI);
+        imgGrayROI.copyTo(m_imgFloodFill);
+        unsigned char *dataGrayCopy	= m_imgFloodFill.data;
+        int step					= m_imgFloodFill.step;
 
         const int widthROI	= rectROI.width;
         const int heightROI	= rectROI.height;
         const int areaROI	= widthROI * heightROI;
 
 
-        // map the point to the ROI
-        std::list<int> stack;
+        // map the point to the ROI. The stack keeps its capacity between calls.
+        std::vector<int> &stack = m_vecFloodStack;
+        stack.clear();
         stack.push_back(
                         (point.x - rectROI.x) +			// x
                         (point.y - rectROI.y) * step	// y
@@ -1576,13 +1837,13 @@ namespace gt {
     }
 
 
-    void PupilTracker::clearVars() {
+    void PupilTracker::clearVars(PupilFrame &f) {
 
-        this->ellipse_pupil = cv::RotatedRect();
+        f.ellipse_pupil = cv::RotatedRect();
 
-        this->cluster_pupil.clear();
+        f.cluster_pupil.clear();
 
-        crs.getCentres().clear();
+        f.crs.getCentres().clear();
 
     }
 
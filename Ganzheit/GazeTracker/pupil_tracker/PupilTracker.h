@@ -11,6 +11,9 @@
 #include "starburst.h"
 #include "clusteriser.h"
 #include "CRTemplate.h"
+#include "Preprocessor.h"
+#include "StageTimes.h"
+#include "trackerSettings.h"
 
 #define AREA(X) (3.14159265 * (X) * (X))
 
@@ -116,13 +119,154 @@ namespace gt {
     };
 
 
+    class PupilTracker;
+
+
+    /*
+     * The work images and the results of a single frame. PupilTracker
+     * keeps one of these for track(). The staged interface, see
+     * PupilTracker::prepare(), works on frames given by the caller, so
+     * that several frames can be in different stages at the same time.
+     */
+    class PupilFrame {
+
+	public:
+
+		PupilFrame() {
+			m_bPupilFound         = false;
+			m_nPupilMaskThreshold = -1;
+			m_nCrMaskThreshold    = -1;
+		}
+
+		const std::vector<std::vector<cv::Point> > &getClusters() const {
+			return clusteriser.getClusters();
+		}
+
+		const Clusteriser &getClusteriser() const {return clusteriser;}
+
+		const std::vector<cv::Point2d> &getCornealReflections() const {return crs.getCentres();}
+
+		const std::vector<cv::Point> &getClusterPupil() const {return cluster_pupil;}
+
+		const cv::Mat &getBinaryImage() const {return m_imgBinary;}
+
+		const cv::Mat &getGrayImage() const {return m_imgGray;}
+
+		const cv::Point &getWorkOffset() const {return m_pointOffset;}
+
+		const cv::Rect &getROI() const {return m_rectRoi;}
+
+		const Thresholds &getThresholds() const {return thresholds;}
+
+		const cv::RotatedRect *getEllipsePupil() const {return &ellipse_pupil;}
+
+		const cv::Rect &getCropArea() const {return m_rectCrop;}
+
+		const std::vector<int> &getClusterLabels() const {return clusterLabels;}
+
+		const cv::RotatedRect &getSearchEllipse() const {return m_crSearchEllipse;}
+
+		/* Was the pupil found in this frame, see PupilTracker::findPupil() */
+		bool isPupilFound() const {return m_bPupilFound;}
+
+		/* The times of the stages run for this frame */
+		const StageTimes &getStageTimes() const {return m_times;}
+
+	private:
+
+		friend class PupilTracker;
+
+		/*
+		 * Forbid the use of a copy constructor and the assignment operator.
+		 */
+		PupilFrame(const PupilFrame &other);
+		PupilFrame &operator=(const PupilFrame &other);
+
+		/*
+		 * This binary image is the result of an inverse-threshold operation.
+		 * This means that the dark areas become white and the bright areas become black.
+		 */
+		cv::Mat m_imgBinary;
+
+		cv::Mat m_imgGray;
+
+		/* Binary image of the CRs, 255 where brighter than the CR threshold */
+		cv::Mat m_imgBinaryCr;
+
+		/*
+		 * The thresholds with which preprocessImage() made the binary
+		 * images of the work area, -1 if not made.
+		 */
+		int m_nPupilMaskThreshold;
+		int m_nCrMaskThreshold;
+
+		/* Keeps its row buffers between the frames */
+		Preprocessor m_preprocessor;
+
+		/* The region of interest, ROI */
+		cv::Rect m_rectRoi;
+
+		/* The cropped area in frame coordinates */
+		cv::Rect m_rectCrop;
+
+		/* The cropped area in work coordinates */
+		cv::Rect m_rectWork;
+
+		/* Position of the work images in the frame */
+		cv::Point m_pointOffset;
+
+		/* Size of the input frame */
+		cv::Size m_sizeFrame;
+
+		// the clusteriser, keeps its work image between the frames
+		Clusteriser clusteriser;
+
+		/* Points of the corneal reflections */
+		CRs crs;
+
+		cv::RotatedRect ellipse_pupil;
+		std::vector<cv::Point> cluster_pupil;
+
+		Thresholds thresholds;
+
+		/* Sotres labels for the pupil cluster candidates, nice for debugging purposes. */
+		std::vector<int> clusterLabels;
+
+		/*
+		 * This ellipse is used as a search area in finding the CRs.
+		 * The ellipse is extracted in trackEyeLids().
+		 */
+		cv::RotatedRect m_crSearchEllipse;
+
+		bool m_bPupilFound;
+
+		/* Cleared by PupilTracker::prepare() */
+		StageTimes m_times;
+
+    };
+
+
     class PupilTracker {
 
 	public:
 
+		/* Uses a copy of the global trackerSettings */
 		PupilTracker();
+
+		/* Uses a copy of the given settings */
+		explicit PupilTracker(const TrackerSettings &settings);
+
 		~PupilTracker();
 
+		/*
+		 * Replace the settings of this instance. The settings are
+		 * private to the instance, so several trackers can run in
+		 * parallel with different settings.
+		 */
+		void setSettings(const TrackerSettings &settings);
+
+		const TrackerSettings &getSettings() const {return m_settings;}
+
         /*
          * Reset the pupil tracker. The next call to track() will
          * not use previous tracking results as refernces. This function
@@ -134,43 +278,87 @@ namespace gt {
 		/*
 		 * Track the pupil and the glints. The input image will be
 		 * copied. All operations will be applied to the copy image.
+		 * In the crop-only mode only the crop area is copied, see
+		 * setCropOnly(). Same as calling prepare(), findPupil() and
+		 * findGlints() for the frame owned by this instance.
 		 */
 		bool track(const cv::Mat &_imgGray, const cv::Point2f *suggestedStartPoint = NULL);
 
 
 		/*****************************************************************
-		 * Accessors
+		 * The stages of track(). These allow the stages of consecutive
+		 * frames to run in different threads:
+		 *
+		 *   prepare()   : copy and preprocess the input. Does not touch
+		 *                 the state of the tracker, so it may be called
+		 *                 for several frames in parallel.
+		 *   findPupil() : starburst, threshold, clusters and the ellipse
+		 *                 fit. Updates the state carried from frame to
+		 *                 frame, so it must be called in frame order.
+		 *   findGlints(): eye lids and the CRs, then translates the
+		 *                 results to frame coordinates. Must be called
+		 *                 in frame order, but may run at the same time
+		 *                 as findPupil() for the next frame.
+		 *
+		 * The settings must not be changed while a frame is between
+		 * prepare() and findGlints().
+		 *****************************************************************/
+
+		void prepare(const cv::Mat &_imgGray, PupilFrame &frame) const;
+
+		bool findPupil(PupilFrame &frame, const cv::Point2f *suggestedStartPoint = NULL);
+
+		void findGlints(PupilFrame &frame);
+
+
+		/*****************************************************************
+		 * Accessors, the results of the last track()
 		 *****************************************************************/
 
+		const PupilFrame &getFrame() const {return m_frame;}
+
 		const std::vector<std::vector<cv::Point> > &getClusters() const {
-			return clusteriser.getClusters();
+			return m_frame.getClusters();
 		}
 
 		const Clusteriser &getClusteriser() const {
-			return clusteriser;
+			return m_frame.getClusteriser();
 		}
 
-		const std::vector<cv::Point2d> &getCornealReflections() const {return crs.getCentres();}
+		const std::vector<cv::Point2d> &getCornealReflections() const {return m_frame.getCornealReflections();}
 
 		const std::vector<cv::Point> &getClusterPupil() const {
-			return this->cluster_pupil;
+			return m_frame.getClusterPupil();
 		}
 
-		const cv::Mat &getBinaryImage() {return m_imgBinary;}
+		/*
+		 * The work images. In the crop-only mode these have the size
+		 * of the crop area, see getWorkOffset().
+		 */
+		const cv::Mat &getBinaryImage() {return m_frame.m_imgBinary;}
+
+		const cv::Mat &getGrayImage() const {return m_frame.m_imgGray;}
 
-		const cv::Mat &getGrayImage() const {return m_imgGray;}
+		/*
+		 * The position of the work images in the input frame. (0, 0),
+		 * unless the crop-only mode is used. The clusters, the ROI, the
+		 * ellipses and the CRs are always given in frame coordinates,
+		 * whereas the work images and the starburst points are relative
+		 * to this offset.
+		 */
+		const cv::Point &getWorkOffset() const {return m_frame.m_pointOffset;}
 
-		const cv::Rect &getROI() {return m_rectRoi;}
+		const cv::Rect &getROI() {return m_frame.m_rectRoi;}
 
-		Thresholds *getThresholds() {return &this->thresholds;}
+		Thresholds *getThresholds() {return &m_frame.thresholds;}
 
-		const cv::RotatedRect *getEllipsePupil() const {return &this->ellipse_pupil;}
+		const cv::RotatedRect *getEllipsePupil() const {return m_frame.getEllipsePupil();}
 
 		const Starburst &getStarburstObject() {return this->starburst;}
 
-        cv::Rect getCropArea() {return m_rectCrop;}
+        cv::Rect getCropArea() {return m_frame.m_rectCrop;}
 
-        const std::vector<int> &getClusterLabels() {return clusterLabels;}
+        const std::vector<int> &getClusterLabels() {return m_frame.clusterLabels;}
 
 
 		/*****************************************************************
@@ -178,27 +366,64 @@ namespace gt {
 		 *****************************************************************/
 
         void setCropArea(const cv::Rect &rectCrop) {
-            m_rectCrop = rectCrop;
+            m_frame.m_rectCrop = rectCrop;
         }
 
 		/* Set the number of glints to detect */
 		void set_nof_crs(int n) {
-			crs.setMax(n);
+			m_nMaxCrs = n;
 		}
 
 		/* Increase the number of glints to detect */
 		void inc_nof_crs(int _inc) {
-			int suggested = crs.getMax() + _inc;
+			int suggested = m_nMaxCrs + _inc;
 
 			if(suggested >= 1 && suggested <= 20) {
-				crs.setMax(suggested);
+				m_nMaxCrs = suggested;
 			}
 		}
 
+		/* Turn the automatic threshold on or off for this instance */
 		void useAutoTh(bool t);
 
+		/*
+		 * In the crop-only mode only the crop area of the input frame
+		 * is copied into persistent work buffers of the crop size and
+		 * all stages operate in crop-local coordinates. The results
+		 * are translated back to frame coordinates at the end of
+		 * track(). The blur at the border of the crop area differs from
+		 * that of the whole frame, and so does the histogram of the
+		 * equalisation, so the results may differ slightly. Off by
+		 * default, GTWorker turns it on.
+		 */
+		void setCropOnly(bool b) {m_bCropOnly = b;}
+
+		bool isCropOnly() const {return m_bCropOnly;}
+
+		/*
+		 * In the mirrored mode the input frames are as captured, and
+		 * the tracker works as if they were mirrored around the y-axis
+		 * like the eye camera, see Camera::setMirrored(). The crop area
+		 * is mirrored to the input frame, and copied mirrored to the
+		 * work image. The results are the same as when the frames were
+		 * flipped before tracking. Off by default.
+		 */
+		void setMirrored(bool b) {m_bMirrored = b;}
+
+		bool isMirrored() const {return m_bMirrored;}
+
 
-        cv::RotatedRect getSearchEllipse() {return m_crSearchEllipse;}
+        cv::RotatedRect getSearchEllipse() {return m_frame.m_crSearchEllipse;}
+
+		/*
+		 * The mean difference of the gray image, scaled to 128..255, and
+		 * a template of the pupil over the rectangle br, which must be
+		 * inside the image. The template is 128 inside the ellipse e and
+		 * 0 outside, anti-aliased, with e placed at its coordinates in
+		 * the template and not in the image, as the error has always
+		 * been computed. Used by testPupilCandidate().
+		 */
+		static double getTemplateError(const cv::Mat &imgGray, const cv::RotatedRect &e, const cv::Rect &br);
 
 	private:
 
@@ -208,17 +433,23 @@ namespace gt {
         PupilTracker(const PupilTracker &other);
         PupilTracker &operator=(const PupilTracker &other);
 
+        /* Common part of the constructors */
+        void init(const TrackerSettings &settings);
+
         /*
          * Perform preprocessing, like histogram equalisation etc. Performed
-         * only for the cropped area.
+         * only for the cropped area. Makes also the binary image of the
+         * CRs and, if the pupil threshold is fixed, the binary image of
+         * the pupil.
          */
-        void preprocessImage();
+        void preprocessImage(PupilFrame &f) const;
 
 		/*
 		 * Performs the double ellipse fitting described in:
 		 *   "FreeGaze: A Gaze Tracking System for Everyday Gaze Interaction".
 		 */
-		bool doubleEllipseFit(const std::vector<cv::Point> &curCluster,
+		bool doubleEllipseFit(const PupilFrame &f,
+							  const Blob &curBlob,
 							  cv::RotatedRect &ellipse,
 							  std::vector<cv::Point> &edgePoints);
 
@@ -226,37 +457,39 @@ namespace gt {
 		 * Test if the given ellipse is coherent with the previously
 		 * selected ellipses
 		 */
-		bool isCoherent(const cv::RotatedRect &ellipse);
+		bool isCoherent(const PupilFrame &f, const cv::RotatedRect &ellipse);
 
         /*
          * Collect edge points of the cluster starting from the center and
          * moving radially between -45 to 45 degrees towards the edges.
          * Uses the binary image.
          */
-		void getEdgePoints(std::vector<cv::Point> &pupil_points, const int xc, const int yc);
+		void getEdgePoints(const PupilFrame &f, std::vector<cv::Point> &pupil_points, const int xc, const int yc);
 
 		/* n = the number of edge points used in fitting the ellipse */
-		bool testPupilCandidate(const cv::RotatedRect &e, int n, double &err);
+		bool testPupilCandidate(const PupilFrame &f, const cv::RotatedRect &e, int n, double &err);
 
 
 		/*
-		 * Threshold the image within the ROI with the given threshold
+		 * Threshold the work area of the image with the given threshold
 		 * value. The resulting threshold image is stored in img_binary.
 		 * The thresholding method inverts colors, i.e. black => white
-		 * and white => black.
+		 * and white => black. Nothing is done if preprocessImage()
+		 * already used the same threshold.
 		 */
-		void thresholdImage(int threshold, const cv::Rect &_rectRoi) {
+		static void thresholdImage(PupilFrame &f, int threshold) {
 
-			// if the sizes differ, reallocate img_binary
-			if(m_imgGray.size() != m_imgBinary.size()) {
-				m_imgBinary.release();
-				m_imgBinary = cv::Mat(m_imgGray.size(), CV_8UC1);
+			if(threshold == f.m_nPupilMaskThreshold) {
+				return;
 			}
 
-			cv::Mat imgGrayRoi   = cv::Mat(m_imgGray, _rectRoi);
-			cv::Mat imgBinaryRoi = cv::Mat(m_imgBinary, _rectRoi);
+			// reallocates img_binary only if the sizes differ
+			f.m_imgBinary.create(f.m_imgGray.size(), CV_8UC1);
 
-			cv::threshold(imgGrayRoi, imgBinaryRoi, threshold, 255, cv::THRESH_BINARY_INV);
+			cv::Mat imgGrayWork   = cv::Mat(f.m_imgGray, f.m_rectWork);
+			cv::Mat imgBinaryWork = cv::Mat(f.m_imgBinary, f.m_rectWork);
+
+			cv::threshold(imgGrayWork, imgBinaryWork, threshold, 255, cv::THRESH_BINARY_INV);
 		}
 
 
@@ -266,7 +499,7 @@ namespace gt {
 		 * centre of the roi and how far spread the samples are. The previous
 		 * pupil ellipse is used for defining the width of the ROI.
 		 */
-		bool define_ROI(const cv::Point2f *suggestedStartPoint);
+		bool define_ROI(PupilFrame &f, const cv::Point2f *suggestedStartPoint);
 
 		/*
 		 * Get the best pupil candidate from the clusters.
@@ -280,14 +513,14 @@ namespace gt {
 		 * This method was first introduced by Arto Meriläinen in his Master's
 		 * Thesis.
 		 */
-		bool getPupilFromClusters();
+		bool getPupilFromClusters(PupilFrame &f);
 
         /*
          * Track the eye lids. This function fits and ellipse to the points
          * of the top and bottom eye lids. The obtained ellipse, m_crSearchEllipse
          * will serve as a search area when finding the corneal reflections
          */
-        cv::RotatedRect trackEyeLids();
+        cv::RotatedRect trackEyeLids(const PupilFrame &f);
 
         /*
          * Try to find all corneal reflections inside the ellipse.
@@ -297,14 +530,14 @@ namespace gt {
          * Returns true if at least one CR was found and false,
          * otherwise.
          */
-		bool findCornealReflections();
+		bool findCornealReflections(PupilFrame &f);
 
         /*
          * Populate the given list with good CR candidates.
          * An estimate for the pupil has to have been found, before a call to this
          * function.
          */
-        void getCrCandidates(std::list<ERR> &listCrCandidates);
+        void getCrCandidates(PupilFrame &f, std::list<ERR> &listCrCandidates);
 
         /*
          * Select the best candidates out of the given list. The list
@@ -314,17 +547,24 @@ namespace gt {
          * best solution, but easier than returning a list of indices
          * of the chosen candidates or some such method.
          */
-        void selectBestCrCandidates(std::list<ERR> &listCrCandidates);
+        void selectBestCrCandidates(PupilFrame &f, std::list<ERR> &listCrCandidates);
 
-		/*
-		 * Test if this cluster is suitable as a candidate for the
-		 * pupil.
-		 */
-		bool testCluster(const std::vector<cv::Point> &cluster);
+        /* Check that the crop area is ok, if not adjust. */
+        void checkCropArea(const cv::Size &sizeFrame, cv::Rect &rectCrop) const;
 
+        /*
+         * Copy the input into the work buffer of the frame. The buffer is
+         * reused as long as its size does not change. Sets the crop
+         * area, the work offset and the work crop area.
+         */
+        void copyInput(const cv::Mat &img, PupilFrame &f) const;
 
-        /* Check that the crop area is ok, if not adjust. */
-        void checkCropArea();
+        /*
+         * Translate the results of the frame from work coordinates to
+         * frame coordinates. The pupil dependent results are translated
+         * only if the pupil was found.
+         */
+        static void toFrameCoordinates(PupilFrame &f);
 
 		/*
 		 * Computes values for x2 and y2 given the starting point and
@@ -332,7 +572,8 @@ namespace gt {
 		 * to remain within the image preserving the initial slope of the
 		 * desired line.
 		 */
-		void setEndPoints(const int x1,
+		static void setEndPoints(const cv::Rect &rectWork,
+						  const int x1,
 						  const int y1,
 						  int &x2,
 						  int &y2,
@@ -346,7 +587,8 @@ namespace gt {
 		 * returns the point prior to the thresohold value and the point
 		 * at the threhold value. Returns true or false.
 		 */
-		bool findFromLine(int x1,
+		static bool findFromLine(const cv::Mat &imgBinary,
+						  int x1,
 						  int y1,
 						  int x2,
 						  int y2,
@@ -354,17 +596,12 @@ namespace gt {
 						  cv::Point &ret_bright,
 						  cv::Point &ret_dark);
 
-		cv::Point getCenterOfMass(const std::vector<cv::Point> &cluster);
-
 		/*
 		 * The start index must be located within the ROI
 		 */
-		void getCOM_nonrecursive(const cv::Point &point, const cv::Rect &rectROI, cv::Point2d &com, unsigned char th);
-
-		void clearVars();
+		void getCOM_nonrecursive(const cv::Mat &imgGray, const cv::Point &point, const cv::Rect &rectROI, cv::Point2d &com, unsigned char th);
 
-		// the clusteriser
-		Clusteriser clusteriser;
+		static void clearVars(PupilFrame &f);
 
 
         static cv::Point2f computeComOfCluster(const Cluster &c);
@@ -375,40 +612,58 @@ namespace gt {
 		std::vector<int> distX;
 		std::vector<int> distY;
 
-		/*
-		 * This binary image is the result of an inverse-threshold operation.
-		 * This means that the dark areas become white and the bright areas become black.
-		 */
-		cv::Mat m_imgBinary;
+		/* The frame used by track() */
+		PupilFrame m_frame;
 
-		cv::Mat m_imgGray;
+        /*
+         * The scratch buffers below are used only by findGlints(), so
+         * findPupil() can run at the same time in another thread.
+         */
 
-        /* The region of interest, ROI */
-		cv::Rect m_rectRoi;
+        /* Scratch image for the CR flood fill, see getCOM_nonrecursive() */
+        cv::Mat m_imgFloodFill;
+
+        /* Stack for the CR flood fill */
+        std::vector<int> m_vecFloodStack;
+
+        /* The CR template, rebuilt only when the CR settings change */
+        cv::Mat m_imgCrTemplate;
+        int m_nCrTemplateLen;
+        int m_nCrTemplateRadius;
+
+        /* The number of glints to detect */
+        int m_nMaxCrs;
+
+        /* Copy only the crop area, see setCropOnly() */
+        bool m_bCropOnly;
 
-        /* The cropped area */
-        cv::Rect m_rectCrop;
+        /* Mirror the input frames, see setMirrored() */
+        bool m_bMirrored;
+
+        /* The settings of this instance */
+        TrackerSettings m_settings;
 
 
 
 		/*************************************************************
-		 * Results
+		 * State carried from frame to frame, used by findPupil()
 		 *************************************************************/
 
-		/* Points of the corneal reflections */
-		CRs crs;
-
-		cv::RotatedRect ellipse_pupil;
-		std::vector<cv::Point> cluster_pupil;
+		/*
+		 * The pupil of the previous frame in frame coordinates. Empty
+		 * if the pupil was not found.
+		 */
+		cv::RotatedRect m_ellipsePrevious;
+		bool m_bPreviousFound;
 
-		// clusters should also be here
+		/* The work offset of the previous frame */
+		cv::Point m_pointOffsetPrevious;
 
 
 		/* This variable indicates if the corneal reflections are being tracked */
 		bool bTrackCRs;
 
 
-		Thresholds thresholds;
 		ThresholdAverager thresholdAverager;
 
 
@@ -426,18 +681,9 @@ namespace gt {
 
 		int failed_tracks;
 
-        /* The last valid starburst initial point */
+        /* The last valid starburst initial point, in frame coordinates */
         cv::Point2f lastValidSBPoint;
 
-        /* Sotres labels for the pupil cluster candidates, nice for debugging purposes. */
-        std::vector<int> clusterLabels;
-
-        /*
-         * This ellipse is used as a search area in finding the CRs.
-         * The ellipse is extracted in trackEyeLids().
-         */
-        cv::RotatedRect m_crSearchEllipse;
-
     };
 
 } // end of namespace gt {
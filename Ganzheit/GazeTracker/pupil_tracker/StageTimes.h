@@ -0,0 +1,125 @@
+#ifndef STAGETIMES_H
+#define STAGETIMES_H
+
+
+#include <time.h>
+#include <stdint.h>
+
+
+
+namespace gt {
+
+    /*
+     * The start times and the durations of the stages of tracking a
+     * frame, see ScopedStage. The times are read from the monotonic
+     * clock in nanoseconds, so the stages of frames tracked in different
+     * threads are on the same time line, see StageTrace. Reading the
+     * clock takes some tens of nanoseconds, so the stages are always
+     * timed.
+     */
+    class StageTimes {
+
+    public:
+
+        /* The stages in the order in which they are run */
+        enum Stage {
+            STAGE_PREPARE,      // copy and preprocess the input
+            STAGE_STARBURST,    // starburst and the ROI
+            STAGE_CLUSTERS,     // threshold and clusterise
+            STAGE_ELLIPSE,      // ellipse fits of the pupil candidates
+            STAGE_EYELIDS,      // the eye lids and the CR search area
+            STAGE_CRS,          // the CR search
+            STAGE_GLINTS,       // glints to 3D and group::GroupManager
+            STAGE_CORNEA,       // the cornea centre
+            STAGE_PUPIL,        // the pupil perimeter ray trace
+            NOF_STAGES
+        };
+
+
+        StageTimes() {clear();}
+
+        /* Mark all stages as not run */
+        void clear() {
+            for(int i = 0; i < NOF_STAGES; ++i) {
+                begin[i] = -1;
+                dur[i]   = -1;
+            }
+        }
+
+        void set(Stage stage, int64_t _begin, int64_t _end) {
+            begin[stage] = _begin;
+            dur[stage]   = _end - _begin;
+        }
+
+        /* In nanoseconds, -1 if the stage was not run */
+        int64_t getBegin(int stage) const {return begin[stage];}
+        int64_t getDuration(int stage) const {return dur[stage];}
+
+        /* The monotonic clock in nanoseconds */
+        static int64_t now() {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+        }
+
+        static const char *getName(int stage) {
+            static const char *names[NOF_STAGES] = {"prepare", "starburst", "clusters",
+                                                    "ellipse", "eyelids", "crs",
+                                                    "glints", "cornea", "pupil"};
+            return names[stage];
+        }
+
+    private:
+
+        int64_t begin[NOF_STAGES];
+        int64_t dur[NOF_STAGES];
+
+    };
+
+
+    /*
+     * Times a stage from the construction until next() or the end of
+     * the scope, so the early returns of a stage are timed too:
+     *
+     *     ScopedStage timer(times, StageTimes::STAGE_GLINTS);
+     *     ...
+     *     timer.next(StageTimes::STAGE_CORNEA);
+     *     ...
+     */
+    class ScopedStage {
+
+    public:
+
+        ScopedStage(StageTimes &_times, StageTimes::Stage _stage) : times(_times) {
+            stage = _stage;
+            begin = StageTimes::now();
+        }
+
+        ~ScopedStage() {
+            times.set(stage, begin, StageTimes::now());
+        }
+
+        /* End the current stage and begin the given one */
+        void next(StageTimes::Stage _stage) {
+            const int64_t t = StageTimes::now();
+            times.set(stage, begin, t);
+            stage = _stage;
+            begin = t;
+        }
+
+    private:
+
+        ScopedStage(const ScopedStage &other);
+        ScopedStage &operator=(const ScopedStage &other);
+
+        StageTimes &times;
+        StageTimes::Stage stage;
+        int64_t begin;
+
+    };
+
+} // end of namespace gt {
+
+
+
+#endif
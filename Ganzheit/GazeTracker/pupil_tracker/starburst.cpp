@@ -33,17 +33,233 @@
 #include <math.h>
 #include <cstring>
 #include <iostream>
+#include <algorithm>
+#include <deque>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/time.h>
 
 #include "starburst.h"
 #include "trackerSettings.h"
 
 static const double PI = 3.141592653589;
 static const int EDGE_THR_MIN = 5;
+static const int EDGE_THR_MAX = 40;
+
+/*
+ * The threshold search after a reset. At most SEARCH_MAX_START_POINTS
+ * of the darkest start points are tried, first with every
+ * SEARCH_COARSE_STEP'th threshold. The thresholds in between are then
+ * tried for the start points whose standard deviation is at most
+ * SEARCH_REFINE_RATIO times the lowest one.
+ */
+static const size_t SEARCH_MAX_START_POINTS = 4;
+static const int SEARCH_COARSE_STEP = 4;
+static const double SEARCH_REFINE_RATIO = 1.5;
+
+/* The maximum number of search threads, in addition to the caller */
+static const int SEARCH_MAX_THREADS = 7;
+
+
+/*****************************************************************************
+ * StarburstSearchPool
+ ****************************************************************************/
+
+/*
+ * The threads that run the evaluations of the threshold searches of all
+ * Starburst instances. The threads are created on the first search and
+ * live until the process exits. The caller of run() evaluates items as
+ * well, so that a search proceeds even when the threads are busy with
+ * the searches of other instances.
+ */
+class StarburstSearchPool {
+
+public:
+
+	static StarburstSearchPool &instance();
+
+	/*
+	 * Evaluate the items with the settings of owner. owner is the work
+	 * space of the calling thread, its results are overwritten.
+	 */
+	void run(Starburst &owner,
+	         const cv::Mat &img_gray,
+	         const cv::Rect &roi,
+	         std::vector<Starburst::SearchItem> &items);
+
+	/* The thread function, must not be called */
+	void runThread();
+
+private:
+
+	/* The items of a call to run() */
+	struct Batch {
+		const cv::Mat *img_gray;
+		const cv::Rect *roi;
+		const TrackerSettings *settings;
+		Starburst::SearchItem *items;
+		int nof_items;
+		int next;
+		int done;
+	};
+
+	StarburstSearchPool();
+
+	static void createInstance();
+
+	static StarburstSearchPool *pool;
+	static pthread_once_t once;
+
+	pthread_mutex_t mutex;
+	pthread_cond_t cond_work;
+	pthread_cond_t cond_done;
+
+	/* The batches that have items left to evaluate */
+	std::deque<Batch *> batches;
+
+};
+
+
+StarburstSearchPool *StarburstSearchPool::pool = NULL;
+pthread_once_t StarburstSearchPool::once = PTHREAD_ONCE_INIT;
+
+
+static void *search_thread(void *arg) {
+	((StarburstSearchPool *)arg)->runThread();
+	return NULL;
+}
+
+
+StarburstSearchPool &StarburstSearchPool::instance() {
+	pthread_once(&once, StarburstSearchPool::createInstance);
+	return *pool;
+}
+
+
+void StarburstSearchPool::createInstance() {
+	pool = new StarburstSearchPool();
+}
+
+
+StarburstSearchPool::StarburstSearchPool() {
+
+	pthread_mutex_init(&mutex, NULL);
+	pthread_cond_init(&cond_work, NULL);
+	pthread_cond_init(&cond_done, NULL);
+
+	long nof_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	const int nof_threads = std::min((int)std::max(nof_cpus - 1, 0L), SEARCH_MAX_THREADS);
+
+	for(int i = 0; i < nof_threads; i++) {
+
+		pthread_t thread;
+		if(pthread_create(&thread, NULL, search_thread, (void *)this) != 0) {
+			printf("StarburstSearchPool::StarburstSearchPool(): could not create a thread\n");
+			break;
+		}
+
+		pthread_detach(thread);
+	}
+}
+
+
+void StarburstSearchPool::run(Starburst &owner,
+                              const cv::Mat &img_gray,
+                              const cv::Rect &roi,
+                              std::vector<Starburst::SearchItem> &items) {
+
+	if(items.empty()) {
+		return;
+	}
+
+	Batch batch;
+	batch.img_gray = &img_gray;
+	batch.roi = &roi;
+	batch.settings = &owner.m_settings;
+	batch.items = &items[0];
+	batch.nof_items = (int)items.size();
+	batch.next = 0;
+	batch.done = 0;
+
+	pthread_mutex_lock(&mutex);
+
+		batches.push_back(&batch);
+		pthread_cond_broadcast(&cond_work);
+
+		// evaluate in this thread too
+		while(batch.next < batch.nof_items) {
+
+			const int i = batch.next++;
+			if(batch.next == batch.nof_items) {
+				batches.erase(std::find(batches.begin(), batches.end(), &batch));
+			}
+
+			pthread_mutex_unlock(&mutex);
+
+			owner.evaluate(img_gray, roi, batch.items[i]);
+
+			pthread_mutex_lock(&mutex);
+
+			batch.done++;
+		}
+
+		// wait for the items evaluated by the threads
+		while(batch.done < batch.nof_items) {
+			pthread_cond_wait(&cond_done, &mutex);
+		}
+
+	pthread_mutex_unlock(&mutex);
+}
+
+
+void StarburstSearchPool::runThread() {
+
+	// the work space of this thread
+	Starburst work;
+
+	pthread_mutex_lock(&mutex);
+
+	while(1) {
+
+		while(batches.empty()) {
+			pthread_cond_wait(&cond_work, &mutex);
+		}
+
+		Batch *batch = batches.front();
+
+		const int i = batch->next++;
+		if(batch->next == batch->nof_items) {
+			batches.pop_front();
+		}
+
+		pthread_mutex_unlock(&mutex);
+
+		work.setSettings(*batch->settings);
+		work.evaluate(*batch->img_gray, *batch->roi, batch->items[i]);
+
+		pthread_mutex_lock(&mutex);
+
+		if(++batch->done == batch->nof_items) {
+			pthread_cond_broadcast(&cond_done);
+		}
+	}
+}
+
+
+/*****************************************************************************
+ * Starburst
+ ****************************************************************************/
 
 
 Starburst::Starburst(void)
 {
 	this->b_reset = true;
+	this->m_settings = trackerSettings;
+	this->seed_steps_N = -1;
+	this->seed_steps_dis = -1;
+	this->searchMillis = -1;
+	this->searchEvaluations = 0;
+	this->b_exhaustive_search = false;
 }
 
 bool Starburst::process(const cv::Mat &img_gray, const cv::Rect &roi, cv::Point2f sp)
@@ -61,6 +277,8 @@ bool Starburst::process(const cv::Mat &img_gray, const cv::Rect &roi, cv::Point2
         validRoi = roi;
     }
 
+	this->searchMillis = -1;
+	this->searchEvaluations = 0;
 
 	ProcessStatus ret = tryProcess(img_gray, validRoi, sp);
 
@@ -114,8 +332,8 @@ ProcessStatus Starburst::tryProcess(const cv::Mat &img_gray, const cv::Rect &roi
 	if(!this->starburst_pupil_contour_detection(img_gray,
                                                 roi,
                                                 this->pupil_edge_thres,
-                                                trackerSettings.STARBURST_CIRCULAR_STEPS,
-                                                trackerSettings.STARBURST_MIN_SEED_POINTS)) {
+                                                m_settings.STARBURST_CIRCULAR_STEPS,
+                                                m_settings.STARBURST_MIN_SEED_POINTS)) {
 
 		ProcessStatus ret = this->b_reset ? UNRECOVERABLE_ERROR : RECOVERABLE_ERROR;
 		this->b_reset = true;
@@ -148,7 +366,7 @@ ProcessStatus Starburst::tryProcess(const cv::Mat &img_gray, const cv::Rect &roi
 
 	if(var < 0 || !edge_point.size() || 
 		(!b_reset && sd_difference > std::sqrt(varianceOfOriginalImage) * 
-		trackerSettings.STARBURST_RELATIVE_MAX_POINT_VARIANCE)) {
+		m_settings.STARBURST_RELATIVE_MAX_POINT_VARIANCE)) {
 
 		ProcessStatus ret = this->b_reset ? UNRECOVERABLE_ERROR : RECOVERABLE_ERROR;
 		this->b_reset = true;
@@ -171,75 +389,181 @@ bool Starburst::testThresholds(const cv::Mat &img_gray,
                                double &pointVariance,
                                cv::Point2f suggestedStartPoint) {
 
+	struct timeval t1, t2;
+	gettimeofday(&t1, NULL);
+
     // was a valid point given
     bool bStartPointSet = suggestedStartPoint.x != -1 && suggestedStartPoint.y != -1;
 
-	double lowest_var = -1;
 
-	// Test different threshold values
-	int best_threshold = 1;
-	int numOfPoints = -1;
+	/*************************************************************
+	 * The start points, the darkest first
+	 ************************************************************/
+	std::vector<SearchItem> points;
 
-	cv::Point2f best_point(0, 0);
+	if(bStartPointSet) {
 
-    const int nX = bStartPointSet ? 1 : (int)trackerSettings.STARBURST_BLOCK_COUNT;
-    const int nY = nX;
+		SearchItem point;
+		point.grid_index = 0;
+		point.start_point = suggestedStartPoint;
+		points.push_back(point);
 
+	}
+	else {
 
-	// Try different starting points
-	for(int x = 1; x <= nX; x++) {
+		const size_t max_points = this->b_exhaustive_search ? (size_t)-1 : SEARCH_MAX_START_POINTS;
+		this->rankStartPoints(img_gray, roi, max_points, points);
+
+	}
 
-		start_point.x = bStartPointSet        ?
-                        suggestedStartPoint.x : 
-                        roi.x + x * (roi.width / ((int)trackerSettings.STARBURST_BLOCK_COUNT + 1));
+	// no start points if STARBURST_BLOCK_COUNT is 0
+	if(points.empty()) {
 
-		for(int y = 1; y <= nY; y++) {
+		this->searchEvaluations = 0;
+
+		gettimeofday(&t2, NULL);
+		this->searchMillis = 1e3 * (t2.tv_sec - t1.tv_sec) + 1e-3 * (t2.tv_usec - t1.tv_usec);
+
+		return false;
+
+	}
+
+
+	/*************************************************************
+	 * The coarse pass: every SEARCH_COARSE_STEP'th threshold, or
+	 * all of them in the exhaustive search
+	 ************************************************************/
+	const int thr_step = this->b_exhaustive_search ? 1 : SEARCH_COARSE_STEP;
+
+	search_items.clear();
+	search_results.clear();
+
+	for(size_t i = 0; i < points.size(); i++) {
+		for(int thr = EDGE_THR_MIN; thr < EDGE_THR_MAX; thr += thr_step) {
+			points[i].edge_thresh = thr;
+			search_items.push_back(points[i]);
+		}
+	}
+
+	StarburstSearchPool::instance().run(*this, img_gray, roi, search_items);
+	search_results.insert(search_results.end(), search_items.begin(), search_items.end());
+
+
+	/*************************************************************
+	 * The fine pass: the thresholds in between, around the best
+	 * coarse threshold of each start point whose variance is
+	 * close to the lowest one. If the coarse pass found nothing,
+	 * all thresholds in between are tried.
+	 ************************************************************/
+	if(thr_step > 1) {
 
-            start_point.y = bStartPointSet        ?
-                            suggestedStartPoint.y : 
-                            roi.y + y * (roi.height / ((int)trackerSettings.STARBURST_BLOCK_COUNT + 1));
+		const size_t nof_coarse = search_items.size() / points.size();
 
+		std::vector<double> best_sd(points.size(), -1);
+		std::vector<int> best_thr(points.size(), EDGE_THR_MIN);
+		double lowest_sd = -1;
 
-			// Try different thresholds
-			for(pupil_edge_thres = EDGE_THR_MIN;
-				pupil_edge_thres < 40;
-				pupil_edge_thres++) {
+		for(size_t i = 0; i < search_items.size(); i++) {
 
-				if(!this->starburst_pupil_contour_detection(
-                                        img_gray,
-                                        roi,
-                                        this->pupil_edge_thres,
-                                        trackerSettings.STARBURST_CIRCULAR_STEPS,
-                                        trackerSettings.STARBURST_MIN_SEED_POINTS)) {
+			const SearchItem &item = search_items[i];
+			const size_t p = i / nof_coarse;
 
+			if(item.var < 0) {
+				continue;
+			}
+
+			const double sd = std::sqrt(item.var);
+
+			if(best_sd[p] < 0 || sd < best_sd[p]) {
+				best_sd[p] = sd;
+				best_thr[p] = item.edge_thresh;
+			}
+
+			if(lowest_sd < 0 || sd < lowest_sd) {
+				lowest_sd = sd;
+			}
+
+		}
+
+		search_items.clear();
+
+		for(size_t p = 0; p < points.size(); p++) {
+
+			int thr_min = EDGE_THR_MIN;
+			int thr_max = EDGE_THR_MAX - 1;
+
+			if(lowest_sd >= 0) {
+
+				if(best_sd[p] < 0 || best_sd[p] > lowest_sd * SEARCH_REFINE_RATIO) {
 					continue;
+				}
 
+				thr_min = std::max(thr_min, best_thr[p] - (thr_step - 1));
+				thr_max = std::min(thr_max, best_thr[p] + (thr_step - 1));
+
+			}
+
+			for(int thr = thr_min; thr <= thr_max; thr++) {
+
+				// already tried in the coarse pass
+				if((thr - EDGE_THR_MIN) % thr_step == 0) {
+					continue;
 				}
 
-				cv::Point2f center;
-				double var = calculateStatistics(center);
+				points[p].edge_thresh = thr;
+				search_items.push_back(points[p]);
 
-				/* If there happens to be a good threshold
-				 * with a smaller amount of points, pick it
-				 * (avoid selecting "almost perfect"
-				 * threshold value) */
+			}
 
-				if((var >= 0) && (lowest_var < 0 ||
-					std::sqrt(var) < std::sqrt(lowest_var))) {
+		}
 
-					if((numOfPoints > (int)edge_point.size()) || (numOfPoints == -1)) {
-						numOfPoints = this->edge_point.size();
-						lowest_var = var;
-						best_threshold = pupil_edge_thres;
-						best_point = start_point;
-					}
+		StarburstSearchPool::instance().run(*this, img_gray, roi, search_items);
+		search_results.insert(search_results.end(), search_items.begin(), search_items.end());
 
-				}
+	}
+
+
+	/*************************************************************
+	 * Pick the best one, in the order of the original search
+	 ************************************************************/
+	std::sort(search_results.begin(), search_results.end());
 
+	double lowest_var = -1;
+
+	int best_threshold = 1;
+	int numOfPoints = -1;
+
+	cv::Point2f best_point(0, 0);
+
+	for(size_t i = 0; i < search_results.size(); i++) {
+
+		const SearchItem &item = search_results[i];
+		const double var = item.var;
+
+		/* If there happens to be a good threshold
+		 * with a smaller amount of points, pick it
+		 * (avoid selecting "almost perfect"
+		 * threshold value) */
+
+		if((var >= 0) && (lowest_var < 0 ||
+			std::sqrt(var) < std::sqrt(lowest_var))) {
+
+			if((numOfPoints > item.nof_points) || (numOfPoints == -1)) {
+				numOfPoints = item.nof_points;
+				lowest_var = var;
+				best_threshold = item.edge_thresh;
+				best_point = item.start_point;
 			}
+
 		}
+
 	}
 
+	this->searchEvaluations = (int)search_results.size();
+
+	gettimeofday(&t2, NULL);
+	this->searchMillis = 1e3 * (t2.tv_sec - t1.tv_sec) + 1e-3 * (t2.tv_usec - t1.tv_usec);
+
 	if(lowest_var < 0) {
 		return false;
 	}
@@ -254,6 +578,79 @@ bool Starburst::testThresholds(const cv::Mat &img_gray,
 }
 
 
+void Starburst::evaluate(const cv::Mat &img_gray, const cv::Rect &roi, SearchItem &item) {
+
+	this->start_point = item.start_point;
+
+	item.var = -1;
+	item.nof_points = 0;
+
+	if(!this->starburst_pupil_contour_detection(img_gray,
+	                                            roi,
+	                                            item.edge_thresh,
+	                                            m_settings.STARBURST_CIRCULAR_STEPS,
+	                                            m_settings.STARBURST_MIN_SEED_POINTS)) {
+		return;
+	}
+
+	cv::Point2f center;
+	item.var = calculateStatistics(center);
+	item.nof_points = (int)this->edge_point.size();
+}
+
+
+void Starburst::rankStartPoints(const cv::Mat &img_gray,
+                                const cv::Rect &roi,
+                                size_t max_points,
+                                std::vector<SearchItem> &points) const {
+
+	const int nof_blocks = (int)m_settings.STARBURST_BLOCK_COUNT;
+	const int nX = nof_blocks;
+	const int nY = nX;
+
+	const int block_w = roi.width / (nof_blocks + 1);
+	const int block_h = roi.height / (nof_blocks + 1);
+
+	// the windows of the neighbouring points touch each other
+	const int r = std::max(1, std::min(block_w, block_h) / 2);
+
+	std::vector<SearchItem> grid;
+
+	// the mean intensity of the window around each point and the index of the point
+	std::vector<std::pair<double, int> > scores;
+
+	for(int x = 1; x <= nX; x++) {
+		for(int y = 1; y <= nY; y++) {
+
+			SearchItem point;
+			point.grid_index = (int)grid.size();
+			point.start_point.x = roi.x + x * block_w;
+			point.start_point.y = roi.y + y * block_h;
+
+			const cv::Rect window = cv::Rect((int)point.start_point.x - r,
+			                                 (int)point.start_point.y - r,
+			                                 2 * r + 1,
+			                                 2 * r + 1) & roi;
+
+			const double score = window.area() > 0 ? cv::mean(img_gray(window))[0] : 255.0;
+
+			scores.push_back(std::make_pair(score, point.grid_index));
+			grid.push_back(point);
+
+		}
+	}
+
+	// the darkest first, the grid order among equals
+	std::sort(scores.begin(), scores.end());
+
+	points.clear();
+
+	for(size_t i = 0; i < scores.size() && i < max_points; i++) {
+		points.push_back(grid[scores[i].second]);
+	}
+}
+
+
 //------------ Starburst pupil edge detection -----------//
 
 // Input
@@ -281,9 +678,16 @@ bool Starburst::starburst_pupil_contour_detection(const cv::Mat &img_gray,
 	double cx = start_point.x;
 	double cy = start_point.y;
 
+	// the seed point rays are the same for every call
+	if(N != seed_steps_N || dis != seed_steps_dis) {
+		Starburst::make_steps(dis, (2.0 * PI) / (double)(N-1), 0, 2.0 * PI, seed_steps_x, seed_steps_y);
+		seed_steps_N = N;
+		seed_steps_dis = dis;
+	}
+
 	int loop_count = 0;
 
-	while(loop_count <= trackerSettings.STARBURST_MAX_ITERATIONS) {
+	while(loop_count <= m_settings.STARBURST_MAX_ITERATIONS) {
 
 		edge_point.clear();
 
@@ -291,11 +695,13 @@ bool Starburst::starburst_pupil_contour_detection(const cv::Mat &img_gray,
 		 * First phase of the algorithm: Find the seed points
 		 ************************************************************/
 
-		pointContainer seed_points;
+		seed_points.clear();
         //Starburst::locate_edge_points(img_gray, roi, cx, cy, dis, angle_step, 0, 2 * PI, edge_thresh, seed_points);
-        Starburst::locate_edge_points(img_gray, roi, cx, cy,
-                                      dis, (2.0 * PI) / (double)(N-1), 0, 2.0 * PI,
-                                      edge_thresh, seed_points);
+        if(!seed_steps_x.empty()) {
+            Starburst::cast_rays(img_gray, roi, cx, cy,
+                                 &seed_steps_x[0], &seed_steps_y[0], (int)seed_steps_x.size(),
+                                 edge_thresh, seed_points);
+        }
 
 
 		// Is there enough seed points?
@@ -311,22 +717,24 @@ bool Starburst::starburst_pupil_contour_detection(const cv::Mat &img_gray,
 		 * returning rays.
 		 ************************************************************/
 
-		pointContainer::iterator itEdge;
-		for(itEdge = seed_points.begin(); itEdge != seed_points.end(); itEdge++) {
+		for(size_t i = 0; i < seed_points.size(); i++) {
 
-            double angle_normal = atan2(cy - itEdge->point.y, cx - itEdge->point.x);
+            const float seed_x = seed_points.x[i];
+            const float seed_y = seed_points.y[i];
+
+            double angle_normal = atan2(cy - seed_y, cx - seed_x);
 
             /*
              * TODO: The new step is less than or equal to the original one.
              * When it's less than the original, the algorithm does not cover
              * the entire spread. Just from [min, max-(orig-new)]. Rethink.
              */
-            double new_angle_step = angle_step * ( (double)edge_thresh / (double)itEdge->intensityDifference);
+            double new_angle_step = angle_step * ( (double)edge_thresh / (double)seed_points.intensityDifference[i]);
 
-			Starburst::locate_edge_points(img_gray,
+			this->locate_edge_points(img_gray,
                                           roi,
-                                          itEdge->point.x,
-                                          itEdge->point.y,
+                                          seed_x,
+                                          seed_y,
                                           dis,
                                           new_angle_step,
                                           angle_normal,
@@ -342,13 +750,13 @@ bool Starburst::starburst_pupil_contour_detection(const cv::Mat &img_gray,
 
 		// Merge seed points with edge_points.
 		//edge_point.splice(edge_point.begin(), seed_points);
-        edge_point.insert(edge_point.end(), seed_points.begin(), seed_points.end());
+        edge_point.append(seed_points);
 
 		loop_count += 1;
 		cv::Point2f edge_mean = get_edge_mean(edge_point);
 
 		// Converge?
-		if ((fabs(edge_mean.x-cx) + fabs(edge_mean.y-cy)) < trackerSettings.STARBURST_REQUIRED_ACCURACY) {
+		if ((fabs(edge_mean.x-cx) + fabs(edge_mean.y-cy)) < m_settings.STARBURST_REQUIRED_ACCURACY) {
 
 			return true;
 		}
@@ -362,42 +770,83 @@ bool Starburst::starburst_pupil_contour_detection(const cv::Mat &img_gray,
 }
 
 
-// static method
 void Starburst::locate_edge_points(const cv::Mat &img_gray,
                                    const cv::Rect &roi,
                                    double cx, double cy,
                                    int dis, double angle_step, double angle_normal, double angle_spread,
                                    int edge_thresh, pointContainer & pointList) {
 
-	double angle;
-	cv::Point2f p;
-	double dis_cos, dis_sin;
-	int pixel_value1, pixel_value2;
+	Starburst::make_steps(dis, angle_step, angle_normal, angle_spread, ray_steps_x, ray_steps_y);
+
+	if(ray_steps_x.empty()) {
+		return;
+	}
+
+	Starburst::cast_rays(img_gray, roi, cx, cy,
+	                     &ray_steps_x[0], &ray_steps_y[0], (int)ray_steps_x.size(),
+	                     edge_thresh, pointList);
+}
+
+
+// static method
+void Starburst::make_steps(int dis,
+                           double angle_step,
+                           double angle_normal,
+                           double angle_spread,
+                           std::vector<double> &steps_x,
+                           std::vector<double> &steps_y) {
+
+	steps_x.clear();
+	steps_y.clear();
+
+	for (double angle = angle_normal - angle_spread / 2.0 + 0.0001; angle < angle_normal + angle_spread / 2.0; angle += angle_step) {
+		const double dis_cos = dis * cos(angle);
+		const double dis_sin = dis * sin(angle);
+		steps_x.push_back(dis_cos);
+		steps_y.push_back(dis_sin);
+	}
+}
+
+
+// static method
+void Starburst::cast_rays(const cv::Mat &img_gray,
+                          const cv::Rect &roi,
+                          double cx, double cy,
+                          const double *steps_x, const double *steps_y, int nof_rays,
+                          int edge_thresh, pointContainer & pointList) {
+
+	const unsigned char *data = img_gray.data;
+	const size_t step = img_gray.step;
+
+	// inclusive bounds
+	const int xBegin = roi.x;
+	const int yBegin = roi.y;
+	const int xEnd = roi.x + roi.width - 1;
+	const int yEnd = roi.y + roi.height - 1;
 
-    // inclusive bounds
-    const int xEnd = roi.x + roi.width - 1;
-    const int yEnd = roi.y + roi.height - 1;
+	for (int i = 0; i < nof_rays; i++) {
 
-	for (angle = angle_normal - angle_spread / 2.0 + 0.0001; angle < angle_normal + angle_spread / 2.0; angle += angle_step) {
-		dis_cos = dis * cos(angle);
-		dis_sin = dis * sin(angle);
-		p.x = cx + dis_cos;
-		p.y = cy + dis_sin;
+		const double dis_cos = steps_x[i];
+		const double dis_sin = steps_y[i];
 
-		if (p.x < roi.x || p.x > xEnd || p.y < roi.y || p.y > yEnd)
+		// the points are floats, as in the original implementation
+		float px = cx + dis_cos;
+		float py = cy + dis_sin;
+
+		if (px < xBegin || px > xEnd || py < yBegin || py > yEnd)
 			continue;
 
-		pixel_value1 = img_gray.data[(int)(p.y)*img_gray.step+(int)(p.x)];
+		int pixel_value1 = data[(int)(py)*step+(int)(px)];
 		while (1) {
-			p.x += dis_cos;
-			p.y += dis_sin;
-			if (p.x < roi.x || p.x > xEnd || p.y < roi.y || p.y > yEnd)
+			px += dis_cos;
+			py += dis_sin;
+			if (px < xBegin || px > xEnd || py < yBegin || py > yEnd)
 				break;
 
-			pixel_value2 = img_gray.data[(int)(p.y)*img_gray.step+(int)(p.x)];
+			const int pixel_value2 = data[(int)(py)*step+(int)(px)];
 
 			if (pixel_value2 - pixel_value1 > edge_thresh) {
-				pointList.push_back(EdgePoint(cv::Point2f(p.x - dis_cos / 2.0, p.y - dis_sin / 2.0), pixel_value2 - pixel_value1));
+				pointList.push_back(px - dis_cos / 2.0, py - dis_sin / 2.0, pixel_value2 - pixel_value1);
 				break;
 			}
 
@@ -415,10 +864,8 @@ unsigned int Starburst::computeThreshold(const cv::Mat &img_gray)
 	size_t n = this->edge_point.size();
 	unsigned int sum = 0;
 
-	pointContainer::iterator edge;
-
-	for(edge = edge_point.begin(); edge != edge_point.end(); edge++) {
-		int ind = round(edge->point.y) * step + round(edge->point.x);
+	for(size_t i = 0; i < n; i++) {
+		int ind = round(edge_point.y[i]) * step + round(edge_point.x[i]);
 
 		sum += data[ind];
 	}
@@ -431,37 +878,31 @@ void Starburst::removeOutliers(cv::Point2f &mean, double var)
 
 	const double stdDev = std::sqrt(var);	
 
-	pointContainer::iterator edge;
-	for(edge = edge_point.begin(); edge != edge_point.end();) {
+	// move the outliers out and the inliers to the beginning, keeping the order
+	size_t n_inliers = 0;
 
-		double diff_x = edge->point.x - mean.x;
-		double diff_y = edge->point.y - mean.y;
+	for(size_t i = 0; i < edge_point.size(); i++) {
+
+		double diff_x = edge_point.x[i] - mean.x;
+		double diff_y = edge_point.y[i] - mean.y;
 
 		if(std::sqrt(diff_x * diff_x + diff_y * diff_y) > (stdDev * 
-			trackerSettings.STARBURST_OUTLIER_DISTANCE)) {
-
-			// Store the element
-			edge_point_outlier.push_back(*edge);
-
-			// Take the element to remove
-			pointContainer::iterator remove_pos = edge;
-
-			// Is this the first element?
-			if(remove_pos != edge_point.begin()) {
-				// No.. just remove it
-				edge--;
-				edge_point.erase(remove_pos);
-			} else {
-				// We're removing the first element... remove and reset iterator.
-				edge_point.erase(remove_pos);
-				edge = edge_point.begin();
-				continue;
-			}
+			m_settings.STARBURST_OUTLIER_DISTANCE)) {
+
+			edge_point_outlier.push_back(edge_point.x[i],
+			                             edge_point.y[i],
+			                             edge_point.intensityDifference[i]);
 		}
+		else {
 
-		// Next element (NOTE! This must not be run if we are dealing with the first element!)
-		edge++;
+			edge_point.x[n_inliers] = edge_point.x[i];
+			edge_point.y[n_inliers] = edge_point.y[i];
+			edge_point.intensityDifference[n_inliers] = edge_point.intensityDifference[i];
+			n_inliers++;
+		}
 	}
+
+	edge_point.resize(n_inliers);
 }
 
 
@@ -471,24 +912,30 @@ double Starburst::calculateStatistics(cv::Point2f &center)
 
 	center = cv::Point2f(0.0, 0.0);
 
-	if(edge_point.size() != 0) {
+	const size_t n = edge_point.size();
+
+	if(n != 0) {
+
+		const float *xs = &edge_point.x[0];
+		const float *ys = &edge_point.y[0];
 
-		pointContainer::const_iterator itEdge;
-		for(itEdge = edge_point.begin();
-			itEdge != edge_point.end();
-			itEdge++) {
+		for(size_t i = 0; i < n; i++) {
 
-			center   += itEdge->point;
-			square_x += itEdge->point.x * itEdge->point.x;
-			square_y += itEdge->point.y * itEdge->point.y;
+			const float x = xs[i];
+			const float y = ys[i];
+
+			center.x += x;
+			center.y += y;
+			square_x += x * x;
+			square_y += y * y;
 
 		}
 
-		center.x /= edge_point.size();
-		center.y /= edge_point.size();
+		center.x /= n;
+		center.y /= n;
 
-		square_x /= edge_point.size();
-		square_y /= edge_point.size();
+		square_x /= n;
+		square_y /= n;
 
 		double var_x = (center.x * center.x - square_x);
 		double var_y = (center.y * center.y - square_y);
@@ -506,10 +953,9 @@ cv::Point2f Starburst::get_edge_mean(pointContainer & pointList)
 	double sumx = 0, sumy = 0;
 	cv::Point2f edge_mean(0, 0);
 
-	pointContainer::iterator edge;
-	for(edge = pointList.begin(); edge != pointList.end(); edge++) {
-		sumx += edge->point.x;
-		sumy += edge->point.y;
+	for(size_t i = 0; i < pointList.size(); i++) {
+		sumx += pointList.x[i];
+		sumy += pointList.y[i];
 	}
 
 	if (edge_point.size() != 0) {
@@ -522,5 +968,3 @@ cv::Point2f Starburst::get_edge_mean(pointContainer & pointList)
 
 	return edge_mean;
 }
-
-
@@ -36,36 +36,82 @@
 
 
 #include <list>
+#include <vector>
 #include <opencv2/imgproc/imgproc.hpp>
 
+#include "trackerSettings.h"
+
 
 
 enum ProcessStatus {OK, RECOVERABLE_ERROR, UNRECOVERABLE_ERROR};
 
-class EdgePoint {
+/*
+ * Edge points stored as a structure of arrays, so that the statistics
+ * loops read only the coordinates.
+ */
+class EdgePoints {
 
-public:	
+public:
 
-    EdgePoint(cv::Point2f _point, int _intensity) {
+    void clear() {
+        x.clear();
+        y.clear();
+        intensityDifference.clear();
+    }
+
+    size_t size() const {return x.size();}
 
-        this->point = _point;
-        this->intensityDifference = _intensity;
+    bool empty() const {return x.empty();}
 
+    void push_back(float _x, float _y, int _intensity) {
+        x.push_back(_x);
+        y.push_back(_y);
+        intensityDifference.push_back(_intensity);
     }
 
-    cv::Point2f point;
-    int intensityDifference;
+    /* Append the points of other */
+    void append(const EdgePoints &other) {
+        x.insert(x.end(), other.x.begin(), other.x.end());
+        y.insert(y.end(), other.y.begin(), other.y.end());
+        intensityDifference.insert(intensityDifference.end(),
+                                   other.intensityDifference.begin(),
+                                   other.intensityDifference.end());
+    }
+
+    /* Keep the first n points */
+    void resize(size_t n) {
+        x.resize(n);
+        y.resize(n);
+        intensityDifference.resize(n);
+    }
+
+    cv::Point2f point(size_t i) const {return cv::Point2f(x[i], y[i]);}
+
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<int> intensityDifference;
+
 };
 
-typedef std::vector<EdgePoint> pointContainer;
+typedef EdgePoints pointContainer;
+
+
+/* Runs the evaluations of the threshold search, see starburst.cpp */
+class StarburstSearchPool;
 
 
 class Starburst {
 
 public:
 
+    /* Uses a copy of the global settings, see setSettings() */
     Starburst(void);
 
+    /* Use the given settings instead of the current ones */
+    void setSettings(const TrackerSettings &settings) {
+        this->m_settings = settings;
+    }
+
     void reset(void) {
         this->b_reset = true;
     }
@@ -111,10 +157,75 @@ public:
         return start_point;
     }
 
+    /*
+     * The duration of the threshold search, i.e. the time it took to
+     * reacquire the pupil after a reset, in milliseconds. -1 if the last
+     * call to process() did not search.
+     */
+    double getSearchMillis() const {
+        return this->searchMillis;
+    }
+
+    /* The number of contour detections run by the last search */
+    int getSearchEvaluations() const {
+        return this->searchEvaluations;
+    }
+
+    /*
+     * Search all start points and thresholds after a reset, as the
+     * original implementation did, instead of the coarse-to-fine search.
+     * The evaluations are still run in parallel. Meant for comparisons.
+     */
+    void setExhaustiveSearch(bool b) {
+        this->b_exhaustive_search = b;
+    }
+
 private:
 
+    friend class StarburstSearchPool;
+
+    /*
+     * A single evaluation of the threshold search: the contour detection
+     * from start_point with edge_thresh.
+     */
+    struct SearchItem {
+
+        /* The index of the start point in the search grid */
+        int grid_index;
+
+        cv::Point2f start_point;
+        int edge_thresh;
+
+        /* The results, var is -1 if the detection failed */
+        double var;
+        int nof_points;
+
+        bool operator<(const SearchItem &other) const {
+            return grid_index < other.grid_index ||
+                   (grid_index == other.grid_index && edge_thresh < other.edge_thresh);
+        }
+
+    };
+
+    /* Run the contour detection of item and store the results in it */
+    void evaluate(const cv::Mat &img_gray, const cv::Rect &roi, SearchItem &item);
+
+    /*
+     * The grid of start points, the darkest first. At most max_points
+     * points are returned.
+     */
+    void rankStartPoints(const cv::Mat &img_gray,
+                         const cv::Rect &roi,
+                         size_t max_points,
+                         std::vector<SearchItem> &points) const;
+
     double calculateStatistics(cv::Point2f &center);
 
+    /*
+     * Find the start point and the edge threshold that give the lowest
+     * variance, coarse-to-fine unless b_exhaustive_search is set. The
+     * evaluations run in parallel, see StarburstSearchPool.
+     */
     bool testThresholds(const cv::Mat &img_gray,
                         const cv::Rect &roi,
                         int &threshold,
@@ -130,16 +241,42 @@ private:
                                            int N,
                                            unsigned int minimum_cadidate_features);
 
-    static void locate_edge_points(const cv::Mat &img_gray,
-                                   const cv::Rect &roi,
-                                   double cx,
-                                   double cy,
-                                   int dis,
-                                   double angle_step,
-                                   double angle_normal,
-                                   double angle_spread,
-                                   int edge_thresh,
-                                   pointContainer & pointList);
+    void locate_edge_points(const cv::Mat &img_gray,
+                            const cv::Rect &roi,
+                            double cx,
+                            double cy,
+                            int dis,
+                            double angle_step,
+                            double angle_normal,
+                            double angle_spread,
+                            int edge_thresh,
+                            pointContainer & pointList);
+
+    /*
+     * Walk the rays from (cx, cy) with the given steps until the
+     * intensity increases more than edge_thresh or the ray leaves
+     * the roi.
+     */
+    static void cast_rays(const cv::Mat &img_gray,
+                          const cv::Rect &roi,
+                          double cx,
+                          double cy,
+                          const double *steps_x,
+                          const double *steps_y,
+                          int nof_rays,
+                          int edge_thresh,
+                          pointContainer & pointList);
+
+    /*
+     * Compute the steps of the rays at the angles
+     * [angle_normal - angle_spread / 2, angle_normal + angle_spread / 2[
+     */
+    static void make_steps(int dis,
+                           double angle_step,
+                           double angle_normal,
+                           double angle_spread,
+                           std::vector<double> &steps_x,
+                           std::vector<double> &steps_y);
 
     void removeOutliers(cv::Point2f &mean, double var);
     cv::Point2f get_edge_mean(pointContainer & pointList);
@@ -162,6 +299,31 @@ private:
 
     bool b_reset;
 
+    /*
+     * The steps of the seed point rays, which are the same for every
+     * call, and the steps of the returning rays, reused
+     */
+    std::vector<double> seed_steps_x;
+    std::vector<double> seed_steps_y;
+    int seed_steps_N;
+    int seed_steps_dis;
+    std::vector<double> ray_steps_x;
+    std::vector<double> ray_steps_y;
+
+    /* The seed points, reused */
+    pointContainer seed_points;
+
+    /* The evaluations of the threshold search, reused */
+    std::vector<SearchItem> search_items;
+    std::vector<SearchItem> search_results;
+
+    double searchMillis;
+    int searchEvaluations;
+    bool b_exhaustive_search;
+
+    /* A private copy of the settings, never shared between instances */
+    TrackerSettings m_settings;
+
 };
 
 #endif
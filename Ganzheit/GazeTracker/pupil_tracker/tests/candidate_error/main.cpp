@@ -0,0 +1,153 @@
+/*
+ * Checks the template error of the pupil candidates, see
+ * PupilTracker::getTemplateError(), against the way it used to be
+ * computed: the gray image and an anti-aliased cv::ellipse() template
+ * were scaled and subtracted as images. The ellipse was drawn at its
+ * frame coordinates into the template, so the template is empty unless
+ * the pupil is close to the top left corner of the frame.
+ *
+ * Random ellipses are tested around dark pupils of random sizes on a
+ * noisy background, every other one close to the top left corner. The
+ * relative difference of the errors must be below MAX_EMPTY_DIFF for
+ * the empty templates, and below MAX_REL_DIFF for every ellipse and
+ * MEAN_REL_DIFF on average for the others.
+ *
+ * Usage: candidate_error [nof ellipses]
+ */
+
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "PupilTracker.h"
+
+
+static const int FRAME_W           = 640;
+static const int FRAME_H           = 480;
+static const int NOF_ELLIPSES      = 2000;
+
+static const double MAX_EMPTY_DIFF = 1e-4;
+static const double MAX_REL_DIFF   = 0.01;
+static const double MEAN_REL_DIFF  = 0.001;
+
+
+/*
+ * The error as testPupilCandidate() computed it before
+ * getTemplateError(), without the scaling by the number of edge points.
+ * bEmpty tells if the ellipse missed the template.
+ */
+static double getReferenceError(const cv::Mat &imgGray, const cv::RotatedRect &e, const cv::Rect &br, bool &bEmpty) {
+
+    cv::Mat img_ellipse = imgGray(br).clone();
+
+    cv::Mat img_template = cv::Mat(img_ellipse.size(), CV_8UC1);
+
+    cv::rectangle(img_template,
+                  cv::Point(0, 0),
+                  cv::Point(img_template.cols-1, img_template.rows-1),
+                  cv::Scalar(BINARY_WHITE),
+                  CV_FILLED);
+
+    // at the frame coordinates, not relative to the rectangle
+    cv::ellipse(img_template, e, cv::Scalar(BINARY_BLACK), CV_FILLED, CV_AA);
+
+    bEmpty = cv::countNonZero(img_template) == 0;
+
+    img_ellipse.convertTo(img_ellipse, img_ellipse.type(), 0.5, 128);
+    img_template.convertTo(img_template, img_template.type(), 0.5, 0);
+    cv::Mat result_image = img_ellipse - img_template;
+
+    unsigned long sum = 0;
+    const int pixels = result_image.rows * result_image.cols;
+    const unsigned char *data = result_image.data;
+    for(int i = 0; i < pixels; ++i) {
+        sum += data[i];
+    }
+
+    return (double)sum / (double)pixels;
+
+}
+
+
+int main(int argc, char **argv) {
+
+    const int nEllipses = argc > 1 ? std::max(atoi(argv[1]), 1) : NOF_ELLIPSES;
+
+    cv::RNG rng(7);
+
+    cv::Mat img(FRAME_H, FRAME_W, CV_8UC1);
+
+    const cv::Rect rectImg(0, 0, FRAME_W, FRAME_H);
+
+    double dMaxEmptyDiff    = 0.0;
+    double dMaxDiff         = 0.0;
+    double dSumDiff         = 0.0;
+    int nEmpty              = 0;
+    int nTested             = 0;
+
+    for(int i = 0; i < nEllipses; ++i) {
+
+        cv::randu(img, cv::Scalar(120), cv::Scalar(200));
+
+        const float r = rng.uniform(8.0f, 60.0f);
+
+        // every other pupil where the template is not empty
+        const cv::Point2f centre = i % 2 ?
+            cv::Point2f(rng.uniform(r + 2.0f, 3.5f * r), rng.uniform(r + 2.0f, 3.5f * r)) :
+            cv::Point2f(rng.uniform(r + 2.0f, FRAME_W - r - 2.0f), rng.uniform(r + 2.0f, FRAME_H - r - 2.0f));
+
+        cv::circle(img, centre, (int)r, cv::Scalar(rng.uniform(10, 50)), CV_FILLED, CV_AA);
+
+        // a candidate close to the pupil
+        const cv::RotatedRect e(cv::Point2f(centre.x + (float)rng.gaussian(2.0),
+                                            centre.y + (float)rng.gaussian(2.0)),
+                                cv::Size2f(2.0f * r * rng.uniform(0.8f, 1.2f),
+                                           2.0f * r * rng.uniform(0.8f, 1.2f)),
+                                rng.uniform(0.0f, 180.0f));
+
+        const cv::Rect br = e.boundingRect();
+        if((br & rectImg) != br) {
+            continue;
+        }
+
+        bool bEmpty;
+        const double errRef = getReferenceError(img, e, br, bEmpty);
+        const double err    = gt::PupilTracker::getTemplateError(img, e, br);
+        const double diff   = fabs(err - errRef) / errRef;
+
+        if(diff > (bEmpty ? MAX_EMPTY_DIFF : MAX_REL_DIFF)) {
+            printf("    ellipse (%.2f, %.2f) %.2f x %.2f, %.1f deg: %.3f, %.3f before\n",
+                   e.center.x, e.center.y, e.size.width, e.size.height, e.angle, err, errRef);
+        }
+
+        if(bEmpty) {
+            dMaxEmptyDiff = std::max(dMaxEmptyDiff, diff);
+            ++nEmpty;
+        }
+        else {
+            dMaxDiff = std::max(dMaxDiff, diff);
+            dSumDiff += diff;
+            ++nTested;
+        }
+
+    }
+
+    const double dMeanDiff = dSumDiff / std::max(nTested, 1);
+
+    printf("%d empty templates, relative difference %.5f %% at most (%.2f %% allowed)\n",
+           nEmpty, 100.0 * dMaxEmptyDiff, 100.0 * MAX_EMPTY_DIFF);
+
+    printf("%d other ellipses, relative difference %.3f %% at most (%.1f %% allowed), %.3f %% on average (%.1f %% allowed)\n",
+           nTested, 100.0 * dMaxDiff, 100.0 * MAX_REL_DIFF, 100.0 * dMeanDiff, 100.0 * MEAN_REL_DIFF);
+
+    const bool ok = nEmpty > 0 && nTested > 0 &&
+                    dMaxEmptyDiff <= MAX_EMPTY_DIFF &&
+                    dMaxDiff <= MAX_REL_DIFF && dMeanDiff <= MEAN_REL_DIFF;
+
+    printf("\n%s\n", ok ? "OK" : "FAILED");
+
+    return ok ? 0 : 1;
+
+}
@@ -0,0 +1,225 @@
+/*
+ * Measures how many bytes PupilTracker::track() allocates per frame
+ * when the whole frame is copied and when only the crop area is
+ * copied, see PupilTracker::setCropOnly().
+ *
+ * All heap allocations of the process are counted by interposing
+ * malloc() and friends. Only the allocations made inside track() are
+ * counted and the first frames are skipped, so that the persistent
+ * work buffers do not show up in the numbers.
+ *
+ * Usage: crop_alloc [image] [nof frames]
+ *
+ * If no image is given, a synthetic 1280x720 eye image is used.
+ */
+
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <sys/time.h>
+
+#include "PupilTracker.h"
+#include "trackerSettings.h"
+#include "SyntheticEye.h"
+
+
+/*****************************************************************************
+ * Allocation counting
+ ****************************************************************************/
+
+extern "C" {
+    void *__libc_malloc(size_t sz);
+    void *__libc_calloc(size_t n, size_t sz);
+    void *__libc_realloc(void *p, size_t sz);
+    void *__libc_memalign(size_t alignment, size_t sz);
+}
+
+static volatile int g_bCount      = 0;
+static volatile size_t g_nBytes   = 0;
+static volatile size_t g_nAllocs  = 0;
+
+
+static inline void countAlloc(size_t sz) {
+    if(g_bCount) {
+        __sync_fetch_and_add(&g_nBytes, sz);
+        __sync_fetch_and_add(&g_nAllocs, 1);
+    }
+}
+
+
+extern "C" void *malloc(size_t sz) {
+    countAlloc(sz);
+    return __libc_malloc(sz);
+}
+
+
+extern "C" void *calloc(size_t n, size_t sz) {
+    countAlloc(n * sz);
+    return __libc_calloc(n, sz);
+}
+
+
+extern "C" void *realloc(void *p, size_t sz) {
+    countAlloc(sz);
+    return __libc_realloc(p, sz);
+}
+
+
+extern "C" int posix_memalign(void **p, size_t alignment, size_t sz) {
+    countAlloc(sz);
+    *p = __libc_memalign(alignment, sz);
+    return *p == NULL ? 12 : 0; // ENOMEM
+}
+
+
+
+/*****************************************************************************
+ * The benchmark
+ ****************************************************************************/
+
+static const int FRAME_W        = 1280;
+static const int FRAME_H        = 720;
+static const int WARMUP_FRAMES  = 10;
+
+
+static double getMs(const struct timeval &t1, const struct timeval &t2) {
+    return (t2.tv_sec - t1.tv_sec) * 1000.0 + (t2.tv_usec - t1.tv_usec) / 1000.0;
+}
+
+
+struct Result {
+    double bytesPerFrame;
+    double allocsPerFrame;
+    double msPerFrame;
+    std::vector<cv::Point2f> centres;
+};
+
+
+static void run(const cv::Mat *imgInput, int nFrames, bool bCropOnly, Result &res) {
+
+    gt::PupilTracker tracker;
+    tracker.setCropOnly(bCropOnly);
+
+    cv::Mat img(FRAME_H, FRAME_W, CV_8UC1);
+    if(imgInput != NULL) {
+        img = *imgInput;
+    }
+
+    // a simple eye with two glints, the pupil moves slowly
+    SyntheticEye eye(FRAME_W, FRAME_H);
+    eye.ampX        = 40;
+    eye.ampY        = 20;
+    eye.speed       = 0.05;
+    eye.pupilAngle  = 10.0;
+    eye.addGlint(cv::Point(-20, 40), 3);
+    eye.addGlint(cv::Point( 20, 40), 3);
+
+    size_t nBytes  = 0;
+    size_t nAllocs = 0;
+    double ms      = 0.0;
+
+    for(int i = 0; i < nFrames + WARMUP_FRAMES; ++i) {
+
+        if(imgInput == NULL) {
+            eye.draw(img, i);
+        }
+
+        g_nBytes  = 0;
+        g_nAllocs = 0;
+
+        struct timeval t1, t2;
+        gettimeofday(&t1, NULL);
+
+        g_bCount = 1;
+        tracker.track(img);
+        g_bCount = 0;
+
+        gettimeofday(&t2, NULL);
+
+        if(i < WARMUP_FRAMES) {
+            continue;
+        }
+
+        nBytes  += g_nBytes;
+        nAllocs += g_nAllocs;
+        ms      += getMs(t1, t2);
+
+        res.centres.push_back(tracker.getEllipsePupil()->center);
+
+    }
+
+    res.bytesPerFrame  = (double)nBytes  / nFrames;
+    res.allocsPerFrame = (double)nAllocs / nFrames;
+    res.msPerFrame     = ms / nFrames;
+
+}
+
+
+int main(int argc, char **argv) {
+
+    cv::Mat imgFile;
+    const cv::Mat *pImg = NULL;
+
+    if(argc > 1) {
+
+        imgFile = cv::imread(argv[1], 0);
+
+        if(imgFile.empty()) {
+            printf("Could not read %s\n", argv[1]);
+            return -1;
+        }
+
+        pImg = &imgFile;
+
+    }
+
+    int nFrames = argc > 2 ? atoi(argv[2]) : 300;
+    if(nFrames <= 0) {
+        nFrames = 300;
+    }
+
+    const int w = pImg != NULL ? pImg->cols : FRAME_W;
+    const int h = pImg != NULL ? pImg->rows : FRAME_H;
+
+    // a typical crop area around the eye
+    trackerSettings.CROP_AREA_W = w / 3;
+    trackerSettings.CROP_AREA_H = h / 2;
+    trackerSettings.CROP_AREA_X = (w - trackerSettings.CROP_AREA_W) / 2;
+    trackerSettings.CROP_AREA_Y = (h - trackerSettings.CROP_AREA_H) / 2;
+
+    printf("frame: %dx%d, crop area: (%d, %d, %d, %d), frames: %d\n",
+           w, h,
+           trackerSettings.CROP_AREA_X,
+           trackerSettings.CROP_AREA_Y,
+           trackerSettings.CROP_AREA_W,
+           trackerSettings.CROP_AREA_H,
+           nFrames);
+
+    Result resFull;
+    Result resCrop;
+    run(pImg, nFrames, false, resFull);
+    run(pImg, nFrames, true,  resCrop);
+
+    printf("\n%-12s %16s %16s %12s\n", "mode", "bytes/frame", "allocs/frame", "ms/frame");
+    printf("%-12s %16.0f %16.1f %12.3f\n", "full frame", resFull.bytesPerFrame, resFull.allocsPerFrame, resFull.msPerFrame);
+    printf("%-12s %16.0f %16.1f %12.3f\n", "crop only",  resCrop.bytesPerFrame, resCrop.allocsPerFrame, resCrop.msPerFrame);
+
+
+    /*
+     * The results must be in frame coordinates in both modes. The blur
+     * at the crop border may differ slightly, so report the difference
+     * instead of requiring equality.
+     */
+    double maxDiff = 0.0;
+    for(size_t i = 0; i < resFull.centres.size(); ++i) {
+        cv::Point2f d = resFull.centres[i] - resCrop.centres[i];
+        maxDiff = std::max(maxDiff, (double)sqrt(d.x * d.x + d.y * d.y));
+    }
+
+    printf("\nmax pupil centre difference between the modes: %.3f px\n", maxDiff);
+
+    return maxDiff < 1.0 ? 0 : 1;
+
+}
@@ -0,0 +1,528 @@
+/*
+ * Checks that tracking the eye frames as captured in the mirrored mode,
+ * see PupilTracker::setMirrored(), gives exactly the same results as
+ * flipping the frames around the y-axis before tracking, which the
+ * front ends did before. The ResultData written by the tracker is made
+ * of these results, so it must not change by a single bit.
+ *
+ * Both the crop-only mode and the whole frame are checked. The crop
+ * area is off the centre, so a wrongly mirrored area shows up. The
+ * work images must be the same as well, and the pupil must be found
+ * in some of the frames.
+ *
+ * The session is then tracked with gt::GazeTracker as GTWorker gives the
+ * frames to it, before and after the tracker mirrored them. Before, the
+ * mirrored crop area was decoded, flipped and placed in the crop area of
+ * the frame. Now it is decoded where it is, and the eye camera is
+ * mirrored. Only the crop area is decoded, the rest of the frame is
+ * different in the two. The results in frame coordinates, i.e. after
+ * PupilTracker::toFrameCoordinates(), the glints and their LED labels,
+ * and the cornea and pupil centres must be the same, bit by bit.
+ *
+ * Usage: mirror [camera1.mjpg] [nof frames]
+ *
+ * The eye video of a recorded session is read, by default a synthetic
+ * 640x480 eye sequence is used. Both gaze trackers use the same made-up
+ * calibration, it does not change the comparison.
+ */
+
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "PupilTracker.h"
+#include "GazeTracker.h"
+#include "Camera.h"
+#include "trackerSettings.h"
+#include "SyntheticEye.h"
+
+
+static const int FRAME_W        = 640;
+static const int FRAME_H        = 480;
+static const int NOF_FRAMES     = 300;
+
+
+static bool equal(const cv::Mat &a, const cv::Mat &b) {
+
+    if(a.size() != b.size() || a.type() != b.type()) {
+        return false;
+    }
+
+    const size_t nBytes = a.cols * a.elemSize();
+
+    for(int y = 0; y < a.rows; ++y) {
+        if(memcmp(a.ptr(y), b.ptr(y), nBytes) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+
+}
+
+
+static bool equal(const cv::RotatedRect &a, const cv::RotatedRect &b) {
+
+    return memcmp(&a.center, &b.center, sizeof(a.center)) == 0 &&
+           memcmp(&a.size, &b.size, sizeof(a.size)) == 0 &&
+           memcmp(&a.angle, &b.angle, sizeof(a.angle)) == 0;
+
+}
+
+
+static bool equal(const std::vector<cv::Point2d> &a, const std::vector<cv::Point2d> &b) {
+
+    return a.size() == b.size() &&
+           (a.size() == 0 || memcmp(&a[0], &b[0], a.size() * sizeof(a[0])) == 0);
+
+}
+
+
+static bool equal(const cv::Point3d *a, const cv::Point3d *b) {
+
+    return (a == NULL && b == NULL) ||
+           (a != NULL && b != NULL && memcmp(a, b, sizeof(*a)) == 0);
+
+}
+
+
+static bool equal(const std::vector<std::vector<cv::Point> > &a, const std::vector<std::vector<cv::Point> > &b) {
+
+    if(a.size() != b.size()) {
+        return false;
+    }
+
+    for(size_t i = 0; i < a.size(); ++i) {
+        if(a[i] != b[i]) {
+            return false;
+        }
+    }
+
+    return true;
+
+}
+
+
+/*
+ * Track the frame flipped with the reference tracker and as it is with
+ * the mirrored one. Returns a description of the first difference, or
+ * NULL if there is none. bFound tells if the pupil was found.
+ */
+static const char *compare(const cv::Mat &img, gt::PupilTracker &reference, gt::PupilTracker &mirrored, bool &bFound) {
+
+    cv::Mat imgFlipped;
+    cv::flip(img, imgFlipped, 1);
+
+    const bool bRef = reference.track(imgFlipped);
+    const bool bMir = mirrored.track(img);
+
+    bFound = bRef;
+
+    if(reference.getCropArea() != mirrored.getCropArea()) {
+        return "crop area";
+    }
+
+    // the mirrored tracker flips while copying, this is the image tracked
+    if(!equal(reference.getGrayImage(), mirrored.getGrayImage())) {
+        return "work image";
+    }
+
+    if(bRef != bMir) {
+        return "pupil found";
+    }
+
+    if(reference.getROI() != mirrored.getROI()) {
+        return "ROI";
+    }
+
+    if(!equal(*reference.getEllipsePupil(), *mirrored.getEllipsePupil())) {
+        return "pupil ellipse";
+    }
+
+    if(!equal(reference.getCornealReflections(), mirrored.getCornealReflections())) {
+        return "glints";
+    }
+
+    if(!equal(reference.getClusters(), mirrored.getClusters())) {
+        return "clusters";
+    }
+
+    if(reference.getClusterPupil() != mirrored.getClusterPupil()) {
+        return "pupil cluster";
+    }
+
+    return NULL;
+
+}
+
+
+/*
+ * Read the next frame of the video, or draw the synthetic eye if there
+ * is no video. Returns false at the end of the video.
+ */
+static bool readFrame(cv::VideoCapture &cap, const SyntheticEye &eye, int i, cv::Mat &img, cv::Mat &imgGray) {
+
+    if(!cap.isOpened()) {
+        eye.draw(imgGray, i);
+        return true;
+    }
+
+    if(!cap.read(img)) {
+        return false;
+    }
+
+    cv::cvtColor(img, imgGray, CV_BGR2GRAY);
+
+    return true;
+
+}
+
+
+/* Returns the number of frames that differ */
+static int run(const char *file, int nFrames, bool bCropOnly, int &nFound) {
+
+    cv::VideoCapture cap;
+
+    if(file != NULL && !cap.open(file)) {
+        printf("Could not open %s\n", file);
+        return -1;
+    }
+
+    gt::PupilTracker reference;
+    reference.setCropOnly(bCropOnly);
+
+    gt::PupilTracker mirrored;
+    mirrored.setCropOnly(bCropOnly);
+    mirrored.setMirrored(true);
+
+    /*
+     * An eye that is not symmetric around the y-axis: the pupil moves
+     * around a point left of the centre, the glints are not in a row
+     * and there is a dark eyelash blob on one side.
+     */
+    SyntheticEye eye(FRAME_W, FRAME_H);
+    eye.offset      = cv::Point(-50, 0);
+    eye.ampX        = 40;
+    eye.ampY        = 20;
+    eye.freqY       = 1.3;
+    eye.speed       = 0.05;
+    eye.pupilAxes   = cv::Size(34, 28);
+    eye.pupilAngle  = 25.0;
+    eye.addGlint(cv::Point(-24, 38), 3);
+    eye.addGlint(cv::Point( 10, 44), 3);
+    eye.addGlint(cv::Point( 30, 30), 2);
+    eye.addBlob(cv::Point(FRAME_W / 2 + 120, 140), cv::Size(60, 12), -15.0, 40);
+
+    cv::Mat img;
+    cv::Mat imgGray;
+
+    int nDiffering = 0;
+    nFound = 0;
+
+    for(int i = 0; i < nFrames; ++i) {
+
+        if(!readFrame(cap, eye, i, img, imgGray)) {
+            break;
+        }
+
+        bool bFound;
+        const char *diff = compare(imgGray, reference, mirrored, bFound);
+
+        if(diff != NULL) {
+
+            if(nDiffering == 0) {
+                printf("    frame %d: the %s differs\n", i, diff);
+            }
+
+            ++nDiffering;
+
+        }
+
+        nFound += bFound;
+
+    }
+
+    return nDiffering;
+
+}
+
+
+/*
+ * The frame GTWorker gave to the tracker before the tracker mirrored the
+ * frames: the mirrored crop area of the captured frame, flipped, in the
+ * crop area. The rest of the frame is not decoded.
+ */
+static void decodeFlipped(const cv::Mat &img, const cv::Rect &rectCrop, cv::Mat &frame) {
+
+    frame.create(img.size(), CV_8UC1);
+    frame.setTo(cv::Scalar(0));
+
+    const cv::Rect rectMirrored(img.cols - rectCrop.x - rectCrop.width, rectCrop.y, rectCrop.width, rectCrop.height);
+
+    cv::Mat crop(frame, rectCrop);
+    cv::flip(cv::Mat(img, rectMirrored), crop, 1);
+
+}
+
+
+/*
+ * The frame GTWorker gives to the tracker of a mirrored eye camera: the
+ * mirrored crop area of the captured frame, where it is.
+ */
+static void decodeMirrored(const cv::Mat &img, const cv::Rect &rectCrop, cv::Mat &frame) {
+
+    frame.create(img.size(), CV_8UC1);
+    frame.setTo(cv::Scalar(255));
+
+    const cv::Rect rectMirrored(img.cols - rectCrop.x - rectCrop.width, rectCrop.y, rectCrop.width, rectCrop.height);
+
+    cv::Mat crop(frame, rectMirrored);
+    cv::Mat(img, rectMirrored).copyTo(crop);
+
+}
+
+
+/*
+ * Compare the results of the gaze trackers, in frame coordinates.
+ * Returns a description of the first difference, or NULL if there is
+ * none. nLabelled is the number of glints with an LED label.
+ */
+static const char *compareGaze(gt::GazeTracker &reference, gt::GazeTracker &mirrored, int &nLabelled) {
+
+    nLabelled = 0;
+
+    const gt::PupilTracker *pupilRef = reference.getPupilTracker();
+    const gt::PupilTracker *pupilMir = mirrored.getPupilTracker();
+
+    if(!equal(*pupilRef->getEllipsePupil(), *pupilMir->getEllipsePupil())) {
+        return "pupil ellipse";
+    }
+
+    if(!equal(pupilRef->getCornealReflections(), pupilMir->getCornealReflections())) {
+        return "glints";
+    }
+
+    const std::vector<gt::LED> &ledsRef = reference.getLEDs();
+    const std::vector<gt::LED> &ledsMir = mirrored.getLEDs();
+
+    if(ledsRef.size() != ledsMir.size()) {
+        return "number of LEDs";
+    }
+
+    for(size_t i = 0; i < ledsRef.size(); ++i) {
+
+        if(ledsRef[i].getLabel() != ledsMir[i].getLabel()) {
+            return "glint label";
+        }
+
+        if(memcmp(&ledsRef[i].getGlint2D(), &ledsMir[i].getGlint2D(), sizeof(cv::Point2d)) != 0) {
+            return "glint of the LED";
+        }
+
+        if(!equal(ledsRef[i].getGlintDirection3D(), ledsMir[i].getGlintDirection3D())) {
+            return "glint direction";
+        }
+
+        nLabelled += ledsRef[i].getLabel() >= 0;
+
+    }
+
+    if(memcmp(reference.getCentreCornea(), mirrored.getCentreCornea(), 3 * sizeof(double)) != 0) {
+        return "cornea centre";
+    }
+
+    if(memcmp(reference.getCentrePupil(), mirrored.getCentrePupil(), 3 * sizeof(double)) != 0) {
+        return "pupil centre";
+    }
+
+    const double dRadiusRef = reference.getPupilRadius();
+    const double dRadiusMir = mirrored.getPupilRadius();
+
+    if(memcmp(&dRadiusRef, &dRadiusMir, sizeof(double)) != 0) {
+        return "pupil radius";
+    }
+
+    return NULL;
+
+}
+
+
+/*
+ * Track the session with gaze trackers, as GTWorker gives the frames
+ * before and after the tracker mirrored them. Returns the number of
+ * frames that differ.
+ */
+static int runSession(const char *file, int nFrames, int &nTracked, int &nLabelled) {
+
+    cv::VideoCapture cap;
+
+    if(file != NULL && !cap.open(file)) {
+        printf("Could not open %s\n", file);
+        return -1;
+    }
+
+    // as in run(), with the glints of the six LEDs
+    SyntheticEye eye(FRAME_W, FRAME_H);
+    eye.offset      = cv::Point(-50, 0);
+    eye.ampX        = 40;
+    eye.ampY        = 20;
+    eye.freqY       = 1.3;
+    eye.speed       = 0.05;
+    eye.pupilAxes   = cv::Size(34, 28);
+    eye.pupilAngle  = 25.0;
+    eye.addSixLEDGlints(2);
+    eye.addBlob(cv::Point(FRAME_W / 2 + 120, 140), cv::Size(60, 12), -15.0, 40);
+
+    // the LEDs around the camera, in metres
+    std::vector<cv::Point3d> leds(6);
+    leds[0] = cv::Point3d( 0.000, -0.015, 0.0);
+    leds[1] = cv::Point3d(-0.013, -0.007, 0.0);
+    leds[2] = cv::Point3d(-0.013,  0.007, 0.0);
+    leds[3] = cv::Point3d( 0.000,  0.015, 0.0);
+    leds[4] = cv::Point3d( 0.013,  0.007, 0.0);
+    leds[5] = cv::Point3d( 0.013, -0.007, 0.0);
+
+    const cv::Rect rectCrop(trackerSettings.CROP_AREA_X,
+                            trackerSettings.CROP_AREA_Y,
+                            trackerSettings.CROP_AREA_W,
+                            trackerSettings.CROP_AREA_H);
+
+    gt::GazeTracker reference;
+    gt::GazeTracker mirrored;
+    bool bInit = false;
+
+    cv::Mat img;
+    cv::Mat imgGray;
+    cv::Mat frameRef;
+    cv::Mat frameMir;
+
+    int nDiffering = 0;
+    nTracked  = 0;
+    nLabelled = 0;
+
+    for(int i = 0; i < nFrames; ++i) {
+
+        if(!readFrame(cap, eye, i, img, imgGray)) {
+            break;
+        }
+
+        if(!bInit) {
+
+            // column-major order
+            const double intr[9] = {800.0,   0.0, 0.0,
+                                      0.0, 800.0, 0.0,
+                                    0.5 * imgGray.cols, 0.5 * imgGray.rows, 1.0};
+            const double dist[5] = {0.0, 0.0, 0.0, 0.0, 0.0};
+
+            Camera camera;
+            camera.setIntrinsicMatrix(intr);
+            camera.setDistortion(dist);
+
+            reference.init(camera, leds);
+
+            camera.setMirrored(true);
+            mirrored.init(camera, leds);
+
+            // GTWorker decodes only the crop area
+            reference.getPupilTracker()->setCropOnly(true);
+            mirrored.getPupilTracker()->setCropOnly(true);
+
+            bInit = true;
+
+        }
+
+        decodeFlipped(imgGray, rectCrop, frameRef);
+        decodeMirrored(imgGray, rectCrop, frameMir);
+
+        const bool bRef = reference.track(frameRef);
+        const bool bMir = mirrored.track(frameMir);
+
+        int nFrameLabelled = 0;
+        const char *diff = bRef != bMir ? "tracking result" : compareGaze(reference, mirrored, nFrameLabelled);
+
+        if(diff != NULL) {
+
+            if(nDiffering == 0) {
+                printf("    frame %d: the %s differs\n", i, diff);
+            }
+
+            ++nDiffering;
+
+        }
+
+        nTracked  += bRef;
+        nLabelled += nFrameLabelled;
+
+    }
+
+    return nDiffering;
+
+}
+
+
+int main(int argc, char **argv) {
+
+    const char *file = argc > 1 ? argv[1] : NULL;
+
+    int nFrames = argc > 2 ? atoi(argv[2]) : NOF_FRAMES;
+    if(nFrames <= 0) {
+        nFrames = NOF_FRAMES;
+    }
+
+    // a crop area off the centre, in the coordinates of the flipped frames
+    trackerSettings.CROP_AREA_X = 148;
+    trackerSettings.CROP_AREA_Y = 60;
+    trackerSettings.CROP_AREA_W = 400;
+    trackerSettings.CROP_AREA_H = 320;
+
+    printf("%s, crop area (%d, %d, %d, %d)\n",
+           file != NULL ? file : "synthetic eye",
+           trackerSettings.CROP_AREA_X,
+           trackerSettings.CROP_AREA_Y,
+           trackerSettings.CROP_AREA_W,
+           trackerSettings.CROP_AREA_H);
+
+    bool ok = true;
+
+    for(int i = 0; i < 2; ++i) {
+
+        const bool bCropOnly = i == 0;
+
+        printf("%s:\n", bCropOnly ? "crop only" : "whole frame");
+
+        int nFound = 0;
+        const int nDiffering = run(file, nFrames, bCropOnly, nFound);
+
+        if(nDiffering < 0) {
+            return -1;
+        }
+
+        printf("    pupil found in %d frames, %d frames differ\n", nFound, nDiffering);
+
+        // the results are compared only if there are some
+        ok &= nDiffering == 0 && nFound > 0;
+
+    }
+
+    printf("gaze trackers, the frames as given by GTWorker:\n");
+
+    int nTracked  = 0;
+    int nLabelled = 0;
+    const int nDiffering = runSession(file, nFrames, nTracked, nLabelled);
+
+    if(nDiffering < 0) {
+        return -1;
+    }
+
+    printf("    tracked %d frames, %d glints labelled, %d frames differ\n", nTracked, nLabelled, nDiffering);
+
+    ok &= nDiffering == 0 && nTracked > 0 && nLabelled > 0;
+
+    printf("\n%s\n", ok ? "OK" : "FAILED");
+
+    return ok ? 0 : 1;
+
+}
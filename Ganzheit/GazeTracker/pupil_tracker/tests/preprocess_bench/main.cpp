@@ -0,0 +1,151 @@
+/*
+ * Micro-benchmark for gt::Preprocessor.
+ *
+ * Compares Preprocessor::process() with the OpenCV call chain it
+ * replaces, cv::blur() + cv::equalizeHist() + two cv::threshold()s, at
+ * the typical crop sizes. Both the full-frame mode, where the work area
+ * is a part of a 640x480 frame, and the crop-only mode, where the image
+ * is the work area, are run. The results must be identical, bit by bit.
+ *
+ * Usage: preprocess_bench [nof iterations]
+ */
+
+#include <opencv2/imgproc/imgproc.hpp>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "Preprocessor.h"
+#include "SyntheticEye.h"
+
+
+static const int FRAME_W      = 640;
+static const int FRAME_H      = 480;
+static const int TH_PUPIL     = 40;
+static const int TH_CR        = 200;
+
+
+static double getMillis(const struct timeval &t1, const struct timeval &t2) {
+    return 1e3 * (t2.tv_sec - t1.tv_sec) + 1e-3 * (t2.tv_usec - t1.tv_usec);
+}
+
+
+static bool equalArea(const cv::Mat &a, const cv::Mat &b, const cv::Rect &rect) {
+
+    for(int y = rect.y; y < rect.y + rect.height; ++y) {
+        if(memcmp(a.ptr<unsigned char>(y) + rect.x, b.ptr<unsigned char>(y) + rect.x, rect.width) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+
+}
+
+
+/*
+ * Run both versions nIter times on a copy of imgSrc, check that the
+ * results are identical and print the timings.
+ */
+static bool runCase(const char *strName, const cv::Mat &imgSrc, const cv::Rect &rectWork, int nIter) {
+
+    gt::Preprocessor preprocessor;
+
+    cv::Mat imgGrayRef, imgCrRef, imgPupilRef;
+    cv::Mat imgGray, imgCr, imgPupil;
+
+    double dMillisRef = 0.0;
+    double dMillis    = 0.0;
+
+    for(int i = 0; i < nIter; ++i) {
+
+        struct timeval t1, t2;
+
+        imgSrc.copyTo(imgGrayRef);
+        gettimeofday(&t1, NULL);
+        gt::Preprocessor::processOpenCV(imgGrayRef, rectWork, TH_CR, imgCrRef, TH_PUPIL, imgPupilRef);
+        gettimeofday(&t2, NULL);
+        dMillisRef += getMillis(t1, t2);
+
+        imgSrc.copyTo(imgGray);
+        gettimeofday(&t1, NULL);
+        preprocessor.process(imgGray, rectWork, TH_CR, imgCr, TH_PUPIL, imgPupil);
+        gettimeofday(&t2, NULL);
+        dMillis += getMillis(t1, t2);
+
+    }
+
+    const bool bEqual = equalArea(imgGrayRef, imgGray, cv::Rect(0, 0, imgGray.cols, imgGray.rows)) &&
+                        equalArea(imgCrRef, imgCr, rectWork)                                      &&
+                        equalArea(imgPupilRef, imgPupil, rectWork);
+
+    printf("%-10s %3dx%3d   OpenCV %7.3f ms   fused %7.3f ms   x%4.2f   %s\n",
+           strName,
+           rectWork.width,
+           rectWork.height,
+           dMillisRef / nIter,
+           dMillis / nIter,
+           dMillisRef / dMillis,
+           bEqual ? "OK" : "DIFFERS");
+
+    return bEqual;
+
+}
+
+
+int main(int argc, char **argv) {
+
+    int nIter = argc > 1 ? atoi(argv[1]) : 500;
+    nIter = std::max(nIter, 1);
+
+    // a noisy eye with a dark pupil and a few glints
+    SyntheticEye eye(FRAME_W, FRAME_H);
+    eye.bgLow       = 140;
+    eye.bgHigh      = 190;
+    eye.irisLevel   = 100;
+    eye.pupilAxes   = cv::Size(35, 30);
+    eye.pupilAngle  = 20.0;
+    for(int i = 0; i < 6; ++i) {
+        eye.addGlint(cv::Point(-25 + 10 * i, -15 + 6 * (i % 2)), 2);
+    }
+
+    cv::Mat imgFrame;
+    eye.draw(imgFrame, 0);
+
+    // the typical crop areas, centred
+    const cv::Size sizes[] = {cv::Size(200, 150),
+                              cv::Size(320, 240),
+                              cv::Size(400, 300),
+                              cv::Size(480, 360),
+                              cv::Size(640, 480)};
+
+    const int nSizes = sizeof(sizes) / sizeof(sizes[0]);
+
+    int nFailures = 0;
+
+    for(int i = 0; i < nSizes; ++i) {
+
+        const cv::Rect rectCrop((FRAME_W - sizes[i].width) / 2,
+                                (FRAME_H - sizes[i].height) / 2,
+                                sizes[i].width,
+                                sizes[i].height);
+
+        // the work area is a part of the frame
+        if(!runCase("frame", imgFrame, rectCrop, nIter)) {
+            ++nFailures;
+        }
+
+        // the work image is the crop area
+        const cv::Mat imgCrop(imgFrame, rectCrop);
+        if(!runCase("crop-only", imgCrop.clone(), cv::Rect(0, 0, rectCrop.width, rectCrop.height), nIter)) {
+            ++nFailures;
+        }
+
+    }
+
+    printf("%s\n", nFailures == 0 ? "OK" : "FAILED");
+
+    return nFailures == 0 ? 0 : 1;
+
+}
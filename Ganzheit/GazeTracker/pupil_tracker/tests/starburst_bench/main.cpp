@@ -0,0 +1,231 @@
+/*
+ * Benchmark for Starburst::process() on recorded eye frames.
+ *
+ * The frames are read from a video, converted to grayscale and
+ * preprocessed as in PupilTracker. Starburst::process() is then timed
+ * in two modes:
+ *
+ *   tracking : the start point is carried from frame to frame
+ *   reset    : the starburst is reset before every frame, so that the
+ *              thresholds and start points are searched every time
+ *
+ * A checksum of the results is printed, so that the results of two
+ * builds can be compared.
+ *
+ * Usage: starburst_bench [video] [settings file] [nof frames]
+ *
+ * If no video is given, synthetic eye frames are used.
+ */
+
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <sys/time.h>
+#include <vector>
+
+#include "starburst.h"
+#include "Preprocessor.h"
+#include "trackerSettings.h"
+#include "localTrackerSettings.h"
+#include "settingsIO.h"
+#include "SyntheticEye.h"
+
+
+static const int FRAME_W            = 640;
+static const int FRAME_H            = 480;
+static const int NOF_FRAMES_DEFAULT = 300;
+
+
+static double getMillis(const struct timeval &t1, const struct timeval &t2) {
+    return 1e3 * (t2.tv_sec - t1.tv_sec) + 1e-3 * (t2.tv_usec - t1.tv_usec);
+}
+
+
+/*
+ * Read and preprocess the frames
+ */
+static bool readFrames(const char *strVideo, int nFrames, std::vector<cv::Mat> &frames, cv::Rect &rectWork) {
+
+    cv::VideoCapture cap;
+    if(strVideo != NULL && !cap.open(strVideo)) {
+        printf("Could not open %s\n", strVideo);
+        return false;
+    }
+
+    gt::Preprocessor preprocessor;
+    cv::Mat imgCr, imgPupil;
+
+    // a noisy eye with a dark pupil, moving from frame to frame
+    SyntheticEye eye(FRAME_W, FRAME_H);
+    eye.bgLow       = 150;
+    eye.bgHigh      = 180;
+    eye.ampX        = 60;
+    eye.ampY        = 30;
+    eye.freqY       = 0.7;
+    eye.irisLevel   = 100;
+    eye.pupilAxes   = cv::Size(35, 30);
+
+    for(int i = 0; i < nFrames; ++i) {
+
+        cv::Mat imgGray;
+
+        if(strVideo != NULL) {
+
+            cv::Mat img;
+            if(!cap.read(img) || img.empty()) {
+                break;
+            }
+
+            if(img.channels() == 3) {
+                cv::cvtColor(img, imgGray, CV_BGR2GRAY);
+            }
+            else {
+                img.copyTo(imgGray);
+            }
+
+        }
+        else {
+            eye.draw(imgGray, i);
+        }
+
+        // the crop area of the settings, if it fits in the frame
+        rectWork = cv::Rect(trackerSettings.CROP_AREA_X,
+                            trackerSettings.CROP_AREA_Y,
+                            trackerSettings.CROP_AREA_W,
+                            trackerSettings.CROP_AREA_H);
+
+        if(rectWork.x < 0 || rectWork.y < 0 ||
+           rectWork.width <= 0 || rectWork.height <= 0 ||
+           rectWork.x + rectWork.width > imgGray.cols ||
+           rectWork.y + rectWork.height > imgGray.rows) {
+
+            rectWork = cv::Rect(0, 0, imgGray.cols, imgGray.rows);
+
+        }
+
+        preprocessor.process(imgGray, rectWork, -1, imgCr, -1, imgPupil);
+
+        frames.push_back(imgGray);
+
+    }
+
+    return !frames.empty();
+
+}
+
+
+/*
+ * Run the starburst on all frames, return the time per frame in ms.
+ * dSearchMillis is the mean duration of the threshold searches.
+ */
+static double runStarburst(const std::vector<cv::Mat> &frames,
+                           const cv::Rect &rectWork,
+                           bool bReset,
+                           bool bExhaustive,
+                           int &nFound,
+                           double &dChecksum,
+                           double &dSearchMillis) {
+
+    Starburst starburst;
+    starburst.setExhaustiveSearch(bExhaustive);
+
+    nFound    = 0;
+    dChecksum = 0.0;
+
+    int nSearches = 0;
+    dSearchMillis = 0.0;
+
+    struct timeval t1, t2;
+    gettimeofday(&t1, NULL);
+
+    for(size_t i = 0; i < frames.size(); ++i) {
+
+        if(bReset) {
+            starburst.reset();
+        }
+
+        const bool bFound = starburst.process(frames[i], rectWork);
+
+        if(starburst.getSearchMillis() >= 0.0) {
+            dSearchMillis += starburst.getSearchMillis();
+            ++nSearches;
+        }
+
+        if(bFound) {
+
+            const cv::Point2f c = starburst.getROICenter();
+
+            ++nFound;
+            dChecksum += c.x + c.y + starburst.getThreshold() + starburst.getPupilVariance();
+
+        }
+
+    }
+
+    gettimeofday(&t2, NULL);
+
+    if(nSearches > 0) {
+        dSearchMillis /= nSearches;
+    }
+
+    return getMillis(t1, t2) / frames.size();
+
+}
+
+
+int main(int argc, char **argv) {
+
+    const char *strVideo    = argc > 1 ? argv[1] : NULL;
+    const char *strSettings = argc > 2 ? argv[2] : NULL;
+    int nFrames             = argc > 3 ? atoi(argv[3]) : NOF_FRAMES_DEFAULT;
+
+    nFrames = std::max(nFrames, 1);
+
+    if(strSettings != NULL) {
+        SettingsIO settingsFile(strSettings);
+        LocalTrackerSettings localSettings;
+        localSettings.open(settingsFile);
+        trackerSettings.set(localSettings);
+    }
+
+    std::vector<cv::Mat> frames;
+    cv::Rect rectWork;
+    if(!readFrames(strVideo, nFrames, frames, rectWork)) {
+        printf("No frames\n");
+        return -1;
+    }
+
+    printf("%d frames %dx%d, work area %dx%d\n",
+           (int)frames.size(),
+           frames[0].cols,
+           frames[0].rows,
+           rectWork.width,
+           rectWork.height);
+
+    const char *strModes[] = {"tracking", "reset", "exhaustive"};
+
+    for(int nMode = 0; nMode < 3; ++nMode) {
+
+        const bool bReset      = nMode >= 1;
+        const bool bExhaustive = nMode == 2;
+
+        int nFound;
+        double dChecksum, dSearchMillis;
+        const double dMillis = runStarburst(frames, rectWork, bReset, bExhaustive, nFound, dChecksum, dSearchMillis);
+
+        printf("%-10s %8.3f ms/frame   search %8.3f ms   found %d/%d   checksum %.6f\n",
+               strModes[nMode],
+               dMillis,
+               dSearchMillis,
+               nFound,
+               (int)frames.size(),
+               dChecksum);
+
+    }
+
+    return 0;
+
+}
@@ -0,0 +1,170 @@
+#ifndef SYNTHETICEYE_H
+#define SYNTHETICEYE_H
+
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <math.h>
+#include <vector>
+
+
+
+/*
+ * Draws the synthetic eye frames of the tests: bright skin, an iris, a
+ * dark pupil, glints, and dark eye lashes and blobs. The eye moves
+ * around the centre of the frame, by default it does not move. The
+ * tests set the members they need before drawing:
+ *
+ *     SyntheticEye eye(FRAME_W, FRAME_H);
+ *     eye.ampX = 40;
+ *     eye.addGlint(cv::Point(-20, 40), 3);
+ *     ...
+ *     eye.draw(img, nFrame);
+ *
+ * For frames with a known eye model and ground truth, see EyeSimulator.
+ */
+class SyntheticEye {
+
+public:
+
+    SyntheticEye(int _w, int _h) {
+
+        w           = _w;
+        h           = _h;
+
+        bgLow       = 180;
+        bgHigh      = 180;
+
+        offset      = cv::Point(0, 0);
+        ampX        = 0.0;
+        ampY        = 0.0;
+        freqY       = 1.0;
+        speed       = 0.1;
+
+        irisRadius  = 90;
+        irisLevel   = 110;
+
+        pupilAxes   = cv::Size(34, 30);
+        pupilAngle  = 15.0;
+        pupilLevel  = 25;
+
+        nofLashes   = 0;
+
+    }
+
+    /* A glint at the offset from the pupil centre */
+    void addGlint(const cv::Point &_offset, int _radius) {
+        Glint g;
+        g.offset = _offset;
+        g.radius = _radius;
+        glints.push_back(g);
+    }
+
+    /* The six glints in the pattern expected by GazeTracker::SixLEDs */
+    void addSixLEDGlints(int radius) {
+        addGlint(cv::Point(  0, -22), radius);
+        addGlint(cv::Point(-20, -10), radius);
+        addGlint(cv::Point(-20,  10), radius);
+        addGlint(cv::Point(  0,  22), radius);
+        addGlint(cv::Point( 20,  10), radius);
+        addGlint(cv::Point( 20, -10), radius);
+    }
+
+    /* A dark ellipse at a fixed place of the frame, without anti-aliasing */
+    void addBlob(const cv::Point &_centre, const cv::Size &_axes, double _angle, int _level) {
+        Blob b;
+        b.centre = _centre;
+        b.axes   = _axes;
+        b.angle  = _angle;
+        b.level  = _level;
+        blobs.push_back(b);
+    }
+
+    /* The pupil centre in the frame nFrame */
+    cv::Point getCentre(int nFrame) const {
+        const double t = nFrame * speed;
+        return cv::Point((int)(w / 2 + offset.x + ampX * cos(t)),
+                         (int)(h / 2 + offset.y + ampY * sin(freqY * t)));
+    }
+
+    /* An 8-bit gray frame, allocated only if img is not w x h already */
+    void draw(cv::Mat &img, int nFrame) const {
+
+        img.create(h, w, CV_8UC1);
+
+        if(bgHigh > bgLow) {
+            cv::randu(img, cv::Scalar(bgLow), cv::Scalar(bgHigh));
+        }
+        else {
+            img = cv::Scalar(bgLow);
+        }
+
+        const cv::Point centre = getCentre(nFrame);
+
+        cv::circle(img, centre, irisRadius, cv::Scalar(irisLevel), CV_FILLED, CV_AA);
+        cv::ellipse(img, centre, pupilAxes, pupilAngle, 0.0, 360.0, cv::Scalar(pupilLevel), CV_FILLED, CV_AA);
+
+        for(size_t i = 0; i < glints.size(); ++i) {
+            cv::circle(img, centre + glints[i].offset, glints[i].radius, cv::Scalar(250), CV_FILLED, CV_AA);
+        }
+
+        // eye lashes and such along the top of the frame, they move too
+        const double t = nFrame * speed;
+        for(int i = 0; i < nofLashes; ++i) {
+            const cv::Point p(40 + 50 * i, 40 + (int)(20 * sin(i + t)));
+            cv::circle(img, p, 4 + i % 5, cv::Scalar(10), CV_FILLED, CV_AA);
+        }
+
+        for(size_t i = 0; i < blobs.size(); ++i) {
+            cv::ellipse(img, blobs[i].centre, blobs[i].axes, blobs[i].angle, 0.0, 360.0, cv::Scalar(blobs[i].level), CV_FILLED);
+        }
+
+    }
+
+
+    int w, h;
+
+    /* The skin is uniform noise in [bgLow, bgHigh), or bgLow if bgHigh is not larger */
+    int bgLow, bgHigh;
+
+    /*
+     * The pupil centre is at (w / 2 + offset.x + ampX * cos(t),
+     * h / 2 + offset.y + ampY * sin(freqY * t)), t = speed * nFrame
+     */
+    cv::Point offset;
+    double ampX, ampY;
+    double freqY;
+    double speed;
+
+    int irisRadius;
+    int irisLevel;
+
+    cv::Size pupilAxes;
+    double pupilAngle;
+    int pupilLevel;
+
+    /* The number of dark spots along the top of the frame */
+    int nofLashes;
+
+private:
+
+    struct Glint {
+        cv::Point offset;
+        int radius;
+    };
+
+    struct Blob {
+        cv::Point centre;
+        cv::Size axes;
+        double angle;
+        int level;
+    };
+
+    std::vector<Glint> glints;
+    std::vector<Blob> blobs;
+
+};
+
+
+
+#endif
@@ -7,6 +7,7 @@ Camera::Camera() {
 
 	this->intrinsic_matrix = cv::Mat::zeros(3, 3, CV_64FC1);
 	this->distortion = cv::Mat::zeros(1, 5, CV_64FC1);
+	this->bMirrored = false;
 }
 
 
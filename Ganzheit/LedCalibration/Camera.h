@@ -37,6 +37,7 @@ public:
 
         intrinsic_matrix = other.intrinsic_matrix.clone();
         distortion       = other.distortion.clone();
+        bMirrored        = other.bMirrored;
 
     }
 
@@ -49,6 +50,7 @@ public:
 
             intrinsic_matrix = other.intrinsic_matrix.clone();
             distortion       = other.distortion.clone();
+            bMirrored        = other.bMirrored;
 
         }
 
@@ -75,10 +77,27 @@ public:
     void pixToWorld(double u, double v, cv::Point3d &p3D) const;
     void worldToPix(const cv::Point3d &p3D, double *u, double *v) const;
 
+    /*
+     * The pixel coordinates of a mirrored camera are those of its images
+     * mirrored around the y-axis. The calibration, the tracking and the
+     * results are in these coordinates, while the images are used as
+     * captured. Not mirrored by default.
+     */
+    void setMirrored(bool b) {bMirrored = b;}
+    bool isMirrored() const {return bMirrored;}
+
+    /*
+     * The x coordinate in the images of width w of a pixel of the camera,
+     * or the other way round.
+     */
+    double mirrorX(double x, int w) const {return bMirrored ? w - 1 - x : x;}
+
 private:
 
     cv::Mat intrinsic_matrix;
     cv::Mat distortion;
+
+    bool bMirrored;
 };
 
 
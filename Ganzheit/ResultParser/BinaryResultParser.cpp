@@ -1,4 +1,5 @@
 #include "BinaryResultParser.h"
+#include <algorithm>
 
 
 // 2^32 - 1
@@ -90,6 +91,22 @@ static void FLOAT_TO_4_BYTE_LE(float val, char *buff, bool bIsLittleEndian) {
 }
 
 
+bool BinaryResultParser::parseHeader(const char *buff, const int len, uint32_t &sz, unsigned long &id) {
+
+	if(len < MIN_BYTES) {
+		return false;
+	}
+
+	sz = LE_4_BYTES_TO_UINT32(buff);
+
+	// the success byte is between the size and the id
+	id = LE_4_BYTES_TO_UINT32(buff + 5);
+
+	return sz >= (uint32_t)MIN_BYTES;
+
+}
+
+
 bool BinaryResultParser::parsePacket(const char *buff, const int len, ResultData &data) {
 
 	data.clear();
@@ -264,6 +281,28 @@ bool BinaryResultParser::parsePacket(const char *buff, const int len, ResultData
 	ptrBuff += 2;
 
 
+	/*********************************************************************
+	 * Stage durations, optional, 1 + nStages * 4 bytes
+	 *********************************************************************/
+	if(ptrBuff < buff + len) {
+
+		const int nStages = (unsigned char)*ptrBuff;
+		ptrBuff += 1;
+
+		if(ptrBuff + 4 * nStages > buff + len) {
+			return false;
+		}
+
+		data.stageDurMicros.resize(nStages);
+
+		for(int i = 0; i < nStages; ++i) {
+			data.stageDurMicros[i] = LE_4_BYTES_TO_FLOAT(ptrBuff);
+			ptrBuff += 4;
+		}
+
+	}
+
+
 	return true;
 
 }
@@ -284,7 +323,12 @@ void BinaryResultParser::resDataToBuffer(const ResultData &data, std::vector<cha
 	}
 
 	const int nGlintBytes = 2*4*data.listGlints.size();
-	const int resDataSz = MIN_BYTES + nGlintBytes + nContoursBytes;
+
+	// at most 255 stages
+	const int nStages = (int)std::min(data.stageDurMicros.size(), (size_t)255);
+	const int nStageBytes = nStages > 0 ? 1 + 4*nStages : 0;
+
+	const int resDataSz = MIN_BYTES + nGlintBytes + nContoursBytes + nStageBytes;
 
 
 	buff.resize(resDataSz);
@@ -418,5 +462,19 @@ void BinaryResultParser::resDataToBuffer(const ResultData &data, std::vector<cha
 	UINT16_TO_2_BYTE_LE(data.gazeVecEndPoint2D.y, ptrBuff);
 	ptrBuff += 2;
 
+
+	// stage durations
+	if(nStages > 0) {
+
+		*ptrBuff = (char)nStages;
+		ptrBuff += 1;
+
+		for(int i = 0; i < nStages; ++i) {
+			FLOAT_TO_4_BYTE_LE(data.stageDurMicros[i], ptrBuff, bIsLittleEndian);
+			ptrBuff += 4;
+		}
+
+	}
+
 }
 
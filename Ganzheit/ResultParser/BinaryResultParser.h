@@ -3,6 +3,7 @@
 
 
 #include "ResultParser.h"
+#include <stdint.h>
 
 
 /*
@@ -60,11 +61,22 @@
  *   | gaze vector end     | end image point       | 2*2 bytes            |
  *   |                     |                       |                      |
  *   ----------------------------------------------------------------------
+ *   | N stages            | number of stage       | 1 byte, optional     |
+ *   |                     | durations             |                      |
+ *   ----------------------------------------------------------------------
+ *   | Stage durations     | durations of the      | n * 4 bytes          |
+ *   |                     | tracking stages in    | n = number of stages |
+ *   |                     | microseconds          |                      |
+ *   ----------------------------------------------------------------------
  *
  * The total number of bytes is therefore:
  *     4 + 1 + 4 + 4 + 4 + 20 + 12 + 12 + 8 + 2 + 8*nGlints + 2 + 4*nContours + 8*totalContourPoints + 4 + 4
  *     = 81 + 8*nGlints + 4*nContours + 4*totalContourPoints
  *
+ * and 1 + 4*nStages more with the stage durations. These are written
+ * only if there are any, and the packets without them are read as
+ * before. The older parsers ignore them.
+ *
  */
 
 class BinaryResultParser {
@@ -75,6 +87,12 @@ class BinaryResultParser {
 
 		static void resDataToBuffer(const ResultData &data, std::vector<char> &buff);
 
+		/*
+		 * Read only the size and the id of a packet. Returns false if
+		 * the packet is too short to be one.
+		 */
+		static bool parseHeader(const char *buff, const int len, uint32_t &sz, unsigned long &id);
+
 		enum LIMITS {
 
 			MIN_BYTES = 81
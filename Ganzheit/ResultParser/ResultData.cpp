@@ -21,6 +21,7 @@ void ResultData::clear() {
 	listContours.clear();
 	gazeVecStartPoint2D = cv::Point();
 	gazeVecEndPoint2D = cv::Point();
+	stageDurMicros.clear();
 
 }
 
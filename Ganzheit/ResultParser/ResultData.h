@@ -27,6 +27,7 @@ class ResultData {
 		std::vector<std::vector<cv::Point> > listContours;	// contours
 		cv::Point gazeVecStartPoint2D;						// the gaze vector start point in the image, 2D
 		cv::Point gazeVecEndPoint2D;						// the gaze vector end point in the image, 2D
+		std::vector<float> stageDurMicros;					// durations of the tracking stages in microseconds, -1 if not run, see gt::StageTimes
 
 		void clear();
 
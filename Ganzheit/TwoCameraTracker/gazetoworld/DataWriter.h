@@ -2,6 +2,7 @@
 #define DATA_WRITER_H
 
 #include "Thread.h"
+#include "QueuePolicy.h"
 
 
 class DataWriter : public Thread {
@@ -13,10 +14,32 @@ public:
     virtual ~DataWriter() {}
 
     virtual bool init(const std::string &) = 0;
-    virtual bool addFrames(const CameraFrame *_f1, const CameraFrame *_f2) = 0;
+
+    /* id identifies the pair, its results have the same id */
+    virtual bool addFrames(const CameraFrame *_f1, const CameraFrame *_f2, unsigned long id) = 0;
+
     virtual bool addResults(const std::vector<char> &) = 0;
     virtual int getBufferState() = 0;
 
+
+    /*
+     * What addFrames() does when the queue is full, see QueuePolicy.
+     * Must be called before init(). The results are never dropped by
+     * the policy.
+     */
+    void setPolicy(QueuePolicy::Type type, int blockMs = QueuePolicy::DEFAULT_BLOCK_MS) {
+        policy.set(type, blockMs);
+    }
+
+    /* The number of frame pairs added and dropped */
+    void getQueueStats(QueuePolicy::Stats &stats) {
+        policy.getStats(stats);
+    }
+
+protected:
+
+    QueuePolicy policy;
+
 };
 
 
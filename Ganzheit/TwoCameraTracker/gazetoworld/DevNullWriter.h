@@ -15,7 +15,7 @@ public:
 
     bool init(const std::string &) {return true;}
 
-    bool addFrames(const CameraFrame *_f1, const CameraFrame *_f2) {return true;}
+    bool addFrames(const CameraFrame *_f1, const CameraFrame *_f2, unsigned long id) {return true;}
 
     bool addResults(const std::vector<char> &) {return true;}
 
@@ -64,6 +64,21 @@ DualFrameReceiver::DualFrameReceiver(bool _bGUIActive) {
 
 	bGUIActive = _bGUIActive;
 
+	for(int i = 0; i < NOF_QUEUES; ++i) {
+		policyTypes[i]		= QueuePolicy::POLICY_DROP_NEWEST;
+		policyBlockMs[i]	= QueuePolicy::DEFAULT_BLOCK_MS;
+	}
+
+	syncPolicy = SegmentWriter::SYNC_NONE;
+
+}
+
+
+void DualFrameReceiver::setQueuePolicy(Queue queue, QueuePolicy::Type type, int blockMs) {
+
+	policyTypes[queue]		= type;
+	policyBlockMs[queue]	= blockMs;
+
 }
 
 
@@ -209,13 +224,17 @@ bool DualFrameReceiver::init(bool bOnlyResults,
         video_writer = new ResultWriter();
     }
     else {
-        video_writer = new VideoWriter();
+        VideoWriter *writer = new VideoWriter();
+        writer->setSyncPolicy(syncPolicy);
+        video_writer = writer;
     }
 
 
 	/*************************************************************
 	 * Create the output streams
 	 *************************************************************/
+	video_writer->setPolicy(policyTypes[QUEUE_WRITER], policyBlockMs[QUEUE_WRITER]);
+
 	if(!video_writer->init(saveDir)) {
 		return false;
 	}
@@ -248,7 +267,12 @@ bool DualFrameReceiver::init(bool bOnlyResults,
 		else {
 			GTWorker *w = new GTWorker();
 			w->setTracker(tracker, mapper);
+			w->setColourFrames(isGUIActive());
 			workers[i] = w;
+
+			if(!traceFile.empty() && !w->setTraceFile(traceFile)) {
+				return false;
+			}
 		}
 
 		// get a pointer to the current worker
@@ -260,6 +284,10 @@ bool DualFrameReceiver::init(bool bOnlyResults,
 
 		list_worker_user_data[i] = user_data;
 
+		// the eye frames go to the tracker
+		const Queue queue = i == 0 ? QUEUE_TRACKER : QUEUE_SCENE;
+		cur->setPolicy(policyTypes[queue], policyBlockMs[queue]);
+
 		// try initialising the worker
 		if(!cur->init(this, MAX_BUFFER_SIZE, user_data)) {
 			return false;
@@ -322,11 +350,11 @@ void DualFrameReceiver::destroyWorkers() {
 /*
  * This function should execute as fast as possible.
  * All heavy operations must take place in separate
- * threads. A JPEGWorker and a GTWorker are being used here.
+ * threads. A GTWorker and a SceneFrameWorker are being used here.
  */
 void DualFrameReceiver::framesReceived(const CameraFrame *_frameEye, const CameraFrame *_frameScene) {
 
-	// copy the eye frame
+	// share the eye frame
 	CameraFrameExtended *frameEye = new CameraFrameExtended(*_frameEye);
 
 
@@ -338,67 +366,32 @@ void DualFrameReceiver::framesReceived(const CameraFrame *_frameEye, const Camer
     frameEye->id = n_received_pairs - 1UL;
 
 
-    // first copy the videos to the saver
-    video_writer->addFrames(_frameEye, _frameScene);
+    // first give the videos to the saver, it shares the data
+    video_writer->addFrames(_frameEye, _frameScene, frameEye->id);
 
 
     /*
      * Depending upon the user's request, either both frames will be
      * placed to their designated worker queues for further processing
      * or just the eye frame will be placed to it's corresponding
-     * worker's queue.
+     * worker's queue. Each queue applies its own policy when it is
+     * full, and frameProcessed() pairs the frames by their ids.
      */
     if(isGUIActive()) {
 
-        /*
-         * See if there is space in both workers' queues. If either
-         * one is full, we will not add either frame to anywhere
-         */
-        const bool b_is_space = workers[0]->isSpace() && workers[1]->isSpace();
-
-
-        /*
-         * Only add the frames to the workers if both workers' queues allow
-         * for that.
-         */
-        if(b_is_space) {
-
-            // copy the eye frame
-            CameraFrameExtended *frameScene = new CameraFrameExtended(*_frameScene);
-            frameScene->id = n_received_pairs - 1UL;
-
-            // add to workers
-            workers[0]->add(frameEye);
-            workers[1]->add(frameScene);
+        // share the scene frame
+        CameraFrameExtended *frameScene = new CameraFrameExtended(*_frameScene);
+        frameScene->id = n_received_pairs - 1UL;
 
-        }
-        else {
-
-            printf("DualFrameReceiver::framesReceived(): At least one of the worker's queue is full, skipping\n");
-            delete frameEye;
-
-        }
+        // add to workers, they delete the frames they drop
+        workers[0]->add(frameEye);
+        workers[1]->add(frameScene);
 
     }
 
     else { // GUI not active
 
-        // see if the gaze tracker's worker queue has space
-        const bool bIsSpace = workers[0]->isSpace();
-
-        if(bIsSpace) {
-
-            // add to worker
-            workers[0]->add(frameEye);
-
-        }
-        else { // no space
-
-            printf("DualFrameReceiver::framesReceived(): No space int the GTWorker's queue, skipping\n");
-
-            delete frameEye;
-
-        }
+        workers[0]->add(frameEye);
 
     }
 
@@ -424,6 +417,19 @@ bool DualFrameReceiver::frameProcessed(CameraFrame *_frame, void *user_data) {
 	}
 
 
+	/*
+	 * The eye frames decoded before the GUI became active have no
+	 * image to show
+	 */
+	if(_frame->data == NULL) {
+
+		delete _frame;
+
+		return true;
+
+	}
+
+
 	pthread_mutex_lock(&mutex_oput);
 
 		const int id = *((int *)user_data);
@@ -433,7 +439,11 @@ bool DualFrameReceiver::frameProcessed(CameraFrame *_frame, void *user_data) {
 		CameraFrameExtended *frame_extended = (CameraFrameExtended *)_frame;
 
 
-		/* See if there is a pair waiting for this frame */
+		/*
+		 * See if there is a pair waiting for this frame. The queues
+		 * drop frames independently, so the pairs are found by the
+		 * frame ids.
+		 */
 		std::list<OutputData *>::iterator it = list_oput.begin();
 		while(it != list_oput.end()) {
 
@@ -441,7 +451,7 @@ bool DualFrameReceiver::frameProcessed(CameraFrame *_frame, void *user_data) {
 			CameraFrameExtended **cur_frames = cur_oput->frames;
 
             // NULL means open slot
-			if(cur_frames[id] == NULL) {
+			if(cur_frames[id] == NULL && cur_frames[1 - id]->id == frame_extended->id) {
 
 				cur_frames[id] = frame_extended;
 
@@ -456,6 +466,38 @@ bool DualFrameReceiver::frameProcessed(CameraFrame *_frame, void *user_data) {
 		}
 
 
+		/*
+		 * The frames of both workers arrive in the order of the ids, so
+		 * the incomplete pairs older than this one lost a frame to a
+		 * full queue, and will never be complete.
+		 */
+		if(oput != NULL) {
+
+			it = list_oput.begin();
+			while(it != list_oput.end()) {
+
+				CameraFrameExtended **cur_frames = (*it)->frames;
+
+				const bool bOrphan = (cur_frames[0] == NULL || cur_frames[1] == NULL) &&
+									 (cur_frames[0] != NULL ? cur_frames[0] : cur_frames[1])->id < frame_extended->id;
+
+				if(bOrphan) {
+
+					(*it)->releaseFrames();
+					delete *it;
+
+					it = list_oput.erase(it);
+
+				}
+				else {
+					++it;
+				}
+
+			}
+
+		}
+
+
 		/* oput == NULL, when the frame has no pair waiting for it */
 		if(oput == NULL) {
 
@@ -623,6 +665,23 @@ OutputData *DualFrameReceiver::getNewestData() {
 }
 
 
+void DualFrameReceiver::setTrackerSettings(const TrackerSettings &settings) {
+
+	if(tracker == NULL) {
+		return;
+	}
+
+	// the tracker is being used by the pipeline of the GTWorker
+	if(b_workers_running) {
+		((GTWorker *)workers[0])->setTrackerSettings(settings);
+	}
+	else {
+		tracker->setSettings(settings);
+	}
+
+}
+
+
 void DualFrameReceiver::collectForGUI(bool bCollect) {
 
 	pthread_mutex_lock(&mutex_oput);
@@ -637,6 +696,11 @@ void DualFrameReceiver::collectForGUI(bool bCollect) {
 
 	pthread_mutex_unlock(&mutex_oput);
 
+	// the eye frames are decoded in colour only for the GUI
+	if(b_workers_running) {
+		((GTWorker *)workers[0])->setColourFrames(bCollect);
+	}
+
 }
 
 
@@ -703,6 +767,28 @@ int DualFrameReceiver::getSaveBufferState() {
 }
 
 
+void DualFrameReceiver::getTrackerLatency(DelayStats &stats) {
+
+	// the eye frames are tracked by the first worker
+	((GTWorker *)workers[0])->getLatency(stats);
+
+}
+
+
+void DualFrameReceiver::getQueueStats(Queue queue, QueuePolicy::Stats &stats) {
+
+	switch(queue) {
+
+		case QUEUE_TRACKER:	workers[0]->getQueueStats(stats); break;
+		case QUEUE_SCENE:	workers[1]->getQueueStats(stats); break;
+		case QUEUE_WRITER:	video_writer->getQueueStats(stats); break;
+		default:			break;
+
+	}
+
+}
+
+
 bool DualFrameReceiver::alive() {
 
 	pthread_mutex_lock(&mutex_alive);
@@ -759,6 +845,12 @@ bool DualFrameReceiver::configureEyeCamData(const std::string &eyeCamCalibFile)
 		camEye->setIntrinsicMatrix(camContainer.intr);
 		camEye->setDistortion(camContainer.dist);
 
+		/*
+		 * The calibration and the results are for the eye frames
+		 * mirrored around the y-axis, the tracker mirrors the frames
+		 */
+		camEye->setMirrored(true);
+
 	}
 
 
@@ -37,6 +37,7 @@ public:
 
     }
 
+    /* Share the data of the frame */
     CameraFrameExtended(const CameraFrameExtended &orig) : CameraFrame(orig) {
         id = orig.id;
         res = orig.res;
@@ -114,9 +115,39 @@ class DualFrameReceiver : public WorkerCBHandler {
 
 public:
 
+    /* The queues of the receiver, see setQueuePolicy() */
+    enum Queue {
+        QUEUE_TRACKER,
+        QUEUE_SCENE,
+        QUEUE_WRITER,
+        NOF_QUEUES
+    };
+
+
     DualFrameReceiver(bool _bGUIActive);
     ~DualFrameReceiver();
 
+
+    /*
+     * What framesReceived() does when the given queue is full, see
+     * QueuePolicy. Must be called before init(). By default the newest
+     * frames are dropped.
+     */
+    void setQueuePolicy(Queue queue, QueuePolicy::Type type, int blockMs = QueuePolicy::DEFAULT_BLOCK_MS);
+
+    /*
+     * When the recorded videos are synced to the disk, see
+     * SegmentWriter. Must be called before init().
+     */
+    void setSyncPolicy(SegmentWriter::SyncPolicy sync) {syncPolicy = sync;}
+
+    /*
+     * Write the times of the tracking stages to the file, see
+     * gt::StageTrace. Must be called before init(). Not written by
+     * default.
+     */
+    void setTraceFile(const std::string &fname) {traceFile = fname;}
+
     /*
      * Initialise everything. Must be called only once.
      * saveDir must contain the trailing '/'.
@@ -129,7 +160,8 @@ public:
 
 
     /*
-     * Protected by a mutex. Execution must be fast.
+     * Protected by a mutex. Execution must be fast, but blocks
+     * for the block time of a full queue with POLICY_BLOCK.
      * The highest priority is to place the frames to
      * the saver queue.
      */
@@ -173,6 +205,12 @@ public:
     /* Return the number of frames in the saver's queue */
     int getSaveBufferState();
 
+    /* Return the delays from the capture of the eye frames to the tracker */
+    void getTrackerLatency(DelayStats &stats);
+
+    /* Return the number of frames added to and dropped from the given queue */
+    void getQueueStats(Queue queue, QueuePolicy::Stats &stats);
+
     /* Return the eye camera */
     const Camera *getEyeCamera() const {return camEye;}
 
@@ -186,9 +224,19 @@ public:
     const gt::GazeTracker *getTracker() const {return tracker;}
 
 
-    /* Whether or not to collect frames for the GUI. */
+    /*
+     * Whether or not to collect frames for the GUI. Otherwise the
+     * tracker decodes only the crop area of the eye frames.
+     */
     void collectForGUI(bool bCollect);
 
+    /*
+     * Give new settings to the tracker. The tracker has its own copy
+     * of the settings, so changing the global trackerSettings does not
+     * affect it. The settings are taken into use between two frames.
+     */
+    void setTrackerSettings(const TrackerSettings &settings);
+
 private:
 
     /* Create the gaze tracker */
@@ -229,6 +277,15 @@ private:
     /* Output video writer */
     DataWriter *video_writer;
 
+    /* The policies of the queues, given to them in init() */
+    QueuePolicy::Type policyTypes[NOF_QUEUES];
+    int policyBlockMs[NOF_QUEUES];
+
+    SegmentWriter::SyncPolicy syncPolicy;
+
+    /* Empty if no trace is written */
+    std::string traceFile;
+
     pthread_mutex_t mutex_receive;
 
     /* A mutex protecting the output frames */
@@ -270,10 +327,11 @@ private:
 
     /*
      * This variable indicates whether to process both frames for drawing
-     * to the GUI, or just to analyse the eye frame. If enabled, the scene
-     * camera frame will also be decompressed, which is computationally
-     * expensive. Therefore this feature should only be enabled when the
-     * images are really being observed.
+     * to the GUI, or just to analyse the eye frame. If enabled, the eye
+     * frames are decompressed in colour and the scene frames are paired
+     * with them, undecoded. The GUI decodes the scene frames it shows.
+     * Therefore this feature should only be enabled when the images are
+     * really being observed.
      */
     bool bGUIActive;
 
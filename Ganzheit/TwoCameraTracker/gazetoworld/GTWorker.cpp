@@ -1,12 +1,33 @@
 #include "GTWorker.h"
 #include "DualFrameReceiver.h"
 #include "ResultData.h"
+#include "FrameFormat.h"
+#include <string.h>
 
 
-extern pthread_mutex_t mutex_tracker;
+/* The number of frames in the tracker pipeline at a time */
+static const int NOF_PIPELINE_FRAMES = 4;
 
 
-GTWorker::GTWorker() : JPEGWorker() {}
+GTWorker::GTWorker() : JPEGWorker() {
+
+	tracker		= NULL;
+	mapper		= NULL;
+	cb_handler	= NULL;
+	user_data	= NULL;
+
+	bColourFrames = 0;
+
+	pthread_mutex_init(&mutex_latency, NULL);
+
+}
+
+
+GTWorker::~GTWorker() {
+
+	pthread_mutex_destroy(&mutex_latency);
+
+}
 
 
 
@@ -15,34 +36,171 @@ void GTWorker::setTracker(gt::GazeTracker *_tracker, SceneMapper *_mapper) {
 	tracker = _tracker;
 	mapper = _mapper;
 
+	// only the crop area of the frames is decoded, see decodeGray()
+	tracker->getPupilTracker()->setCropOnly(true);
+
+}
+
+
+bool GTWorker::init(WorkerCBHandler *_cb_handler, int _max_n_frames, void *_user_data) {
+
+	// the frames are handed over to the handler by frameTracked()
+	cb_handler = _cb_handler;
+	user_data = _user_data;
+
+	return StreamWorker::init(_cb_handler, _max_n_frames, _user_data);
+
+}
+
+
+bool GTWorker::start() {
+
+	if(!pipeline.start(tracker, this, NOF_PIPELINE_FRAMES)) {
+		return false;
+	}
+
+	if(!StreamWorker::start()) {
+		pipeline.end();
+		return false;
+	}
+
+	return true;
+
+}
+
+
+void GTWorker::end() {
+
+	// no more frames to the pipeline...
+	StreamWorker::end();
+
+	// ...and track the ones in it
+	pipeline.end();
+
+	trace.close();
+
+}
+
+
+void GTWorker::setTrackerSettings(const TrackerSettings &settings) {
+
+	pipeline.setSettings(settings);
+
+}
+
+
+bool GTWorker::setTraceFile(const std::string &fname) {
+
+	return trace.open(fname);
+
+}
+
+
+void GTWorker::setColourFrames(bool b) {
+
+	__atomic_store_n(&bColourFrames, b ? 1 : 0, __ATOMIC_RELAXED);
+
 }
 
 
 CameraFrame *GTWorker::process(CameraFrame *img_compr) {
 
+	/*
+	 * The crop area comes from the settings of the tracker, so the
+	 * pending settings are taken into use before decoding
+	 */
+	pipeline.applySettings();
+
+
 	/* dcompress the frame */
 	CameraFrame *frame;
+	cv::Mat imgGray;
+
+	if(__atomic_load_n(&bColourFrames, __ATOMIC_RELAXED)) {
+
+		frame = decodeColour(img_compr, imgGray);
+
+	}
+	else {
+
+		decodeGray(img_compr, imgGray);
+
+		// the frame has no image data
+		frame = new CameraFrame(img_compr->w, img_compr->h);
+
+	}
+
+
+	unsigned long id = ((CameraFrameExtended *)(img_compr))->id;
+
+	// shares the data, the results are added in frameTracked()
+	CameraFrameExtended *frame_extended = new CameraFrameExtended(*frame);
+	frame_extended->id = id;
+
+	delete frame;
+
+
+	// the frame enters the tracker
+	if(img_compr->timestamp != 0) {
+
+		MutexLocker locker(&mutex_latency);
+		latency.add(CameraFrame::getTime() - img_compr->timestamp);
+
+	}
+
+
+	/*
+	 * Track the grayscale image. The pipeline copies the image, so it
+	 * can be reused for the next frame.
+	 */
+	if(!pipeline.add(imgGray, frame_extended)) {
+		delete frame_extended;
+	}
+
+	// the frame is given to the handler by frameTracked()
+	return NULL;
+
+}
+
+
+CameraFrame *GTWorker::decodeColour(CameraFrame *img_compr, cv::Mat &imgGray) {
+
+	CameraFrame *frame;
 
     if(img_compr->format == FORMAT_MJPG) {
 
         frame = JPEGWorker::process(img_compr);
 
     }
-    else {
+    else if(img_compr->format == FORMAT_YUV || img_compr->format == FORMAT_I420) {
 
-        frame = new CameraFrame(img_compr->w,
-                                img_compr->h,
-                                img_compr->bpp,
-                                img_compr->data,
-                                img_compr->sz,
-                                img_compr->format,
-                                true,	 // copy data
-                                false);	 // do not become parent, i.e. do not destroy data in destructor
+        const int w = img_compr->w;
+        const int h = img_compr->h;
+
+        SharedBuffer *buffer = BufferPool::getDefault().acquire(3 * w * h);
+
+        if(!FrameFormat::toBGR(*img_compr, buffer->data)) {
+            memset(buffer->data, 255, 3 * w * h);
+        }
+
+        frame = new CameraFrame(w, h, 3, buffer, FORMAT_BGR);
+
+        // the frame holds a reference now
+        buffer->unref();
+
+        // the tracker takes the luma as it is
+        decodeGray(img_compr, imgGray);
+
+        return frame;
 
     }
+    else {
 
+        // share the data, the frame is only read
+        frame = new CameraFrame(*img_compr);
+
+    }
 
-	/* Analyse the frame */
 
 	// make a cv::Mat header of the CameraFrame
 	cv::Mat ocvFrame24(
@@ -53,107 +211,186 @@ CameraFrame *GTWorker::process(CameraFrame *img_compr) {
 		frame->w * frame->bpp	// bytes per row
 	);
 
-	// convert the 24-bit image to gray
+	// convert the 24-bit image to gray, the tracker mirrors it
 	int conversionType = frame->format == FORMAT_RGB ? CV_RGB2GRAY : CV_BGR2GRAY;
-	cv::Mat ocvFrameGray;
 	cv::cvtColor(ocvFrame24, ocvFrameGray, conversionType);
 
-    // flip around y-axis
-    cv::flip(ocvFrameGray, ocvFrameGray, 1);
+	imgGray = ocvFrameGray;
 
-	// track the grayscale image
-	pthread_mutex_lock(&mutex_tracker);
+	return frame;
 
-		/***************************************************************
-		 * Track gaze
-		 **************************************************************/
-		const bool trackSuccess = tracker->track(ocvFrameGray);
+}
 
 
-		/***************************************************************
-		 * Map the gaze vector to the scene
-		 **************************************************************/
-		const double *c_pupil	= tracker->getCentrePupil();
-		const double *c_cornea	= tracker->getCentreCornea();
-		Eigen::Vector3d eigCornea(c_cornea[0], c_cornea[1], c_cornea[2]);
-		Eigen::Vector3d eigPupil(c_pupil[0], c_pupil[1], c_pupil[2]);
+void GTWorker::decodeGray(CameraFrame *img_compr, cv::Mat &imgGray) {
 
-		// Map the gaze to the scene
-		cv::Point2d scenePoint;
-		mapper->getPosition(eigCornea, eigPupil, scenePoint);
+	const int w = img_compr->w;
+	const int h = img_compr->h;
 
+	// the luma plane of an I420 frame is tracked without a copy
+	int step;
+	const unsigned char *plane = FrameFormat::getLumaPlane(*img_compr, step);
 
-		/***************************************************************
-		 * Compute gaze vector in 2D
-		 ***************************************************************/
-		const Camera &cam = tracker->getCamera();
+	if(plane != NULL) {
+		imgGray = cv::Mat(h, w, CV_8UC1, (unsigned char *)plane, step);
+		return;
+	}
 
-		// convert to OpenCV container
-		cv::Point3d p_cornea(c_cornea[0], c_cornea[1], c_cornea[2]);
+	/*
+	 * Only the crop area of the gray frame is set, the tracker does
+	 * not look at the rest
+	 */
+	ocvFrameGray.create(h, w, CV_8UC1);
 
-		// get the corresponding pixel
-		double u1, v1;
-		cam.worldToPix(p_cornea, &u1, &v1);
+	cv::Rect rectCrop = getCropArea(w, h);
 
-		// convert to OpenCV container
-		cv::Point3d p_pupil(c_pupil[0], c_pupil[1], c_pupil[2]);
+	// the crop area is in the coordinates of the eye camera, see Camera::setMirrored()
+	if(tracker->getCamera().isMirrored()) {
+		rectCrop.x = w - rectCrop.x - rectCrop.width;
+	}
 
+	cv::Mat ocvCrop(ocvFrameGray, rectCrop);
 
-		cv::Point3d pupil_to_cornea(
-				p_pupil.x - p_cornea.x,
-				p_pupil.y - p_cornea.y,
-				p_pupil.z - p_cornea.z
-		);
+	bool success = FrameFormat::getLuma(*img_compr,
+										rectCrop.x,
+										rectCrop.y,
+										rectCrop.width,
+										rectCrop.height,
+										ocvCrop.data,
+										(int)ocvCrop.step,
+										jpgd);
 
-		pupil_to_cornea *= 3.0;
-		double u2, v2;
-		cam.worldToPix(pupil_to_cornea + p_cornea, &u2, &v2);
+	// if unsuccessfull, make the area white like JPEGWorker does
+	if(!success) {
+		printf("GTWorker::decodeGray(): Could not decode, setting the crop area to white\n");
+		ocvCrop.setTo(cv::Scalar(255));
+	}
 
+	imgGray = ocvFrameGray;
 
-		/***************************************************************
-		 * Create and store results
-		 **************************************************************/
-		unsigned long id = ((CameraFrameExtended *)(img_compr))->id;
+}
 
-		gt::PupilTracker *pupilTracker = tracker->getPupilTracker();
 
-		// create the results object
-		ResultData *tr = new ResultData();
+/*
+ * Like gt::PupilTracker::checkCropArea(), so that the tracker gets
+ * the area it uses. In the coordinates of the tracker, mirrored if
+ * the eye camera is.
+ */
+cv::Rect GTWorker::getCropArea(int w, int h) const {
 
-		// copy the results
-		tr->id					= id;
-		tr->timestamp			= time(NULL);
-		tr->listContours		= pupilTracker->getClusters();
-		tr->ellipsePupil		= *pupilTracker->getEllipsePupil();
-		tr->listGlints			= pupilTracker->getCornealReflections();
-		tr->trackDurMicros		= tracker->getTrackDurationMicros();
-		tr->scenePoint			= scenePoint;
-		tr->bTrackSuccessfull	= trackSuccess;
-		tr->pupilCentre			= cv::Point3d(c_pupil[0], c_pupil[1], c_pupil[2]);
-		tr->corneaCentre		= cv::Point3d(c_cornea[0], c_cornea[1], c_cornea[2]);
-		tr->gazeVecStartPoint2D	= cv::Point(u1, v1);
-		tr->gazeVecEndPoint2D	= cv::Point(u2, v2);
+	const TrackerSettings &settings = tracker->getSettings();
 
-	pthread_mutex_unlock(&mutex_tracker);
+	cv::Rect rectCrop(settings.CROP_AREA_X,
+					  settings.CROP_AREA_Y,
+					  settings.CROP_AREA_W,
+					  settings.CROP_AREA_H);
 
+	if(rectCrop.x < 0 || rectCrop.y < 0 || rectCrop.width <= 0 || rectCrop.height <= 0 ||
+	   rectCrop.x >= w || rectCrop.y >= h) {
+		return cv::Rect(0, 0, w, h);
+	}
 
-	CameraFrameExtended *frame_extended = new CameraFrameExtended(
-												id,
-												tr,
-												frame->w,
-												frame->h,
-												frame->bpp,
-												frame->data,
-												frame->sz,
-												frame->format,
-												false,			// do not copy
-												true);			// become parent
+	rectCrop.width	= std::min(rectCrop.width, w - rectCrop.x);
+	rectCrop.height	= std::min(rectCrop.height, h - rectCrop.y);
 
-	// keep data, delete all other things
-	frame->b_own_data = false;
-	delete frame;
+	return rectCrop;
+
+}
 
-	return frame_extended;
+
+void GTWorker::getLatency(DelayStats &stats) {
+
+	MutexLocker locker(&mutex_latency);
+
+	stats = latency;
 
 }
 
+
+void GTWorker::frameTracked(const gt::PipelineFrame &frame) {
+
+	CameraFrameExtended *frame_extended = (CameraFrameExtended *)frame.pUserData;
+
+	/***************************************************************
+	 * Map the gaze vector to the scene
+	 **************************************************************/
+	const double *c_pupil	= frame.centrePupil;
+	const double *c_cornea	= frame.centreCornea;
+	Eigen::Vector3d eigCornea(c_cornea[0], c_cornea[1], c_cornea[2]);
+	Eigen::Vector3d eigPupil(c_pupil[0], c_pupil[1], c_pupil[2]);
+
+	// Map the gaze to the scene
+	cv::Point2d scenePoint;
+	mapper->getPosition(eigCornea, eigPupil, scenePoint);
+
+
+	/***************************************************************
+	 * Compute gaze vector in 2D
+	 ***************************************************************/
+	const Camera &cam = tracker->getCamera();
+
+	// convert to OpenCV container
+	cv::Point3d p_cornea(c_cornea[0], c_cornea[1], c_cornea[2]);
+
+	// get the corresponding pixel
+	double u1, v1;
+	cam.worldToPix(p_cornea, &u1, &v1);
+
+	// convert to OpenCV container
+	cv::Point3d p_pupil(c_pupil[0], c_pupil[1], c_pupil[2]);
+
+
+	cv::Point3d pupil_to_cornea(
+			p_pupil.x - p_cornea.x,
+			p_pupil.y - p_cornea.y,
+			p_pupil.z - p_cornea.z
+	);
+
+	pupil_to_cornea *= 3.0;
+	double u2, v2;
+	cam.worldToPix(pupil_to_cornea + p_cornea, &u2, &v2);
+
+
+	/***************************************************************
+	 * Create and store results
+	 **************************************************************/
+	const gt::PupilFrame &pupilFrame = frame.pupil;
+
+	// create the results object
+	ResultData *tr = new ResultData();
+
+	// copy the results
+	tr->id					= frame_extended->id;
+	tr->timestamp			= time(NULL);
+	tr->listContours		= pupilFrame.getClusters();
+	tr->ellipsePupil		= *pupilFrame.getEllipsePupil();
+	tr->listGlints			= pupilFrame.getCornealReflections();
+	tr->trackDurMicros		= frame.trackDurMicros;
+	tr->scenePoint			= scenePoint;
+	tr->bTrackSuccessfull	= frame.bTrackSuccessfull;
+	tr->pupilCentre			= cv::Point3d(c_pupil[0], c_pupil[1], c_pupil[2]);
+	tr->corneaCentre		= cv::Point3d(c_cornea[0], c_cornea[1], c_cornea[2]);
+	tr->gazeVecStartPoint2D	= cv::Point(u1, v1);
+	tr->gazeVecEndPoint2D	= cv::Point(u2, v2);
+
+	// the stages in microseconds
+	tr->stageDurMicros.resize(gt::StageTimes::NOF_STAGES);
+	for(int i = 0; i < gt::StageTimes::NOF_STAGES; ++i) {
+		const int64_t dur = frame.times.getDuration(i);
+		tr->stageDurMicros[i] = dur < 0 ? -1.0f : 1e-3f * dur;
+	}
+
+	trace.add(frame_extended->id, frame.times);
+
+	frame_extended->res = tr;
+
+
+	// fire the callback
+	bool cb_ret = cb_handler->frameProcessed(frame_extended, user_data);
+
+	// the return value states if the cb_handler is the owner or not
+	if(!cb_ret) {
+		delete frame_extended;
+	}
+
+}
@@ -4,24 +4,106 @@
 
 #include "JPEGWorker.h"
 #include "GazeTracker.h"
+#include "TrackerPipeline.h"
+#include "StageTrace.h"
 #include "SceneMapper.h"
 
 
 
-class GTWorker : public JPEGWorker {
+/*
+ * Decodes the eye frames and feeds them to a gt::TrackerPipeline. The
+ * tracking stages run in the pipeline's threads, the frames are passed
+ * to the callback handler from the thread of the last stage, in the
+ * order they were received.
+ *
+ * The tracker uses only the crop area of the frames. Unless the colour
+ * frames are needed for showing them, only the luma of the crop area
+ * is decoded, and the frames given to the handler have no image data.
+ * The luma plane of the I420 frames is tracked as it is. The YUV frames
+ * are converted to BGR only for showing them.
+ *
+ * The durations of the tracking stages are given in the results, and
+ * may be written to a trace file, see gt::StageTrace.
+ */
+class GTWorker : public JPEGWorker, public gt::PipelineHandler {
 
 	public:
 
 		GTWorker();
+		~GTWorker();
 
 		void setTracker(gt::GazeTracker *_tracker, SceneMapper *_mapper);
 
+		bool init(WorkerCBHandler *_cb_handler, int _max_n_frames, void *_user_data);
+
+		/* Start and end the pipeline together with the worker thread */
+		bool start();
+		void end();
+
+		/*
+		 * Give new settings to the tracker. They are taken into use
+		 * between two frames.
+		 */
+		void setTrackerSettings(const TrackerSettings &settings);
+
+		/*
+		 * Decode the whole frames in colour for the handler, or only
+		 * the crop area to gray. Off by default. Thread safe.
+		 */
+		void setColourFrames(bool b);
+
+		/*
+		 * Write the stage times of the tracked frames to the file. Must
+		 * be called before start(), the file is closed by end().
+		 */
+		bool setTraceFile(const std::string &fname);
+
+		/* Called by the pipeline, see gt::PipelineHandler */
+		void frameTracked(const gt::PipelineFrame &frame);
+
+		/* The delays from the capture of the frames to the tracker */
+		void getLatency(DelayStats &stats);
+
 	private:
 
 		CameraFrame *process(CameraFrame *img_compr);
+
+		/*
+		 * Decode the whole frame in colour, and give the gray image for
+		 * the tracker in imgGray
+		 */
+		CameraFrame *decodeColour(CameraFrame *img_compr, cv::Mat &imgGray);
+
+		/*
+		 * Give the luma of the crop area in imgGray, the rest of the
+		 * image is not set. imgGray may point to the data of img_compr.
+		 */
+		void decodeGray(CameraFrame *img_compr, cv::Mat &imgGray);
+
+		/* The crop area of the tracker in the frame of size w x h */
+		cv::Rect getCropArea(int w, int h) const;
+
 		gt::GazeTracker *tracker;
 		SceneMapper *mapper;
 
+		gt::TrackerPipeline pipeline;
+
+		/* Written by frameTracked(), if open */
+		gt::StageTrace trace;
+
+		/* The grayscale frame, reused. Never points to the frame data. */
+		cv::Mat ocvFrameGray;
+
+		/* Set by setColourFrames() */
+		int bColourFrames;
+
+		WorkerCBHandler *cb_handler;
+		void *user_data;
+
+		/* Capture to the tracker, protected by mutex_latency */
+		DelayStats latency;
+		pthread_mutex_t mutex_latency;
+
 };
 
 
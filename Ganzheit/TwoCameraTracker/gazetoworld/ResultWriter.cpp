@@ -2,32 +2,32 @@
 #include <sys/stat.h>
 
 
-ResultWriter::ResultWriter() : DataWriter() {
+/* Elements in the queue */
+static const size_t QUEUE_CAPACITY = 1024;
 
-}
+/* The most elements run() takes from the queue at a time */
+static const size_t BATCH_SIZE = 16;
 
+/* How long run() waits for data before checking the state */
+static const int WAIT_MS = 4;
 
-ResultWriter::~ResultWriter() {
 
-	pthread_mutex_lock(&mutex);
+ResultWriter::ResultWriter() : DataWriter() {
 
-		// flush
-		std::list<QueueData>::iterator it = queue.begin();
-		while(it != queue.end()) {
+}
 
-			write(*it);
 
-			it->release();
+ResultWriter::~ResultWriter() {
 
-			++it;
-		}
+	// flush
+	QueueData el;
+	while(queue.pop(el)) {
 
-	queue.clear();
+		write(el);
 
-	pthread_mutex_unlock(&mutex);
+		el.release();
 
-	pthread_mutex_destroy(&mutex);
-	pthread_cond_destroy(&cond);
+	}
 
 }
 
@@ -47,12 +47,8 @@ bool ResultWriter::init(const std::string &_parentDir) {
     }
 
 
-	// create the mutex
-	if(pthread_mutex_init(&mutex, NULL) != 0) {
-		return false;
-	}
-
-	if(pthread_cond_init(&cond, NULL) != 0) {
+	// create the queue
+	if(!queue.init(QUEUE_CAPACITY)) {
 		return false;
 	}
 
@@ -62,7 +58,7 @@ bool ResultWriter::init(const std::string &_parentDir) {
 }
 
 
-bool ResultWriter::addFrames(const CameraFrame *_f1, const CameraFrame *_f2) {
+bool ResultWriter::addFrames(const CameraFrame *_f1, const CameraFrame *_f2, unsigned long id) {
 
 	return true;
 
@@ -82,15 +78,16 @@ bool ResultWriter::addResults(const std::vector<char> &buff) {
 	char *data = new char[sz];
 	memcpy(data, buff.data(), sz);
 
-	pthread_mutex_lock(&mutex); {
+	QueueData el(data, sz);
+
+	// run() is woken if it is waiting
+	if(!queue.push(el)) {
 
-        QueueData el(data, sz);
-		queue.push_back(el);
+		printf("ResultWriter::addResults(): the queue is full, dropping the results\n");
 
-		// getElement() might be waiting
-		pthread_cond_signal(&cond);
+		el.release();
 
-    } pthread_mutex_unlock(&mutex);
+	}
 
 	return false;
 
@@ -102,91 +99,32 @@ void ResultWriter::run() {
 	// loop while alive
 	while(isRunning()) {
 
-		// get the oldest element
-		QueueData el = getElement();
-
-		// continue if empty
-		if(el.empty()) {
+		// get the oldest elements
+		QueueData els[BATCH_SIZE];
+		const size_t n = queue.popBatch(els, BATCH_SIZE);
 
+		// wait for data if empty
+		if(n == 0) {
 
-			// give add() a chance to execute
-			sleepMs(2);
+			queue.wait(WAIT_MS);
 
 			continue;
 
 		}
 
-		// write to files
-		write(el);
-
-		// destroy data
-		el.release();
-
-	}
-
-	printf("ResultWriter::run(): bye\n");
-
-}
-
-
-void ResultWriter::waitForData() {
-
-    // get the system time
-    struct timespec ts;
-
-    static const long BILLION = 1e9;
-    static const long MILLION = 1e6;
-
-    clock_gettime(CLOCK_REALTIME, &ts);
-
-    int millis = 4;
-
-    // add the requested wait time
-    ts.tv_sec  += millis / 1000;
-    ts.tv_nsec += (millis % 1000) * MILLION; // millis * 1e6 => nanosecond
-
-    // account for overflow
-    if(ts.tv_nsec >= BILLION) {
-        ++ts.tv_sec;
-        ts.tv_nsec -= BILLION;
-    }
-
+		for(size_t i = 0; i < n; ++i) {
 
-    /*****************************************************************
-     * Wait on the condition, which must be locked
-     *****************************************************************/
+			// write to files
+			write(els[i]);
 
-    // on success returns zero
-    /*int ret =*/ pthread_cond_timedwait(&cond, &mutex, &ts);
+			// destroy data
+			els[i].release();
 
-}
-
-
-QueueData ResultWriter::getElement() {
-
-	pthread_mutex_lock(&mutex);
-
-		// wait if empty
-        while(queue.size() == 0 && isRunning()) {
-            waitForData();
-        }
-
-		// if still empty, i.e. the destructor signalled, return
-		if(queue.size() == 0) {
-			pthread_mutex_unlock(&mutex);
-			return QueueData();
 		}
 
-		std::list<QueueData>::iterator it = queue.begin();
-
-		const QueueData el = *it;
-
-		// remove the reference from the list
-		queue.erase(it);
-
-    pthread_mutex_unlock(&mutex);
+	}
 
-	return el;
+	printf("ResultWriter::run(): bye\n");
 
 }
 
@@ -200,11 +138,7 @@ void ResultWriter::write(const QueueData &el) {
 
 int ResultWriter::getBufferState() {
 
-	pthread_mutex_lock(&mutex);
-		int ret = (int)queue.size();
-	pthread_mutex_unlock(&mutex);
-
-	return ret;
+	return (int)queue.size();
 
 }
 
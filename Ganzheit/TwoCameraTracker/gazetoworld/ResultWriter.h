@@ -2,7 +2,6 @@
 #define RESULT_WRITER_H
 
 
-#include <list>
 #include <vector>
 #include <string>
 #include <pthread.h>
@@ -11,6 +10,7 @@
 #include "BinaryResultParser.h"
 #include <sys/time.h>
 #include "DataWriter.h"
+#include "RingQueue.h"
 
 
 class QueueData {
@@ -68,25 +68,19 @@ public:
      * parentDir must contain the trailing '/'.
      */
     bool init(const std::string &parentDir);
-    bool addFrames(const CameraFrame *_f1, const CameraFrame *_f2);
+    bool addFrames(const CameraFrame *_f1, const CameraFrame *_f2, unsigned long id);
     bool addResults(const std::vector<char> &);
     int getBufferState();
 
 private:
 
-    void waitForData();
-
-    QueueData getElement();
-
     void write(const QueueData &el);
 
     /* Output files */
     std::ofstream streamResults;
 
-    pthread_mutex_t mutex;
-    pthread_cond_t cond;
-
-    std::list<QueueData> queue;
+    /* addResults() adds, run() writes */
+    RingQueue<QueueData> queue;
 
 
     std::string workingDir;
@@ -2,29 +2,21 @@
 #define SCENE_FRAME_WORKER_H
 
 
-#include "JPEGWorker.h"
+#include "StreamWorker.h"
 
 
-class SceneFrameWorker : public JPEGWorker {
+/*
+ * Passes the scene frames to the GUI as they are, undecoded. The GUI
+ * decodes only the frames it shows, at the size it shows them, see
+ * PreviewDecoder. The frames keep their id, the pairs are found by it.
+ */
+class SceneFrameWorker : public StreamWorker {
 
 private:
 
     CameraFrame *process(CameraFrame *img_compr) {
 
-        CameraFrame *frame;
-
-        if(img_compr->format == FORMAT_MJPG) {
-
-            frame = JPEGWorker::process(img_compr);
-
-        }
-        else {
-
-            frame = img_compr;
-
-        }
-
-        return frame;
+        return img_compr;
 
     }
 
@@ -32,4 +24,3 @@ private:
 
 
 #endif
-
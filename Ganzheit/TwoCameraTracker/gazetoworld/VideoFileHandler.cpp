@@ -1,10 +1,14 @@
 #include "VideoFileHandler.h"
 
 
+/* The frame interval if the recording has no timestamps, in microseconds */
+static const int64_t DEFAULT_INTERVAL = 33333;
 
 
 VideoFileHandler::VideoFileHandler() {
 
+    frameReceiver = NULL;
+    pairPos = 0;
 
 }
 
@@ -21,63 +25,77 @@ bool VideoFileHandler::init(const std::vector<VideoInfo> &info, DualFrameReceive
     }
 
     frameReceiver = _r;
+    pairPos = 0;
 
-    capEye.open(info[0].devname);
-    if(!capEye.isOpened()) {
+    if(!reader.open(info[0].devname)) {
         return false;
     }
 
-    capScene.open(info[1].devname);
-    if(!capScene.isOpened()) {
-        return false;
-    }
-
-    return true;
+    return reader.getNofPairs() > 0;
 
 }
 
 
 void VideoFileHandler::run() {
 
+    int64_t prevTimestamp = 0;
+
     while(isRunning()) {
 
-        cv::Mat imgEye, imgScene;
+        // the recording has ended
+        if(pairPos >= reader.getNofPairs()) {
+            sleepMs(100);
+            continue;
+        }
 
-        capEye >> imgEye;
-        capScene >> imgScene;
+        RecordingReader::Frame eye, scene;
+        reader.getFrames(pairPos++, eye, scene);
+
+        // wait for as long as the cameras did between the frames
+        if(pairPos > 1) {
+
+            int64_t interval = DEFAULT_INTERVAL;
+
+            if(prevTimestamp != 0 && eye.timestamp > prevTimestamp) {
+                interval = eye.timestamp - prevTimestamp;
+            }
+
+            sleepMs((int)(interval / 1000));
 
-        if(imgEye.empty() || imgScene.empty()) {
-            continue;
         }
 
-        int w = imgEye.cols;
-        int h = imgEye.rows;
-        int bpp = 3;
+        prevTimestamp = eye.timestamp;
+
+        // the size of the frames recorded before the index was not always found
+        if(eye.w == 0 || scene.w == 0) {
+            printf("VideoFileHandler::run(): The size of the frames is not known\n");
+            continue;
+        }
 
         // create a header for the data. Does not copy data.
-        CameraFrame frameEye(w,
-                             h,
-                             bpp,         // bytes per pixel
-                             imgEye.data,
-                             w*h*bpp,
-                             FORMAT_BGR,
+        CameraFrame frameEye(eye.w,
+                             eye.h,
+                             3,           // bytes per pixel when decompressed
+                             (unsigned char *)eye.data,
+                             eye.sz,
+                             FORMAT_MJPG,
                              false,       // do not copy data
                              false);      // do not become parent, i.e. do not destroy data in destructor
 
 
         // create a header for the data. Does not copy data.
-        CameraFrame frameScene(w,
-                               h,
-                               bpp,         // bytes per pixel
-                               imgScene.data,
-                               w*h*bpp,
-                               FORMAT_BGR,
+        CameraFrame frameScene(scene.w,
+                               scene.h,
+                               3,           // bytes per pixel when decompressed
+                               (unsigned char *)scene.data,
+                               scene.sz,
+                               FORMAT_MJPG,
                                false,       // do not copy data
                                false);      // do not become parent, i.e. do not destroy data in destructor
 
+        frameEye.timestamp = frameScene.timestamp = CameraFrame::getTime();
 
-        frameReceiver->frameReceived(&frameEye,   0);
-        frameReceiver->frameReceived(&frameScene, 1);
+        frameReceiver->framesReceived(&frameEye, &frameScene);
 
 
         size_t states[2];
@@ -92,9 +110,6 @@ void VideoFileHandler::run() {
             sleepMs(1000);
         }
 
-        sleepMs(30);
-
     }
 
 }
-
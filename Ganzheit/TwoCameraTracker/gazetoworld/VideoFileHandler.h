@@ -2,12 +2,17 @@
 #define VIDEO_FILE_HANDLER_H
 
 
-#include <opencv2/imgproc/imgproc.hpp>
-#include <opencv2/highgui/highgui.hpp>
 #include "Thread.h"
 #include "DualFrameReceiver.h"
+#include "RecordingReader.h"
 
 
+/*
+ * Plays a recording of VideoWriter to a DualFrameReceiver as if the
+ * frames came from the cameras. The MJPG frames are given as they are,
+ * at the pace they were captured, and stamped with the time they are
+ * given like VideoSync does.
+ */
 class VideoFileHandler : public Thread {
 
 public:
@@ -19,7 +24,11 @@ public:
     void run();
 
 
-    /* Mimics the behavior of VideoHandler::init() */
+    /*
+     * Mimics the behavior of VideoHandler::init(). The devname of the
+     * first VideoInfo is the folder of the recording, with the trailing
+     * '/'.
+     */
     bool init(const std::vector<VideoInfo> &info, DualFrameReceiver *_r);
 
 
@@ -27,8 +36,10 @@ private:
 
     DualFrameReceiver *frameReceiver;
 
-	cv::VideoCapture capEye;
-	cv::VideoCapture capScene;
+    RecordingReader reader;
+
+    /* The next frame pair to play */
+    size_t pairPos;
 
 
 };
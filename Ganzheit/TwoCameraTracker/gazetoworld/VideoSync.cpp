@@ -1,6 +1,42 @@
 #include "VideoSync.h"
 
 
+/* The number of frame pairs waiting for the receiver */
+static const int MAX_PAIRS = 4;
+
+/* How long run() waits for a pair before checking the state */
+static const int WAIT_MS = 100;
+
+/* Interval of printing the statistics in microseconds */
+static const int64_t STATS_INTERVAL = 10000000;
+
+
+/*
+ * Shares the data of a cv::Mat with the frames. The matrix header keeps
+ * a reference to the data as long as any frame uses it.
+ */
+class MatSharedBuffer : public SharedBuffer {
+
+public:
+
+    MatSharedBuffer(const cv::Mat &_img) :
+        SharedBuffer(_img.data, _img.total() * _img.elemSize()) {
+
+        img = _img;
+
+    }
+
+protected:
+
+    void dispose() {
+        delete this;
+    }
+
+private:
+
+    cv::Mat img;
+
+};
 
 
 VideoSync::VideoSync() : Thread() {
@@ -8,10 +44,25 @@ VideoSync::VideoSync() : Thread() {
     m_bVideoFile = false;
     m_nFPS = 0;
 
+    capDevs[0] = capDevs[1] = NULL;
+    pairs = NULL;
+    timeStats = 0;
+
+}
+
+
+VideoSync::~VideoSync() {
+
+    // stop the cameras before destroying the buffer they feed
+    delete capDevs[0];
+    delete capDevs[1];
+
+    delete pairs;
+
 }
 
 
-bool VideoSync::init(const std::vector<VideoInfo> &info, DualFrameReceiver *_r) {
+bool VideoSync::init(const std::vector<VideoInfo> &info, DualFrameReceiver *_r, double maxSkewMs) {
 
     if(info.size() != 2) {
         return false;
@@ -45,35 +96,26 @@ bool VideoSync::init(const std::vector<VideoInfo> &info, DualFrameReceiver *_r)
     }
     else { // camera device
 
-        int w = info[0].w;
-        int h = info[0].h;
-        Format format = info[0].format;
-        int fps = info[0].fps;
-        std::string devname = info[0].devname;
+        // must be ready before the cameras start streaming
+        pairs = new MultiImageBuffer(MAX_PAIRS, 2, (int64_t)(1000.0 * maxSkewMs));
 
-        if(!simpleCapEye.open(devname,   // device path
-                              w,		 // witdth
-                              h,		 // height
-                              fps,		 // framerate
-                              format)) { // format
+        timeStats = CameraFrame::getTime();
 
-            return false;
+        for(int i = 0; i < 2; ++i) {
 
-        }
+            capDevs[i] = new CaptureDevice();
 
-        w = info[1].w;
-        h = info[1].h;
-        format = info[1].format;
-        fps = info[1].fps;
-        devname = info[1].devname;
+            if(!capDevs[i]->init(info[i].devname,   // device path
+                                 info[i].w,         // witdth
+                                 info[i].h,         // height
+                                 info[i].fps,       // framerate
+                                 info[i].format,    // format
+                                 this,              // this is the FrameReceiver
+                                 i)) {              // 0 eye, 1 scene
 
-        if(!simpleCapScene.open(devname,   // device path
-                                w,		 // witdth
-                                h,		 // height
-                                fps,		 // framerate
-                                format)) { // format
+                return false;
 
-            return false;
+            }
 
         }
 
@@ -111,27 +153,23 @@ void VideoSync::run() {
             int h = imgEye.rows;
             int bpp = 3;
 
-            // create a header for the data. Does not copy data.
-            CameraFrame frameEye(w,
-                                 h,
-                                 bpp,         // bytes per pixel
-                                 imgEye.data,
-                                 w*h*bpp,
-                                 FORMAT_BGR,
-                                 false,       // do not copy data
-                                 false);      // do not become parent, i.e. do not destroy data in destructor
-                                              // cv::Mat owns the data
-
-            // create a header for the data. Does not copy data.
-            CameraFrame frameScene(w,
-                                   h,
-                                   bpp,         // bytes per pixel
-                                   imgScene.data,
-                                   w*h*bpp,
-                                   FORMAT_BGR,
-                                   false,       // do not copy data
-                                   false);      // do not become parent, i.e. do not destroy data in destructor
-                                                // cv::Mat owns the data
+            /*
+             * Share the data of the matrices with the frames, so that the
+             * receiver does not copy them. The images are continuous,
+             * because the capture allocates them.
+             */
+            SharedBuffer *bufferEye   = new MatSharedBuffer(imgEye);
+            SharedBuffer *bufferScene = new MatSharedBuffer(imgScene);
+
+            CameraFrame frameEye(w, h, bpp, bufferEye, FORMAT_BGR);
+            CameraFrame frameScene(imgScene.cols, imgScene.rows, bpp, bufferScene, FORMAT_BGR);
+
+            // the frames hold the references now
+            bufferEye->unref();
+            bufferScene->unref();
+
+            // read together, no need to pair
+            frameEye.timestamp = frameScene.timestamp = CameraFrame::getTime();
 
             frameReceiver->framesReceived(&frameEye, &frameScene);
 
@@ -142,37 +180,83 @@ void VideoSync::run() {
         }
         else { // camera
 
-            CameraFrame *frameEye   = simpleCapEye.grabFrame(true);
-            CameraFrame *frameScene = simpleCapScene.grabFrame(true);
-
-            if(frameEye == NULL || frameScene == NULL) {
-
-                delete frameEye;
-                delete frameScene;
+            std::vector<CameraFrame *> frames(2);
 
+            if(!pairs->waitFrames(frames, WAIT_MS)) {
                 continue;
             }
 
-            frameReceiver->framesReceived(frameEye, frameScene);
+            frameReceiver->framesReceived(frames[0], frames[1]);
 
-            delete frameEye;
-            delete frameScene;
+            delete frames[0];
+            delete frames[1];
+
+            if(CameraFrame::getTime() - timeStats >= STATS_INTERVAL) {
+                printStats();
+            }
 
         }
 
-        size_t states[2];
-		frameReceiver->getWorkerBufferStates(states);
+        /*
+         * The full queues of the receiver are handled by their
+         * policies, see DualFrameReceiver::setQueuePolicy()
+         */
+
+    }
+
+}
 
-		/* Return the maximum allowed worker buffer queue size */
-		int maxBuffSz = frameReceiver->getMaxBufferSize();
 
-        int max = std::max(states[0], states[1]);
+void VideoSync::frameReceived(const CameraFrame *frame, int id) {
+
+    // share the data of the frame, the capture time is copied
+    pairs->add(new CameraFrame(*frame), id);
+
+}
 
-        if(max >= maxBuffSz) {
-            sleepMs(1000);
-        }
 
+void VideoSync::getPairStats(MultiImageBuffer::Stats &stats) {
+
+    if(pairs != NULL) {
+        pairs->getStats(stats);
     }
 
 }
 
+
+void VideoSync::printStats() {
+
+    timeStats = CameraFrame::getTime();
+
+    MultiImageBuffer::Stats stats;
+    pairs->getStats(stats);
+
+    DelayStats latency;
+    frameReceiver->getTrackerLatency(latency);
+
+    printf("VideoSync: %lu pairs, %lu dropped, %lu + %lu unmatched, skew %.1f/%.1f ms, capture to tracker %.1f/%.1f ms (mean/max)\n",
+           stats.nGroups,
+           stats.nDropped,
+           stats.nUnmatched[0],
+           stats.nUnmatched[1],
+           stats.skew.getMean() / 1000.0,
+           stats.skew.max / 1000.0,
+           latency.getMean() / 1000.0,
+           latency.max / 1000.0);
+
+    static const char *names[DualFrameReceiver::NOF_QUEUES] = {"tracker", "scene", "writer"};
+
+    for(int i = 0; i < DualFrameReceiver::NOF_QUEUES; ++i) {
+
+        QueuePolicy::Stats queueStats;
+        frameReceiver->getQueueStats((DualFrameReceiver::Queue)i, queueStats);
+
+        printf("    %s queue: %lu added, %lu dropped, %lu blocked\n",
+               names[i],
+               queueStats.nAdded,
+               queueStats.nDropped,
+               queueStats.nBlocked);
+
+    }
+
+}
@@ -6,32 +6,62 @@
 #include <opencv2/highgui/highgui.hpp>
 #include "Thread.h"
 #include "DualFrameReceiver.h"
-#include "SimpleCapture.h"
+#include "CaptureDevice.h"
+#include "VideoBuffer.h"
 
 
-class VideoSync : public Thread {
+/*
+ * Pairs the frames of the eye and the scene cameras and gives them to
+ * the DualFrameReceiver. The cameras deliver the frames in their own
+ * gstreamer threads, and the frames are paired by their capture times.
+ */
+class VideoSync : public Thread, public FrameReceiver {
 
 public:
 
     VideoSync();
+    ~VideoSync();
 
     /* Inherited from Thread */
     void run();
 
 
-    /* Mimics the behavior of VideoHandler::init() */
-    bool init(const std::vector<VideoInfo> &info, DualFrameReceiver *_r);
+    /*
+     * Mimics the behavior of VideoHandler::init(). The frames of the
+     * cameras are paired if their capture times differ by maxSkewMs
+     * at most.
+     */
+    bool init(const std::vector<VideoInfo> &info,
+              DualFrameReceiver *_r,
+              double maxSkewMs = MultiImageBuffer::DEFAULT_MAX_SKEW / 1000.0);
+
+
+    /* Inherited from FrameReceiver, called from the threads of the cameras */
+    void frameReceived(const CameraFrame *frame, int id);
+
+
+    /* The pairing statistics of the cameras */
+    void getPairStats(MultiImageBuffer::Stats &stats);
 
 
 private:
 
+    /* Print the pairing and latency statistics */
+    void printStats();
+
     DualFrameReceiver *frameReceiver;
 
 	cv::VideoCapture capEye;
 	cv::VideoCapture capScene;
 
-    SimpleCapture simpleCapEye;
-    SimpleCapture simpleCapScene;
+    /* The eye and the scene cameras */
+    CaptureDevice *capDevs[2];
+
+    /* The frames of the cameras waiting for a pair */
+    MultiImageBuffer *pairs;
+
+    /* When the statistics were printed, see CameraFrame::getTime() */
+    int64_t timeStats;
 
     /*
      * Tells if this is a video file or a camera device
@@ -2,40 +2,55 @@
 #include <sys/stat.h>
 
 
-static const long BILLION = 1e9;
-
 /* Duration between backups in seconds */
 static const long DUR_BACKUP = 2 * 60;
 
+/* Elements in the queue, about 17 seconds of frame pairs at 30 fps */
+static const size_t QUEUE_SIZE = 1024;
+
+/* The most elements run() takes from the queue and writes at a time */
+static const size_t BATCH_SIZE = 64;
+
+/* Preallocated at a time, the frames of a few seconds */
+static const size_t CHUNK_FRAMES	= 16 * 1024 * 1024;
+static const size_t CHUNK_RESULTS	= 1024 * 1024;
+static const size_t CHUNK_INDEX		= 256 * 1024;
+
+/* How long run() waits for data before checking the state and the backup timer */
+static const int WAIT_MS = 4;
+
 
 VideoWriter::VideoWriter() : DataWriter() {
 
-	countBackup = 0;
+	bDropFrame2 = false;
+	fileIndex = -1;
 
 }
 
 
 VideoWriter::~VideoWriter() {
 
-	pthread_mutex_lock(&mutex);
-
-		// flush
-		std::list<QueueElement>::iterator it = queue.begin();
-		while(it != queue.end()) {
+	// flush
+	QueueElement el;
+	while(queue.pop(el)) {
 
-			write(*it);
-
-			it->release();
+		if(el.type == QueueElement::TYPE_FRAME2 && bDropFrame2) {
+			bDropFrame2 = false;
+			el.release();
+		}
+		else {
+			write(el);
+		}
 
-			++it;
+		if(pending.size() >= BATCH_SIZE) {
+			flush();
 		}
 
-	queue.clear();
+	}
 
-	pthread_mutex_unlock(&mutex);
+	flush();
 
-	pthread_mutex_destroy(&mutex);
-	pthread_cond_destroy(&cond);
+	segments.end();
 
 }
 
@@ -78,92 +93,27 @@ bool VideoWriter::init(const std::string &_parentDir) {
     }
 
 	/**************************************************
-	 * Create the output files
+	 * Create the output files, in the order of
+	 * IndexEntry::Stream, and the index
 	 **************************************************/
-	if(!createNewFiles()) {
-		return false;
-	}
-
-
-	// create the mutex
-	if(pthread_mutex_init(&mutex, NULL) != 0) {
-		return false;
-	}
-
-	if(pthread_cond_init(&cond, NULL) != 0) {
-		return false;
-	}
-
-
-	return true;
-
-}
+	std::vector<char> header(RecordingIndex::HEADER_SIZE);
+	RecordingIndex::headerToBuffer(&header[0]);
 
+	segments.addFile(RecordingIndex::FILE_EYE, CHUNK_FRAMES);
+	segments.addFile(RecordingIndex::FILE_SCENE, CHUNK_FRAMES);
+	segments.addFile(RecordingIndex::FILE_RESULTS, CHUNK_RESULTS);
+	fileIndex = segments.addFile(RecordingIndex::FILE_INDEX, CHUNK_INDEX, header);
 
-bool VideoWriter::createNewFiles() {
-
-	printf("VideoWriter::createNewFiles(): creating new files\n");
-
-	/****************************************
-	 * First create the new folder
-	 ****************************************/
-
-	std::stringstream ss;
-	ss << workingDir << "part" << countBackup++ << "/";
-
-	std::string folderPath = ss.str();
-
-	if(!createFolder(folderPath)) {
-
+	if(!segments.init(workingDir)) {
 		return false;
-
 	}
 
+	pending.reserve(BATCH_SIZE);
+	pendingIndex.reserve(BATCH_SIZE * RecordingIndex::ENTRY_SIZE);
 
-	/****************************************
-	 * Now create the files
-	 ****************************************/
-
-    // create new video files if required
 
-    std::string fileCamEye = std::string(folderPath);
-    fileCamEye.append("camera1.mjpg");
-
-    std::string fileCamScene = std::string(folderPath);
-    fileCamScene.append("camera2.mjpg");
-
-    // eye cam file
-    streamEyeCam.close();
-    streamEyeCam.open(fileCamEye.c_str(), std::ofstream::binary);
-
-    // check if the file is open
-    if(!streamEyeCam.is_open()) {
-        printf("VideoWriter::init(): Could not create %s\n", fileCamEye.c_str());
-        return false;
-    }
-
-    // scene cam file
-    streamSceneCam.close();
-    streamSceneCam.open(fileCamScene.c_str(), std::ofstream::binary);
-
-    // check if the file is open
-    if(!streamSceneCam.is_open()) {
-        printf("VideoWriter::init(): Could not create %s\n", fileCamScene.c_str());
-        return false;
-    }
-
-
-	std::string fileResults = std::string(folderPath);
-	fileResults.append("results.res");
-
-
-	// result file
-	streamResults.close();
-	streamResults.open(fileResults.c_str(), std::ofstream::binary);
-
-	// check if the file is open
-	if(!streamResults.is_open()) {
-		printf("VideoWriter::init(): Could not create %s\n", fileResults.c_str());
+	// create the queue, with room for the elements the policy drops later
+	if(!queue.init(policy.getCapacity(QUEUE_SIZE))) {
 		return false;
 	}
 
@@ -173,7 +123,7 @@ bool VideoWriter::createNewFiles() {
 }
 
 
-bool VideoWriter::addFrames(const CameraFrame *_f1, const CameraFrame *_f2) {
+bool VideoWriter::addFrames(const CameraFrame *_f1, const CameraFrame *_f2, unsigned long id) {
 
     // if this thread is not running, do not add
 	if(!isRunning()) {
@@ -181,29 +131,27 @@ bool VideoWriter::addFrames(const CameraFrame *_f1, const CameraFrame *_f2) {
 	}
 
 
-	// create element 1
-	int sz1 = _f1->sz;
-	char *data1 = new char[sz1];
-	memcpy(data1, _f1->data, sz1);
-	QueueElement el1(data1, sz1, QueueElement::TYPE_FRAME1);
+	// create the elements, they share the data with the frames
+	QueueElement els[2] = {
+		QueueElement(_f1, QueueElement::TYPE_FRAME1, id),
+		QueueElement(_f2, QueueElement::TYPE_FRAME2, id)
+	};
 
-	// create element 2
-	int sz2 = _f2->sz;
-	char *data2 = new char[sz2];
-	memcpy(data2, _f2->data, sz2);
-	QueueElement el2(data2, sz2, QueueElement::TYPE_FRAME2);
 
+	/*
+	 * Place the elements to the queue, one after the other so that
+	 * the pair is not split. run() is woken if it is waiting.
+	 */
+	if(!policy.admit(queue, QUEUE_SIZE) || !queue.pushBatch(els, 2)) {
 
-	pthread_mutex_lock(&mutex);
+		policy.dropped();
 
-		// place the elements to the queue
-		queue.push_back(el1);
-		queue.push_back(el2);
+		els[0].release();
+		els[1].release();
 
-		// getElement() might be waiting
-		pthread_cond_signal(&cond);
+		return false;
 
-	pthread_mutex_unlock(&mutex);
+	}
 
 	return true;
 
@@ -223,17 +171,20 @@ bool VideoWriter::addResults(const std::vector<char> &buff) {
 	char *data = new char[sz];
 	memcpy(data, buff.data(), sz);
 
-	pthread_mutex_lock(&mutex);
+	QueueElement el(data, sz, QueueElement::TYPE_RESULTS);
+
+	// run() is woken if it is waiting
+	if(!queue.push(el)) {
+
+		printf("VideoWriter::addResults(): the queue is full, dropping the results\n");
 
-		QueueElement el(data, sz, QueueElement::TYPE_RESULTS);
-		queue.push_back(el);
+		el.release();
 
-		// getElement() might be waiting
-		pthread_cond_signal(&cond);
+		return false;
 
-	pthread_mutex_unlock(&mutex);
+	}
 
-	return false;
+	return true;
 
 }
 
@@ -246,13 +197,15 @@ void VideoWriter::run() {
 	while(isRunning()) {
 
 		/* Every predefined interval, backups will be made */
-		if(DUR_BACKUP == elapsedSeconds()) {
+		if(elapsedSeconds() >= DUR_BACKUP) {
 
 			// indicates that the backups are being done
 			zeroTimer();
 
-			// create new output files for the streams
-			if(!createNewFiles()) {
+			printf("VideoWriter::run(): continuing in a new part\n");
+
+			// the files were created in advance
+			if(!flush() || !segments.rotate()) {
 
 				// this thread must exit
 				killSelf();
@@ -264,24 +217,46 @@ void VideoWriter::run() {
 		}
 
 
-		// get the oldest element
-		QueueElement el = getElement();
+		trim();
 
-		// continue if empty
-		if(el.empty()) {
+		// get the oldest elements
+		QueueElement els[BATCH_SIZE];
+		const size_t n = queue.popBatch(els, BATCH_SIZE);
 
-			// give add() a chance to execute
-			sleepMs(2);
+		if(n > 0) {
 
-			continue;
+			// addFrames() might be waiting for room
+			policy.taken();
 
 		}
 
-		// write to files
-		write(el);
+		for(size_t i = 0; i < n; ++i) {
 
-		// destroy the frame pair
-		el.release();
+			// the other half of a dropped pair
+			if(els[i].type == QueueElement::TYPE_FRAME2 && bDropFrame2) {
+				bDropFrame2 = false;
+				els[i].release();
+			}
+			else {
+				write(els[i]);
+			}
+
+		}
+
+		// write the batch, a call per file
+		if(!flush()) {
+
+			// this thread must exit
+			killSelf();
+
+			break;
+
+		}
+
+		// wait for data if empty
+		if(n == 0) {
+			queue.wait(WAIT_MS);
+		}
 
 	}
 
@@ -290,42 +265,68 @@ void VideoWriter::run() {
 }
 
 
-QueueElement VideoWriter::getElement() {
+void VideoWriter::trim() {
 
-	pthread_mutex_lock(&mutex);
+	size_t n = policy.trim(queue.size(), QUEUE_SIZE);
 
-		// wait if empty
-        while(queue.size() == 0 && isRunning()) {
-            waitForData();
-        }
+	QueueElement el;
 
-		// if still empty, i.e. the destructor signalled, return
-		if(queue.size() == 0) {
-			pthread_mutex_unlock(&mutex);
-			return QueueElement();
-		}
+	while(n > 0 && queue.pop(el)) {
+
+		--n;
+
+		switch(el.type) {
+
+			// the pairs are dropped as a whole, see run()
+			case QueueElement::TYPE_FRAME1: {
+
+				policy.dropped();
+				bDropFrame2 = true;
+
+				break;
+
+			}
+
+			case QueueElement::TYPE_FRAME2: {
 
-		std::list<QueueElement>::iterator it = queue.begin();
+				bDropFrame2 = false;
 
-		const QueueElement el = *it;
+				break;
+
+			}
+
+			// the results are always written
+			default: {
+
+				write(el);
+
+				continue;
+
+			}
 
-		// remove the reference from the list
-		queue.erase(it);
+		}
 
-	pthread_mutex_unlock(&mutex);
+		el.release();
 
-	return el;
+	}
 
 }
 
 
-void VideoWriter::write(const QueueElement &el) {
+void VideoWriter::write(QueueElement &el) {
+
+	IndexEntry entry;
+	entry.id		= (uint32_t)el.id;
+	entry.sz		= (uint32_t)el.size;
+	entry.w			= el.w;
+	entry.h			= el.h;
+	entry.timestamp	= el.timestamp;
 
 	switch(el.type) {
 
 		case QueueElement::TYPE_FRAME1: {
 
-			streamEyeCam.write((const char *)el.data, el.size);
+			entry.stream = IndexEntry::STREAM_EYE;
 
 			break;
 
@@ -333,7 +334,7 @@ void VideoWriter::write(const QueueElement &el) {
 
 		case QueueElement::TYPE_FRAME2: {
 
-			streamSceneCam.write((const char *)el.data, el.size);
+			entry.stream = IndexEntry::STREAM_SCENE;
 
 			break;
 
@@ -341,16 +342,60 @@ void VideoWriter::write(const QueueElement &el) {
 
 		case QueueElement::TYPE_RESULTS: {
 
-			streamResults.write((const char *)el.data, el.size);
+			entry.stream = IndexEntry::STREAM_RESULTS;
+
+			// the id is in the packet
+			uint32_t sz;
+			unsigned long id;
+			if(BinaryResultParser::parseHeader(el.data, el.size, sz, id)) {
+				entry.id = (uint32_t)id;
+			}
 
 			break;
 
 		}
 
-		default: break; // should never be reached
+		default: { // should never be reached
+
+			el.release();
+
+			return;
 
+		}
+
+	}
+
+	// the files of the segments are in the order of the streams
+	entry.offset = segments.add(entry.stream, el.data, el.size);
+
+	const size_t pos = pendingIndex.size();
+	pendingIndex.resize(pos + RecordingIndex::ENTRY_SIZE);
+	RecordingIndex::entryToBuffer(entry, &pendingIndex[pos]);
+
+	// the data must stay until flush()
+	pending.push_back(el);
+
+}
+
+
+bool VideoWriter::flush() {
+
+	// the reader skips the entries that point past the data, e.g. after a crash
+	if(!pendingIndex.empty()) {
+		segments.add(fileIndex, &pendingIndex[0], pendingIndex.size());
+	}
+
+	const bool ok = segments.flush();
+
+	for(size_t i = 0; i < pending.size(); ++i) {
+		pending[i].release();
 	}
 
+	pending.clear();
+	pendingIndex.clear();
+
+	return ok;
+
 }
 
 
@@ -414,44 +459,7 @@ bool VideoWriter::createFolder(const std::string &oputDir) {
 
 int VideoWriter::getBufferState() {
 
-	pthread_mutex_lock(&mutex);
-		int ret = (int)queue.size();
-	pthread_mutex_unlock(&mutex);
-
-	return ret;
-
-}
-
-
-void VideoWriter::waitForData() {
-
-    // get the system time
-    struct timespec ts;
-
-    static const long BILLION = 1e9;
-    static const long MILLION = 1e6;
-
-    clock_gettime(CLOCK_REALTIME, &ts);
-
-    int millis = 4;
-
-    // add the requested wait time
-    ts.tv_sec  += millis / 1000;
-    ts.tv_nsec += (millis % 1000) * MILLION; // millis * 1e6 => nanosecond
-
-    // account for overflow
-    if(ts.tv_nsec >= BILLION) {
-        ++ts.tv_sec;
-        ts.tv_nsec -= BILLION;
-    }
-
-
-    /*****************************************************************
-     * Wait on the condition, which must be locked
-     *****************************************************************/
-
-    // on success returns zero
-    /*int ret =*/ pthread_cond_timedwait(&cond, &mutex, &ts);
+	return (int)queue.size();
 
 }
 
@@ -2,7 +2,6 @@
 #define VIDEOWRITER_H
 
 
-#include <list>
 #include <vector>
 #include <string>
 #include <pthread.h>
@@ -11,6 +10,9 @@
 #include "BinaryResultParser.h"
 #include <sys/time.h>
 #include "DataWriter.h"
+#include "RingQueue.h"
+#include "RecordingIndex.h"
+#include "SegmentWriter.h"
 
 
 class QueueElement {
@@ -31,15 +33,37 @@ public:
         data = _data;
         size = _size;
         type = _type;
+        buffer = NULL;
+        id = 0;
+        w = h = 0;
+        timestamp = 0;
+    }
+
+    /* Takes the given reference to the buffer of the frame */
+    QueueElement(const CameraFrame *frame, int _type, unsigned long _id) {
+        buffer = frame->share();
+        data = (char *)buffer->data;
+        size = (int)buffer->sz;
+        type = _type;
+        id = _id;
+        w = frame->w;
+        h = frame->h;
+        timestamp = frame->timestamp;
     }
 
     void release() {
 
-        delete[] data;
+        if(buffer != NULL) {
+            buffer->unref();
+        }
+        else {
+            delete[] data;
+        }
 
         data = NULL;
         size = 0;
         type = TYPE_NO_TYPE;
+        buffer = NULL;
 
     }
 
@@ -49,6 +73,14 @@ public:
     int size;
     int type;
 
+    /* The frame data, shared with the other users of the frame. NULL for the results. */
+    SharedBuffer *buffer;
+
+    /* For the index, see RecordingIndex. The results carry their id in the data. */
+    unsigned long id;
+    int w, h;
+    int64_t timestamp;
+
 };
 
 
@@ -66,7 +98,10 @@ public:
      */
     bool init(const std::string &parentDir);
 
-    bool addFrames(const CameraFrame *_f1, const CameraFrame *_f2);
+    /* When the files are synced to the disk, must be called before init() */
+    void setSyncPolicy(SegmentWriter::SyncPolicy sync) {segments.setSyncPolicy(sync);}
+
+    bool addFrames(const CameraFrame *_f1, const CameraFrame *_f2, unsigned long id);
 
     bool addResults(const std::vector<char> &);
 
@@ -74,40 +109,47 @@ public:
 
     int getBufferState();
 
-private:
+    /* The recording folder created by init(), with the trailing '/' */
+    const std::string &getDir() const {return workingDir;}
 
-    void waitForData();
+private:
 
     long elapsedSeconds();
     void zeroTimer();
 
     bool createFolder(const std::string &oputDir);
-    bool createNewFiles();
     void setTerminated();
 
-    QueueElement getElement();
+    /*
+     * Queue the element to its stream and its entry to the index. The
+     * element is released by flush().
+     */
+    void write(QueueElement &el);
+
+    /* Write the queued elements and release them */
+    bool flush();
 
-    void write(const QueueElement &el);
+    /* Drop the oldest elements the policy does not keep */
+    void trim();
 
-    bool wait(int millis);
+    /* Output files, the streams and the side index, see RecordingIndex */
+    SegmentWriter segments;
+    int fileIndex;
 
-    /* Output files */
-    std::ofstream streamEyeCam;
-    std::ofstream streamSceneCam;
-    std::ofstream streamResults;
+    /* Written by write(), not yet flushed */
+    std::vector<QueueElement> pending;
+    std::vector<char> pendingIndex;
 
-    pthread_mutex_t mutex;
-    pthread_cond_t cond;
+    /* The producers add, run() writes */
+    RingQueue<QueueElement> queue;
 
-    std::list<QueueElement> queue;
+    /* The eye frame of the pair was dropped, drop the scene frame too */
+    bool bDropFrame2;
 
     struct timeval timeStart;
 
     std::string workingDir;
 
-    /* How many backups */
-    int countBackup;
-
 };
 
 
@@ -8,6 +8,9 @@ namespace gui {
 
     GLVideoCanvas::GLVideoCanvas(const View &_view) : GLWidget(_view) {
 
+        bMirrored = false;
+        bTexture = false;
+
         /******************************************************
          * create the texture for the instructions
          ******************************************************/
@@ -29,6 +32,10 @@ namespace gui {
 
     void GLVideoCanvas::draw(const CameraFrame *img) {
 
+        if(img == NULL && !bTexture) {
+            return;
+        }
+
         GLWidget::draw();
 
         /***************************************************************
@@ -39,13 +46,20 @@ namespace gui {
         // draw the results to the lower view
         glBindTexture(GL_TEXTURE_2D, texture);
 
-        glTexImage2D(GL_TEXTURE_2D, 0, 3, img->w, img->h, 0, GL_BGR, GL_UNSIGNED_BYTE, img->data);
+        if(img != NULL) {
+            glTexImage2D(GL_TEXTURE_2D, 0, 3, img->w, img->h, 0, GL_BGR, GL_UNSIGNED_BYTE, img->data);
+            bTexture = true;
+        }
+
+        // mirrored by swapping the left and the right edge of the texture
+        const double left	= bMirrored ? 1.0 : 0.0;
+        const double right	= 1.0 - left;
 
         glBegin(GL_QUADS);
-		glTexCoord2d(0.0, 0.0); glVertex2d(0,			view.h-1);	// upper left
-		glTexCoord2d(0.0, 1.0); glVertex2d(0,			0);			// lower left
-		glTexCoord2d(1.0, 1.0); glVertex2d(view.w-1,	0);			// lower right
-		glTexCoord2d(1.0, 0.0); glVertex2d(view.w-1,	view.h-1);	// upper right
+		glTexCoord2d(left, 0.0);	glVertex2d(0,			view.h-1);	// upper left
+		glTexCoord2d(left, 1.0);	glVertex2d(0,			0);			// lower left
+		glTexCoord2d(right, 1.0);	glVertex2d(view.w-1,	0);			// lower right
+		glTexCoord2d(right, 0.0);	glVertex2d(view.w-1,	view.h-1);	// upper right
         glEnd();
 
 
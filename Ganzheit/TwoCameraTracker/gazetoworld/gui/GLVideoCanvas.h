@@ -20,12 +20,24 @@ class GLVideoCanvas : public GLWidget {
 		GLVideoCanvas(const View &_view);
 		~GLVideoCanvas();
 
+		/*
+		 * Show the frame, scaled to the view. If img is NULL, the last
+		 * frame is shown again.
+		 */
 		void draw(const CameraFrame *img);
 
+		/* Show the frames mirrored around the y-axis. Off by default. */
+		void setMirrored(bool b) {bMirrored = b;}
+
 
 	private:
 		GLuint texture;
 
+		/* Set when the texture holds a frame */
+		bool bTexture;
+
+		bool bMirrored;
+
 
 };
 
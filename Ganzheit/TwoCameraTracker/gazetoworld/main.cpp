@@ -12,6 +12,7 @@
 #include "VideoSync.h"
 #include "Timing.h"
 #include "GLCornea.h"
+#include "PreviewDecoder.h"
 
 
 /* Extern the global tracker protecting mutex */
@@ -26,7 +27,7 @@ static void handleEvents();
 static bool build_GUI(SettingsIO &settings);
 static void collectFramesAndDrawGUI();
 static void draw_GUI(CameraFrame *img_eye, CameraFrame *img_scene, const ResultData *res);
-static void drawResults(CameraFrameExtended *imgEye, CameraFrameExtended *imgScene, OutputData *data);
+static void drawResults(CameraFrameExtended *imgEye, CameraFrame *imgScene, double sceneScale, OutputData *data);
 static bool init_all(const char *input_file);
 static bool init_SDL(SDL_Surface **screen);
 static bool init_video(const Settings &settings);
@@ -63,6 +64,9 @@ static gui::BufferWidget *panel_statusbars	= NULL;
 static gui::SettingsPanel *panel_settings	= NULL;
 static gui::PanelIdle *panelIdle			= NULL;
 
+/* Decodes the scene frames for panel_scene */
+static PreviewDecoder *sceneDecoder			= NULL;
+
 /* Stream related */
 static const int NDEVS						= 2;
 static const int FRAMERATE					= 30;
@@ -80,6 +84,12 @@ cv::Point3d lastValidCorneaCentre;
 
 static const double FPSPeriodMs             = 1000.0 / 60.0;
 
+/*
+ * New frames are shown at most at this rate. The frame pairs in between
+ * are dropped, and their scene frames are never decoded.
+ */
+static const double PreviewPeriodMs         = 1000.0 / 15.0;
+
 /*
  * An array containing N_POINTS last scene points. This class
  * will automatically remove the oldest point once a new sample
@@ -322,13 +332,9 @@ void handleEvents() {
             /* get a pointer to the panel's settings */
             LocalTrackerSettings *lts = panel_settings->getSettings();
 
-            // protect the tracker
-            pthread_mutex_lock(&mutex_tracker);
-
-            // set new settings
+            // set new settings, the tracker has its own copy
             trackerSettings.set(*lts);
-
-            pthread_mutex_unlock(&mutex_tracker);
+            receiver->setTrackerSettings(trackerSettings);
 
         }
 
@@ -489,6 +495,14 @@ bool init_video(const Settings &settings) {
         bOnlyResults = false;
     }
 
+    // what to do when the queues are full
+    receiver->setQueuePolicy(DualFrameReceiver::QUEUE_TRACKER, settings.trackerPolicy, settings.blockMs);
+    receiver->setQueuePolicy(DualFrameReceiver::QUEUE_SCENE, settings.scenePolicy, settings.blockMs);
+    receiver->setQueuePolicy(DualFrameReceiver::QUEUE_WRITER, settings.writerPolicy, settings.blockMs);
+
+    receiver->setSyncPolicy(settings.syncPolicy);
+    receiver->setTraceFile(settings.traceFile);
+
     if(!receiver->init(bOnlyResults,
                        oput_parent_dir,
                        settings.eyeCamCalibFile,
@@ -518,7 +532,7 @@ bool init_video(const Settings &settings) {
     info[1].format	= FORMAT_MJPG;
 
     videoSync = new VideoSync();
-    if(!videoSync->init(info, receiver)) {
+    if(!videoSync->init(info, receiver, settings.maxSkewMs)) {
         std::cout << "main(): Could not initialise the video sync object" << std::endl;
         return false;
     }
@@ -542,25 +556,39 @@ void print_usage_info() {
 
 void collectFramesAndDrawGUI() {
 
-    /* Camera frames and tracking results */
-    OutputData *data = receiver->getNewestData();
+    /* Since the last frames were shown */
+    static utils::Timing timingPreview;
+
+    /* Camera frames and tracking results, at most at the preview rate */
+    OutputData *data = NULL;
+
+    if(timingPreview.getElapsedMicros() >= PreviewPeriodMs * 1000.0) {
+        data = receiver->getNewestData();
+    }
 
     // try to get the video frames
     if(data != NULL) {
 
+        timingPreview.markTime();
+
         // array of pointers to the frames
         CameraFrameExtended **frames = data->frames;
 
         /* pointers to the frames in data */
         CameraFrameExtended *img_eye	= frames[0];
-        CameraFrameExtended *img_scene	= frames[1];
+
+        // the scene frame is decoded only now, at about the size of the panel
+        CameraFrame *img_scene			= sceneDecoder->decode(*frames[1]);
+        const double sceneScale			= (double)img_scene->w / frames[1]->w;
 
         // draw the results
-        drawResults(img_eye, img_scene, data);
+        drawResults(img_eye, img_scene, sceneScale, data);
 
         // draw the GUI
         draw_GUI(img_eye, img_scene, data->res);
 
+        delete img_scene;
+
         /*
          * we must delete these images since the VideoHandler donated
          * them to us
@@ -570,7 +598,7 @@ void collectFramesAndDrawGUI() {
 
     }
 
-    /* There were no new frames in the receiver, just update the GUI */
+    /* There were no new frames in the receiver, show the last ones */
     else {
 
         // draw the GUI
@@ -583,13 +611,9 @@ void collectFramesAndDrawGUI() {
 
 void draw_GUI(CameraFrame *img_eye, CameraFrame *img_scene, const ResultData *res) {
 
-    if(img_eye != NULL && img_scene != NULL) {
-
-        // draw the frames to the GUI
-        panel_eye->draw(img_eye);
-        panel_scene->draw(img_scene);
-
-    }
+    // draw the frames to the GUI, or the last ones if NULL
+    panel_eye->draw(img_eye);
+    panel_scene->draw(img_scene);
 
     panel_settings->draw();
 
@@ -625,12 +649,16 @@ void draw_GUI(CameraFrame *img_eye, CameraFrame *img_scene, const ResultData *re
 }
 
 
-void drawResults(CameraFrameExtended *imgEye, CameraFrameExtended *imgScene, OutputData *data) {
+void drawResults(CameraFrameExtended *imgEye, CameraFrame *imgScene, double sceneScale, OutputData *data) {
 
     if(!data->res->bTrackSuccessfull) {
         //        return;
     }
 
+    // the frames may share their data with the video writer
+    imgEye->makeWritable();
+    imgScene->makeWritable();
+
 
     /************************************************************
      * All contours
@@ -648,13 +676,25 @@ void drawResults(CameraFrameExtended *imgEye, CameraFrameExtended *imgScene, Out
                       imgEye->w*imgEye->bpp	// bytes per row
                       );
 
-    // flip around y-axis
-    cv::flip(ocvImgEye, ocvImgEye, 1);
+    /*
+     * The frame is drawn as captured, the results are in the coordinates
+     * of the mirrored eye camera. The panel shows the frame mirrored.
+     */
+    const Camera *cam = receiver->getEyeCamera();
+    const int w = imgEye->w;
 
     if(listContours.size() > 0) {
 
+        std::vector<std::vector<cv::Point> > contours(listContours);
+
+        for(size_t i = 0; i < contours.size(); ++i) {
+            for(size_t j = 0; j < contours[i].size(); ++j) {
+                contours[i][j].x = (int)cam->mirrorX(contours[i][j].x, w);
+            }
+        }
+
         cv::drawContours(ocvImgEye,					// opencv image
-                         listContours,				// list of contours to be drawn
+                         contours,					// list of contours to be drawn
                          -1,							// draw all contours in the list
                          cv::Scalar(0, 255, 255),	// colour
                          2,							// thickness
@@ -666,7 +706,12 @@ void drawResults(CameraFrameExtended *imgEye, CameraFrameExtended *imgScene, Out
     /************************************************************
      * Pupil ellipse
      ************************************************************/
-    const cv::RotatedRect &ellipse_pupil = data->res->ellipsePupil;
+    cv::RotatedRect ellipse_pupil = data->res->ellipsePupil;
+    ellipse_pupil.center.x = (float)cam->mirrorX(ellipse_pupil.center.x, w);
+    if(cam->isMirrored()) {
+        ellipse_pupil.angle = -ellipse_pupil.angle;
+    }
+
     cv::ellipse(ocvImgEye,				// opencv image
                 ellipse_pupil,			// pupil ellipse
                 cv::Scalar(0, 0, 255),	// colour
@@ -681,7 +726,7 @@ void drawResults(CameraFrameExtended *imgEye, CameraFrameExtended *imgScene, Out
     if(crs.size()) {
         if(crs[0].x != -1) {
             for(int i = 0; i < (int)crs.size(); ++i) {
-                int x = (int)(crs[i].x + 0.5);
+                int x = (int)(cam->mirrorX(crs[i].x, w) + 0.5);
                 int y = (int)(crs[i].y + 0.5);
                 int x1 = x - 5;
                 int x2 = x + 5;
@@ -697,15 +742,20 @@ void drawResults(CameraFrameExtended *imgEye, CameraFrameExtended *imgScene, Out
     /************************************************************
      * Gaze vector
      ************************************************************/
+    const cv::Point &p1 = data->res->gazeVecStartPoint2D;
+    const cv::Point &p2 = data->res->gazeVecEndPoint2D;
+
     cv::line(ocvImgEye,
-             data->res->gazeVecStartPoint2D,
-             data->res->gazeVecEndPoint2D,
+             cv::Point((int)cam->mirrorX(p1.x, w), p1.y),
+             cv::Point((int)cam->mirrorX(p2.x, w), p2.y),
              cv::Scalar(0, 0, 255),
              3);
 
 
     /***************************************************************
-     * Draw the point in the scene frame
+     * Draw the point in the scene frame. The frame may be decoded at
+     * a smaller size, the points and the circles are scaled by
+     * sceneScale.
      **************************************************************/
 
     // make an openCV header of the frame
@@ -730,13 +780,15 @@ void drawResults(CameraFrameExtended *imgEye, CameraFrameExtended *imgScene, Out
     double kerroin = 0;
     int SHOW_FILTERED_POINT = 1;
 
+    const double s = sceneScale;
+
     for(int i = 0; i < (int)vec.size(); ++i) {
 
         cv::circle(ocvImgScene,
-                   vec[i],
-                   10,
+                   vec[i] * s,
+                   (int)(10 * s + 0.5),
                    cv::Scalar(255,0,0),
-                   2,
+                   std::max(1, (int)(2 * s + 0.5)),
                    CV_AA);
 	
         filteredPoint = filteredPoint + (i+1.0)/(vec.size()+1.0)*vec[i];
@@ -750,8 +802,8 @@ void drawResults(CameraFrameExtended *imgEye, CameraFrameExtended *imgScene, Out
     filteredPoint = filteredPoint * (1.0/(kerroin));
     
     if (SHOW_FILTERED_POINT)
-        cv::circle(ocvImgScene, filteredPoint, 20, cv::Scalar(0,255,0), 3, CV_AA);
-    cv::circle(ocvImgScene, data->res->scenePoint, 10, cv::Scalar(0,0,255), 2, CV_AA);
+        cv::circle(ocvImgScene, filteredPoint * s, (int)(20 * s + 0.5), cv::Scalar(0,255,0), std::max(1, (int)(3 * s + 0.5)), CV_AA);
+    cv::circle(ocvImgScene, data->res->scenePoint * s, (int)(10 * s + 0.5), cv::Scalar(0,0,255), std::max(1, (int)(2 * s + 0.5)), CV_AA);
 
 }
 
@@ -795,6 +847,9 @@ bool build_GUI(SettingsIO &settings) {
 
     panel_eye	= new gui::GLVideoCanvas(view1);
 
+    // the eye frames are shown mirrored like the eye camera, see drawResults()
+    panel_eye->setMirrored(receiver->getEyeCamera()->isMirrored());
+
 
     /*************************************************
      * Camera 2
@@ -808,6 +863,9 @@ bool build_GUI(SettingsIO &settings) {
 
     panel_scene	= new gui::GLVideoCanvas(view2);
 
+    // the scene frames are decoded for the panel
+    sceneDecoder = new PreviewDecoder(view2.w, view2.h);
+
 
     /*************************************************
      * Status bar panel
@@ -886,6 +944,7 @@ void quit() {
 
     delete panel_eye;
     delete panel_scene;
+    delete sceneDecoder;
     delete panel_statusbars;
     delete panel_settings;
     delete panelIdle;
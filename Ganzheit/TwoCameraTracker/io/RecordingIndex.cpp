@@ -0,0 +1,112 @@
+#include "RecordingIndex.h"
+#include <string.h>
+
+
+static const char MAGIC[4] = {'G', 'T', 'I', 'X'};
+
+
+const char *RecordingIndex::FILE_INDEX		= "index.idx";
+const char *RecordingIndex::FILE_EYE		= "camera1.mjpg";
+const char *RecordingIndex::FILE_SCENE		= "camera2.mjpg";
+const char *RecordingIndex::FILE_RESULTS	= "results.res";
+
+
+/* Write val to n bytes of buff, little-endian */
+static void toLE(uint64_t val, int n, char *buff) {
+
+	for(int i = 0; i < n; ++i) {
+		buff[i] = (char)((val >> (8 * i)) & 0xFF);
+	}
+
+}
+
+
+/* Read n little-endian bytes of buff */
+static uint64_t fromLE(const char *buff, int n) {
+
+	uint64_t val = 0;
+
+	for(int i = 0; i < n; ++i) {
+		val |= (uint64_t)(unsigned char)buff[i] << (8 * i);
+	}
+
+	return val;
+
+}
+
+
+IndexEntry::IndexEntry() {
+
+	stream		= STREAM_EYE;
+	w			= 0;
+	h			= 0;
+	id			= 0;
+	sz			= 0;
+	offset		= 0;
+	timestamp	= 0;
+
+}
+
+
+const char *RecordingIndex::getFileName(int stream) {
+
+	switch(stream) {
+
+		case IndexEntry::STREAM_EYE:		return FILE_EYE;
+		case IndexEntry::STREAM_SCENE:		return FILE_SCENE;
+		case IndexEntry::STREAM_RESULTS:	return FILE_RESULTS;
+		default:							return NULL;
+
+	}
+
+}
+
+
+void RecordingIndex::headerToBuffer(char *buff) {
+
+	memcpy(buff, MAGIC, 4);
+	toLE(VERSION, 4, buff + 4);
+
+}
+
+
+bool RecordingIndex::parseHeader(const char *buff, size_t len) {
+
+	if(len < HEADER_SIZE || memcmp(buff, MAGIC, 4) != 0) {
+		return false;
+	}
+
+	return fromLE(buff + 4, 4) == VERSION;
+
+}
+
+
+void RecordingIndex::entryToBuffer(const IndexEntry &entry, char *buff) {
+
+	memset(buff, 0, ENTRY_SIZE);
+
+	toLE(entry.stream,			1, buff);
+	toLE(entry.w,				2, buff + 2);
+	toLE(entry.h,				2, buff + 4);
+	toLE(entry.id,				4, buff + 8);
+	toLE(entry.sz,				4, buff + 12);
+	toLE(entry.offset,			8, buff + 16);
+	toLE(entry.timestamp,		8, buff + 24);
+
+}
+
+
+bool RecordingIndex::parseEntry(const char *buff, IndexEntry &entry) {
+
+	entry.stream	= (int)fromLE(buff, 1);
+	entry.w			= (int)fromLE(buff + 2, 2);
+	entry.h			= (int)fromLE(buff + 4, 2);
+	entry.id		= (uint32_t)fromLE(buff + 8, 4);
+	entry.sz		= (uint32_t)fromLE(buff + 12, 4);
+	entry.offset	= fromLE(buff + 16, 8);
+	entry.timestamp	= (int64_t)fromLE(buff + 24, 8);
+
+	return getFileName(entry.stream) != NULL;
+
+}
+
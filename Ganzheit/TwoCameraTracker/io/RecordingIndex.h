@@ -0,0 +1,108 @@
+#ifndef RECORDING_INDEX_H
+#define RECORDING_INDEX_H
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+/*
+ * An entry of the side index of a recording: where a frame or a result
+ * packet is in its stream file.
+ */
+class IndexEntry {
+
+	public:
+
+		enum Stream {
+
+			STREAM_EYE,		// camera1.mjpg
+			STREAM_SCENE,	// camera2.mjpg
+			STREAM_RESULTS	// results.res
+
+		};
+
+		IndexEntry();
+
+		int stream;				// see Stream
+		int w, h;				// frame size, 0 for the results and if unknown
+		uint32_t id;			// frame pair id, for the results that of their frame
+		uint32_t sz;			// size in bytes in the stream
+		uint64_t offset;		// from the beginning of the stream file
+		int64_t timestamp;		// capture time in microseconds, 0 if unknown
+
+};
+
+
+/*
+ * The side index VideoWriter writes to index.idx in each partX folder of
+ * a recording. It has an entry for each frame and result packet written
+ * to the streams of the folder, in the order they were written. The
+ * file begins with a header, followed by the entries. All members are
+ * little-endian:
+ *
+ *   ----------------------|-----------------------|-----------------------
+ *   | Parameter           | Description           | Number of bytes      |
+ *   **********************************************************************
+ *   | Header              | "GTIX" and VERSION    | 4 + 4 bytes          |
+ *   ----------------------|-----------------------|-----------------------
+ *   | Stream              | see IndexEntry        | 1 byte               |
+ *   ----------------------|-----------------------|-----------------------
+ *   | Reserved            |                       | 1 byte               |
+ *   ----------------------|-----------------------|-----------------------
+ *   | Width, height       | frame size            | 2 * 2 bytes          |
+ *   ----------------------|-----------------------|-----------------------
+ *   | Reserved            |                       | 2 bytes              |
+ *   ----------------------|-----------------------|-----------------------
+ *   | ID                  | frame pair id         | 4 bytes              |
+ *   ----------------------|-----------------------|-----------------------
+ *   | Size                | bytes in the stream   | 4 bytes              |
+ *   ----------------------|-----------------------|-----------------------
+ *   | Offset              | bytes from the        | 8 bytes              |
+ *   |                     | beginning of the file |                      |
+ *   ----------------------|-----------------------|-----------------------
+ *   | Time stamp          | capture time in       | 8 bytes              |
+ *   |                     | microseconds          |                      |
+ *   ----------------------------------------------------------------------
+ *
+ * An entry is written after the data it points to, so after a crash
+ * the last entries may point past the end of the streams.
+ */
+class RecordingIndex {
+
+	public:
+
+		enum LIMITS {
+
+			VERSION			= 1,
+			HEADER_SIZE		= 8,
+			ENTRY_SIZE		= 32
+
+		};
+
+		/* The file names in each partX folder */
+		static const char *FILE_INDEX;
+		static const char *FILE_EYE;
+		static const char *FILE_SCENE;
+		static const char *FILE_RESULTS;
+
+		/* The stream file of IndexEntry::Stream */
+		static const char *getFileName(int stream);
+
+		/* buff must hold HEADER_SIZE bytes */
+		static void headerToBuffer(char *buff);
+
+		/* Returns false if this is not an index of a known version */
+		static bool parseHeader(const char *buff, size_t len);
+
+		/* buff must hold ENTRY_SIZE bytes */
+		static void entryToBuffer(const IndexEntry &entry, char *buff);
+
+		/* buff must hold ENTRY_SIZE bytes. Returns false if the stream is unknown. */
+		static bool parseEntry(const char *buff, IndexEntry &entry);
+
+};
+
+
+#endif
+
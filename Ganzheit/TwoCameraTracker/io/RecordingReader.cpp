@@ -0,0 +1,495 @@
+#include "RecordingReader.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sstream>
+#include <algorithm>
+
+
+/* Read a 2-byte big-endian value, the byte order of the JPEG markers */
+static int BE_2_BYTES(const unsigned char *buff) {
+
+	return (buff[0] << 8) | buff[1];
+
+}
+
+
+/*
+ * Find the JPEG image beginning at or after pos. On success begin and
+ * end are the first byte and one past the last byte of the image, and w
+ * and h the size from the start of frame marker, or 0 if there is none.
+ */
+static bool findJPEG(const unsigned char *data, size_t sz, size_t pos,
+					 size_t &begin, size_t &end, int &w, int &h) {
+
+	// the start of image marker
+	while(pos + 1 < sz && !(data[pos] == 0xFF && data[pos + 1] == 0xD8)) {
+		++pos;
+	}
+
+	if(pos + 1 >= sz) {
+		return false;
+	}
+
+	begin = pos;
+	w = h = 0;
+
+	size_t i = pos + 2;
+
+	while(i + 1 < sz) {
+
+		if(data[i] != 0xFF) {
+			return false;
+		}
+
+		const int marker = data[i + 1];
+
+		// fill bytes
+		if(marker == 0xFF) {
+			++i;
+			continue;
+		}
+
+		// end of image
+		if(marker == 0xD9) {
+			end = i + 2;
+			return true;
+		}
+
+		// the markers without a length
+		if(marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+			i += 2;
+			continue;
+		}
+
+		if(i + 4 > sz) {
+			return false;
+		}
+
+		const size_t len = BE_2_BYTES(data + i + 2);
+
+		// start of frame, except DHT, JPG and DAC
+		if(marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC && i + 9 <= sz) {
+			h = BE_2_BYTES(data + i + 5);
+			w = BE_2_BYTES(data + i + 7);
+		}
+
+		i += 2 + len;
+
+		// the entropy-coded data of a scan ends at a marker other than a restart
+		if(marker == 0xDA) {
+
+			while(i + 1 < sz && !(data[i] == 0xFF && data[i + 1] != 0x00 &&
+								  !(data[i + 1] >= 0xD0 && data[i + 1] <= 0xD7))) {
+				++i;
+			}
+
+		}
+
+	}
+
+	return false;
+
+}
+
+
+
+/******************************************************************
+ * RecordingReader class
+ ******************************************************************/
+
+RecordingReader::Frame::Frame() {
+
+	data		= NULL;
+	sz			= 0;
+	w			= 0;
+	h			= 0;
+	timestamp	= 0;
+
+}
+
+
+RecordingReader::Location::Location() {
+
+	file		= -1;
+	offset		= 0;
+	sz			= 0;
+	w			= 0;
+	h			= 0;
+	timestamp	= 0;
+
+}
+
+
+RecordingReader::RecordingReader() {
+
+	firstId = 0;
+	nextScanIds[0] = nextScanIds[1] = 0;
+
+}
+
+
+RecordingReader::~RecordingReader() {
+
+	close();
+
+}
+
+
+bool RecordingReader::open(const std::string &dir) {
+
+	close();
+
+	std::map<uint32_t, Pair> pairsById;
+
+	for(int part = 0; ; ++part) {
+
+		std::stringstream ss;
+		ss << dir << "part" << part << "/";
+
+		if(!openPart(ss.str(), pairsById)) {
+
+			if(part == 0) {
+				printf("RecordingReader::open(): Could not read %s\n", ss.str().c_str());
+				close();
+				return false;
+			}
+
+			break;
+
+		}
+
+	}
+
+
+	// only the complete pairs, the other half of a pair might have been dropped
+	std::map<uint32_t, Pair>::const_iterator it;
+	for(it = pairsById.begin(); it != pairsById.end(); ++it) {
+
+		if(it->second.eye.file != -1 && it->second.scene.file != -1) {
+			pairs.push_back(it->second);
+		}
+
+	}
+
+	if(pairs.empty()) {
+		return true;
+	}
+
+	firstId = pairs.front().id;
+	pairById.assign(pairs.back().id - firstId + 1, -1);
+
+	for(size_t i = 0; i < pairs.size(); ++i) {
+		pairById[pairs[i].id - firstId] = (int)i;
+	}
+
+	return true;
+
+}
+
+
+void RecordingReader::close() {
+
+	for(size_t i = 0; i < files.size(); ++i) {
+		delete files[i];
+	}
+
+	files.clear();
+	pairs.clear();
+	pairById.clear();
+
+	firstId = 0;
+	nextScanIds[0] = nextScanIds[1] = 0;
+
+}
+
+
+bool RecordingReader::find(uint32_t id, size_t &n) const {
+
+	if(id < firstId || id - firstId >= pairById.size() || pairById[id - firstId] == -1) {
+		return false;
+	}
+
+	n = pairById[id - firstId];
+
+	return true;
+
+}
+
+
+bool RecordingReader::getFrames(size_t n, Frame &eye, Frame &scene) const {
+
+	if(n >= pairs.size()) {
+		return false;
+	}
+
+	getFrame(pairs[n].eye, eye);
+	getFrame(pairs[n].scene, scene);
+
+	return true;
+
+}
+
+
+bool RecordingReader::getResults(size_t n, ResultData &data) const {
+
+	data.clear();
+
+	if(n >= pairs.size() || pairs[n].results.file == -1) {
+		return false;
+	}
+
+	const Location &loc = pairs[n].results;
+
+	return BinaryResultParser::parsePacket(files[loc.file]->data + loc.offset, loc.sz, data);
+
+}
+
+
+void RecordingReader::getFrame(const Location &loc, Frame &frame) const {
+
+	frame.data		= (const unsigned char *)files[loc.file]->data + loc.offset;
+	frame.sz		= loc.sz;
+	frame.w			= loc.w;
+	frame.h			= loc.h;
+	frame.timestamp	= loc.timestamp;
+
+}
+
+
+bool RecordingReader::openPart(const std::string &partDir, std::map<uint32_t, Pair> &pairsById) {
+
+	// the stream files in the order of IndexEntry::Stream
+	int streamFiles[3];
+
+	for(int stream = IndexEntry::STREAM_EYE; stream <= IndexEntry::STREAM_RESULTS; ++stream) {
+
+		streamFiles[stream] = mapFile(partDir + RecordingIndex::getFileName(stream));
+
+		if(streamFiles[stream] == -1) {
+			return false;
+		}
+
+	}
+
+
+	MappedFile index;
+	if(index.map(partDir + RecordingIndex::FILE_INDEX)) {
+		return readIndex(index, streamFiles, pairsById);
+	}
+
+
+	// recorded without an index
+	return scanFrames(IndexEntry::STREAM_EYE, streamFiles[IndexEntry::STREAM_EYE], pairsById)		&&
+		   scanFrames(IndexEntry::STREAM_SCENE, streamFiles[IndexEntry::STREAM_SCENE], pairsById)	&&
+		   scanResults(streamFiles[IndexEntry::STREAM_RESULTS], pairsById);
+
+}
+
+
+int RecordingReader::mapFile(const std::string &path) {
+
+	MappedFile *file = new MappedFile();
+
+	if(!file->map(path)) {
+		delete file;
+		return -1;
+	}
+
+	files.push_back(file);
+
+	return (int)files.size() - 1;
+
+}
+
+
+bool RecordingReader::readIndex(const MappedFile &index, const int streamFiles[3], std::map<uint32_t, Pair> &pairsById) {
+
+	if(!RecordingIndex::parseHeader(index.data, index.sz)) {
+		printf("RecordingReader::readIndex(): Not an index\n");
+		return false;
+	}
+
+	// a partial entry at the end is ignored
+	const size_t nofEntries = (index.sz - RecordingIndex::HEADER_SIZE) / RecordingIndex::ENTRY_SIZE;
+
+	for(size_t i = 0; i < nofEntries; ++i) {
+
+		IndexEntry entry;
+
+		if(!RecordingIndex::parseEntry(index.data + RecordingIndex::HEADER_SIZE + i * RecordingIndex::ENTRY_SIZE, entry)) {
+			printf("RecordingReader::readIndex(): Unknown stream %d\n", entry.stream);
+			continue;
+		}
+
+		const int file = streamFiles[entry.stream];
+
+		// written before the crash of the recorder, but not the data
+		if(entry.offset + entry.sz > files[file]->sz) {
+			continue;
+		}
+
+		add(entry, file, pairsById);
+
+	}
+
+	return true;
+
+}
+
+
+bool RecordingReader::scanFrames(int stream, int file, std::map<uint32_t, Pair> &pairsById) {
+
+	const unsigned char *data = (const unsigned char *)files[file]->data;
+	const size_t sz = files[file]->sz;
+
+	size_t pos = 0;
+	size_t begin, end;
+	int w, h;
+
+	while(findJPEG(data, sz, pos, begin, end, w, h)) {
+
+		IndexEntry entry;
+		entry.stream	= stream;
+		entry.w			= w;
+		entry.h			= h;
+		entry.id		= nextScanIds[stream]++;
+		entry.sz		= (uint32_t)(end - begin);
+		entry.offset	= begin;
+
+		add(entry, file, pairsById);
+
+		pos = end;
+
+	}
+
+	return true;
+
+}
+
+
+bool RecordingReader::scanResults(int file, std::map<uint32_t, Pair> &pairsById) {
+
+	const char *data = files[file]->data;
+	const size_t sz = files[file]->sz;
+
+	size_t pos = 0;
+
+	while(pos < sz) {
+
+		IndexEntry entry;
+		entry.stream = IndexEntry::STREAM_RESULTS;
+		entry.offset = pos;
+
+		unsigned long id;
+
+		if(!BinaryResultParser::parseHeader(data + pos, (int)std::min(sz - pos, (size_t)0x7FFFFFFF), entry.sz, id) ||
+		   entry.sz > sz - pos) {
+
+			// the recorder was stopped in the middle of a packet
+			printf("RecordingReader::scanResults(): Broken packet at %lu\n", (unsigned long)pos);
+			break;
+
+		}
+
+		entry.id = (uint32_t)id;
+
+		add(entry, file, pairsById);
+
+		pos += entry.sz;
+
+	}
+
+	return true;
+
+}
+
+
+void RecordingReader::add(const IndexEntry &entry, int file, std::map<uint32_t, Pair> &pairsById) {
+
+	Pair &pair = pairsById[entry.id];
+	pair.id = entry.id;
+
+	Location *loc;
+
+	switch(entry.stream) {
+
+		case IndexEntry::STREAM_EYE:	loc = &pair.eye;		break;
+		case IndexEntry::STREAM_SCENE:	loc = &pair.scene;		break;
+		default:						loc = &pair.results;	break;
+
+	}
+
+	loc->file		= file;
+	loc->offset		= entry.offset;
+	loc->sz			= entry.sz;
+	loc->w			= entry.w;
+	loc->h			= entry.h;
+	loc->timestamp	= entry.timestamp;
+
+}
+
+
+
+/******************************************************************
+ * MappedFile class
+ ******************************************************************/
+
+RecordingReader::MappedFile::MappedFile() {
+
+	data	= NULL;
+	sz		= 0;
+
+}
+
+
+RecordingReader::MappedFile::~MappedFile() {
+
+	if(data != NULL) {
+		munmap((void *)data, sz);
+	}
+
+}
+
+
+bool RecordingReader::MappedFile::map(const std::string &path) {
+
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if(fd == -1) {
+		return false;
+	}
+
+	struct stat myStat;
+	if(fstat(fd, &myStat) != 0) {
+		::close(fd);
+		return false;
+	}
+
+	sz = (size_t)myStat.st_size;
+
+	// an empty file cannot be mapped, and there is nothing to read
+	if(sz > 0) {
+
+		void *ptr = mmap(NULL, sz, PROT_READ, MAP_PRIVATE, fd, 0);
+
+		if(ptr == MAP_FAILED) {
+			printf("RecordingReader::MappedFile::map(): Could not map %s\n", path.c_str());
+			::close(fd);
+			sz = 0;
+			return false;
+		}
+
+		data = (const char *)ptr;
+
+	}
+
+	// the mapping stays after closing
+	::close(fd);
+
+	return true;
+
+}
+
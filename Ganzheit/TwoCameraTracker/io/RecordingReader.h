@@ -0,0 +1,154 @@
+#ifndef RECORDING_READER_H
+#define RECORDING_READER_H
+
+
+#include <string>
+#include <vector>
+#include <map>
+#include "RecordingIndex.h"
+#include "BinaryResultParser.h"
+
+
+/*
+ * Reads a recording of VideoWriter, the folder containing the part0,
+ * part1... sub-folders. The stream files of the parts are memory-mapped
+ * and the frame pairs are looked up through index.idx, so any pair and
+ * its results are got in constant time. The parts without an index,
+ * i.e. the recordings made before it, are indexed when opened by
+ * walking the JPEG markers of the frames and the sizes of the result
+ * packets; their frame pairs are numbered in order from 0 and their
+ * timestamps are not known.
+ *
+ * The data of the frames is valid until close(). The reader does not
+ * change after open(), so several threads can read it at once.
+ */
+class RecordingReader {
+
+	public:
+
+		/* A compressed frame in the mapped stream */
+		class Frame {
+
+			public:
+
+				Frame();
+
+				const unsigned char *data;
+				size_t sz;
+				int w, h;				// 0 if unknown
+				int64_t timestamp;		// capture time in microseconds, 0 if unknown
+
+		};
+
+
+		RecordingReader();
+		~RecordingReader();
+
+		/*
+		 * Open the recording in dir, which must contain the trailing '/'.
+		 * Fails if part0 cannot be read.
+		 */
+		bool open(const std::string &dir);
+
+		/* Unmap the files */
+		void close();
+
+		/* The number of complete frame pairs, in the order of their ids */
+		size_t getNofPairs() const {return pairs.size();}
+
+		/* The id of the n-th pair */
+		uint32_t getId(size_t n) const {return pairs[n].id;}
+
+		/* The position of the pair with the id. Returns false if there is none. */
+		bool find(uint32_t id, size_t &n) const;
+
+		/* The frames of the n-th pair */
+		bool getFrames(size_t n, Frame &eye, Frame &scene) const;
+
+		/* The results of the n-th pair. Returns false if the pair has none. */
+		bool getResults(size_t n, ResultData &data) const;
+
+	private:
+
+		/* Not copyable, the frames point to the mapped files */
+		RecordingReader(const RecordingReader &);
+		RecordingReader &operator=(const RecordingReader &);
+
+
+		/* A read-only memory-mapped file */
+		class MappedFile {
+
+			public:
+
+				MappedFile();
+				~MappedFile();
+
+				bool map(const std::string &path);
+
+				const char *data;
+				size_t sz;
+
+		};
+
+
+		/* Where an entry of the index is */
+		class Location {
+
+			public:
+
+				Location();
+
+				int file;				// in files, -1 if none
+				uint64_t offset;
+				uint32_t sz;
+				int w, h;
+				int64_t timestamp;
+
+		};
+
+
+		class Pair {
+
+			public:
+
+				uint32_t id;
+				Location eye;
+				Location scene;
+				Location results;
+
+		};
+
+
+		bool openPart(const std::string &partDir, std::map<uint32_t, Pair> &pairsById);
+
+		/* Map the stream file, returns the position in files or -1 */
+		int mapFile(const std::string &path);
+
+		bool readIndex(const MappedFile &index, const int streamFiles[3], std::map<uint32_t, Pair> &pairsById);
+
+		/* Index the part without index.idx */
+		bool scanFrames(int stream, int file, std::map<uint32_t, Pair> &pairsById);
+		bool scanResults(int file, std::map<uint32_t, Pair> &pairsById);
+
+		void add(const IndexEntry &entry, int file, std::map<uint32_t, Pair> &pairsById);
+
+		void getFrame(const Location &loc, Frame &frame) const;
+
+
+		std::vector<MappedFile *> files;
+
+		/* The complete pairs sorted by id */
+		std::vector<Pair> pairs;
+
+		/* The position of the pair in pairs by its id - firstId, -1 if none */
+		std::vector<int> pairById;
+		uint32_t firstId;
+
+		/* The next ids of the scanned frames */
+		uint32_t nextScanIds[2];
+
+};
+
+
+#endif
+
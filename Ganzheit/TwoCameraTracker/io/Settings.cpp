@@ -1,5 +1,6 @@
 #include "Settings.h"
 #include <vector>
+#include <stdlib.h>
 
 
 /*
@@ -10,6 +11,9 @@
 static const int NOF_SETTINGS = 3;
 
 
+const double Settings::DEFAULT_MAX_SKEW = 16.0;
+
+
 bool Settings::readSettings(const char *fname) {
 
 	// create the xml reader instance
@@ -82,6 +86,85 @@ bool Settings::readSettings(const char *fname) {
 
 	}
 
+
+	// optional
+	const std::string strSkew = getString(rootElement, "input_devices", "maxSkew");
+
+	maxSkewMs = strSkew.empty() ? DEFAULT_MAX_SKEW : atof(strSkew.c_str());
+
+	if(maxSkewMs <= 0.0) {
+
+		printf("Settings::readSettings(): invalid maxSkew %s\n", strSkew.c_str());
+
+		return false;
+
+	}
+
+
+	// optional
+	const std::string strSync = getString(rootElement, "output", "sync");
+
+	syncPolicy = SegmentWriter::SYNC_NONE;
+
+	if(!strSync.empty() && !SegmentWriter::parse(strSync.c_str(), syncPolicy)) {
+
+		printf("Settings::readSettings(): unknown sync %s, use none, segment or batch\n", strSync.c_str());
+
+		return false;
+
+	}
+
+
+	// optional
+	traceFile = getString(rootElement, "output", "trace");
+
+
+	// optional
+	if(!getPolicy(rootElement, "tracker", trackerPolicy) ||
+	   !getPolicy(rootElement, "scene", scenePolicy) ||
+	   !getPolicy(rootElement, "writer", writerPolicy)) {
+
+		return false;
+
+	}
+
+	const std::string strBlockMs = getString(rootElement, "queues", "blockMs");
+
+	blockMs = strBlockMs.empty() ? (int)QueuePolicy::DEFAULT_BLOCK_MS : atoi(strBlockMs.c_str());
+
+	if(blockMs <= 0) {
+
+		printf("Settings::readSettings(): invalid blockMs %s\n", strBlockMs.c_str());
+
+		return false;
+
+	}
+
+	return true;
+
+}
+
+
+bool Settings::getPolicy(TiXmlElement *rootElement, const char *param, QueuePolicy::Type &type) {
+
+	const std::string str = getString(rootElement, "queues", param);
+
+	if(str.empty()) {
+
+		type = QueuePolicy::POLICY_DROP_NEWEST;
+
+		return true;
+
+	}
+
+	if(!QueuePolicy::parse(str.c_str(), type)) {
+
+		printf("Settings::getPolicy(): unknown policy %s for %s, use block, dropOldest, dropNewest or latest\n", str.c_str(), param);
+
+		return false;
+
+	}
+
 	return true;
 
 }
@@ -4,6 +4,8 @@
 
 #include <string>
 #include <tinyxml.h>
+#include "QueuePolicy.h"
+#include "SegmentWriter.h"
 
 
 /*
@@ -13,11 +15,14 @@
  *
  *		<settings id="output">
  *			<directory value="somedir" />
+ *			<sync value="segment" />
+ *			<trace value="trace.json" />
  *		</settings>
  *
  *		<settings id="input_devices">
  *			<dev1 value="video1" />
  *			<dev2 value="video2" />
+ *			<maxSkew value="16" />
  *		</settings>
  *
  *		<settings id="input_files">
@@ -27,6 +32,13 @@
  *			<mapper value = "mapper.yaml" />
  *		</settings>
  *
+ *		<settings id="queues">
+ *			<tracker value="latest" />
+ *			<scene value="dropOldest" />
+ *			<writer value="block" />
+ *			<blockMs value="20" />
+ *		</settings>
+ *
  *	</document>
  */
 class Settings {
@@ -41,6 +53,14 @@ class Settings {
 		std::string dev1;
 		std::string dev2;
 
+		/*
+		 * Maximum difference of the capture times of a frame pair, in
+		 * milliseconds. Optional, defaults to DEFAULT_MAX_SKEW.
+		 */
+		double maxSkewMs;
+
+		static const double DEFAULT_MAX_SKEW;
+
 
 		/*
 		 * Directory for the output files:
@@ -50,6 +70,18 @@ class Settings {
 		 */
 		std::string oput_dir;
 
+		/*
+		 * When the recording is synced to the disk, see SegmentWriter.
+		 * Optional, left to the kernel by default.
+		 */
+		SegmentWriter::SyncPolicy syncPolicy;
+
+		/*
+		 * A file for the times of the tracking stages in the Chrome
+		 * trace format, see gt::StageTrace. Optional, empty if none.
+		 */
+		std::string traceFile;
+
 
 		/* Gaze tracker settings file */
 		std::string gazetrackerFile;
@@ -63,11 +95,27 @@ class Settings {
 		/* The transformation matrix between the eye and the scene cameras */
 		std::string mapperFile;
 
+
+		/*
+		 * What to do when the queues of the tracker, the scene frames
+		 * and the writer are full, see QueuePolicy. Optional, the
+		 * newest frames are dropped by default.
+		 */
+		QueuePolicy::Type trackerPolicy;
+		QueuePolicy::Type scenePolicy;
+		QueuePolicy::Type writerPolicy;
+
+		/* How long the "block" policy waits for room, in milliseconds */
+		int blockMs;
+
 	private:
 
 		/* Get a string corresponding the attribute and parameter */
 		std::string getString(TiXmlElement *rootElement, const char *attr, const char *param);
 
+		/* Get the optional queue policy of the parameter */
+		bool getPolicy(TiXmlElement *rootElement, const char *param, QueuePolicy::Type &type);
+
 };
 
 
@@ -1,8 +1,24 @@
 #include "ResultStreamer.h"
 #include <sys/stat.h>
 #include <iostream>
+#include <algorithm>
 
 
+/* If the recording has no timestamps */
+static const int DEFAULT_FPS = 30;
+
+
+/* Decode a compressed frame of the recording to BGR */
+static bool decode(const RecordingReader::Frame &frame, cv::Mat &img) {
+
+    const cv::Mat buff(1, (int)frame.sz, CV_8UC1, (void *)frame.data);
+
+    img = cv::imdecode(buff, 1);
+
+    return !img.empty();
+
+}
+
 
 ResultStreamer::ResultStreamer() {
 
@@ -14,7 +30,6 @@ ResultStreamer::ResultStreamer() {
 bool ResultStreamer::init(const std::string &_folder) {
 
     framePos = 0;
-    prevDataPacket = ResultData();
 
     parentDir = _folder;
 
@@ -26,51 +41,77 @@ bool ResultStreamer::init(const std::string &_folder) {
 
     }
 
-    if(!eyeStream.init(parentDir, std::string("camera1.mjpg"))) {
+    return reader.open(parentDir);
 
-        return false;
-
-    }
-
-    if(!sceneStream.init(parentDir, "camera2.mjpg")) {
-
-        return false;
+}
 
-    }
 
-	if(!resStream.init(parentDir, "results.res")) {
+bool ResultStreamer::reset() {
 
-		return false;
-	}
+    framePos = 0;
 
     return true;
 
 }
 
 
-bool ResultStreamer::reset() {
+bool ResultStreamer::seek(unsigned long id) {
+
+    size_t n;
+    if(!reader.find((uint32_t)id, n)) {
+        return false;
+    }
+
+    framePos = n;
 
-    return init(parentDir);
+    return true;
 
 }
 
 
 int ResultStreamer::getFourCC() {
-    return static_cast<int>(sceneStream.cap.get(CV_CAP_PROP_FOURCC));
+    return CV_FOURCC('M','J','P','G');
 }
 
 
 cv::Size ResultStreamer::getDim() {
 
-    return cv::Size((int) sceneStream.cap.get(CV_CAP_PROP_FRAME_WIDTH),
-                    (int) sceneStream.cap.get(CV_CAP_PROP_FRAME_HEIGHT));
+    RecordingReader::Frame eye, scene;
+    if(!reader.getFrames(0, eye, scene)) {
+        return cv::Size(0, 0);
+    }
+
+    if(scene.w != 0) {
+        return cv::Size(scene.w, scene.h);
+    }
+
+    // not found when the recording was indexed
+    cv::Mat img;
+    decode(scene, img);
+
+    return img.size();
 
 }
 
 
 int ResultStreamer::getFps() {
 
-    return sceneStream.cap.get(CV_CAP_PROP_FPS);
+    const size_t n = reader.getNofPairs();
+
+    RecordingReader::Frame eyeFirst, sceneFirst, eyeLast, sceneLast;
+    if(!reader.getFrames(0, eyeFirst, sceneFirst) || !reader.getFrames(n - 1, eyeLast, sceneLast)) {
+        return DEFAULT_FPS;
+    }
+
+    if(sceneFirst.timestamp == 0 || sceneLast.timestamp <= sceneFirst.timestamp) {
+        return DEFAULT_FPS;
+    }
+
+    // the ids count the pairs dropped by the recorder too
+    const double dur = 1e-6 * (sceneLast.timestamp - sceneFirst.timestamp);
+    const double nofIntervals = reader.getId(n - 1) - reader.getId(0);
+
+    return std::max(1, (int)(nofIntervals / dur + 0.5));
 
 }
 
@@ -79,34 +120,23 @@ int ResultStreamer::get(cv::Mat &imgEye, cv::Mat &imgScene, ResultData &data) {
 
     data.clear();
 
-    bool bSceneStreamOk = sceneStream.getNextFrame(imgScene);
-    bool bEyeStreamOk   = eyeStream.getNextFrame(imgEye);
-
-    // if just one of them is ok, there is an error
-    if((bSceneStreamOk && !bEyeStreamOk) || (!bSceneStreamOk && bEyeStreamOk)) {
-        return STREAM_ERROR;
-    }
-
-    if(!bSceneStreamOk && !bEyeStreamOk) {
+    if(framePos >= reader.getNofPairs()) {
         return STREAM_FINISHED;
     }
 
+    RecordingReader::Frame eye, scene;
+    reader.getFrames(framePos, eye, scene);
 
-    // get new data only if the current frame position exceeds the previous data id
-    if(prevDataPacket.id < framePos || framePos == 0) {
-
-        bool bResStreamOk = resStream.getNextDataPacket(prevDataPacket);
-        if(!bResStreamOk) {
+    if(!decode(eye, imgEye) || !decode(scene, imgScene)) {
 
-            return STREAM_ERROR;
+        printf("ResultStreamer::get(): Could not decode the frames %lu\n", (unsigned long)reader.getId(framePos));
 
-        }
+        return STREAM_ERROR;
 
     }
 
-    if(prevDataPacket.id == framePos) {
-        data = prevDataPacket;
-    }
+    // the pair might have no results
+    reader.getResults(framePos, data);
 
     ++framePos;
 
@@ -125,191 +155,3 @@ bool ResultStreamer::exists(const std::string &dir) {
     return false;
 
 }
-
-
-
-
-/******************************************************************
- * DataStream class
- ******************************************************************/
-
-bool DataStream::init(const std::string &folder, const std::string &_fileName) {
-
-    folderID = -1;
-
-    // the parent folder, the one that containes part0, part1...
-    parentDir = folder;
-
-    // the file name in each partX, e.g. camera1.mjpg
-    fileName = _fileName;
-
-    return true;
-
-}
-
-
-std::string DataStream::getNextFileName() {
-
-    // increase the id and create create a new file name
-    ++folderID;
-
-    std::stringstream ss;
-    ss << parentDir << "part" << folderID << "/" << fileName;
-
-    return ss.str();
-
-}
-
-
-
-/******************************************************************
- * VideoStream class, extends DataStream
- ******************************************************************/
-
-bool VideoStream::init(const std::string &folder, const std::string &_fileName) {
-
-    // call parent function
-    if(!DataStream::init(folder, _fileName)) {
-        return false;
-    }
-
-    std::string path = getNextFileName();
-
-    cap.release();
-    cap.open(path);
-
-    return cap.isOpened();
-
-}
-
-
-bool VideoStream::getNextFrame(cv::Mat &frame) {
-
-    cap >> frame;
-
-    // if the frame is empty, change to a new file, if exists, and try again
-    if(frame.empty()) {
-
-        std::string path = getNextFileName();
-        cap.release();
-        cap.open(path);
-
-        if(!cap.isOpened()) {
-
-            return false;
-
-        }
-
-        cap >> frame;
-
-    }
-
-
-    return !frame.empty();
-
-}
-
-
-
-
-/******************************************************************
- * ResultStream class, extends DataStream
- ******************************************************************/
-
-
-bool ResultStream::init(const std::string &folder, const std::string &_fileName) {
-
-    if(!DataStream::init(folder, _fileName)) {
-        return false;
-    }
-
-    resIn.close();
-    resIn.clear();
-
-    std::string path = getNextFileName();
-    resIn.open(path.c_str(), std::ifstream::binary);
-    resIn.seekg(0);
-
-    return resIn.is_open();
-
-}
-
-
-bool ResultStream::getNextDataPacket(ResultData &data) {
-
-	int32_t packetSz;
-	resIn.read((char *)&packetSz, 4);
-
-	int nRead = resIn.gcount();
-	if(nRead != 4) {
-
-        // nRead can be zero only if eof() was reached, otherwise there is a seious error
-        if(resIn.eof()) {
-
-            resIn.close();
-            resIn.clear();
-
-            std::string path = getNextFileName();
-            resIn.open(path.c_str());
-            resIn.seekg(0);
-
-            if(!resIn.is_open()) {
-
-                printf("ResultStream::getNextDataPacket(): Error opening the next file \"%s\"\n", path.c_str());
-                return false;
-
-            }
-
-
-            resIn.read((char *)&packetSz, 4);
-
-            int nRead = resIn.gcount();
-            if(nRead != 4) {
-                printf("ResultStream::getNextDataPacket(): could not read packet size in new file\n");
-                return false;
-            }
-
-        }
-        else { // nRead != 4 although eof() was not reached
-            printf("ResultStream::getNextDataPacket(): could not read packet size\n");
-            return false;
-        }
-
-	}
-
-
-	const char *tmp = (char *)&packetSz;
-	packetSz = (tmp[0] & 0x000000FF)       |
-			   (tmp[1] & 0x000000FF) << 8  |
-			   (tmp[2] & 0x000000FF) << 16 |
-			   (tmp[3] & 0x000000FF) << 24;
-
-	if(packetSz < BinaryResultParser::MIN_BYTES) {
-        printf("ResultStream::getNextDataPacket(): packet size too small\n");
-		return false;
-	}
-
-	std::vector<char> packet(packetSz);
-	memcpy(packet.data(), tmp, 4);
-
-	// read the rest
-	resIn.read(packet.data() + 4, packet.size() - 4);
-
-	nRead = resIn.gcount();
-	if(nRead != (int)packet.size() - 4) {
-        printf("ResultStream::getNextDataPacket(): could not read the rest\n");
-		return false;
-	}
-
-
-	bool res = BinaryResultParser::parsePacket(packet.data(), packet.size(), data);
-
-	if(!res) {
-		printf("BinaryResultParser::parsePacket() failed\n");
-		return false;
-	}
-
-    return true;
-
-}
-
@@ -5,64 +5,13 @@
 #include <string>
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/highgui/highgui.hpp>
-#include "BinaryResultParser.h"
-#include <fstream>
-
-
-
-class DataStream {
-
-public:
-
-    virtual bool init(const std::string &folder, const std::string &_fileName);
-
-
-protected:
-
-    std::string getNextFileName();
-
-private:
-
-
-
-    std::string fileName;
-
-    /* partX, X is the folder id */
-    int folderID;
-
-    std::string parentDir;
-
-};
-
-
-class VideoStream : public DataStream {
-
-public:
-
-    bool init(const std::string &folder, const std::string &_fileName);
-
-    bool getNextFrame(cv::Mat &frame);
-
-	cv::VideoCapture cap;
-
-};
-
-
-class ResultStream : public DataStream {
-
-public:
-
-    bool init(const std::string &folder, const std::string &_filename);
-
-    bool getNextDataPacket(ResultData &data);
-
-private:
-
-    std::ifstream resIn;
-
-};
+#include "RecordingReader.h"
 
 
+/*
+ * Streams the frame pairs of a recording and their results, decoded to
+ * BGR. See RecordingReader.
+ */
 class ResultStreamer {
 
     public:
@@ -84,6 +33,9 @@ class ResultStreamer {
 
     int get(cv::Mat &imgEye, cv::Mat &imgScene, ResultData &data);
 
+    /* Continue from the frame pair with the id. Returns false if there is none. */
+    bool seek(unsigned long id);
+
 
     static bool exists(const std::string &dir);
 
@@ -95,18 +47,12 @@ class ResultStreamer {
 
 private:
 
-    VideoStream sceneStream;
-    VideoStream eyeStream;
-
-    ResultStream resStream;
+    RecordingReader reader;
 
     std::string parentDir;
 
-    /* Used for syncing the results to the frames */
-    unsigned int framePos;
-
-    /* Used for syncing the results to the frames */
-    ResultData prevDataPacket;
+    /* The next frame pair */
+    size_t framePos;
 
 
 };
@@ -56,6 +56,9 @@ std::string inputFolder;
 std::string outputFolder;
 bool bBurnVideos = false;
 
+/* The id of the first frame pair, -1 for the beginning */
+long startId = -1;
+
 
 
 
@@ -161,6 +164,14 @@ int main(const int argc, const char **args) {
 
     }
 
+    if(startId >= 0 && !resStreamer.seek(startId)) {
+
+        printf("No frame pair %ld\n", startId);
+
+        return -1;
+
+    }
+
 
 
     cv::VideoWriter videoWriterEye;
@@ -459,6 +470,12 @@ bool handleParameter(const ParamAndValue &pair) {
 
     }
 
+    else if(pair.name == "s") {
+
+        startId = atol(pair.value.c_str());
+
+    }
+
     else {
         return false;
     }
@@ -480,6 +497,7 @@ void printUsageInfo() {
            "      [-h]                 Display help\n"
            "      [-help]              Same as -h\n"
            "      [-f]                 Flip the eye image along the y-axis\n"
+           "      [-s <id>]            Start from the frame pair with the id\n"
            );
 
 }
@@ -3,7 +3,14 @@
 #include <stdio.h>
 
 
-static const long BILLION = 1e9;
+/* Elements in the queue */
+static const size_t QUEUE_CAPACITY = 256;
+
+/* The most elements run() takes from the queue at a time */
+static const size_t BATCH_SIZE = 16;
+
+/* How long run() waits for data before checking the state */
+static const int WAIT_MS = 4;
 
 
 static void *thred_fnct(void *arg) {
@@ -26,29 +33,17 @@ DataSink::DataSink() {
 DataSink::~DataSink() {
 
 	// flush
-	std::list<DataContainer *>::iterator it = queueData.begin();
-	while(it != queueData.end()) {
-
-		DataContainer *data = *it;
+	DataContainer *data = NULL;
+	while(queueData.pop(data)) {
 
 		write(data);
 
 		destroyDataContainer(data);
 
-		++it;
 	}
 
-	pthread_mutex_lock(&mutex);
-
-		// signal finally
-		pthread_cond_signal(&cond);
-
-	pthread_mutex_unlock(&mutex);
-
 
 	pthread_mutex_destroy(&mutex_alive);
-	pthread_mutex_destroy(&mutex);
-	pthread_cond_destroy(&cond);
 
 }
 
@@ -70,12 +65,8 @@ bool DataSink::init(const char *socketFile) {
 	printf("ok\n");
 
 
-	// create the mutexe
-	if(pthread_mutex_init(&mutex, NULL) != 0) {
-		return false;
-	}
-
-	if(pthread_cond_init(&cond, NULL) != 0) {
+	// create the queue
+	if(!queueData.init(QUEUE_CAPACITY)) {
 		return false;
 	}
 
@@ -124,44 +115,43 @@ bool DataSink::init(const char *socketFile) {
 }
 
 
-/* The mutex must be locked before a call to this function */
+/* Takes the ownership of data. run() is woken if it is waiting. */
 void DataSink::add(char *data, int32_t len) {
 
-	queueData.push_back(new DataContainer());
-
-	DataContainer *dataCont = queueData.back();
+	DataContainer *dataCont = new DataContainer();
 	dataCont->data = data;
 	dataCont->len = len;
 
-}
+	if(!queueData.push(dataCont)) {
 
+		printf("DataSink::add(): the queue is full, dropping the data\n");
 
-void DataSink::addResults(ResultData *res) {
+		destroyDataContainer(dataCont);
 
-	pthread_mutex_lock(&mutex);
+	}
 
-		std::vector<char> buff;
-		BinaryResultParser::resDataToBuffer(*res, buff);
+}
 
-		int len = 4 + buff.size();
 
-		char *newData = new char[len];
+void DataSink::addResults(ResultData *res) {
+
+	std::vector<char> buff;
+	BinaryResultParser::resDataToBuffer(*res, buff);
 
-		int32_t dataType = DataContainer::TYPE_TRACK_RESULTS;
+	int len = 4 + buff.size();
 
-		newData[0] = (dataType & 0x000000FF);
-		newData[1] = (dataType & 0x0000FF00) >> 8;
-		newData[2] = (dataType & 0x00FF0000) >> 16;
-		newData[3] = (dataType & 0xFF000000) >> 24;
+	char *newData = new char[len];
 
-		memcpy(newData + 4, buff.data(), buff.size());
+	int32_t dataType = DataContainer::TYPE_TRACK_RESULTS;
 
-		add(newData, len);
+	newData[0] = (dataType & 0x000000FF);
+	newData[1] = (dataType & 0x0000FF00) >> 8;
+	newData[2] = (dataType & 0x00FF0000) >> 16;
+	newData[3] = (dataType & 0xFF000000) >> 24;
 
-		// write() might be waiting
-		pthread_cond_signal(&cond);
+	memcpy(newData + 4, buff.data(), buff.size());
 
-	pthread_mutex_unlock(&mutex);
+	add(newData, len);
 
 }
 
@@ -169,56 +159,48 @@ void DataSink::addResults(ResultData *res) {
 // TYPE_FRAME1 or TYPE_FRAME2
 void DataSink::addFrame(CameraFrameExtended *frame, int32_t dataType) {
 
-	pthread_mutex_lock(&mutex);
+	// type + size + format + id + data
+	int len = 4 + 4 + 4 + 4 + frame->sz;
 
-		// type + size + format + id + data
-		int len = 4 + 4 + 4 + 4 + frame->sz;
+	char *newData = new char[len];
 
-		char *newData = new char[len];
 
+	// type
+	newData[0] = (dataType & 0x000000FF);
+	newData[1] = (dataType & 0x0000FF00) >> 8;
+	newData[2] = (dataType & 0x00FF0000) >> 16;
+	newData[3] = (dataType & 0xFF000000) >> 24;
 
-		// type
-		newData[0] = (dataType & 0x000000FF);
-		newData[1] = (dataType & 0x0000FF00) >> 8;
-		newData[2] = (dataType & 0x00FF0000) >> 16;
-		newData[3] = (dataType & 0xFF000000) >> 24;
 
+	// size, size of the data, including this 4-byte size info + 4-byte format + 4-byte id
+	int32_t size = frame->sz + 4 + 4 + 4;
 
-		// size, size of the data, including this 4-byte size info + 4-byte format + 4-byte id
-		int32_t size = frame->sz + 4 + 4 + 4;
+	newData[4] = (size & 0x000000FF);
+	newData[5] = (size & 0x0000FF00) >> 8;
+	newData[6] = (size & 0x00FF0000) >> 16;
+	newData[7] = (size & 0xFF000000) >> 24;
 
-		newData[4] = (size & 0x000000FF);
-		newData[5] = (size & 0x0000FF00) >> 8;
-		newData[6] = (size & 0x00FF0000) >> 16;
-		newData[7] = (size & 0xFF000000) >> 24;
 
+	// format
+	int32_t format = frame->format;
 
-		// format
-		int32_t format = frame->format;
-
-		newData[8]  = (format & 0x000000FF);
-		newData[9]  = (format & 0x0000FF00) >> 8;
-		newData[10] = (format & 0x00FF0000) >> 16;
-		newData[11] = (format & 0xFF000000) >> 24;
-
-
-		// id
-		int32_t id = frame->id;
+	newData[8]  = (format & 0x000000FF);
+	newData[9]  = (format & 0x0000FF00) >> 8;
+	newData[10] = (format & 0x00FF0000) >> 16;
+	newData[11] = (format & 0xFF000000) >> 24;
 
-		newData[12]  = (id & 0x000000FF);
-		newData[13]  = (id & 0x0000FF00) >> 8;
-		newData[14] = (id & 0x00FF0000) >> 16;
-		newData[15] = (id & 0xFF000000) >> 24;
 
-		memcpy(newData + 16, frame->data, frame->sz);
+	// id
+	int32_t id = frame->id;
 
-		add(newData, len);
+	newData[12]  = (id & 0x000000FF);
+	newData[13]  = (id & 0x0000FF00) >> 8;
+	newData[14] = (id & 0x00FF0000) >> 16;
+	newData[15] = (id & 0xFF000000) >> 24;
 
+	memcpy(newData + 16, frame->data, frame->sz);
 
-		// write() might be waiting
-		pthread_cond_signal(&cond);
-
-	pthread_mutex_unlock(&mutex);
+	add(newData, len);
 
 }
 
@@ -226,67 +208,59 @@ void DataSink::addFrame(CameraFrameExtended *frame, int32_t dataType) {
 // Order must be TYPE_FRAME1 then TYPE_FRAME2
 void DataSink::addFrames(CameraFrameExtended *frames[2]) {
 
-	pthread_mutex_lock(&mutex);
-
-		// write() might be waiting
-		pthread_cond_signal(&cond);
-
-
-		// type + size + format + id + data
-		int len = 2 * (4 + 4 + 4 + 4) + frames[0]->sz + frames[1]->sz;
+	// type + size + format + id + data
+	int len = 2 * (4 + 4 + 4 + 4) + frames[0]->sz + frames[1]->sz;
 
-		char *newData = new char[len];
-		char *ptr = newData;
-		int32_t dataTypes[2] = {DataContainer::TYPE_FRAME1, DataContainer::TYPE_FRAME2};
+	char *newData = new char[len];
+	char *ptr = newData;
+	int32_t dataTypes[2] = {DataContainer::TYPE_FRAME1, DataContainer::TYPE_FRAME2};
 
-		for(int i = 0; i < 2; ++i) {
+	for(int i = 0; i < 2; ++i) {
 
-			const CameraFrameExtended *curFrame = frames[i];
+		const CameraFrameExtended *curFrame = frames[i];
 
-			int32_t type = dataTypes[i];
-
-			// type
-			ptr[0] = (type & 0x000000FF);
-			ptr[1] = (type & 0x0000FF00) >> 8;
-			ptr[2] = (type & 0x00FF0000) >> 16;
-			ptr[3] = (type & 0xFF000000) >> 24;
+		int32_t type = dataTypes[i];
 
+		// type
+		ptr[0] = (type & 0x000000FF);
+		ptr[1] = (type & 0x0000FF00) >> 8;
+		ptr[2] = (type & 0x00FF0000) >> 16;
+		ptr[3] = (type & 0xFF000000) >> 24;
 
-			// size, size of the data, including this 4-byte size info + 4-byte format + 4-byte id
-			int32_t size = curFrame->sz + 4 + 4 + 4;
 
-			ptr[4] = (size & 0x000000FF);
-			ptr[5] = (size & 0x0000FF00) >> 8;
-			ptr[6] = (size & 0x00FF0000) >> 16;
-			ptr[7] = (size & 0xFF000000) >> 24;
+		// size, size of the data, including this 4-byte size info + 4-byte format + 4-byte id
+		int32_t size = curFrame->sz + 4 + 4 + 4;
 
+		ptr[4] = (size & 0x000000FF);
+		ptr[5] = (size & 0x0000FF00) >> 8;
+		ptr[6] = (size & 0x00FF0000) >> 16;
+		ptr[7] = (size & 0xFF000000) >> 24;
 
-			// format
-			int32_t format = curFrame->format;
 
-			ptr[8]  = (format & 0x000000FF);
-			ptr[9]  = (format & 0x0000FF00) >> 8;
-			ptr[10] = (format & 0x00FF0000) >> 16;
-			ptr[11] = (format & 0xFF000000) >> 24;
+		// format
+		int32_t format = curFrame->format;
 
+		ptr[8]  = (format & 0x000000FF);
+		ptr[9]  = (format & 0x0000FF00) >> 8;
+		ptr[10] = (format & 0x00FF0000) >> 16;
+		ptr[11] = (format & 0xFF000000) >> 24;
 
-			// id
-			int32_t id = curFrame->id;
 
-			ptr[12]  = (id & 0x000000FF);
-			ptr[13]  = (id & 0x0000FF00) >> 8;
-			ptr[14] = (id & 0x00FF0000) >> 16;
-			ptr[15] = (id & 0xFF000000) >> 24;
+		// id
+		int32_t id = curFrame->id;
 
-			memcpy(ptr + 16, curFrame->data, curFrame->sz);
+		ptr[12]  = (id & 0x000000FF);
+		ptr[13]  = (id & 0x0000FF00) >> 8;
+		ptr[14] = (id & 0x00FF0000) >> 16;
+		ptr[15] = (id & 0xFF000000) >> 24;
 
-			ptr += 4 + 4 + 4 + 4 + curFrame->sz;
+		memcpy(ptr + 16, curFrame->data, curFrame->sz);
 
-		}
+		ptr += 4 + 4 + 4 + 4 + curFrame->sz;
 
-		add(newData, len);
+	}
 
-	pthread_mutex_unlock(&mutex);
+	add(newData, len);
 
 }
 
@@ -296,55 +270,32 @@ void DataSink::run() {
 	// loop while alive
 	while(alive()) {
 
-		// get the oldest frame pair
-		DataContainer *data = getDataContainer();
-
-		// continue if NULL
-		if(data == NULL) {
-			continue;
-		}
-
-		// write to the client socket
-		write(data);
-
-		// destroy the data container
-		destroyDataContainer(data);
-
-		// give add() a chance to execute
-		wait(2);
-
-	}
+		// get the oldest data
+		DataContainer *data[BATCH_SIZE];
+		const size_t n = queueData.popBatch(data, BATCH_SIZE);
 
-	printf("DataSink::run(): bye\n");
-
-}
+		// wait for data if empty, end() wakes us up
+		if(n == 0) {
 
+			queueData.wait(WAIT_MS);
 
-DataContainer *DataSink::getDataContainer() {
-
-	pthread_mutex_lock(&mutex);
+			continue;
 
-		// wait if empty
-		if(queueData.size() == 0) {
-			pthread_cond_wait(&cond, &mutex);
 		}
 
-		// if still empty, i.e. the destructor signalled, return
-		if(queueData.size() == 0) {
-			pthread_mutex_unlock(&mutex);
-			return NULL;
-		}
+		for(size_t i = 0; i < n; ++i) {
 
-		std::list<DataContainer *>::iterator it = queueData.begin();
+			// write to the client socket
+			write(data[i]);
 
-		DataContainer *data = *it;
+			// destroy the data container
+			destroyDataContainer(data[i]);
 
-		// remove the reference from the list
-		queueData.erase(it);
+		}
 
-	pthread_mutex_unlock(&mutex);
+	}
 
-	return data;
+	printf("DataSink::run(): bye\n");
 
 }
 
@@ -366,37 +317,6 @@ void DataSink::destroyDataContainer(DataContainer *dataCont) {
 }
 
 
-bool DataSink::wait(int millis) {
-
-	// get the system time
-	struct timespec ts;
-	clock_gettime(CLOCK_REALTIME, &ts);
-
-	// add the requested wait time
-	ts.tv_sec	+= millis/1000;
-	ts.tv_nsec	+= (millis % 1000) * 1000000;
-
-	// account for overflow
-	if(ts.tv_nsec >= BILLION) {
-		ts.tv_sec++;
-		ts.tv_nsec -= BILLION;
-	}
-
-	/*****************************************************************
-	 * Wait on the condition
-	 *****************************************************************/
-
-	pthread_mutex_lock(&mutex);
-
-	// on success returns zero
-	int ret = pthread_cond_timedwait(&cond, &mutex, &ts);
-
-	pthread_mutex_unlock(&mutex);
-
-	return (bool)(ret == 0);	// ret == 0 means we were signalled
-}
-
-
 bool DataSink::alive() {
 
 	pthread_mutex_lock(&mutex_alive);
@@ -413,14 +333,11 @@ void DataSink::end() {
 
 		b_alive = false;
 
-		pthread_mutex_lock(&mutex);
-
-		// signal finally
-		pthread_cond_signal(&cond);
+	pthread_mutex_unlock(&mutex_alive);
 
-		pthread_mutex_unlock(&mutex);
 
-	pthread_mutex_unlock(&mutex_alive);
+	// run() might be waiting
+	queueData.wake();
 
 
 	// wait for the thread to finish
@@ -431,11 +348,7 @@ void DataSink::end() {
 
 int DataSink::getBufferState() {
 
-	pthread_mutex_lock(&mutex);
-		int ret = (int)queueData.size();
-	pthread_mutex_unlock(&mutex);
-
-	return ret;
+	return (int)queueData.size();
 
 }
 
@@ -2,10 +2,10 @@
 #define DADASINK_H
 
 
-#include <list>
 #include <vector>
 #include <pthread.h>
 #include "Client.h"
+#include "RingQueue.h"
 #include "ResultData.h"
 #include "CameraFrameExtended.h"
 
@@ -58,21 +58,16 @@ class DataSink {
 
 		void add(char *data, int32_t len);
 
-		DataContainer *getDataContainer();
-
 		void destroyDataContainer(DataContainer *dataCont);
 
 		bool alive();
 
-		bool wait(int millis);
-
-		pthread_mutex_t mutex;
-		pthread_cond_t cond;
 		pthread_t thread;
 		pthread_mutex_t mutex_alive;
 		volatile bool b_alive;
 
-		std::list<DataContainer *> queueData;
+		/* The producers add, run() sends */
+		RingQueue<DataContainer *> queueData;
 
 		gtSocket::Client client;
 
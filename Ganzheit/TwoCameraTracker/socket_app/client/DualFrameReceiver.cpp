@@ -431,6 +431,12 @@ bool DualFrameReceiver::configureEyeCamData(const std::string &eyeCamCalibFile)
 		camEye->setIntrinsicMatrix(camContainer.intr);
 		camEye->setDistortion(camContainer.dist);
 
+		/*
+		 * The calibration and the results are for the eye frames
+		 * mirrored around the y-axis, the tracker mirrors the frames
+		 */
+		camEye->setMirrored(true);
+
 	}
 
 
@@ -0,0 +1,428 @@
+/*
+ * Records frame pairs and results with VideoWriter and reads them back
+ * with RecordingReader:
+ *
+ *     index     through index.idx, with the timestamps and sizes
+ *     scan      without index.idx, like the recordings made before it
+ *     crash     the end of camera2.mjpg cut off, the last pair must be
+ *               left out
+ *
+ * The frames are small JPEG-like streams: the markers of a real frame
+ * and random entropy-coded data with stuffed 0xFF bytes and restart
+ * markers, enough for the reader to walk them. Every pair must be got
+ * in any order, with its results if it has any, and the pairs must be
+ * found by their ids. Every other result has the durations of the
+ * tracking stages, which are optional in the packets.
+ *
+ * Usage: recording [nof pairs]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <vector>
+#include <string>
+
+#include "VideoWriter.h"
+#include "RecordingReader.h"
+
+
+static const int NOF_PAIRS_DEFAULT	= 300;
+
+/* Every pair with id % RESULTS_GAP == RESULTS_GAP - 1 has no results */
+static const int RESULTS_GAP		= 7;
+
+/* The results come this many pairs after the frames, like from the tracker */
+static const int RESULTS_DELAY		= 3;
+
+static const int EYE_W				= 64;
+static const int EYE_H				= 48;
+static const int SCENE_W			= 160;
+static const int SCENE_H			= 120;
+
+static const int64_t FRAME_INTERVAL	= 33333;
+
+
+static void putMarker(std::vector<unsigned char> &jpg, int marker) {
+
+	jpg.push_back(0xFF);
+	jpg.push_back((unsigned char)marker);
+
+}
+
+
+static void putSegment(std::vector<unsigned char> &jpg, int marker, const std::vector<unsigned char> &payload) {
+
+	putMarker(jpg, marker);
+
+	const int len = (int)payload.size() + 2;
+	jpg.push_back((unsigned char)(len >> 8));
+	jpg.push_back((unsigned char)(len & 0xFF));
+
+	jpg.insert(jpg.end(), payload.begin(), payload.end());
+
+}
+
+
+/* A frame of about n bytes with the markers of a baseline JPEG */
+static void makeFrame(int w, int h, int n, std::vector<unsigned char> &jpg) {
+
+	jpg.clear();
+
+	putMarker(jpg, 0xD8);
+
+	std::vector<unsigned char> app0(14, 0);
+	memcpy(&app0[0], "JFIF", 5);
+	putSegment(jpg, 0xE0, app0);
+
+	std::vector<unsigned char> sof(15, 0);
+	sof[0] = 8;
+	sof[1] = (unsigned char)(h >> 8);
+	sof[2] = (unsigned char)(h & 0xFF);
+	sof[3] = (unsigned char)(w >> 8);
+	sof[4] = (unsigned char)(w & 0xFF);
+	sof[5] = 3;
+	putSegment(jpg, 0xC0, sof);
+
+	putSegment(jpg, 0xDA, std::vector<unsigned char>(10, 1));
+
+	for(int i = 0; i < n; ++i) {
+
+		const unsigned char c = (unsigned char)(rand() & 0xFF);
+		jpg.push_back(c);
+
+		// stuffed
+		if(c == 0xFF) {
+			jpg.push_back(0x00);
+		}
+
+		if(i % 97 == 96) {
+			putMarker(jpg, 0xD0 + (i / 97) % 8);
+		}
+
+	}
+
+	putMarker(jpg, 0xD9);
+
+}
+
+
+static void makeResults(uint32_t id, std::vector<char> &buff) {
+
+	ResultData data;
+	data.id = id;
+	data.bTrackSuccessfull = true;
+	data.trackDurMicros = 1000 + id;
+	data.scenePoint = cv::Point2d(id, 2.0 * id);
+
+	if(id % 2 == 0) {
+		for(int i = 0; i < 9; ++i) {
+			data.stageDurMicros.push_back(i == 4 ? -1.0f : 0.5f * id + i);
+		}
+	}
+
+	BinaryResultParser::resDataToBuffer(data, buff);
+
+}
+
+
+/* The recording VideoWriter created in the parent */
+static bool findRecording(const std::string &parent, std::string &dir) {
+
+	DIR *d = opendir(parent.c_str());
+	if(d == NULL) {
+		return false;
+	}
+
+	bool found = false;
+
+	struct dirent *ent;
+	while((ent = readdir(d)) != NULL) {
+
+		if(ent->d_name[0] != '.') {
+			dir = parent + ent->d_name + "/";
+			found = true;
+		}
+
+	}
+
+	closedir(d);
+
+	return found;
+
+}
+
+
+/* Check the pair against what was recorded. Returns false if it differs. */
+static bool checkPair(const RecordingReader &reader, size_t n,
+					  const std::vector<std::vector<unsigned char> > &eyes,
+					  const std::vector<std::vector<unsigned char> > &scenes,
+					  bool bTimestamps) {
+
+	const uint32_t id = reader.getId(n);
+
+	if(id >= eyes.size()) {
+		printf("    pair %u was not recorded\n", id);
+		return false;
+	}
+
+	RecordingReader::Frame eye, scene;
+	if(!reader.getFrames(n, eye, scene)) {
+		printf("    pair %u: no frames\n", id);
+		return false;
+	}
+
+	if(eye.sz != eyes[id].size() || memcmp(eye.data, &eyes[id][0], eye.sz) != 0 ||
+	   scene.sz != scenes[id].size() || memcmp(scene.data, &scenes[id][0], scene.sz) != 0) {
+		printf("    pair %u: the frames differ\n", id);
+		return false;
+	}
+
+	if(eye.w != EYE_W || eye.h != EYE_H || scene.w != SCENE_W || scene.h != SCENE_H) {
+		printf("    pair %u: the frames are %dx%d and %dx%d\n", id, eye.w, eye.h, scene.w, scene.h);
+		return false;
+	}
+
+	const int64_t timestamp = bTimestamps ? (id + 1) * FRAME_INTERVAL : 0;
+
+	if(eye.timestamp != timestamp || scene.timestamp != timestamp) {
+		printf("    pair %u: the timestamps are %ld and %ld\n", id, (long)eye.timestamp, (long)scene.timestamp);
+		return false;
+	}
+
+	ResultData data;
+	const bool bResults = reader.getResults(n, data);
+
+	if(bResults != (id % RESULTS_GAP != RESULTS_GAP - 1)) {
+		printf("    pair %u: the results are %s\n", id, bResults ? "there" : "missing");
+		return false;
+	}
+
+	if(bResults && (data.id != id || data.trackDurMicros != 1000 + (long)id)) {
+		printf("    pair %u: the results are of %lu\n", id, data.id);
+		return false;
+	}
+
+	if(bResults && data.stageDurMicros.size() != (id % 2 == 0 ? 9u : 0u)) {
+		printf("    pair %u: %lu stage durations\n", id, (unsigned long)data.stageDurMicros.size());
+		return false;
+	}
+
+	for(size_t i = 0; bResults && i < data.stageDurMicros.size(); ++i) {
+
+		if(data.stageDurMicros[i] != (i == 4 ? -1.0f : 0.5f * id + i)) {
+			printf("    pair %u: stage %lu took %.1f us\n", id, (unsigned long)i, data.stageDurMicros[i]);
+			return false;
+		}
+
+	}
+
+	size_t found;
+	if(!reader.find(id, found) || found != n) {
+		printf("    pair %u: not found by the id\n", id);
+		return false;
+	}
+
+	return true;
+
+}
+
+
+/* Read every pair, from the last one to the first */
+static bool checkRecording(const std::string &dir, size_t nofPairs,
+						   const std::vector<std::vector<unsigned char> > &eyes,
+						   const std::vector<std::vector<unsigned char> > &scenes,
+						   bool bTimestamps) {
+
+	RecordingReader reader;
+
+	const int64_t t1 = CameraFrame::getTime();
+
+	if(!reader.open(dir)) {
+		printf("    could not open\n");
+		return false;
+	}
+
+	const int64_t t2 = CameraFrame::getTime();
+
+	if(reader.getNofPairs() != nofPairs) {
+		printf("    %lu pairs, %lu expected\n", (unsigned long)reader.getNofPairs(), (unsigned long)nofPairs);
+		return false;
+	}
+
+	for(size_t i = nofPairs; i > 0; --i) {
+
+		if(!checkPair(reader, i - 1, eyes, scenes, bTimestamps)) {
+			return false;
+		}
+
+	}
+
+	const int64_t t3 = CameraFrame::getTime();
+
+	size_t n;
+	if(reader.find((uint32_t)eyes.size(), n)) {
+		printf("    found a pair that was not recorded\n");
+		return false;
+	}
+
+	printf("    open %ld us, %.2f us per pair\n", (long)(t2 - t1), (double)(t3 - t2) / nofPairs);
+
+	return true;
+
+}
+
+
+int main(int argc, char **argv) {
+
+	const int nofPairs = argc > 1 ? atoi(argv[1]) : NOF_PAIRS_DEFAULT;
+
+	if(nofPairs <= RESULTS_DELAY) {
+		printf("Usage: %s [nof pairs]\n", argv[0]);
+		return -1;
+	}
+
+	char tmpl[] = "/tmp/recordingXXXXXX";
+	if(mkdtemp(tmpl) == NULL) {
+		printf("Could not create a temporary folder\n");
+		return -1;
+	}
+
+	const std::string parent = std::string(tmpl) + "/";
+
+	srand(1);
+
+
+	/*
+	 * Record
+	 */
+	std::vector<std::vector<unsigned char> > eyes(nofPairs);
+	std::vector<std::vector<unsigned char> > scenes(nofPairs);
+
+	VideoWriter *writer = new VideoWriter();
+
+	// nothing may be dropped
+	writer->setPolicy(QueuePolicy::POLICY_BLOCK, 1000);
+
+	if(!writer->init(parent) || !writer->start()) {
+		printf("Could not start the writer\n");
+		return -1;
+	}
+
+	for(int i = 0; i < nofPairs + RESULTS_DELAY; ++i) {
+
+		if(i < nofPairs) {
+
+			makeFrame(EYE_W, EYE_H, 500 + rand() % 500, eyes[i]);
+			makeFrame(SCENE_W, SCENE_H, 2000 + rand() % 2000, scenes[i]);
+
+			CameraFrame eye(EYE_W, EYE_H, 3, &eyes[i][0], eyes[i].size(), FORMAT_MJPG, false, false);
+			CameraFrame scene(SCENE_W, SCENE_H, 3, &scenes[i][0], scenes[i].size(), FORMAT_MJPG, false, false);
+
+			eye.timestamp = scene.timestamp = (i + 1) * FRAME_INTERVAL;
+
+			writer->addFrames(&eye, &scene, i);
+
+		}
+
+		const int id = i - RESULTS_DELAY;
+
+		if(id >= 0 && id % RESULTS_GAP != RESULTS_GAP - 1) {
+
+			std::vector<char> buff;
+			makeResults(id, buff);
+
+			writer->addResults(buff);
+
+		}
+
+	}
+
+	writer->end();
+
+	QueuePolicy::Stats stats;
+	writer->getQueueStats(stats);
+
+	delete writer;
+
+	if(stats.nDropped != 0) {
+		printf("The writer dropped %lu pairs\n", (unsigned long)stats.nDropped);
+		return -1;
+	}
+
+	std::string dir;
+	if(!findRecording(parent, dir)) {
+		printf("No recording in %s\n", parent.c_str());
+		return -1;
+	}
+
+	const std::string partDir = dir + "part0/";
+
+	bool ok = true;
+
+
+	printf("index\n");
+
+	if(!checkRecording(dir, nofPairs, eyes, scenes, true)) {
+		ok = false;
+	}
+
+
+	printf("crash\n");
+
+	// the last scene frame was written only partly
+	const std::string sceneFile = partDir + RecordingIndex::FILE_SCENE;
+
+	std::vector<unsigned char> sceneData;
+	FILE *f = fopen(sceneFile.c_str(), "rb");
+	if(f != NULL) {
+		fseek(f, 0, SEEK_END);
+		sceneData.resize(ftell(f));
+		fseek(f, 0, SEEK_SET);
+		if(fread(&sceneData[0], 1, sceneData.size(), f) != sceneData.size()) {
+			sceneData.clear();
+		}
+		fclose(f);
+	}
+
+	if(sceneData.empty() || truncate(sceneFile.c_str(), sceneData.size() - 10) != 0) {
+		printf("    could not cut %s\n", sceneFile.c_str());
+		ok = false;
+	}
+	else if(!checkRecording(dir, nofPairs - 1, eyes, scenes, true)) {
+		ok = false;
+	}
+
+	// restore
+	f = fopen(sceneFile.c_str(), "wb");
+	if(f != NULL) {
+		fwrite(&sceneData[0], 1, sceneData.size(), f);
+		fclose(f);
+	}
+
+
+	printf("scan\n");
+
+	unlink((partDir + RecordingIndex::FILE_INDEX).c_str());
+
+	if(!checkRecording(dir, nofPairs, eyes, scenes, false)) {
+		ok = false;
+	}
+
+
+	// clean up
+	for(int stream = IndexEntry::STREAM_EYE; stream <= IndexEntry::STREAM_RESULTS; ++stream) {
+		unlink((partDir + RecordingIndex::getFileName(stream)).c_str());
+	}
+
+	rmdir(partDir.c_str());
+	rmdir(dir.c_str());
+	rmdir(parent.c_str());
+
+	printf("\n%s\n", ok ? "OK" : "FAILED");
+
+	return ok ? 0 : -1;
+
+}
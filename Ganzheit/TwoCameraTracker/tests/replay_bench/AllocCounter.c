@@ -0,0 +1,96 @@
+#include "AllocCounter.h"
+#include <stddef.h>
+#include <errno.h>
+
+
+/* The allocators of glibc, which the functions below forward to */
+extern void *__libc_malloc(size_t sz);
+extern void *__libc_calloc(size_t n, size_t sz);
+extern void *__libc_realloc(void *ptr, size_t sz);
+extern void *__libc_memalign(size_t alignment, size_t sz);
+
+
+static volatile int bCounting = 0;
+static unsigned long nAllocs = 0;
+
+
+static void count(void) {
+
+	if(bCounting) {
+		__atomic_add_fetch(&nAllocs, 1, __ATOMIC_RELAXED);
+	}
+
+}
+
+
+void allocCounterStart(void) {
+
+	__atomic_store_n(&nAllocs, 0, __ATOMIC_RELAXED);
+	bCounting = 1;
+
+}
+
+
+unsigned long allocCounterStop(void) {
+
+	bCounting = 0;
+
+	return __atomic_load_n(&nAllocs, __ATOMIC_RELAXED);
+
+}
+
+
+void *malloc(size_t sz) {
+
+	count();
+
+	return __libc_malloc(sz);
+
+}
+
+
+void *calloc(size_t n, size_t sz) {
+
+	count();
+
+	return __libc_calloc(n, sz);
+
+}
+
+
+void *realloc(void *ptr, size_t sz) {
+
+	count();
+
+	return __libc_realloc(ptr, sz);
+
+}
+
+
+void *memalign(size_t alignment, size_t sz) {
+
+	count();
+
+	return __libc_memalign(alignment, sz);
+
+}
+
+
+int posix_memalign(void **ptr, size_t alignment, size_t sz) {
+
+	count();
+
+	*ptr = __libc_memalign(alignment, sz);
+
+	return *ptr == NULL ? ENOMEM : 0;
+
+}
+
+
+void *aligned_alloc(size_t alignment, size_t sz) {
+
+	count();
+
+	return __libc_memalign(alignment, sz);
+
+}
@@ -0,0 +1,27 @@
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * Counts the calls to malloc(), calloc(), realloc() and the aligned
+ * allocators of the whole process, including those of OpenCV and of
+ * operator new, between allocCounterStart() and allocCounterStop().
+ * The functions of glibc are replaced, so this works only with glibc.
+ */
+void allocCounterStart(void);
+
+/* The number of allocations since allocCounterStart() */
+unsigned long allocCounterStop(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif
@@ -0,0 +1,619 @@
+/*
+ * Replays a recorded eye video through the tracker without the GUI and
+ * the cameras, and measures how fast it is tracked:
+ *
+ *     1. The eye frames are decoded to gray into memory, from a
+ *        recording folder with partX sub-folders or from any video file
+ *        OpenCV can read.
+ *     2. Each round tracks all frames with a new gt::GazeTracker, frame
+ *        by frame with track() and SceneMapper::getPosition() like
+ *        gazetoworld does, as fast as it can.
+ *
+ * The warm-up rounds are not measured, so the frames, the code and the
+ * work buffers of the tracker are in the caches. The process can be
+ * pinned to a core. The frame rate, the times per frame and per stage,
+ * see gt::StageTimes, and the allocations per frame are printed, and
+ * written as JSON for comparing the commits.
+ *
+ * Usage: replay_bench -i <recording or video> -e <eyeCam.calib>
+ *                     -s <sceneCam.calib> -m <mapper.yaml> [options]
+ */
+
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+#include <sys/stat.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include "GazeTracker.h"
+#include "SceneMapper.h"
+#include "trackerSettings.h"
+#include "localTrackerSettings.h"
+#include "settingsIO.h"
+#include "CalibDataReader.h"
+#include "MapperReader.h"
+#include "RecordingReader.h"
+#include "InputParser.h"
+#include "AllocCounter.h"
+
+
+/* The timed stages: the frame, the stages of the tracker and the mapper */
+static const int STAGE_FRAME	= gt::StageTimes::NOF_STAGES;
+static const int STAGE_MAPPER	= gt::StageTimes::NOF_STAGES + 1;
+static const int NOF_TIMES		= gt::StageTimes::NOF_STAGES + 2;
+
+
+/******************************************************************************
+ * Options
+ ******************************************************************************/
+
+static std::string inputFile;
+static std::string eyeCamCalibFile;
+static std::string sceneCamCalibFile;
+static std::string mapperFile;
+static std::string trackerFile;
+static std::string jsonFile;
+
+static int maxFrames	= 1000;
+static int nofRounds	= 3;
+static int nofWarmUps	= 0;
+
+/* -1 if not pinned */
+static int cpu			= -1;
+
+static bool bPrintHelp	= false;
+
+
+/* The times of a stage in nanoseconds */
+class Times {
+
+	public:
+
+		Times() {
+			mean = p50 = p95 = p99 = max = 0.0;
+		}
+
+		/* Sort the samples and compute the statistics */
+		void compute() {
+
+			if(samples.empty()) {
+				return;
+			}
+
+			std::sort(samples.begin(), samples.end());
+
+			double sum = 0.0;
+			for(size_t i = 0; i < samples.size(); ++i) {
+				sum += samples[i];
+			}
+
+			mean	= sum / samples.size();
+			p50		= getPercentile(0.50);
+			p95		= getPercentile(0.95);
+			p99		= getPercentile(0.99);
+			max		= samples.back();
+
+		}
+
+		std::vector<double> samples;
+
+		double mean;
+		double p50;
+		double p95;
+		double p99;
+		double max;
+
+	private:
+
+		double getPercentile(double q) const {
+			return samples[std::min(samples.size() - 1, (size_t)(q * samples.size()))];
+		}
+
+};
+
+
+static const char *getTimeName(int n) {
+
+	if(n == STAGE_FRAME) {
+		return "frame";
+	}
+
+	if(n == STAGE_MAPPER) {
+		return "mapper";
+	}
+
+	return gt::StageTimes::getName(n);
+
+}
+
+
+static bool handleParameter(const ParamAndValue &pair) {
+
+	if(pair.name == "i") {
+		inputFile = pair.value;
+	}
+	else if(pair.name == "e") {
+		eyeCamCalibFile = pair.value;
+	}
+	else if(pair.name == "s") {
+		sceneCamCalibFile = pair.value;
+	}
+	else if(pair.name == "m") {
+		mapperFile = pair.value;
+	}
+	else if(pair.name == "t") {
+		trackerFile = pair.value;
+	}
+	else if(pair.name == "j") {
+		jsonFile = pair.value;
+	}
+	else if(pair.name == "n") {
+		maxFrames = atoi(pair.value.c_str());
+	}
+	else if(pair.name == "r") {
+		nofRounds = atoi(pair.value.c_str());
+	}
+	else if(pair.name == "w") {
+		nofWarmUps = atoi(pair.value.c_str());
+	}
+	else if(pair.name == "p") {
+		cpu = atoi(pair.value.c_str());
+	}
+	else if(pair.name == "h" || pair.name == "help") {
+		bPrintHelp = true;
+	}
+	else {
+		return false;
+	}
+
+	return true;
+
+}
+
+
+static bool handleInputParameters(int argc, const char **args) {
+
+	std::vector<ParamAndValue> argVec;
+	if(!parseInput(argc, args, argVec)) {
+		printf("handleInputParameters(): Error parsing input\n");
+		return false;
+	}
+
+	for(size_t i = 0; i < argVec.size(); ++i) {
+
+		if(!handleParameter(argVec[i])) {
+			printf("-%s %s not defined\n", argVec[i].name.c_str(), argVec[i].value.c_str());
+			return false;
+		}
+
+	}
+
+	return true;
+
+}
+
+
+static void printUsageInfo() {
+
+	printf("Usage:\n"
+		   "  ./replay_bench [option arguments]\n"
+		   "  option arguments:\n"
+		   "      -i <input>           Recording folder with partX sub-folders, or a video file\n"
+		   "      -e <eyeCam.calib>    The eye camera and LED calibration\n"
+		   "      -s <sceneCam.calib>  The scene camera calibration\n"
+		   "      -m <mapper.yaml>     The transformation between the cameras\n"
+		   "      [-t <settings.xml>]  The tracker settings, the defaults if not given\n"
+		   "      [-n <frames>]        Replay at most this many frames, %d by default\n"
+		   "      [-r <rounds>]        Measured rounds, %d by default\n"
+		   "      [-w <rounds>]        Warm-up rounds before the measured ones, %d by default\n"
+		   "      [-p <cpu>]           Pin the process to the core\n"
+		   "      [-j <file>]          Write the summary as JSON\n"
+		   "      [-h]                 Display help\n",
+		   maxFrames, nofRounds, nofWarmUps);
+
+}
+
+
+/******************************************************************************
+ * Input
+ ******************************************************************************/
+
+/* The eye frames of a recording made by gazetoworld */
+static bool readRecording(const std::string &dir, std::vector<cv::Mat> &frames) {
+
+	RecordingReader reader;
+	if(!reader.open(dir + "/")) {
+		return false;
+	}
+
+	for(size_t n = 0; n < reader.getNofPairs() && (int)frames.size() < maxFrames; ++n) {
+
+		RecordingReader::Frame eye, scene;
+		reader.getFrames(n, eye, scene);
+
+		const cv::Mat buff(1, (int)eye.sz, CV_8UC1, (void *)eye.data);
+
+		cv::Mat img = cv::imdecode(buff, CV_LOAD_IMAGE_GRAYSCALE);
+
+		if(img.empty()) {
+			printf("readRecording(): Could not decode the eye frame of pair %u\n", reader.getId(n));
+			return false;
+		}
+
+		frames.push_back(img);
+
+	}
+
+	return true;
+
+}
+
+
+static bool readVideo(const std::string &file, std::vector<cv::Mat> &frames) {
+
+	cv::VideoCapture cap(file);
+	if(!cap.isOpened()) {
+		printf("readVideo(): Could not open %s\n", file.c_str());
+		return false;
+	}
+
+	cv::Mat img;
+	while((int)frames.size() < maxFrames && cap.read(img)) {
+
+		cv::Mat gray;
+
+		if(img.channels() == 1) {
+			gray = img.clone();
+		}
+		else {
+			cv::cvtColor(img, gray, CV_BGR2GRAY);
+		}
+
+		frames.push_back(gray);
+
+	}
+
+	return true;
+
+}
+
+
+/*
+ * The eye camera and the LEDs, like gazetoworld. The calibration is for
+ * the mirrored frames.
+ */
+static bool readEyeCamera(Camera &camera, std::vector<cv::Point3d> &leds) {
+
+	CalibDataReader calibReader;
+	if(!calibReader.create(eyeCamCalibFile)) {
+		printf("readEyeCamera(): Could not load %s\n", eyeCamCalibFile.c_str());
+		return false;
+	}
+
+	calib::CameraCalibContainer camContainer;
+	std::vector<calib::LEDCalibContainer> ledContainers;
+
+	if(!calibReader.readCameraContainer(camContainer) || !calibReader.readLEDContainers(ledContainers)) {
+		printf("readEyeCamera(): Could not read %s\n", eyeCamCalibFile.c_str());
+		return false;
+	}
+
+	if(ledContainers.size() != 6) {
+		printf("readEyeCamera(): %d LEDs, 6 are supported\n", (int)ledContainers.size());
+		return false;
+	}
+
+	camera.setIntrinsicMatrix(camContainer.intr);
+	camera.setDistortion(camContainer.dist);
+	camera.setMirrored(true);
+
+	leds.resize(ledContainers.size());
+	for(size_t i = 0; i < ledContainers.size(); ++i) {
+		const double *pos = ledContainers[i].LED_pos;
+		leds[i] = cv::Point3d(pos[0], pos[1], pos[2]);
+	}
+
+	return true;
+
+}
+
+
+static bool readMapper(Camera &sceneCamera, SceneMapper &mapper) {
+
+	CalibDataReader calibReader;
+	calib::CameraCalibContainer camContainer;
+
+	if(!calibReader.create(sceneCamCalibFile) || !calibReader.readCameraContainer(camContainer)) {
+		printf("readMapper(): Could not read %s\n", sceneCamCalibFile.c_str());
+		return false;
+	}
+
+	sceneCamera.setIntrinsicMatrix(camContainer.intr);
+	sceneCamera.setDistortion(camContainer.dist);
+
+	MapperReader reader;
+	if(!reader.readContents(mapperFile)) {
+		printf("readMapper(): Could not read %s\n", mapperFile.c_str());
+		return false;
+	}
+
+	const cv::Mat &tr = reader.getTransformation();
+
+	Eigen::Matrix4d A;
+	for(int i = 0; i < 4; ++i) {
+		A.row(i) << tr.at<double>(i, 0), tr.at<double>(i, 1), tr.at<double>(i, 2), tr.at<double>(i, 3);
+	}
+
+	mapper = SceneMapper(A, &sceneCamera);
+
+	return true;
+
+}
+
+
+/******************************************************************************
+ * Output
+ ******************************************************************************/
+
+static void printTimes(const char *name, const Times &t) {
+
+	printf("%-12s %8lu %9.1f %9.1f %9.1f %9.1f %9.1f\n", name, (unsigned long)t.samples.size(),
+		   1e-3 * t.mean, 1e-3 * t.p50, 1e-3 * t.p95, 1e-3 * t.p99, 1e-3 * t.max);
+
+}
+
+
+/* The string with the JSON escapes */
+static std::string toJSON(const std::string &str) {
+
+	std::string ret;
+
+	for(size_t i = 0; i < str.size(); ++i) {
+
+		if(str[i] == '"' || str[i] == '\\') {
+			ret += '\\';
+		}
+
+		ret += str[i];
+
+	}
+
+	return ret;
+
+}
+
+
+static bool writeJSON(const std::string &file, const cv::Size &size, int nofFrames,
+					  double fps, double tracked, double allocs, const std::vector<Times> &times) {
+
+	FILE *f = fopen(file.c_str(), "w");
+	if(f == NULL) {
+		printf("writeJSON(): Could not create %s\n", file.c_str());
+		return false;
+	}
+
+	fprintf(f, "{\n");
+	fprintf(f, "  \"input\": \"%s\",\n", toJSON(inputFile).c_str());
+	fprintf(f, "  \"width\": %d,\n  \"height\": %d,\n", size.width, size.height);
+	fprintf(f, "  \"frames\": %d,\n  \"rounds\": %d,\n  \"warmUps\": %d,\n  \"cpu\": %d,\n",
+			nofFrames, nofRounds, nofWarmUps, cpu);
+	fprintf(f, "  \"fps\": %.2f,\n  \"tracked\": %.4f,\n  \"allocsPerFrame\": %.2f,\n", fps, tracked, allocs);
+	fprintf(f, "  \"unit\": \"us\",\n  \"times\": {\n");
+
+	for(int i = 0; i < NOF_TIMES; ++i) {
+
+		const Times &t = times[i];
+
+		fprintf(f, "    \"%s\": {\"n\": %lu, \"mean\": %.3f, \"p50\": %.3f, \"p95\": %.3f, \"p99\": %.3f, \"max\": %.3f}%s\n",
+				getTimeName(i), (unsigned long)t.samples.size(),
+				1e-3 * t.mean, 1e-3 * t.p50, 1e-3 * t.p95, 1e-3 * t.p99, 1e-3 * t.max,
+				i + 1 < NOF_TIMES ? "," : "");
+
+	}
+
+	fprintf(f, "  }\n}\n");
+
+	fclose(f);
+
+	return true;
+
+}
+
+
+int main(int argc, const char **argv) {
+
+	if(!handleInputParameters(argc, argv) || bPrintHelp ||
+	   inputFile.empty() || eyeCamCalibFile.empty() || sceneCamCalibFile.empty() || mapperFile.empty() ||
+	   maxFrames <= 0 || nofRounds <= 0 || nofWarmUps < 0) {
+
+		printUsageInfo();
+		return -1;
+
+	}
+
+
+	/**********************************************************************
+	 * The tracker settings, the cameras and the mapper
+	 *********************************************************************/
+	if(!trackerFile.empty()) {
+
+		SettingsIO settingsFile(trackerFile);
+		if(!settingsFile.isOpen()) {
+			printf("Could not read %s\n", trackerFile.c_str());
+			return -1;
+		}
+
+		LocalTrackerSettings localSettings;
+		localSettings.open(settingsFile);
+		trackerSettings.set(localSettings);
+
+	}
+
+	Camera eyeCamera;
+	std::vector<cv::Point3d> leds;
+	Camera sceneCamera;
+	SceneMapper mapper;
+
+	if(!readEyeCamera(eyeCamera, leds) || !readMapper(sceneCamera, mapper)) {
+		return -1;
+	}
+
+
+	/**********************************************************************
+	 * The frames into memory
+	 *********************************************************************/
+	std::vector<cv::Mat> frames;
+
+	struct stat myStat;
+	const bool bFolder = stat(inputFile.c_str(), &myStat) == 0 && S_ISDIR(myStat.st_mode);
+
+	if(!(bFolder ? readRecording(inputFile, frames) : readVideo(inputFile, frames))) {
+		return -1;
+	}
+
+	if(frames.empty()) {
+		printf("No frames in %s\n", inputFile.c_str());
+		return -1;
+	}
+
+	const int nofFrames = (int)frames.size();
+
+
+	/**********************************************************************
+	 * Pin
+	 *********************************************************************/
+	if(cpu >= 0) {
+
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(cpu, &set);
+
+		if(sched_setaffinity(0, sizeof(set), &set) != 0) {
+			printf("Could not pin to the cpu %d\n", cpu);
+			return -1;
+		}
+
+	}
+
+
+	/**********************************************************************
+	 * Replay
+	 *********************************************************************/
+	std::vector<Times> times(NOF_TIMES);
+	for(int i = 0; i < NOF_TIMES; ++i) {
+		times[i].samples.reserve((size_t)nofRounds * nofFrames);
+	}
+
+	int64_t totalNs			= 0;
+	unsigned long nAllocs	= 0;
+	long nTracked			= 0;
+
+	for(int r = 0; r < nofWarmUps + nofRounds; ++r) {
+
+		const bool bMeasure = r >= nofWarmUps;
+
+		gt::GazeTracker tracker;
+		tracker.init(eyeCamera, leds, trackerSettings);
+
+		if(bMeasure) {
+			allocCounterStart();
+		}
+
+		const int64_t t1 = gt::StageTimes::now();
+
+		for(int i = 0; i < nofFrames; ++i) {
+
+			const int64_t tf = gt::StageTimes::now();
+
+			const bool bTracked = tracker.track(frames[i]);
+
+			const int64_t tm = gt::StageTimes::now();
+
+			// like GTWorker::frameTracked()
+			const double *c_pupil	= tracker.getCentrePupil();
+			const double *c_cornea	= tracker.getCentreCornea();
+			Eigen::Vector3d eigCornea(c_cornea[0], c_cornea[1], c_cornea[2]);
+			Eigen::Vector3d eigPupil(c_pupil[0], c_pupil[1], c_pupil[2]);
+
+			cv::Point2d scenePoint;
+			mapper.getPosition(eigCornea, eigPupil, scenePoint);
+
+			const int64_t te = gt::StageTimes::now();
+
+			if(!bMeasure) {
+				continue;
+			}
+
+			nTracked += bTracked ? 1 : 0;
+
+			const gt::StageTimes &stages = tracker.getStageTimes();
+
+			for(int s = 0; s < gt::StageTimes::NOF_STAGES; ++s) {
+				if(stages.getDuration(s) >= 0) {
+					times[s].samples.push_back((double)stages.getDuration(s));
+				}
+			}
+
+			times[STAGE_FRAME].samples.push_back((double)(te - tf));
+			times[STAGE_MAPPER].samples.push_back((double)(te - tm));
+
+		}
+
+		const int64_t t2 = gt::StageTimes::now();
+
+		if(bMeasure) {
+			nAllocs += allocCounterStop();
+			totalNs += t2 - t1;
+		}
+
+	}
+
+
+	/**********************************************************************
+	 * Results
+	 *********************************************************************/
+	for(int i = 0; i < NOF_TIMES; ++i) {
+		times[i].compute();
+	}
+
+	const long nMeasured	= (long)nofRounds * nofFrames;
+	const double fps		= 1e9 * nMeasured / totalNs;
+	const double tracked	= (double)nTracked / nMeasured;
+	const double allocs		= (double)nAllocs / nMeasured;
+
+	printf("%s: %d frames of %dx%d, %d rounds, %d warm-up rounds, ",
+		   inputFile.c_str(), nofFrames, frames[0].cols, frames[0].rows, nofRounds, nofWarmUps);
+
+	if(cpu >= 0) {
+		printf("cpu %d\n\n", cpu);
+	}
+	else {
+		printf("not pinned\n\n");
+	}
+
+	printf("frame rate   %.1f fps\n", fps);
+	printf("tracked      %.1f %%\n", 100.0 * tracked);
+	printf("allocations  %.1f per frame\n\n", allocs);
+
+	printf("%-12s %8s %9s %9s %9s %9s %9s\n", "us", "n", "mean", "p50", "p95", "p99", "max");
+
+	printTimes(getTimeName(STAGE_FRAME), times[STAGE_FRAME]);
+
+	for(int i = 0; i < gt::StageTimes::NOF_STAGES; ++i) {
+		printTimes(getTimeName(i), times[i]);
+	}
+
+	printTimes(getTimeName(STAGE_MAPPER), times[STAGE_MAPPER]);
+
+	if(!jsonFile.empty() && !writeJSON(jsonFile, frames[0].size(), nofFrames, fps, tracked, allocs, times)) {
+		return -1;
+	}
+
+	return 0;
+
+}
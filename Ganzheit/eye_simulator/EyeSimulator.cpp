@@ -0,0 +1,689 @@
+#include "EyeSimulator.h"
+#include "trackerSettings.h"
+#include <stdio.h>
+#include <math.h>
+
+
+static const double PI = 3.14159265358979323846;
+
+/* Points on the pupil perimeter for the ground truth ellipse */
+static const int NOF_PERIMETER_POINTS = 32;
+
+/* Period of the change of the pupil radius, in seconds */
+static const double PUPIL_PERIOD = 7.0;
+
+/* Cornea centre behind the LEDs, when not given */
+static const double EYE_DISTANCE = 0.015;
+
+
+static void normalise(cv::Point3d &p) {
+
+	const double len = sqrt(p.dot(p));
+
+	if(len > 0.0) {
+		p *= 1.0 / len;
+	}
+
+}
+
+
+static cv::Point3d normalised(const cv::Point3d &p) {
+
+	cv::Point3d ret = p;
+	normalise(ret);
+
+	return ret;
+
+}
+
+
+
+/******************************************************************
+ * SimulatedFrame class
+ ******************************************************************/
+
+SimulatedFrame::SimulatedFrame() {
+
+	n				= 0;
+	yaw				= 0.0;
+	pitch			= 0.0;
+	closure			= 0.0;
+	bPupilVisible	= false;
+	pupilRadius		= 0.0;
+
+}
+
+
+
+/******************************************************************
+ * EyeSimulator::Params class
+ ******************************************************************/
+
+EyeSimulator::Params::Params() {
+
+	w					= 640;
+	h					= 480;
+	fps					= 30.0;
+	seed				= 1;
+
+	corneaCentre		= cv::Point3d(0.0, 0.0, 0.0);
+
+	eyeRadius			= 0.012;
+	rotationDistance	= 0.0057;
+	irisRadius			= 0.006;
+	pupilRadius			= 0.002;
+	pupilVariation		= 0.0005;
+
+	gazeRange			= 15.0;
+	fixationTime		= 0.4;
+	saccadeTime			= 0.05;
+	tremor				= 0.05;
+
+	blinkRate			= 15.0;
+	blinkTime			= 0.3;
+
+	eyelid				= 0.1;
+
+	// below the CR threshold of the tracker, except the glints
+	skin				= 120;
+	sclera				= 150;
+	iris				= 80;
+	pupil				= 20;
+	glint				= 255;
+
+	glintSigma			= 0.8;
+	blurSigma			= 0.8;
+	noiseSigma			= 2.0;
+
+	setEyeModel(trackerSettings);
+
+}
+
+
+void EyeSimulator::Params::setEyeModel(const TrackerSettings &settings) {
+
+	RHO	= settings.RHO;
+	rd	= settings.rd;
+	MYY	= settings.MYY;
+
+}
+
+
+
+/******************************************************************
+ * EyeSimulator class
+ ******************************************************************/
+
+EyeSimulator::EyeSimulator() {
+
+	eyeHalfWidth	= 0.0;
+	upperApex		= 0.0;
+	lowerApex		= 0.0;
+	closedApex		= 0.0;
+
+	reset();
+
+}
+
+
+bool EyeSimulator::init(const Camera &_camera, const std::vector<cv::Point3d> &_leds, const Params &_params) {
+
+	params	= _params;
+	camera	= _camera;
+	leds	= _leds;
+
+	const Params &p = params;
+
+	if(p.w <= 0 || p.h <= 0 || p.fps <= 0.0) {
+		printf("EyeSimulator::init(): Invalid frame size or rate\n");
+		return false;
+	}
+
+	if(p.rd >= p.RHO || p.irisRadius >= p.RHO || p.pupilRadius + p.pupilVariation >= p.irisRadius) {
+		printf("EyeSimulator::init(): The pupil must be inside the iris and the iris inside the cornea\n");
+		return false;
+	}
+
+
+	/**************************************************************
+	 * The ray of each pixel
+	 **************************************************************/
+	std::vector<cv::Point2d> pixels((size_t)p.w * p.h);
+	for(int y = 0; y < p.h; ++y) {
+		for(int x = 0; x < p.w; ++x) {
+			pixels[(size_t)y * p.w + x] = cv::Point2d(x, y);
+		}
+	}
+
+	rays.resize(pixels.size());
+	camera.pixToWorld(pixels, rays);
+
+
+	/**************************************************************
+	 * The primary position, behind the LEDs looking at the camera
+	 * unless given
+	 **************************************************************/
+	cv::Point3d c0 = p.corneaCentre;
+
+	if(c0 == cv::Point3d(0.0, 0.0, 0.0)) {
+
+		cv::Point3d mean(0.0, 0.0, 0.0);
+		for(size_t i = 0; i < leds.size(); ++i) {
+			mean += leds[i];
+		}
+
+		if(leds.empty() || mean.z <= 0.0) {
+			printf("EyeSimulator::init(): Give the cornea centre, the LEDs are not in front of the camera\n");
+			return false;
+		}
+
+		mean *= 1.0 / leds.size();
+
+		c0 = mean + EYE_DISTANCE * normalised(mean);
+
+	}
+
+	primaryAxis		= normalised(-c0);
+	right			= normalised(cv::Point3d(0.0, -1.0, 0.0).cross(primaryAxis));
+	up				= primaryAxis.cross(right);
+	rotationCentre	= c0 - p.rotationDistance * primaryAxis;
+
+
+	/**************************************************************
+	 * The eyelids around the iris at the primary position
+	 **************************************************************/
+	const cv::Point3d p0 = c0 + p.rd * primaryAxis;
+
+	camera.worldToPix(p0, &eyeCentre.x, &eyeCentre.y);
+
+	const double f			= camera.getIntrisicMatrix().at<double>(0, 0);
+	const double irisPix	= f * p.irisRadius / sqrt(p0.dot(p0));
+	const double h0			= 1.1 * irisPix;
+
+	eyeHalfWidth	= 2.2 * irisPix;
+	upperApex		= eyeCentre.y - h0 * (1.0 - 2.0 * p.eyelid);
+	lowerApex		= eyeCentre.y + 1.2 * h0;
+	closedApex		= eyeCentre.y + 0.5 * h0;
+
+
+	/**************************************************************
+	 * The eye ball in the image, with a margin
+	 **************************************************************/
+	cv::Point2d e;
+	camera.worldToPix(rotationCentre, &e.x, &e.y);
+
+	const double eyePix = 1.3 * f * p.eyeRadius / sqrt(rotationCentre.dot(rotationCentre));
+
+	roi = cv::Rect((int)(e.x - eyePix), (int)(e.y - eyePix), (int)(2.0 * eyePix), (int)(2.0 * eyePix)) &
+		  cv::Rect(0, 0, p.w, p.h);
+
+	reset();
+
+	return true;
+
+}
+
+
+void EyeSimulator::reset() {
+
+	rng = cv::RNG(params.seed);
+
+	n				= 0;
+
+	yaw				= pitch		= 0.0;
+	fromYaw			= fromPitch	= 0.0;
+	toYaw			= toPitch	= 0.0;
+	saccadeStart	= -1.0;
+	nextSaccade		= params.fixationTime * rng.uniform(0.5, 1.5);
+
+	blinkStart		= -1.0;
+	nextBlink		= params.blinkRate > 0.0 ? 60.0 / params.blinkRate * rng.uniform(0.5, 1.5) : -1.0;
+
+	closure			= 0.0;
+	pupilRadius		= params.pupilRadius;
+
+}
+
+
+void EyeSimulator::next(cv::Mat &img, SimulatedFrame &truth) {
+
+	move();
+
+	getTruth(truth);
+
+	render(img, truth);
+
+	++n;
+
+}
+
+
+void EyeSimulator::move() {
+
+	const Params &p = params;
+
+	const double t = n / p.fps;
+
+
+	/**************************************************************
+	 * Fixations and saccades, with a smooth start and stop
+	 **************************************************************/
+	if(t >= nextSaccade) {
+
+		fromYaw		= toYaw;
+		fromPitch	= toPitch;
+		toYaw		= rng.uniform(-p.gazeRange, p.gazeRange);
+		toPitch		= rng.uniform(-0.7 * p.gazeRange, 0.7 * p.gazeRange);
+
+		saccadeStart	= t;
+		nextSaccade		= t + p.saccadeTime + p.fixationTime * rng.uniform(0.5, 1.5);
+
+	}
+
+	double baseYaw		= toYaw;
+	double basePitch	= toPitch;
+
+	if(saccadeStart >= 0.0 && t < saccadeStart + p.saccadeTime) {
+
+		const double a = (t - saccadeStart) / p.saccadeTime;
+		const double s = a * a * (3.0 - 2.0 * a);
+
+		baseYaw		= fromYaw + s * (toYaw - fromYaw);
+		basePitch	= fromPitch + s * (toPitch - fromPitch);
+
+	}
+
+	yaw		= baseYaw + rng.gaussian(p.tremor);
+	pitch	= basePitch + rng.gaussian(p.tremor);
+
+
+	/**************************************************************
+	 * The pupil and the blinks, closing in a third of the blink
+	 **************************************************************/
+	pupilRadius = p.pupilRadius + p.pupilVariation * sin(2.0 * PI * t / PUPIL_PERIOD);
+
+	if(nextBlink >= 0.0 && t >= nextBlink) {
+		blinkStart	= t;
+		nextBlink	= t + p.blinkTime + 60.0 / p.blinkRate * rng.uniform(0.5, 1.5);
+	}
+
+	closure = 0.0;
+
+	if(blinkStart >= 0.0 && t < blinkStart + p.blinkTime) {
+
+		const double a = (t - blinkStart) / p.blinkTime;
+
+		closure = a < 1.0 / 3.0 ? 3.0 * a : 1.5 * (1.0 - a);
+
+	}
+
+
+	/**************************************************************
+	 * The eye
+	 **************************************************************/
+	axis			= getAxis(yaw, pitch);
+	corneaCentre	= rotationCentre + p.rotationDistance * axis;
+	pupilCentre		= corneaCentre + p.rd * axis;
+
+}
+
+
+cv::Point3d EyeSimulator::getAxis(double _yaw, double _pitch) const {
+
+	const double y = _yaw * PI / 180.0;
+	const double p = _pitch * PI / 180.0;
+
+	return normalised(cos(p) * cos(y) * primaryAxis + cos(p) * sin(y) * right + sin(p) * up);
+
+}
+
+
+bool EyeSimulator::traceToPupilPlane(const cv::Point3d &ray, cv::Point3d &hit) const {
+
+	const double RHO = params.RHO;
+	const double MYY = params.MYY;
+
+	const cv::Point3d &c = corneaCentre;
+
+
+	/**************************************************************
+	 * The front surface of the cornea
+	 **************************************************************/
+	const double a = ray.dot(ray);
+	const double b = -2.0 * ray.dot(c);
+	const double d = b * b - 4.0 * a * (c.dot(c) - RHO * RHO);
+
+	if(d < 0.0) {
+		return false;
+	}
+
+	const double s = (-b - sqrt(d)) / (2.0 * a);
+	if(s < 0.0) {
+		return false;
+	}
+
+	const cv::Point3d u = s * ray;
+	const cv::Point3d N = (u - c) * (1.0 / RHO);
+
+	// only the cap of the cornea in front of the iris
+	const double capCos = sqrt(1.0 - params.irisRadius * params.irisRadius / (RHO * RHO));
+	if(N.dot(axis) < capCos) {
+		return false;
+	}
+
+
+	/**************************************************************
+	 * Refract like GazeTracker::traceDirVecToPupil() and hit the
+	 * plane of the pupil
+	 **************************************************************/
+	const cv::Point3d l = normalised(ray);
+
+	const double cos1 = N.dot(-l);
+	const double cos2 = sqrt(1.0 - MYY * MYY * (1.0 - cos1 * cos1));
+
+	const cv::Point3d K = MYY * l + (MYY * cos1 - cos2) * N;
+
+	const double den = K.dot(axis);
+	if(den >= 0.0) {
+		return false;
+	}
+
+	hit = u + ((pupilCentre - u).dot(axis) / den) * K;
+
+	return true;
+
+}
+
+
+bool EyeSimulator::projectFromPupilPlane(const cv::Point3d &p, cv::Point2d &pix) const {
+
+	// the projection without refraction
+	cv::Point2d target;
+	camera.worldToPix(p, &target.x, &target.y);
+
+	pix = target;
+
+	// move the pixel by the error of the point it sees, until it sees p
+	for(int i = 0; i < 20; ++i) {
+
+		cv::Point3d ray, hit;
+		camera.pixToWorld(pix.x, pix.y, ray);
+
+		if(!traceToPupilPlane(ray, hit)) {
+			return false;
+		}
+
+		cv::Point2d seen;
+		camera.worldToPix(hit, &seen.x, &seen.y);
+
+		const cv::Point2d err = target - seen;
+
+		pix += err;
+
+		if(err.dot(err) < 1e-6) {
+			break;
+		}
+
+	}
+
+	return true;
+
+}
+
+
+bool EyeSimulator::getGlint(const cv::Point3d &led, cv::Point3d &reflection) const {
+
+	const cv::Point3d &c = corneaCentre;
+
+	// the normal halves the directions to the camera and to the LED
+	cv::Point3d N = normalised(normalised(-c) + normalised(led - c));
+
+	for(int i = 0; i < 20; ++i) {
+		reflection	= c + params.RHO * N;
+		N			= normalised(normalised(-reflection) + normalised(led - reflection));
+	}
+
+	reflection = c + params.RHO * N;
+
+	const double capCos = sqrt(1.0 - params.irisRadius * params.irisRadius / (params.RHO * params.RHO));
+
+	return N.dot(axis) >= capCos && N.dot(-reflection) > 0.0;
+
+}
+
+
+void EyeSimulator::getEyelids(double x, double &upper, double &lower) const {
+
+	const double d = (x - eyeCentre.x) / eyeHalfWidth;
+
+	// outside the eye corners
+	if(fabs(d) >= 1.0) {
+		upper = lower = eyeCentre.y;
+		return;
+	}
+
+	const double k = 1.0 - d * d;
+
+	const double upperOpen	= eyeCentre.y - (eyeCentre.y - upperApex) * k;
+	const double lowerOpen	= eyeCentre.y + (lowerApex - eyeCentre.y) * k;
+	const double closed		= eyeCentre.y + (closedApex - eyeCentre.y) * k;
+
+	upper = upperOpen + closure * (closed - upperOpen);
+	lower = lowerOpen + closure * (closed - lowerOpen);
+
+}
+
+
+bool EyeSimulator::isOccluded(const cv::Point2d &pix) const {
+
+	if(pix.x < 0.0 || pix.y < 0.0 || pix.x > params.w - 1 || pix.y > params.h - 1) {
+		return true;
+	}
+
+	double upper, lower;
+	getEyelids(pix.x, upper, lower);
+
+	return pix.y <= upper || pix.y >= lower;
+
+}
+
+
+void EyeSimulator::getTruth(SimulatedFrame &truth) {
+
+	truth.n				= n;
+	truth.yaw			= yaw;
+	truth.pitch			= pitch;
+	truth.closure		= closure;
+	truth.corneaCentre	= corneaCentre;
+	truth.pupilCentre	= pupilCentre;
+	truth.pupilRadius	= pupilRadius;
+
+
+	/**************************************************************
+	 * The pupil perimeter as seen through the cornea
+	 **************************************************************/
+	const cv::Point3d e1 = normalised(right - right.dot(axis) * axis);
+	const cv::Point3d e2 = axis.cross(e1);
+
+	std::vector<cv::Point2f> perimeter;
+	int nVisible = 0;
+
+	for(int i = 0; i < NOF_PERIMETER_POINTS; ++i) {
+
+		const double phi = 2.0 * PI * i / NOF_PERIMETER_POINTS;
+		const cv::Point3d p = pupilCentre + pupilRadius * (cos(phi) * e1 + sin(phi) * e2);
+
+		cv::Point2d pix;
+		if(projectFromPupilPlane(p, pix)) {
+
+			perimeter.push_back(cv::Point2f((float)pix.x, (float)pix.y));
+
+			if(!isOccluded(pix)) {
+				++nVisible;
+			}
+
+		}
+
+	}
+
+	truth.ellipsePupil	= perimeter.size() >= 5 ? cv::fitEllipse(perimeter) : cv::RotatedRect();
+	truth.bPupilVisible	= 2 * nVisible >= NOF_PERIMETER_POINTS;
+
+
+	/**************************************************************
+	 * The glints not hidden by the eyelids
+	 **************************************************************/
+	truth.glints.clear();
+	truth.labels.clear();
+
+	for(size_t i = 0; i < leds.size(); ++i) {
+
+		cv::Point3d reflection;
+		if(!getGlint(leds[i], reflection)) {
+			continue;
+		}
+
+		cv::Point2d pix;
+		camera.worldToPix(reflection, &pix.x, &pix.y);
+
+		if(!isOccluded(pix)) {
+			truth.glints.push_back(pix);
+			truth.labels.push_back((int)i);
+		}
+
+	}
+
+}
+
+
+void EyeSimulator::render(cv::Mat &img, const SimulatedFrame &truth) {
+
+	const Params &p = params;
+
+	img.create(p.h, p.w, CV_8UC1);
+	img.setTo(cv::Scalar(p.skin));
+
+	const double lidEdge = 3.0;
+
+	const cv::Point3d e1 = normalised(right - right.dot(axis) * axis);
+	const cv::Point3d e2 = axis.cross(e1);
+
+	for(int x = roi.x; x < roi.x + roi.width; ++x) {
+
+		if(fabs(x - eyeCentre.x) >= eyeHalfWidth) {
+			continue;
+		}
+
+		double upper, lower;
+		getEyelids(x, upper, lower);
+
+		const int yBegin	= std::max(roi.y, (int)ceil(upper - lidEdge));
+		const int yEnd		= std::min(roi.y + roi.height, (int)floor(lower) + 1);
+
+		for(int y = yBegin; y < yEnd; ++y) {
+
+			unsigned char &px = img.at<unsigned char>(y, x);
+
+			// the dark edge of the upper lid
+			if(y <= upper) {
+				px = (unsigned char)(p.skin / 2);
+				continue;
+			}
+
+			if(y >= lower) {
+				continue;
+			}
+
+			const cv::Point3d &ray = rays[(size_t)y * p.w + x];
+
+			cv::Point3d hit;
+			if(traceToPupilPlane(ray, hit)) {
+
+				const cv::Point3d r = hit - pupilCentre;
+				const double dist = sqrt(r.dot(r));
+
+				if(dist < pupilRadius) {
+					px = (unsigned char)p.pupil;
+				}
+				else if(dist < p.irisRadius) {
+					// radial texture
+					const double phi = atan2(r.dot(e2), r.dot(e1));
+					px = cv::saturate_cast<unsigned char>(p.iris + 8.0 * sin(14.0 * phi));
+				}
+				else {
+					px = (unsigned char)p.sclera;
+				}
+
+				continue;
+
+			}
+
+			// the eye ball, darker towards its edges
+			const cv::Point3d &c = rotationCentre;
+			const double a = ray.dot(ray);
+			const double b = -2.0 * ray.dot(c);
+			const double d = b * b - 4.0 * a * (c.dot(c) - p.eyeRadius * p.eyeRadius);
+
+			if(d >= 0.0) {
+
+				const cv::Point3d u = ((-b - sqrt(d)) / (2.0 * a)) * ray;
+				const cv::Point3d N = (u - c) * (1.0 / p.eyeRadius);
+
+				px = cv::saturate_cast<unsigned char>(p.sclera * (0.75 + 0.25 * N.dot(-normalised(ray))));
+
+			}
+
+		}
+
+	}
+
+
+	/**************************************************************
+	 * The glints
+	 **************************************************************/
+	const int r = (int)ceil(3.0 * p.glintSigma);
+
+	for(size_t i = 0; i < truth.glints.size(); ++i) {
+
+		const cv::Point2d &g = truth.glints[i];
+
+		for(int y = (int)g.y - r; y <= (int)g.y + r + 1; ++y) {
+			for(int x = (int)g.x - r; x <= (int)g.x + r + 1; ++x) {
+
+				if(x < 0 || y < 0 || x >= p.w || y >= p.h) {
+					continue;
+				}
+
+				const double d2 = (x - g.x) * (x - g.x) + (y - g.y) * (y - g.y);
+
+				unsigned char &px = img.at<unsigned char>(y, x);
+
+				px = cv::saturate_cast<unsigned char>(px + 2.0 * p.glint * exp(-d2 / (2.0 * p.glintSigma * p.glintSigma)));
+
+			}
+		}
+
+	}
+
+
+	/**************************************************************
+	 * Blur and noise, and as the camera captures it
+	 **************************************************************/
+	if(p.blurSigma > 0.0) {
+		cv::GaussianBlur(img, img, cv::Size(0, 0), p.blurSigma);
+	}
+
+	if(p.noiseSigma > 0.0) {
+
+		noise.create(p.h, p.w, CV_16SC1);
+		rng.fill(noise, cv::RNG::NORMAL, cv::Scalar(0.0), cv::Scalar(p.noiseSigma));
+
+		cv::add(img, noise, img, cv::noArray(), CV_8U);
+
+	}
+
+	if(camera.isMirrored()) {
+		cv::flip(img, img, 1);
+	}
+
+}
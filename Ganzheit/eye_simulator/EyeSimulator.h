@@ -0,0 +1,211 @@
+#ifndef EYE_SIMULATOR_H
+#define EYE_SIMULATOR_H
+
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <vector>
+#include "Camera.h"
+
+
+class TrackerSettings;
+
+
+/*
+ * The ground truth of a simulated frame. The image coordinates are those
+ * of the tracker, i.e. of the frame after it has been mirrored back if
+ * the camera is mirrored, see Camera::setMirrored(). The 3D coordinates
+ * are in the eye camera coordinate system, in metres.
+ */
+class SimulatedFrame {
+
+	public:
+
+		SimulatedFrame();
+
+		unsigned long n;					// frame number, from 0
+		double yaw, pitch;					// of the gaze from the primary position, in degrees
+		double closure;						// of the eyelids, 0 is open and 1 closed
+		bool bPupilVisible;					// at least half of the pupil perimeter is visible
+		cv::RotatedRect ellipsePupil;		// the pupil in the image
+		cv::Point3d corneaCentre;			// cornea centre
+		cv::Point3d pupilCentre;			// pupil centre
+		double pupilRadius;					// in metres
+		std::vector<cv::Point2d> glints;	// the visible glints
+		std::vector<int> labels;			// the LED of each glint
+
+};
+
+
+/*
+ * Renders eye camera frames of a moving eye with known ground truth, so
+ * that the tracker can be measured on any number of frames without
+ * recordings. The eye follows the model of the tracker: the cornea is a
+ * sphere of radius RHO, the pupil is a disc at the distance rd from the
+ * cornea centre, and the rays to the pupil are refracted with MYY at the
+ * cornea. The glints are the reflections of the calibrated LEDs on the
+ * cornea, labelled with the index of the LED.
+ *
+ * The eye fixates random targets and makes saccades between them, the
+ * pupil size changes slowly and the eye blinks. The frames are blurred
+ * and noise is added. Everything random comes from the seed, so the same
+ * parameters give the same frames:
+ *
+ *     EyeSimulator sim;
+ *     sim.init(camera, leds, params);
+ *     while(...) {
+ *         sim.next(img, truth);
+ *         ...
+ *     }
+ */
+class EyeSimulator {
+
+	public:
+
+		class Params {
+
+			public:
+
+				/* The defaults, and the eye model of the global trackerSettings */
+				Params();
+
+				/* Copy RHO, rd and MYY of the settings */
+				void setEyeModel(const TrackerSettings &settings);
+
+				int w, h;					// frame size
+				double fps;					// frame rate
+				unsigned long seed;			// of the random numbers
+
+				/*
+				 * The cornea centre at the primary position. If zero, the
+				 * eye is placed behind the LEDs, looking at the camera.
+				 */
+				cv::Point3d corneaCentre;
+
+				double RHO;					// cornea radius
+				double rd;					// cornea centre to pupil centre
+				double MYY;					// n_air / n_cornea
+				double eyeRadius;			// of the eye ball
+				double rotationDistance;	// cornea centre to the centre of rotation
+				double irisRadius;
+				double pupilRadius;			// mean
+				double pupilVariation;		// amplitude of the slow change of the radius
+
+				double gazeRange;			// of the fixations from the primary position, in degrees
+				double fixationTime;		// mean, in seconds
+				double saccadeTime;			// in seconds
+				double tremor;				// deviation of the eye position during a fixation, in degrees
+
+				double blinkRate;			// per minute
+				double blinkTime;			// in seconds
+
+				/* How far the upper eyelid covers the iris, 0.5 is to its centre */
+				double eyelid;
+
+				/* Intensities */
+				int skin, sclera, iris, pupil, glint;
+
+				double glintSigma;			// of the glint spots, in pixels
+				double blurSigma;			// of the frame, 0 for none
+				double noiseSigma;			// of the added noise, 0 for none
+
+		};
+
+
+		EyeSimulator();
+
+		/*
+		 * leds are the LED positions from the calibration of the eye
+		 * camera, see CalibDataReader. Returns false if the parameters are
+		 * not usable.
+		 */
+		bool init(const Camera &camera, const std::vector<cv::Point3d> &leds, const Params &params);
+
+		/* Back to the first frame */
+		void reset();
+
+		/*
+		 * Render the next 8-bit gray frame, as the camera captures it,
+		 * and its ground truth.
+		 */
+		void next(cv::Mat &img, SimulatedFrame &truth);
+
+		const Params &getParams() const {return params;}
+
+	private:
+
+		/* The eye state of the next frame */
+		void move();
+
+		/* The optical axis for the gaze angles in degrees */
+		cv::Point3d getAxis(double yaw, double pitch) const;
+
+		/* Trace the ray through the cornea to the plane of the pupil */
+		bool traceToPupilPlane(const cv::Point3d &ray, cv::Point3d &hit) const;
+
+		/* The pixel that sees the point on the pupil plane through the cornea */
+		bool projectFromPupilPlane(const cv::Point3d &p, cv::Point2d &pix) const;
+
+		/* The reflection of the LED on the cornea */
+		bool getGlint(const cv::Point3d &led, cv::Point3d &reflection) const;
+
+		/* The y of the upper and lower eyelids at x, with the current closure */
+		void getEyelids(double x, double &upper, double &lower) const;
+
+		bool isOccluded(const cv::Point2d &pix) const;
+
+		/* The frame with the glints of the truth */
+		void render(cv::Mat &img, const SimulatedFrame &truth);
+
+		void getTruth(SimulatedFrame &truth);
+
+		Params params;
+		Camera camera;
+		std::vector<cv::Point3d> leds;
+
+		/* The ray of each pixel, from Camera::pixToWorld() */
+		std::vector<cv::Point3d> rays;
+
+		/* The primary position */
+		cv::Point3d primaryAxis;
+		cv::Point3d right, up;
+		cv::Point3d rotationCentre;
+
+		/* The eye corners and the apexes of the open eyelids in the image */
+		cv::Point2d eyeCentre;
+		double eyeHalfWidth;
+		double upperApex;
+		double lowerApex;
+		double closedApex;
+
+		/* The area of the eye ball in the image */
+		cv::Rect roi;
+
+		cv::RNG rng;
+
+		unsigned long n;
+
+		/* The fixation */
+		double yaw, pitch;
+		double fromYaw, fromPitch;
+		double toYaw, toPitch;
+		double saccadeStart;
+		double nextSaccade;
+
+		double blinkStart;
+		double nextBlink;
+
+		/* The current eye */
+		double closure;
+		double pupilRadius;
+		cv::Point3d axis;
+		cv::Point3d corneaCentre;
+		cv::Point3d pupilCentre;
+
+		/* The noise of a frame */
+		cv::Mat noise;
+
+};
+
+
+#endif
@@ -0,0 +1,466 @@
+/*
+ * Generates a recording of a simulated eye, see EyeSimulator, for
+ * measuring the tracker without recordings. The eye frames are written
+ * as MJPG with VideoWriter, like gazetoworld records, with uniform scene
+ * frames, so the recording can be replayed and viewed with the tools of
+ * the real recordings:
+ *
+ *     parent/<date>T<time>/partX/...	the recording, the results are the
+ *										ground truth of the frames
+ *     parent/<date>T<time>/truth.csv	the ground truth with the LED of
+ *										each glint
+ *
+ * The frames are as the mirrored eye camera of gazetoworld captures them.
+ * Without -o the frames are only rendered and the rate is printed.
+ *
+ * Usage: eye_simulator -e <eyeCam.calib> [-o <parent>] [options]
+ */
+
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+#include <string>
+
+#include "EyeSimulator.h"
+#include "trackerSettings.h"
+#include "localTrackerSettings.h"
+#include "settingsIO.h"
+#include "CalibDataReader.h"
+#include "VideoWriter.h"
+#include "CameraFrame.h"
+#include "BinaryResultParser.h"
+#include "ResultData.h"
+#include "InputParser.h"
+
+
+/******************************************************************************
+ * Options
+ ******************************************************************************/
+
+static std::string eyeCamCalibFile;
+static std::string trackerFile;
+static std::string parentDir;
+
+static int nofFrames		= 300;
+static bool bMirrored		= true;
+static bool bPrintHelp		= false;
+
+static EyeSimulator::Params params;
+
+
+static bool handleParameter(const ParamAndValue &pair) {
+
+	const double value = atof(pair.value.c_str());
+
+	if(pair.name == "e") {
+		eyeCamCalibFile = pair.value;
+	}
+	else if(pair.name == "t") {
+		trackerFile = pair.value;
+	}
+	else if(pair.name == "o") {
+		parentDir = pair.value;
+	}
+	else if(pair.name == "n") {
+		nofFrames = atoi(pair.value.c_str());
+	}
+	else if(pair.name == "mirror") {
+		bMirrored = atoi(pair.value.c_str()) != 0;
+	}
+	else if(pair.name == "seed") {
+		params.seed = strtoul(pair.value.c_str(), NULL, 10);
+	}
+	else if(pair.name == "fps") {
+		params.fps = value;
+	}
+	else if(pair.name == "gaze") {
+		params.gazeRange = value;
+	}
+	else if(pair.name == "pupil") {
+		params.pupilRadius = 1e-3 * value;
+	}
+	else if(pair.name == "blink") {
+		params.blinkRate = value;
+	}
+	else if(pair.name == "eyelid") {
+		params.eyelid = value;
+	}
+	else if(pair.name == "noise") {
+		params.noiseSigma = value;
+	}
+	else if(pair.name == "blur") {
+		params.blurSigma = value;
+	}
+	else if(pair.name == "h" || pair.name == "help") {
+		bPrintHelp = true;
+	}
+	else {
+		return false;
+	}
+
+	return true;
+
+}
+
+
+static bool handleInputParameters(int argc, const char **args) {
+
+	std::vector<ParamAndValue> argVec;
+	if(!parseInput(argc, args, argVec)) {
+		printf("handleInputParameters(): Error parsing input\n");
+		return false;
+	}
+
+	for(size_t i = 0; i < argVec.size(); ++i) {
+
+		if(!handleParameter(argVec[i])) {
+			printf("-%s %s not defined\n", argVec[i].name.c_str(), argVec[i].value.c_str());
+			return false;
+		}
+
+	}
+
+	return true;
+
+}
+
+
+static void printUsageInfo() {
+
+	const EyeSimulator::Params defaults;
+
+	printf("Usage:\n"
+		   "  ./eye_simulator [option arguments]\n"
+		   "  option arguments:\n"
+		   "      -e <eyeCam.calib>    The eye camera and LED calibration\n"
+		   "      [-o <parent>]        Write the recording into a new folder in parent\n"
+		   "      [-n <frames>]        %d by default\n"
+		   "      [-t <settings.xml>]  The tracker settings of the eye model\n"
+		   "      [-mirror <0|1>]      The camera is mirrored, 1 by default\n"
+		   "      [-seed <n>]          %lu by default\n"
+		   "      [-fps <rate>]        %.0f by default\n"
+		   "      [-gaze <degrees>]    Range of the fixations, %.0f by default\n"
+		   "      [-pupil <mm>]        Mean pupil radius, %.1f by default\n"
+		   "      [-blink <n>]         Blinks per minute, %.0f by default\n"
+		   "      [-eyelid <0..1>]     How far the upper eyelid covers the iris, %.1f by default\n"
+		   "      [-noise <sigma>]     Of the noise, %.1f by default\n"
+		   "      [-blur <sigma>]      Of the blur, %.1f by default\n"
+		   "      [-h]                 Display help\n",
+		   nofFrames, defaults.seed, defaults.fps, defaults.gazeRange, 1e3 * defaults.pupilRadius,
+		   defaults.blinkRate, defaults.eyelid, defaults.noiseSigma, defaults.blurSigma);
+
+}
+
+
+/*
+ * The eye camera and the LEDs, like gazetoworld. The frame size is that
+ * of the calibration if it is known.
+ */
+static bool readEyeCamera(Camera &camera, std::vector<cv::Point3d> &leds) {
+
+	CalibDataReader calibReader;
+	if(!calibReader.create(eyeCamCalibFile)) {
+		printf("readEyeCamera(): Could not load %s\n", eyeCamCalibFile.c_str());
+		return false;
+	}
+
+	calib::CameraCalibContainer camContainer;
+	std::vector<calib::LEDCalibContainer> ledContainers;
+
+	if(!calibReader.readCameraContainer(camContainer) || !calibReader.readLEDContainers(ledContainers)) {
+		printf("readEyeCamera(): Could not read %s\n", eyeCamCalibFile.c_str());
+		return false;
+	}
+
+	camera.setIntrinsicMatrix(camContainer.intr);
+	camera.setDistortion(camContainer.dist);
+	camera.setMirrored(bMirrored);
+
+	if(camContainer.imgSize.width > 0 && camContainer.imgSize.height > 0) {
+		params.w = camContainer.imgSize.width;
+		params.h = camContainer.imgSize.height;
+	}
+
+	leds.resize(ledContainers.size());
+	for(size_t i = 0; i < ledContainers.size(); ++i) {
+		const double *pos = ledContainers[i].LED_pos;
+		leds[i] = cv::Point3d(pos[0], pos[1], pos[2]);
+	}
+
+	return true;
+
+}
+
+
+static void toResults(const SimulatedFrame &truth, time_t t0, ResultData &data) {
+
+	data.clear();
+
+	data.id					= truth.n;
+	data.timestamp			= t0 + (time_t)(truth.n / params.fps);
+	data.bTrackSuccessfull	= truth.bPupilVisible;
+	data.trackDurMicros		= 0;
+	data.ellipsePupil		= truth.ellipsePupil;
+	data.corneaCentre		= truth.corneaCentre;
+	data.pupilCentre		= truth.pupilCentre;
+	data.listGlints			= truth.glints;
+
+}
+
+
+static void writeTruthHeader(FILE *f, size_t nofLEDs) {
+
+	fprintf(f, "frame,yaw,pitch,closure,pupil_visible,"
+			   "ellipse_x,ellipse_y,ellipse_w,ellipse_h,ellipse_angle,"
+			   "cornea_x,cornea_y,cornea_z,pupil_x,pupil_y,pupil_z,pupil_radius");
+
+	for(size_t i = 0; i < nofLEDs; ++i) {
+		fprintf(f, ",glint%d_x,glint%d_y", (int)i, (int)i);
+	}
+
+	fprintf(f, "\n");
+
+}
+
+
+/* The glints of the LEDs that are not visible are empty */
+static void writeTruth(FILE *f, const SimulatedFrame &truth, size_t nofLEDs) {
+
+	const cv::RotatedRect &e = truth.ellipsePupil;
+
+	fprintf(f, "%lu,%.4f,%.4f,%.4f,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.8f,%.8f,%.8f,%.8f,%.8f,%.8f,%.8f",
+			truth.n, truth.yaw, truth.pitch, truth.closure, truth.bPupilVisible ? 1 : 0,
+			e.center.x, e.center.y, e.size.width, e.size.height, e.angle,
+			truth.corneaCentre.x, truth.corneaCentre.y, truth.corneaCentre.z,
+			truth.pupilCentre.x, truth.pupilCentre.y, truth.pupilCentre.z, truth.pupilRadius);
+
+	for(size_t i = 0; i < nofLEDs; ++i) {
+
+		size_t j = 0;
+		while(j < truth.labels.size() && truth.labels[j] != (int)i) {
+			++j;
+		}
+
+		if(j < truth.labels.size()) {
+			fprintf(f, ",%.3f,%.3f", truth.glints[j].x, truth.glints[j].y);
+		}
+		else {
+			fprintf(f, ",,");
+		}
+
+	}
+
+	fprintf(f, "\n");
+
+}
+
+
+/*
+ * The simulator is not realtime, so the frames and the results are not
+ * dropped when the writer stalls, they are offered again. addFrames()
+ * waits for room at most the block time of the policy per try.
+ */
+static const int MAX_WRITE_TRIES		= 10;
+static const useconds_t RETRY_MICROS	= 100000;
+
+static bool addFrames(VideoWriter *writer, const CameraFrame *eye, const CameraFrame *scene, unsigned long id) {
+
+	for(int i = 0; i < MAX_WRITE_TRIES; ++i) {
+
+		if(writer->addFrames(eye, scene, id)) {
+			return true;
+		}
+
+	}
+
+	return false;
+
+}
+
+
+static bool addResults(VideoWriter *writer, const std::vector<char> &buff) {
+
+	for(int i = 0; i < MAX_WRITE_TRIES; ++i) {
+
+		if(writer->addResults(buff)) {
+			return true;
+		}
+
+		// the results do not wait for room
+		usleep(RETRY_MICROS);
+
+	}
+
+	return false;
+
+}
+
+
+int main(int argc, const char **argv) {
+
+	if(!handleInputParameters(argc, argv) || bPrintHelp || eyeCamCalibFile.empty() || nofFrames <= 0) {
+		printUsageInfo();
+		return -1;
+	}
+
+	if(!trackerFile.empty()) {
+
+		SettingsIO settingsFile(trackerFile);
+		if(!settingsFile.isOpen()) {
+			printf("Could not read %s\n", trackerFile.c_str());
+			return -1;
+		}
+
+		LocalTrackerSettings localSettings;
+		localSettings.open(settingsFile);
+		trackerSettings.set(localSettings);
+
+		params.setEyeModel(trackerSettings);
+
+	}
+
+	Camera camera;
+	std::vector<cv::Point3d> leds;
+
+	if(!readEyeCamera(camera, leds)) {
+		return -1;
+	}
+
+	EyeSimulator sim;
+	if(!sim.init(camera, leds, params)) {
+		return -1;
+	}
+
+
+	/**********************************************************************
+	 * The recording, the scene frames are all the same
+	 *********************************************************************/
+	VideoWriter *writer = NULL;
+	FILE *fTruth = NULL;
+	std::vector<unsigned char> scene;
+
+	if(!parentDir.empty()) {
+
+		writer = new VideoWriter();
+
+		// nothing may be dropped
+		writer->setPolicy(QueuePolicy::POLICY_BLOCK, 1000);
+
+		if(!writer->init(parentDir + "/") || !writer->start()) {
+			printf("Could not start the writer\n");
+			delete writer;
+			return -1;
+		}
+
+		const std::string truthFile = writer->getDir() + "truth.csv";
+
+		fTruth = fopen(truthFile.c_str(), "w");
+		if(fTruth == NULL) {
+			printf("Could not create %s\n", truthFile.c_str());
+			writer->end();
+			delete writer;
+			return -1;
+		}
+
+		writeTruthHeader(fTruth, leds.size());
+
+		const cv::Mat imgScene(params.h, params.w, CV_8UC3, cv::Scalar(128, 128, 128));
+		cv::imencode(".jpg", imgScene, scene);
+
+	}
+
+
+	/**********************************************************************
+	 * Render
+	 *********************************************************************/
+	const time_t t0 = time(NULL);
+	const int64_t interval = (int64_t)(1e6 / params.fps);
+
+	int nTracked = 0;
+	int nGlints = 0;
+
+	cv::Mat img, imgBGR;
+	SimulatedFrame truth;
+	std::vector<unsigned char> jpg;
+
+	const int64_t t1 = CameraFrame::getTime();
+
+	bool ok = true;
+
+	for(int i = 0; i < nofFrames; ++i) {
+
+		sim.next(img, truth);
+
+		nTracked += truth.bPupilVisible ? 1 : 0;
+		nGlints += (int)truth.glints.size();
+
+		if(writer == NULL) {
+			continue;
+		}
+
+		// the eye camera is a colour camera
+		cv::cvtColor(img, imgBGR, CV_GRAY2BGR);
+		cv::imencode(".jpg", imgBGR, jpg);
+
+		CameraFrame eye(params.w, params.h, 3, &jpg[0], jpg.size(), FORMAT_MJPG, false, false);
+		CameraFrame sceneFrame(params.w, params.h, 3, &scene[0], scene.size(), FORMAT_MJPG, false, false);
+
+		eye.timestamp = sceneFrame.timestamp = (i + 1) * interval;
+
+		if(!addFrames(writer, &eye, &sceneFrame, i)) {
+			printf("The writer did not take the frames %d\n", i);
+			ok = false;
+			break;
+		}
+
+		ResultData data;
+		toResults(truth, t0, data);
+
+		std::vector<char> buff;
+		BinaryResultParser::resDataToBuffer(data, buff);
+
+		if(!addResults(writer, buff)) {
+			printf("The writer did not take the results %d\n", i);
+			ok = false;
+			break;
+		}
+
+		writeTruth(fTruth, truth, leds.size());
+
+	}
+
+	const int64_t t2 = CameraFrame::getTime();
+
+	if(!ok) {
+
+		writer->end();
+
+		delete writer;
+		fclose(fTruth);
+
+		return -1;
+
+	}
+
+	printf("%d frames of %dx%d, %.1f frames/s\n", nofFrames, params.w, params.h, 1e6 * nofFrames / (t2 - t1));
+	printf("pupil visible in %.1f %%, %.2f glints per frame\n", 100.0 * nTracked / nofFrames, (double)nGlints / nofFrames);
+
+	if(writer != NULL) {
+
+		writer->end();
+
+		printf("Wrote %s\n", writer->getDir().c_str());
+
+		delete writer;
+		fclose(fTruth);
+
+	}
+
+	return 0;
+
+}
@@ -0,0 +1,301 @@
+/*
+ * Tracks simulated frames, see EyeSimulator, and compares the results of
+ * the tracker with the ground truth:
+ *
+ *     pupil       the share of the frames with a visible pupil where the
+ *                 pupil was found, and the error of the ellipse centre
+ *     blinks      pupils found when less than half of the pupil is
+ *                 visible
+ *     glints      the share of the visible glints labelled with their
+ *                 LED, and the error of the labelled ones
+ *     cornea      the error of the cornea centre of the tracked frames
+ *     pupil 3D    the error of the pupil centre of the tracked frames
+ *
+ * The simulator must render the same frames again after reset() and in
+ * another instance with the same parameters, which is checked. The
+ * accuracy is printed for comparing the changes to the tracker.
+ *
+ * Usage: tracking [eyeCam.calib] [frames]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include "EyeSimulator.h"
+#include "GazeTracker.h"
+#include "trackerSettings.h"
+#include "CalibDataReader.h"
+
+
+/* Rendered twice for the determinism */
+static const int NOF_REPEATED = 30;
+
+
+class Errors {
+
+	public:
+
+		Errors() {
+			n = 0;
+		}
+
+		void add(double err) {
+			errs.push_back(err);
+		}
+
+		void print(const char *name, const char *unit, double scale) {
+
+			if(errs.empty()) {
+				printf("%-10s %8s\n", name, "-");
+				return;
+			}
+
+			std::sort(errs.begin(), errs.end());
+
+			double sum = 0.0;
+			for(size_t i = 0; i < errs.size(); ++i) {
+				sum += errs[i];
+			}
+
+			printf("%-10s %8.1f %% %9.3f %9.3f %9.3f  %s\n", name,
+				   n > 0 ? 100.0 * errs.size() / n : 100.0,
+				   scale * sum / errs.size(),
+				   scale * errs[errs.size() / 2],
+				   scale * errs[(errs.size() * 95) / 100],
+				   unit);
+
+		}
+
+		/* The number of cases, of which errs were found */
+		int n;
+		std::vector<double> errs;
+
+};
+
+
+static double dist(const cv::Point2d &a, const cv::Point2d &b) {
+
+	const cv::Point2d d = a - b;
+
+	return sqrt(d.dot(d));
+
+}
+
+
+static double dist(const double *a, const cv::Point3d &b) {
+
+	const cv::Point3d d(a[0] - b.x, a[1] - b.y, a[2] - b.z);
+
+	return sqrt(d.dot(d));
+
+}
+
+
+static bool readEyeCamera(const std::string &file, Camera &camera, std::vector<cv::Point3d> &leds) {
+
+	CalibDataReader calibReader;
+	calib::CameraCalibContainer camContainer;
+	std::vector<calib::LEDCalibContainer> ledContainers;
+
+	if(!calibReader.create(file) || !calibReader.readCameraContainer(camContainer) ||
+	   !calibReader.readLEDContainers(ledContainers)) {
+		printf("readEyeCamera(): Could not read %s\n", file.c_str());
+		return false;
+	}
+
+	camera.setIntrinsicMatrix(camContainer.intr);
+	camera.setDistortion(camContainer.dist);
+	camera.setMirrored(true);
+
+	leds.resize(ledContainers.size());
+	for(size_t i = 0; i < ledContainers.size(); ++i) {
+		const double *pos = ledContainers[i].LED_pos;
+		leds[i] = cv::Point3d(pos[0], pos[1], pos[2]);
+	}
+
+	return true;
+
+}
+
+
+static bool isSame(const cv::Mat &img1, const SimulatedFrame &truth1, const cv::Mat &img2, const SimulatedFrame &truth2) {
+
+	return cv::norm(img1, img2, cv::NORM_INF) == 0.0 &&
+		   truth1.ellipsePupil.center == truth2.ellipsePupil.center &&
+		   truth1.corneaCentre == truth2.corneaCentre &&
+		   truth1.glints == truth2.glints;
+
+}
+
+
+/* Render again after reset() and with another instance */
+static bool checkDeterminism(const Camera &camera, const std::vector<cv::Point3d> &leds) {
+
+	EyeSimulator::Params params;
+
+	EyeSimulator sim1, sim2;
+	if(!sim1.init(camera, leds, params) || !sim2.init(camera, leds, params)) {
+		return false;
+	}
+
+	std::vector<cv::Mat> imgs(NOF_REPEATED);
+	std::vector<SimulatedFrame> truths(NOF_REPEATED);
+
+	for(int i = 0; i < NOF_REPEATED; ++i) {
+		sim1.next(imgs[i], truths[i]);
+	}
+
+	sim1.reset();
+
+	cv::Mat img;
+	SimulatedFrame truth;
+
+	for(int i = 0; i < NOF_REPEATED; ++i) {
+
+		sim1.next(img, truth);
+
+		if(!isSame(img, truth, imgs[i], truths[i])) {
+			printf("    frame %d differs after reset()\n", i);
+			return false;
+		}
+
+		sim2.next(img, truth);
+
+		if(!isSame(img, truth, imgs[i], truths[i])) {
+			printf("    frame %d differs in another instance\n", i);
+			return false;
+		}
+
+	}
+
+	return true;
+
+}
+
+
+int main(int argc, char **argv) {
+
+	const std::string calibFile	= argc > 1 ? argv[1] : "../../../../example_eyeCam.calib";
+	const int nofFrames			= argc > 2 ? atoi(argv[2]) : 600;
+
+	Camera camera;
+	std::vector<cv::Point3d> leds;
+
+	if(!readEyeCamera(calibFile, camera, leds)) {
+		return -1;
+	}
+
+	if(!checkDeterminism(camera, leds)) {
+		printf("Determinism FAILED\n");
+		return -1;
+	}
+
+	EyeSimulator sim;
+	if(!sim.init(camera, leds, EyeSimulator::Params())) {
+		return -1;
+	}
+
+	gt::GazeTracker tracker;
+	tracker.init(camera, leds, trackerSettings);
+
+
+	/**********************************************************************
+	 * Track and compare
+	 *********************************************************************/
+	Errors pupil, blinks, glints, cornea, pupil3D;
+
+	cv::Mat img;
+	SimulatedFrame truth;
+
+	int64_t renderNs = 0;
+	int64_t trackNs = 0;
+
+	for(int i = 0; i < nofFrames; ++i) {
+
+		const int64_t t1 = gt::StageTimes::now();
+
+		sim.next(img, truth);
+
+		const int64_t t2 = gt::StageTimes::now();
+
+		const bool bTracked = tracker.track(img);
+
+		const int64_t t3 = gt::StageTimes::now();
+
+		renderNs += t2 - t1;
+		trackNs += t3 - t2;
+
+		const gt::PupilFrame &frame = tracker.getPupilTracker()->getFrame();
+
+		if(truth.bPupilVisible) {
+
+			++pupil.n;
+
+			if(frame.isPupilFound()) {
+				pupil.add(dist(frame.getEllipsePupil()->center, truth.ellipsePupil.center));
+			}
+
+		}
+		else {
+
+			++blinks.n;
+
+			if(frame.isPupilFound()) {
+				blinks.add(0.0);
+			}
+
+		}
+
+		// the labelled glints of the visible ones
+		const std::vector<gt::LED> &trackedLEDs = tracker.getLEDs();
+
+		for(size_t j = 0; j < truth.glints.size(); ++j) {
+
+			const int label = truth.labels[j];
+
+			++glints.n;
+
+			if(label < (int)trackedLEDs.size() && trackedLEDs[label].getLabel() == label) {
+				glints.add(dist(trackedLEDs[label].getGlint2D(), truth.glints[j]));
+			}
+
+		}
+
+		if(truth.bPupilVisible) {
+
+			++cornea.n;
+			++pupil3D.n;
+
+			if(bTracked) {
+				cornea.add(dist(tracker.getCentreCornea(), truth.corneaCentre));
+				pupil3D.add(dist(tracker.getCentrePupil(), truth.pupilCentre));
+			}
+
+		}
+
+	}
+
+
+	/**********************************************************************
+	 * Results
+	 *********************************************************************/
+	printf("%d frames, rendered %.1f frames/s, tracked %.1f frames/s\n\n", nofFrames,
+		   1e9 * nofFrames / renderNs, 1e9 * nofFrames / trackNs);
+
+	printf("%-10s %10s %9s %9s %9s\n", "", "found", "mean", "p50", "p95");
+
+	pupil.print("pupil", "px", 1.0);
+	glints.print("glints", "px", 1.0);
+	cornea.print("cornea", "mm", 1e3);
+	pupil3D.print("pupil 3D", "mm", 1e3);
+
+	printf("\na pupil found in %d of the %d frames with a hidden pupil\n", (int)blinks.errs.size(), blinks.n);
+
+	printf("\nOK\n");
+
+	return 0;
+
+}
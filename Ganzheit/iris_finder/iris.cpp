@@ -78,7 +78,10 @@ namespace iris {
                                    int edge_thresh,
                                    std::vector<cv::Point2f> & pointList);
 
-    static void removeOutliers(cv::Point2f &mean, double var, std::vector<cv::Point2f> &vecEdges);
+    static void removeOutliers(cv::Point2f &mean,
+                               double var,
+                               double dOutlierDistance,
+                               std::vector<cv::Point2f> &vecEdges);
 
 
 
@@ -87,6 +90,17 @@ namespace iris {
                const cv::RotatedRect &ellipse,
                std::vector<cv::Point2f> &vecEdges) {
 
+        return burst(img_gray, roi, ellipse, vecEdges, trackerSettings);
+
+    }
+
+
+    bool burst(const cv::Mat &img_gray,
+               const cv::Rect &roi,
+               const cv::RotatedRect &ellipse,
+               std::vector<cv::Point2f> &vecEdges,
+               const TrackerSettings &settings) {
+
         // set a valid ROI
         cv::Rect validRoi;
 
@@ -132,7 +146,7 @@ namespace iris {
             return UNRECOVERABLE_ERROR;
         }
 
-        //        removeOutliers(center, var, vecEdges);
+        //        removeOutliers(center, var, settings.STARBURST_OUTLIER_DISTANCE, vecEdges);
 
         var = calculateStatistics(center, vecEdges);
         if(var < 0 || vecEdges.size() == 0) {
@@ -144,7 +158,7 @@ namespace iris {
 
         if(var < 0 || vecEdges.size() == 0 || 
            (sd_difference > std::sqrt(dVarOfOrigImg) * 
-            trackerSettings.STARBURST_RELATIVE_MAX_POINT_VARIANCE)) {
+            settings.STARBURST_RELATIVE_MAX_POINT_VARIANCE)) {
 
             return UNRECOVERABLE_ERROR;
         }
@@ -307,7 +321,10 @@ namespace iris {
     }
 
 
-    void removeOutliers(cv::Point2f &mean, double var, std::vector<cv::Point2f> &vecEdges) {
+    void removeOutliers(cv::Point2f &mean,
+                        double var,
+                        double dOutlierDistance,
+                        std::vector<cv::Point2f> &vecEdges) {
 
         const double stdDev = std::sqrt(var);
 
@@ -317,8 +334,7 @@ namespace iris {
             double diff_x = edge->x - mean.x;
             double diff_y = edge->y - mean.y;
 
-            if(std::sqrt(diff_x * diff_x + diff_y * diff_y) > (stdDev * 
-                                                               trackerSettings.STARBURST_OUTLIER_DISTANCE)) {
+            if(std::sqrt(diff_x * diff_x + diff_y * diff_y) > (stdDev * dOutlierDistance)) {
 
                 // Take the element to remove
                 std::vector<cv::Point2f>::iterator remove_pos = edge;
@@ -34,6 +34,9 @@
 #include <opencv2/core/core.hpp>
 
 
+class TrackerSettings;
+
+
 
 namespace iris {
 
@@ -48,6 +51,16 @@ namespace iris {
                const cv::RotatedRect &ellipse,
                std::vector<cv::Point2f> &listEdges);
 
+    /*
+     * As above, but uses the given settings instead of the global
+     * trackerSettings.
+     */
+    bool burst(const cv::Mat &img_gray,
+               const cv::Rect &roi,
+               const cv::RotatedRect &ellipse,
+               std::vector<cv::Point2f> &listEdges,
+               const TrackerSettings &settings);
+
 
 } // end of "namespace iris"
 
@@ -149,28 +149,6 @@ bool JPEG_Compressor::save(const std::string &fname) {
 
 
 
-JPEG_Decompressor::JPEG_Decompressor() {
-
-	w = h = bpp = 0;
-
-}
-
-
-JPEG_Decompressor::~JPEG_Decompressor() {
-
-}
-
-
-
-
-
-
-
-
-
-
-
-
 static void init_source(j_decompress_ptr cinfo) {
 
 	/* already done in the JPEG_Decompressor::decompress() -method */
@@ -222,6 +200,64 @@ static void term_source(j_decompress_ptr cinfo) {
 
 
 
+JPEG_Decompressor::JPEG_Decompressor() {
+
+	w = h = bpp = 0;
+
+
+	/*********************************************************
+	 * the error manager, errors jump back to the caller
+	 *********************************************************/
+	cinfo.err = jpeg_std_error(&jerr.pub);
+	jerr.pub.error_exit = &errorExit;
+
+
+	/*********************************************************
+	 * initialise the decompressor, it is reused for all frames
+	 *********************************************************/
+	jpeg_create_decompress(&cinfo);
+
+
+	/*********************************************************
+	 * initialise the source manager
+	 *********************************************************/
+	smgr.init_source		= &init_source;
+	smgr.term_source		= &term_source;
+	smgr.resync_to_restart	= jpeg_resync_to_restart; /* use default method */
+	smgr.skip_input_data	= &skip_input_data;
+	smgr.fill_input_buffer	= &fill_input_buffer;
+	smgr.bytes_in_buffer	= 0;
+	smgr.next_input_byte	= NULL;
+
+	cinfo.src = &smgr;
+
+}
+
+
+JPEG_Decompressor::~JPEG_Decompressor() {
+
+	jpeg_destroy_decompress(&cinfo);
+
+}
+
+
+/*
+ * Called by libjpeg on a fatal error instead of exit(). Prints the
+ * message and jumps back to the method decompressing.
+ */
+void JPEG_Decompressor::errorExit(j_common_ptr cinfo) {
+
+	(*cinfo->err->output_message)(cinfo);
+
+	ErrorManager *err = (ErrorManager *)cinfo->err;
+
+	longjmp(err->jmp, 1);
+
+}
+
+
+
+
 
 
 
@@ -328,56 +364,28 @@ int qt_jpeg_load_dht (struct jpeg_decompress_struct *info, const unsigned char *
 }
 
 
-bool JPEG_Decompressor::decompress(const unsigned char *jpg_packed_data, size_t insize, unsigned char *oput) {
-
-	// jpeg structures
-	struct jpeg_decompress_struct cinfo;
-	struct jpeg_error_mgr jerr;
-	struct jpeg_source_mgr smgr;
-
-
-	/*********************************************************
-	 * "update error manager with error handling routines"
-	 *********************************************************/
-	cinfo.err = jpeg_std_error(&jerr);
-
+bool JPEG_Decompressor::readHeader(const unsigned char *jpg_packed_data, size_t insize) {
 
-	/*********************************************************
-	 * initialise the decompressor
-	 *********************************************************/
-	jpeg_create_decompress(&cinfo);
-
-
-	/*********************************************************
-	 * initialise the source manager
-	 *********************************************************/
-	smgr.init_source		= &init_source;
-	smgr.term_source		= &term_source;
-	smgr.resync_to_restart	= jpeg_resync_to_restart; /* use default method */
-	smgr.skip_input_data	= &skip_input_data;
-	smgr.fill_input_buffer	= &fill_input_buffer;
 	smgr.bytes_in_buffer	= insize;
 	smgr.next_input_byte	= (JOCTET *)jpg_packed_data;
 
 
-	// assing the source manager
-	cinfo.src = &smgr;
-
-	
-
 	/***************************************************
 	 * read the jpeg header
 	 ***************************************************/
 	int ret = jpeg_read_header(&cinfo, TRUE);
 
 	if(ret != JPEG_HEADER_OK) {
-		printf("JPEG_Decompressor::decompress(): Could not read the header\n");
-		jpeg_destroy_decompress(&cinfo);
+		printf("JPEG_Decompressor::readHeader(): Could not read the header\n");
+		jpeg_abort_decompress(&cinfo);
 		return false;
 	}
 
 
-
+	/*
+	 * MJPG frames have no huffman tables. The tables of the previous
+	 * frame are kept, so they are loaded only for the first frame.
+	 */
 	if (cinfo.ac_huff_tbl_ptrs[0] == NULL &&
 		cinfo.ac_huff_tbl_ptrs[1] == NULL &&
 		cinfo.dc_huff_tbl_ptrs[0] == NULL &&
@@ -386,6 +394,29 @@ bool JPEG_Decompressor::decompress(const unsigned char *jpg_packed_data, size_t
 			    cinfo.dc_huff_tbl_ptrs );
 	}
 
+	return true;
+
+}
+
+
+bool JPEG_Decompressor::decompress(const unsigned char *jpg_packed_data, size_t insize, unsigned char *oput, int scaleDenom) {
+
+	// libjpeg failed, reset the decompressor for the next frame
+	if(setjmp(jerr.jmp)) {
+		jpeg_abort_decompress(&cinfo);
+		return false;
+	}
+
+	if(!readHeader(jpg_packed_data, insize)) {
+		return false;
+	}
+
+	cinfo.out_color_space = JCS_RGB;
+
+	// the output size is ceil(w / scaleDenom) x ceil(h / scaleDenom)
+	cinfo.scale_num		= 1;
+	cinfo.scale_denom	= scaleDenom;
+
 
 	/*************************************************************************
 	 * "The function jpeg_start_decompress() shall initialize state
@@ -395,18 +426,11 @@ bool JPEG_Decompressor::decompress(const unsigned char *jpg_packed_data, size_t
 	 *************************************************************************/
     if(!jpeg_start_decompress(&cinfo)) {
 		printf("JPEG_Decompressor::decompress(): Could not start decompressing\n");
-		jpeg_destroy_decompress(&cinfo);
+		jpeg_abort_decompress(&cinfo);
 		return false;
 	}
 
 
-	int row_stride = cinfo.output_width * cinfo.output_components;
-
-	// jpeg_finish_decompress() deallocates this memory
-	JSAMPARRAY buffer = (*cinfo.mem->alloc_sarray)
-	((j_common_ptr) &cinfo, JPOOL_IMAGE, row_stride, 1);
-
-
 	/*******************************************************
 	 * set class data
 	 *******************************************************/
@@ -415,17 +439,104 @@ bool JPEG_Decompressor::decompress(const unsigned char *jpg_packed_data, size_t
 	h = cinfo.output_height;
 
 
+	// decompress straight to the output
 	while(cinfo.output_scanline < cinfo.output_height) {
 
-		int row = cinfo.output_scanline;
-		jpeg_read_scanlines(&cinfo, buffer, 1);
-
-		memcpy(oput + bpp*row*w, buffer[0], bpp*w);
+		JSAMPROW row_ptr = oput + bpp*w*cinfo.output_scanline;
+		jpeg_read_scanlines(&cinfo, &row_ptr, 1);
 
 	}
 
 	jpeg_finish_decompress(&cinfo);
-	jpeg_destroy_decompress(&cinfo);
+
+	return true;
+
+}
+
+
+int JPEG_Decompressor::getScaleDenom(int _w, int _h, int targetW, int targetH) {
+
+	int denom = 1;
+
+	while(denom < 8 && (_w + 2*denom - 1) / (2*denom) >= targetW && (_h + 2*denom - 1) / (2*denom) >= targetH) {
+		denom *= 2;
+	}
+
+	return denom;
+
+}
+
+
+bool JPEG_Decompressor::decompressGray(const unsigned char *jpg_packed_data, size_t insize,
+									   int x, int y, int _w, int _h,
+									   unsigned char *oput, int stride) {
+
+	// libjpeg failed, reset the decompressor for the next frame
+	if(setjmp(jerr.jmp)) {
+		jpeg_abort_decompress(&cinfo);
+		return false;
+	}
+
+	if(!readHeader(jpg_packed_data, insize)) {
+		return false;
+	}
+
+	w	= cinfo.image_width;
+	h	= cinfo.image_height;
+	bpp	= 1;
+
+	if(x < 0 || y < 0 || _w <= 0 || _h <= 0 || x + _w > w || y + _h > h) {
+		printf("JPEG_Decompressor::decompressGray(): The area (%d, %d, %d, %d) is not inside the image\n",
+			   x, y, _w, _h);
+		jpeg_abort_decompress(&cinfo);
+		return false;
+	}
+
+	// only the luma is decoded
+	cinfo.out_color_space = JCS_GRAYSCALE;
+
+    if(!jpeg_start_decompress(&cinfo)) {
+		printf("JPEG_Decompressor::decompressGray(): Could not start decompressing\n");
+		jpeg_abort_decompress(&cinfo);
+		return false;
+	}
+
+
+	/*******************************************************
+	 * Restrict the decoding to the area. The first column
+	 * is moved to the start of a MCU, and the rows above
+	 * are skipped without the inverse DCT.
+	 *******************************************************/
+#ifdef LIBJPEG_TURBO_VERSION_NUMBER
+	JDIMENSION xoffset	= x;
+	JDIMENSION width	= _w;
+	jpeg_crop_scanline(&cinfo, &xoffset, &width);
+
+	if(y > 0) {
+		jpeg_skip_scanlines(&cinfo, y);
+	}
+#else
+	const JDIMENSION xoffset = 0;
+#endif
+
+	row.resize(cinfo.output_width);
+	JSAMPROW row_ptr = &row[0];
+
+	const int first = x - (int)xoffset;
+
+	while(cinfo.output_scanline < (JDIMENSION)(y + _h)) {
+
+		const int r = cinfo.output_scanline;
+		jpeg_read_scanlines(&cinfo, &row_ptr, 1);
+
+		if(r >= y) {
+			memcpy(oput + (r - y)*stride, row_ptr + first, _w);
+		}
+
+	}
+
+	// the rows below the area are not needed
+	jpeg_abort_decompress(&cinfo);
 
 	return true;
 
@@ -6,6 +6,7 @@
 #include <vector>
 #include <stdlib.h>
 #include <stdio.h>
+#include <setjmp.h>
 #include <jpeglib.h>
 
 
@@ -26,6 +27,11 @@ class JPEG_Compressor {
 };
 
 
+/*
+ * Decompresses JPEG and MJPG frames. The libjpeg context is created
+ * once and reused for every frame, so an instance should be kept for
+ * a stream. Not thread safe, use an instance per thread.
+ */
 class JPEG_Decompressor {
 
 	public:
@@ -33,12 +39,71 @@ class JPEG_Decompressor {
 		JPEG_Decompressor();
 		~JPEG_Decompressor();
 
-		bool decompress(const unsigned char *jpg_packed_data, size_t insize, unsigned char *decompr_data);
+		/*
+		 * Decompress the whole image to RGB, scaled down by 1/scaleDenom
+		 * with the scaled IDCT of libjpeg. scaleDenom is 1, 2, 4 or 8, the
+		 * size of the output is given by getWidth() and getHeight().
+		 */
+		bool decompress(const unsigned char *jpg_packed_data, size_t insize, unsigned char *decompr_data, int scaleDenom = 1);
+
+		/*
+		 * The largest of 1, 2, 4 and 8 by which a w x h image can be
+		 * scaled down and still be at least targetW x targetH
+		 */
+		static int getScaleDenom(int _w, int _h, int targetW, int targetH);
+
+		/*
+		 * Decompress only the area (x, y, _w, _h) of the image to 8-bit
+		 * grayscale. The chroma is not decoded, and with libjpeg-turbo
+		 * 2.0 or newer the rows above the area are only entropy decoded
+		 * and the columns outside the area are skipped a MCU at a time.
+		 * The decoding stops after the last row of the area. The rows of
+		 * oput are stride bytes apart. Fails if the area is not inside
+		 * the image.
+		 */
+		bool decompressGray(const unsigned char *jpg_packed_data, size_t insize,
+							int x, int y, int _w, int _h,
+							unsigned char *oput, int stride);
 
 		bool save(const std::string &fname);
 
+		/* The size of the last decompressed image */
+		int getWidth() const {return w;}
+		int getHeight() const {return h;}
+
 	private:
 
+		/* Not copyable, the context points to the members */
+		JPEG_Decompressor(const JPEG_Decompressor &);
+		JPEG_Decompressor &operator=(const JPEG_Decompressor &);
+
+		/*
+		 * Give the data to the source manager and read the header.
+		 * Returns false if the header is not ok.
+		 */
+		bool readHeader(const unsigned char *jpg_packed_data, size_t insize);
+
+		static void errorExit(j_common_ptr cinfo);
+
+
+		/* libjpeg calls error_exit() on errors, we jump back from it */
+		class ErrorManager {
+
+			public:
+
+				struct jpeg_error_mgr pub;
+				jmp_buf jmp;
+
+		};
+
+
+		struct jpeg_decompress_struct cinfo;
+		struct jpeg_source_mgr smgr;
+		ErrorManager jerr;
+
+		/* A row of the output, reused */
+		std::vector<JSAMPLE> row;
+
 		int w;
 		int h;
 		int bpp;
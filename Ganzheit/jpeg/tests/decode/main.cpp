@@ -0,0 +1,257 @@
+/*
+ * Compares the decoding times of an eye camera frame:
+ *
+ *     - in colour with a new decompressor for each frame, the way the
+ *       JPEGWorker did before
+ *     - in colour with a decompressor reused for all frames
+ *     - the whole frame to grayscale
+ *     - only the crop area to grayscale, what GTWorker does when the
+ *       frames are not shown
+ *
+ * The colour frames are further converted to gray for the tracker,
+ * that is not included here. The frame is a synthetic eye
+ * image compressed with the chroma subsampling of the MJPG cameras.
+ * The crop area is the one of default.xml. The crop area decoded to
+ * gray must be equal to the same area of the whole gray frame.
+ *
+ * Usage: decode [nof frames]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+
+#include "jpeg.h"
+#include "MyTimer.h"
+
+
+static const int NOF_FRAMES_DEFAULT	= 500;
+
+/* The frame of the eye camera */
+static const int WIDTH				= 640;
+static const int HEIGHT				= 480;
+static const int QUALITY			= 85;
+
+/* The crop area of default.xml, in the frame as captured */
+static const int CROP_AREA_W		= 400;
+static const int CROP_AREA_H		= 320;
+static const int CROP_AREA_X		= WIDTH - 148 - CROP_AREA_W;
+static const int CROP_AREA_Y		= 60;
+
+
+/*
+ * A gray eye with a dark pupil and a few glints, and sensor noise, as
+ * RGB
+ */
+static void drawEye(std::vector<unsigned char> &rgb) {
+
+	rgb.resize(3 * WIDTH * HEIGHT);
+
+	srand(1);
+
+	for(int y = 0; y < HEIGHT; ++y) {
+
+		for(int x = 0; x < WIDTH; ++x) {
+
+			const double dx = x - WIDTH / 2;
+			const double dy = y - HEIGHT / 2;
+			const double r = sqrt(dx*dx + dy*dy);
+
+			double val = 160.0 - 0.2 * r;
+
+			// iris and pupil
+			if(r < 40.0) {
+				val = 20.0;
+			}
+			else if(r < 100.0) {
+				val = 90.0 + 20.0 * sin(atan2(dy, dx) * 12.0);
+			}
+
+			// glints
+			for(int i = 0; i < 4; ++i) {
+
+				const double gx = dx - 30.0 + 20.0 * i;
+				const double gy = dy + 30.0;
+
+				if(gx*gx + gy*gy < 9.0) {
+					val = 255.0;
+				}
+
+			}
+
+			val += (rand() % 9) - 4;
+
+			const unsigned char v = (unsigned char)std::max(0.0, std::min(255.0, val));
+
+			unsigned char *p = &rgb[3 * (y * WIDTH + x)];
+			p[0] = p[1] = p[2] = v;
+
+		}
+
+	}
+
+}
+
+
+/* Compress with 4:2:2 sampling like the MJPG cameras */
+static void compress(const std::vector<unsigned char> &rgb, std::vector<unsigned char> &jpg) {
+
+	struct jpeg_compress_struct cinfo;
+	struct jpeg_error_mgr jerr;
+
+	cinfo.err = jpeg_std_error(&jerr);
+	jpeg_create_compress(&cinfo);
+
+	unsigned char *data = NULL;
+	unsigned long sz = 0;
+	jpeg_mem_dest(&cinfo, &data, &sz);
+
+	cinfo.image_width		= WIDTH;
+	cinfo.image_height		= HEIGHT;
+	cinfo.input_components	= 3;
+	cinfo.in_color_space	= JCS_RGB;
+
+	jpeg_set_defaults(&cinfo);
+	jpeg_set_quality(&cinfo, QUALITY, TRUE);
+
+	cinfo.comp_info[0].h_samp_factor = 2;
+	cinfo.comp_info[0].v_samp_factor = 1;
+
+	jpeg_start_compress(&cinfo, TRUE);
+
+	while(cinfo.next_scanline < cinfo.image_height) {
+		JSAMPROW row_ptr = (JSAMPROW)&rgb[3 * WIDTH * cinfo.next_scanline];
+		jpeg_write_scanlines(&cinfo, &row_ptr, 1);
+	}
+
+	jpeg_finish_compress(&cinfo);
+	jpeg_destroy_compress(&cinfo);
+
+	jpg.assign(data, data + sz);
+
+	free(data);
+
+}
+
+
+static void report(const char *name, unsigned long micros, int nofFrames, double reference) {
+
+	const double perFrame = (double)micros / nofFrames;
+
+	printf("%-32s %8.0f us %8.2f\n", name, perFrame, reference > 0.0 ? reference / perFrame : 1.0);
+
+}
+
+
+int main(int argc, char **argv) {
+
+	const int nofFrames = argc > 1 ? atoi(argv[1]) : NOF_FRAMES_DEFAULT;
+
+	if(nofFrames <= 0) {
+		printf("Usage: %s [nof frames]\n", argv[0]);
+		return -1;
+	}
+
+	std::vector<unsigned char> rgb;
+	drawEye(rgb);
+
+	std::vector<unsigned char> jpg;
+	compress(rgb, jpg);
+
+	printf("%dx%d frame, %lu bytes, crop area (%d, %d, %d, %d), %d frames\n\n",
+		   WIDTH, HEIGHT, (unsigned long)jpg.size(),
+		   CROP_AREA_X, CROP_AREA_Y, CROP_AREA_W, CROP_AREA_H, nofFrames);
+
+	printf("                                 per frame  speed-up\n");
+
+	std::vector<unsigned char> colour(3 * WIDTH * HEIGHT);
+	std::vector<unsigned char> gray(WIDTH * HEIGHT);
+	std::vector<unsigned char> crop(CROP_AREA_W * CROP_AREA_H);
+
+	MyTimer timer;
+	bool ok = true;
+
+
+	/*****************************************************************
+	 * Colour, a new decompressor for each frame
+	 *****************************************************************/
+	timer.markTime();
+
+	for(int i = 0; i < nofFrames; ++i) {
+
+		JPEG_Decompressor jpgd;
+		ok &= jpgd.decompress(&jpg[0], jpg.size(), &colour[0]);
+
+	}
+
+	const double reference = (double)timer.getElapsed_micros() / nofFrames;
+	report("colour, new decompressor", (unsigned long)(reference * nofFrames), nofFrames, 0.0);
+
+
+	/*****************************************************************
+	 * The rest reuse the decompressor
+	 *****************************************************************/
+	JPEG_Decompressor jpgd;
+
+	timer.markTime();
+
+	for(int i = 0; i < nofFrames; ++i) {
+		ok &= jpgd.decompress(&jpg[0], jpg.size(), &colour[0]);
+	}
+
+	report("colour", timer.getElapsed_micros(), nofFrames, reference);
+
+
+	timer.markTime();
+
+	for(int i = 0; i < nofFrames; ++i) {
+		ok &= jpgd.decompressGray(&jpg[0], jpg.size(), 0, 0, WIDTH, HEIGHT, &gray[0], WIDTH);
+	}
+
+	report("gray, whole frame", timer.getElapsed_micros(), nofFrames, reference);
+
+
+	timer.markTime();
+
+	for(int i = 0; i < nofFrames; ++i) {
+		ok &= jpgd.decompressGray(&jpg[0], jpg.size(),
+								  CROP_AREA_X, CROP_AREA_Y, CROP_AREA_W, CROP_AREA_H,
+								  &crop[0], CROP_AREA_W);
+	}
+
+	report("gray, crop area", timer.getElapsed_micros(), nofFrames, reference);
+
+
+	if(!ok) {
+		printf("\nFAILED, could not decompress\n");
+		return -1;
+	}
+
+
+	/*****************************************************************
+	 * The crop area must be as in the whole frame
+	 *****************************************************************/
+	for(int y = 0; y < CROP_AREA_H; ++y) {
+
+		const unsigned char *row = &gray[(CROP_AREA_Y + y) * WIDTH + CROP_AREA_X];
+
+		if(memcmp(row, &crop[y * CROP_AREA_W], CROP_AREA_W) != 0) {
+			printf("\nFAILED, row %d of the crop area differs from the whole frame\n", y);
+			return -1;
+		}
+
+	}
+
+	// the area outside the image must be refused
+	if(jpgd.decompressGray(&jpg[0], jpg.size(), WIDTH - 8, 0, 16, 16, &crop[0], 16)) {
+		printf("\nFAILED, an area outside the image was decompressed\n");
+		return -1;
+	}
+
+	printf("\nOK\n");
+
+	return 0;
+
+}
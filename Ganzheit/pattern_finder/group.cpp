@@ -1,7 +1,9 @@
 #include "group.h"
 #include <stdio.h>
+#include <math.h>
 
 #include <list>
+#include <algorithm>
 
 
 namespace group {
@@ -25,6 +27,13 @@ namespace group {
     static const int VACANCY_OCCUPIED	= 0;
     static const int VACANCY_FREE		= 1;
 
+    /*
+     * The layouts are pruned when the error of the glints labelled so far
+     * exceeds the best error. The errors are summed in a different order
+     * than in computeError(), so allow for rounding.
+     */
+    static const double BOUND_SLACK     = 1.0 + 1e-9;
+
 
     /* Functions for sorting */
     static bool upfirst(Element i, Element j)		{return (i.p.y < j.p.y);}
@@ -257,6 +266,12 @@ namespace group {
     }
 
 
+    GroupManager::GroupManager() {
+        nof_points = 0;
+        b_exhaustive = false;
+    }
+
+
     bool GroupManager::assignToGroups(std::vector<cv::Point> &extracted,
                                       cv::Point pupil_centre) {
 
@@ -396,6 +411,10 @@ namespace group {
         // sort the group members
         sortGroups();
 
+        if(!b_exhaustive) {
+            return searchLayouts();
+        }
+
 
         // set the group configurations
         initialiseGroups();
@@ -518,7 +537,11 @@ namespace group {
     }
 
 
-    double GroupManager::computeError() {
+    /*
+     * The squared error between the angle ang from the glint labelled
+     * label1 to the glint labelled label2 and their angle in the pattern
+     */
+    static double pairError(double ang, int label1, int label2) {
 
         /*
          *               0
@@ -584,6 +607,62 @@ namespace group {
 
         };
 
+        const int ind1 = label1;
+        const int ind2 = label2 == 0 ? 6 : label2;
+        int ind_diff = ind2 - ind1;
+        ind_diff = ind_diff < 0 ? 6 + ind_diff : ind_diff;
+
+        const double ang_real = angles[label1*5 + ind_diff - 1];
+        const double ang_diff = ang_real - ang;
+
+
+        /*
+         * Consider the case:
+         *     ang		= 175
+         *     ang_real	= -175
+         *
+         * The difference is 10, not 350
+         */
+        const double err = std::min(std::abs(ang_diff), std::abs(TWO_PI - ang_diff));
+
+        return err*err;
+
+    }
+
+
+    /*
+     * The angle from p1 to p2
+     */
+    static double measuredAngle(const cv::Point &p1, const cv::Point &p2) {
+
+        /*
+         * Difference in x and y directions. Note that y has been
+         * flipped, because the positive rotation direction is
+         * counterclockwisem, i.e. positive x is to the right and
+         * positive y is upwards.
+         */
+        const int diffy = -(p2.y - p1.y);
+        const int diffx = p2.x - p1.x;
+        double ang = 0;
+
+        // diffx and diffy cannot both be zeros simultaneously
+        if(diffx == 0) {
+            ang = diffy > 0 ? RAD_90 : -RAD_90;
+        }
+        else if(diffy == 0) {
+            ang = diffx > 0 ? 0 : RAD_180;
+        }
+        else {
+            ang = atan2(diffy, diffx);
+        }
+
+        return ang;
+
+    }
+
+
+    double GroupManager::computeError() {
+
         /************************************************************
          * Get all elements from all groups
          *************************************************************/
@@ -627,46 +706,7 @@ namespace group {
                 // compare this to el1
                 const Element *el2 = elements[j];
 
-                /*
-                 * Difference in x and y directions. Note that y has been
-                 * flipped, because the positive rotation direction is
-                 * counterclockwisem, i.e. positive x is to the right and
-                 * positive y is upwards.
-                 */
-                const int diffy = -(el2->p.y - el1->p.y);
-                const int diffx = el2->p.x - el1->p.x;
-                double ang = 0;
-
-                // diffx and diffy cannot both be zeros simultaneously
-                if(diffx == 0) {
-                    ang = diffy > 0 ? RAD_90 : -RAD_90;
-                }
-                else if(diffy == 0) {
-                    ang = diffx > 0 ? 0 : RAD_180;
-                }
-                else {
-                    ang = atan2(diffy, diffx);
-                }
-
-                const int ind1 = el1->label;
-                const int ind2 = el2->label == 0 ? 6 : el2->label;
-                int ind_diff = ind2 - ind1;
-                ind_diff = ind_diff < 0 ? 6 + ind_diff : ind_diff;
-
-                const double ang_real = angles[el1->label*5 + ind_diff - 1];
-                const double ang_diff = ang_real - ang;
-
-
-                /*
-                 * Consider the case:
-                 *     ang		= 175
-                 *     ang_real	= -175
-                 *
-                 * The difference is 10, not 350
-                 */
-                const double err = std::min(std::abs(ang_diff), std::abs(TWO_PI - ang_diff));
-
-                err_sum += err*err;
+                err_sum += pairError(measuredAngle(el1->p, el2->p), el1->label, el2->label);
 
 
                 j = (j + 1) % sz;
@@ -803,5 +843,335 @@ namespace group {
     }
 
 
+
+    /***************************************************************************
+     * The precomputed label layouts
+     ***************************************************************************/
+
+    /*
+     * The valid labels of the glints for every combination of group sizes.
+     * The labels of the glints, in the order of the groups, form a path
+     * from a root to a leaf in a tree. The tree is built with the
+     * exhaustive search when the program starts.
+     */
+    class LayoutTable {
+
+    public:
+
+        class Node {
+        public:
+            /* The label of the glint at this depth */
+            int label;
+
+            /* The first child and the next sibling, 0 if none */
+            int child;
+            int sibling;
+
+            /* The order in which the exhaustive search found the leaf */
+            int order;
+        };
+
+        LayoutTable();
+
+        /* The root of the layouts of the given groups, 0 if there are none */
+        int getRoot(const std::vector<Group> &groups) const;
+
+        const Node &operator[](int i) const {return nodes[i];}
+
+    private:
+
+        /* Each group has 0 - 3 members */
+        static int getKey(int n1, int n2, int n3, int n4) {
+            return n1 | (n2 << 2) | (n3 << 4) | (n4 << 6);
+        }
+
+        int addNode(int label);
+
+        /* Add the labels of the configuration below the root */
+        void insert(int root, const Configuration &c, int order);
+
+        /* Node 0 is not used, so that 0 can mean none */
+        std::vector<Node> nodes;
+
+        int roots[256];
+
+    };
+
+
+    LayoutTable::LayoutTable() {
+
+        nodes.resize(1);
+        std::fill(roots, roots + 256, 0);
+
+        GroupManager grp;
+        grp.groups.resize(4);
+
+        for(int key = 0; key < 256; ++key) {
+
+            const int sizes[4] = {key & 3, (key >> 2) & 3, (key >> 4) & 3, (key >> 6) & 3};
+            const int n = sizes[0] + sizes[1] + sizes[2] + sizes[3];
+
+            if(n <= 1 || n >= 7) {
+                continue;
+            }
+
+            // the groups as in identify(), with the elements numbered in the group order
+            std::vector<Element> v;
+            grp.groups[0] = Group(v, 0, 0);
+            grp.groups[1] = Group(v, 1, 1);
+            grp.groups[2] = Group(v, 2, 3);
+            grp.groups[3] = Group(v, 3, 4);
+
+            int ind = 0;
+            for(int i = 0; i < 4; ++i) {
+                for(int j = 0; j < sizes[i]; ++j) {
+                    grp.groups[i].getMembers().push_back(Element(cv::Point(), -1, ind++));
+                }
+            }
+
+            grp.nof_points = n;
+            grp.configurations.clear();
+            grp.initialiseGroups();
+            grp.loopConfigurations(grp.groups.begin());
+
+            if(grp.configurations.size() == 0) {
+                continue;
+            }
+
+            roots[key] = addNode(-1);
+
+            for(size_t i = 0; i < grp.configurations.size(); ++i) {
+                insert(roots[key], grp.configurations[i], (int)i);
+            }
+
+        }
+
+    }
+
+
+    int LayoutTable::getRoot(const std::vector<Group> &groups) const {
+
+        return roots[getKey((int)groups[0].size(), (int)groups[1].size(),
+                            (int)groups[2].size(), (int)groups[3].size())];
+
+    }
+
+
+    int LayoutTable::addNode(int label) {
+
+        Node node;
+        node.label   = label;
+        node.child   = 0;
+        node.sibling = 0;
+        node.order   = -1;
+
+        nodes.push_back(node);
+
+        return (int)nodes.size() - 1;
+
+    }
+
+
+    void LayoutTable::insert(int root, const Configuration &c, int order) {
+
+        // the elements are sorted by index_in_orig_list, i.e. in the group order
+        int parent = root;
+
+        for(size_t i = 0; i < c.elements.size(); ++i) {
+
+            const int label = c.elements[i].label;
+
+            int prev = 0;
+            int node = nodes[parent].child;
+
+            while(node != 0 && nodes[node].label != label) {
+                prev = node;
+                node = nodes[node].sibling;
+            }
+
+            if(node == 0) {
+
+                node = addNode(label);
+
+                if(prev != 0) {
+                    nodes[prev].sibling = node;
+                }
+                else {
+                    nodes[parent].child = node;
+                }
+
+            }
+
+            parent = node;
+
+        }
+
+        nodes[parent].order = order;
+
+    }
+
+
+    /* Built when the program starts, read-only after that */
+    static const LayoutTable layoutTable;
+
+
+    bool GroupManager::searchLayouts() {
+
+        const int root = layoutTable.getRoot(groups);
+
+        if(root == 0) {
+            return false;
+        }
+
+
+        /************************************************************
+         * The glints in the group order and the angles between them
+         *************************************************************/
+        const Element *elements[6];
+        int n = 0;
+
+        for(size_t g = 0; g < groups.size(); ++g) {
+
+            const std::vector<Element> &m = groups[g].getMembers();
+
+            for(size_t i = 0; i < m.size(); ++i) {
+                elements[n++] = &m[i];
+            }
+
+        }
+
+        double angles[6][6];
+
+        for(int i = 0; i < n; ++i) {
+            for(int j = 0; j < n; ++j) {
+                if(i != j) {
+                    angles[i][j] = measuredAngle(elements[i]->p, elements[j]->p);
+                }
+            }
+        }
+
+
+        /************************************************************
+         * Depth-first search. The error of the glints labelled so
+         * far is a lower bound for the error of the whole layout.
+         *************************************************************/
+        int labels[6];
+        int path[6];
+        double cost[7];
+
+        int best_labels[6];
+        int best_order = -1;
+        double best_err = HUGE_VAL;
+
+        int depth = 0;
+        int node = layoutTable[root].child;
+        cost[0] = 0.0;
+
+        while(depth >= 0) {
+
+            // no more layouts at this depth
+            if(node == 0) {
+
+                if(--depth >= 0) {
+                    node = layoutTable[path[depth]].sibling;
+                }
+
+                continue;
+
+            }
+
+            const int label = layoutTable[node].label;
+
+            double c = cost[depth];
+            for(int k = 0; k < depth; ++k) {
+                c += pairError(angles[k][depth], labels[k], label);
+                c += pairError(angles[depth][k], label, labels[k]);
+            }
+
+            if(c > best_err * BOUND_SLACK) {
+                node = layoutTable[node].sibling;
+                continue;
+            }
+
+            labels[depth] = label;
+
+            if(depth + 1 < n) {
+
+                path[depth] = node;
+                cost[depth + 1] = c;
+                ++depth;
+                node = layoutTable[node].child;
+                continue;
+
+            }
+
+
+            /*
+             * A complete layout. Compute the error in the same order as
+             * computeError() and prefer the layout the exhaustive search
+             * finds first, so that both select the same one.
+             */
+            double err = 0.0;
+
+            for(int i = 0; i < n; ++i) {
+
+                int j = (i + 1) % n;
+
+                while(j != i) {
+                    err += pairError(angles[i][j], labels[i], labels[j]);
+                    j = (j + 1) % n;
+                }
+
+            }
+
+            const int order = layoutTable[node].order;
+
+            if(err < best_err || (err == best_err && order < best_order)) {
+                best_err = err;
+                best_order = order;
+                std::copy(labels, labels + n, best_labels);
+            }
+
+            node = layoutTable[node].sibling;
+
+        }
+
+        if(best_order < 0) {
+            return false;
+        }
+
+
+        /************************************************************
+         * Store the best layout as storeConfiguration() does
+         *************************************************************/
+        config_best.err = best_err;
+        config_best.elements.resize(n);
+
+        int ind = 0;
+
+        for(size_t g = 0; g < groups.size(); ++g) {
+
+            const std::vector<Element> &m = groups[g].getMembers();
+
+            for(size_t i = 0; i < m.size(); ++i) {
+
+                Element &e = config_best.elements[ind];
+
+                e = m[i];
+                e.label = best_labels[ind];
+                e.label_init = (groups[g].getStartLabel() + (int)i) % 6;
+
+                ++ind;
+
+            }
+
+        }
+
+        std::sort(config_best.elements.begin(), config_best.elements.end(), sort_elements);
+
+        return true;
+
+    }
+
 } // end of "namespace group {
 
@@ -69,6 +69,9 @@ namespace group {
 
         int getID() const {return id;}
 
+        /* The label of the first member in the initial configuration */
+        int getStartLabel() const {return startLabel;}
+
         size_t size() const {return members.size();}
 
     private:
@@ -136,20 +139,53 @@ namespace group {
     };
 
 
+    /* The label layouts of the pattern, see group.cpp */
+    class LayoutTable;
+
+
+    /*
+     * Identifies the glints. The glints are assigned to four groups
+     * around the pupil and the labels of the groups are chosen so that
+     * the angles between the glints fit the pattern best.
+     *
+     * The valid labels for each combination of group sizes are computed
+     * once at startup, and the best ones are searched with branch and
+     * bound. The result is the same as with the exhaustive search, see
+     * setExhaustive().
+     */
     class GroupManager {
     public:
 
+        GroupManager();
+
         bool identify(std::vector<cv::Point> &extracted, cv::Point pupil_centre);
 
         const std::vector<Group> &getGroups() const {return groups;}
         std::vector<Group> &getGroups() {return groups;}
 
+        /* All valid configurations, stored only by the exhaustive search */
         const std::vector<Configuration> &getConfigurations() const {return configurations;}
 
         const Configuration &getBestConfiguration() {return config_best;}
 
+        /*
+         * Loop through all configurations of the groups and compute the
+         * error of each, as the original implementation did, instead of
+         * searching the precomputed layouts. Meant for comparisons.
+         */
+        void setExhaustive(bool b) {b_exhaustive = b;}
+
     private:
 
+        friend class LayoutTable;
+
+        /*
+         * Search the precomputed layouts of the current groups for the
+         * one with the minimum error and set config_best. Returns false
+         * if there are no valid layouts.
+         */
+        bool searchLayouts();
+
         /*
          * Tests if the elements occupy vacant labels or not.
          */
@@ -221,6 +257,8 @@ namespace group {
         /* The number of points given in identify() */
         int nof_points;
 
+        bool b_exhaustive;
+
     };
 
 
@@ -63,7 +63,9 @@ int main(int nargs, char **args) {
 	draw(extracted, pupil_centre);
 
 
+	// list all configurations
 	GroupManager grp;
+	grp.setExhaustive(true);
 	bool success = grp.identify(extracted, pupil_centre);
 
 	if(success) {
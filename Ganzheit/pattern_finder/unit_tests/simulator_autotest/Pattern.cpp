@@ -127,13 +127,10 @@ void Pattern::identifyPoints(const cv::Point pupil_centre, std::vector<cv::Point
 	GroupManager grp;
 	if(grp.identify(extracted, pupil_centre)) {
 
-		const Configuration &configurations = grp.getBestConfiguration();
-
-		std::list<int>::const_iterator lit = configurations.labels.begin();
+		const Configuration &config_best = grp.getBestConfiguration();
 
 		for(size_t i = 0; i < labels.size(); ++i) {
-			labels[i] = *lit;
-			++lit;
+			labels[i] = config_best.elements[i].label;
 		}
 
 	}
@@ -1,28 +1,40 @@
-#include <opencv2/highgui/highgui.hpp>
+/*
+ * Automated test and benchmark for group::GroupManager.
+ *
+ * All subsets of the six glints are identified with the pupil at six
+ * positions inside the pattern. The glints are shuffled and jittered a
+ * few pixels, and identified with the precomputed layouts and with the
+ * exhaustive search. The test fails if the two searches disagree. The
+ * labels are also compared to the true ones and the durations printed.
+ *
+ * Usage: pattern [nof rounds]
+ */
 
 #include <stdio.h>
 #include <stdlib.h>
-#include <iostream>
+#include <sys/time.h>
+#include <vector>
 #include "Pattern.h"
 #include "Pupil.h"
+#include "group.h"
 
 
-static const int RIGHT	= 0;
-static const int LEFT	= 1;
-static const int UP		= 2;
-static const int DOWN	= 3;
-static const int SPEED	= 6;
+static const int NOF_ROUNDS_DEFAULT	= 200;
 
+/* The glints are moved at most this many pixels */
+static const int JITTER				= 3;
+
+static const int NOF_POSITIONS		= 6;
+
+const int pupilPos[NOF_POSITIONS][2] = {{230, 162}, {230, 240}, {230, 318}, {410, 162}, {410, 240}, {410, 318}};
 
-const int pupilPos[6][2] = {{230, 162}, {230, 240}, {230, 318}, {410, 162}, {410, 240}, {410, 318}};
 
 /******************************************************************************
  * Prototypes
  ******************************************************************************/
-void drawPoints(cv::Mat &img_bgr, const Pattern &pattern);
-void drawPupil(cv::Mat &img_bgr, const Pupil &pupil);
-void movePupil(Pupil &pupil, int direction, const Pattern &pattern);
-void analyse_and_validate(cv::Mat &img_bgr, int pupilPosition);
+void createPoints(int pat, std::vector<cv::Point> &points, std::vector<int> &truth);
+bool sameConfiguration(const group::Configuration &c1, const group::Configuration &c2);
+double getMillis(const struct timeval &t1, const struct timeval &t2);
 
 
 /******************************************************************************
@@ -33,215 +45,175 @@ static const int WIN_W	= 640;
 static const int WIN_H	= 480;
 
 
-int pat = 0;
-
 // pattern
 Pattern pattern(cv::Size(WIN_W, WIN_H));
 
 // pupil
 Pupil pupil(50, WIN_W / 2, WIN_H / 2);
 
-// main loop state
-bool b_running = true;
 
 int main(int argc, char **argv) {
 
-	/* initialize random seed: */
-	srand(time(NULL));
+	int nRounds = argc > 1 ? atoi(argv[1]) : NOF_ROUNDS_DEFAULT;
+	nRounds = nRounds > 0 ? nRounds : 1;
 
+	srand(1);
 
-	std::string win_name("Main");
+	int nTests		= 0;
+	int nMismatches	= 0;
+	int nIdentified	= 0;
+	int nCorrect	= 0;
 
-	/**********************************************************************
-	 * Initialize the main window
-	 *********************************************************************/
-	cv::namedWindow(win_name, CV_WINDOW_AUTOSIZE);
+	double dMillisLayouts		= 0.0;
+	double dMillisExhaustive	= 0.0;
 
-	// displayed image
-	cv::Mat img_bgr(WIN_H, WIN_W, CV_8UC3);
+	for(int round = 0; round < nRounds; ++round) {
 
-	/**********************************************************************
-	 * Main loop
-	 *********************************************************************/
+		// all subsets of at least two glints
+		for(int pat = 0; pat <= 0x3F; ++pat) {
 
-	for(pat = 0; pat != 0b00111111; pat++) {
+			for(int pos = 0; pos < NOF_POSITIONS; ++pos) {
 
-		for(int i = 0; i < 6; i++)  {
-			if((pat >> i) & 1) {
-				pattern.set(i);
-			} else {
-				pattern.clear(i);
-			}
-		}
+				pupil.moveTo(pupilPos[pos][0], pupilPos[pos][1]);
 
-		for(int pos = 0; pos < 6; pos++) {
+				cv::Point pupil_centre;
+				pupil.getPos(pupil_centre.x, pupil_centre.y);
 
-			pupil.moveTo(pupilPos[pos][0], pupilPos[pos][1]);
+				std::vector<cv::Point> points;
+				std::vector<int> truth;
+				createPoints(pat, points, truth);
 
-			// clear the window
-			cv::rectangle(img_bgr, cv::Point(0, 0), cv::Point(WIN_W, WIN_H), cv::Scalar(255, 255, 255), CV_FILLED);
+				if(points.size() < 2) {
+					continue;
+				}
 
-			// draw the pupil
-			drawPupil(img_bgr, pupil);
+				struct timeval t1, t2;
 
-			// get the points from the pattern and draw them
-			drawPoints(img_bgr, pattern);
+				group::GroupManager grp;
+				gettimeofday(&t1, NULL);
+				const bool bLayouts = grp.identify(points, pupil_centre);
+				gettimeofday(&t2, NULL);
+				dMillisLayouts += getMillis(t1, t2);
 
-			// analyse and draw the results
-			analyse_and_validate(img_bgr, pos);
+				group::GroupManager grp_exhaustive;
+				grp_exhaustive.setExhaustive(true);
+				gettimeofday(&t1, NULL);
+				const bool bExhaustive = grp_exhaustive.identify(points, pupil_centre);
+				gettimeofday(&t2, NULL);
+				dMillisExhaustive += getMillis(t1, t2);
 
-		}
+				++nTests;
 
-	}
+				if(bLayouts != bExhaustive ||
+				   (bLayouts && !sameConfiguration(grp.getBestConfiguration(),
+				                                   grp_exhaustive.getBestConfiguration()))) {
 
+					++nMismatches;
+					printf("Pattern %d, pupil position %d: the searches disagree\n", pat, pos);
+					continue;
 
-	return EXIT_SUCCESS;
-}
-
-
-void drawPoints(cv::Mat &img_bgr, const Pattern &pattern) {
+				}
 
-	const std::vector<Glint> &points = pattern.getPoints();
+				if(!bLayouts) {
+					continue;
+				}
 
-	std::vector<Glint>::const_iterator it = points.begin();
+				++nIdentified;
 
-	// circle radius
-	const int radius = 15;
+				const std::vector<group::Element> &elements = grp.getBestConfiguration().elements;
 
-	while(it != points.end()) {
+				bool bCorrect = true;
+				for(size_t i = 0; i < elements.size(); ++i) {
+					if(elements[i].label != truth[i]) {
+						bCorrect = false;
+					}
+				}
 
-		int solid = it->b_visible ? CV_FILLED : 2;
-		cv::Scalar color = it->b_visible ? cv::Scalar(0, 255, 0) : cv::Scalar(50, 50, 50);
+				if(bCorrect) {
+					++nCorrect;
+				}
+				else if(round == 0) {
+					printf("Pattern %d was misidentified, glints seen: %d, pupil position: %d\n",
+						   pat, (int)points.size(), pos);
+				}
 
-		const cv::Point &p = it->p;
+			}
 
-		cv::circle(img_bgr, p, radius, color, solid, CV_AA);
+		}
 
-		++it;
 	}
 
-}
-
-
-void drawPupil(cv::Mat &img_bgr, const Pupil &pupil) {
-
-	cv::Point p;
-	pupil.getPos(p.x, p.y);
-
-	int radius = pupil.getRadius();
+	printf("%d tests, %d identified, %d correctly\n", nTests, nIdentified, nCorrect);
+	printf("precomputed layouts %8.4f us/test\n", 1e3 * dMillisLayouts / nTests);
+	printf("exhaustive search   %8.4f us/test\n", 1e3 * dMillisExhaustive / nTests);
 
-	cv::circle(img_bgr, p, radius, cv::Scalar(0, 0, 0), CV_FILLED, CV_AA);
+	const bool bOk = nMismatches == 0;
+	printf("%s\n", bOk ? "OK" : "FAILED");
 
+	return bOk ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
 
-void analyse_and_validate(cv::Mat &img_bgr, int pupilPosition) {
-
-	std::vector<int> labels;
-
-	cv::Point pupil_centre;
-	pupil.getPos(pupil_centre.x, pupil_centre.y);
-
+/*
+ * The visible glints of the pattern in a random order. truth holds
+ * the label of each point.
+ */
+void createPoints(int pat, std::vector<cv::Point> &points, std::vector<int> &truth) {
 
 	const std::vector<Glint> &glints = pattern.getPoints();
-	std::vector<cv::Point> tmp_points;
-	for(size_t i = 0; i < glints.size(); ++i) {
-
-		if(glints[i].b_visible) {
-			tmp_points.push_back(glints[i].p);
-		}
-	}
 
-	std::vector<cv::Point> points(tmp_points.size());
+	for(size_t i = 0; i < glints.size(); ++i) {
 
-	for(size_t i = 0; i < points.size(); ++i) {
+		if((pat >> i) & 1) {
 
-		// 0 - 1
-		double c = (double)rand() / (double)RAND_MAX;
+			cv::Point p = glints[i].p;
+			p.x += rand() % (2 * JITTER + 1) - JITTER;
+			p.y += rand() % (2 * JITTER + 1) - JITTER;
 
-		int rand_ind = (int)(c * (tmp_points.size() - 1) + 0.5);
+			points.push_back(p);
+			truth.push_back((int)i);
 
-		points[i] = tmp_points[rand_ind];
+		}
 
-		tmp_points.erase(tmp_points.begin() + rand_ind);
 	}
 
+	// shuffle
+	for(int i = (int)points.size() - 1; i > 0; --i) {
 
-	pattern.identifyPoints(pupil_centre, points, labels);
+		const int j = rand() % (i + 1);
 
-	int foundStuff = 0;
-
-	std::vector<Glint> pointsg = pattern.getPoints();
-
-	for(size_t i = 0; i < labels.size(); ++i) {
-
-		foundStuff |= 1 << labels[i];
-
-		cv::Scalar color = cv::Scalar(255, 0, 0);
-		cv::Point p = pointsg[labels[i]].p;
-		cv::circle(img_bgr, p, 15, color, CV_FILLED, CV_AA);
+		std::swap(points[i], points[j]);
+		std::swap(truth[i], truth[j]);
 
 	}
 
-	if (foundStuff != pat && labels.size() > 1) {
-		
-		std::stringstream tmpstream;
-		tmpstream << "Pattern_" << pat << "_" << foundStuff << ".jpg";
-		std::string tmp = tmpstream.str();
-		cv::imwrite(tmp, img_bgr);
-		std::cout << "Pattern " << pat << " was recognised as " << foundStuff << ", glints seen: " << labels.size() << ", Pupil position: " << pupilPosition << std::endl;
-	}
 }
 
 
-void movePupil(Pupil &pupil, int direction, const Pattern &pattern) {
-
-	int x, y;
-	pupil.getPos(x, y);
-
-	switch(direction) {
-
-		case LEFT: {
-
-			x -= SPEED;
-
-			break;
-		}
-
-		case RIGHT: {
-
-			x += SPEED;
+bool sameConfiguration(const group::Configuration &c1, const group::Configuration &c2) {
 
-			break;
-		}
-
-		case UP: {
-
-			y -= SPEED;
-
-			break;
-		}
+	if(c1.err != c2.err || c1.elements.size() != c2.elements.size()) {
+		return false;
+	}
 
-		case DOWN: {
+	for(size_t i = 0; i < c1.elements.size(); ++i) {
 
-			y += SPEED;
+		const group::Element &e1 = c1.elements[i];
+		const group::Element &e2 = c2.elements[i];
 
-			break;
+		if(e1.label != e2.label ||
+		   e1.index_in_orig_list != e2.index_in_orig_list ||
+		   e1.p != e2.p) {
+			return false;
 		}
 
-		default: break;
-
 	}
 
-	const std::vector<Glint> &glints = pattern.getPoints();
-	std::vector<cv::Point> points(glints.size());
-	for(size_t i = 0; i < points.size(); ++i) {
-		points[i] = glints[i].p;
-	}
-
-	if(cv::pointPolygonTest(points, cv::Point2f(x, y), false) > 0) {
-		pupil.moveTo(x, y);
-	}
+	return true;
 
 }
 
+
+double getMillis(const struct timeval &t1, const struct timeval &t2) {
+	return 1e3 * (t2.tv_sec - t1.tv_sec) + 1e-3 * (t2.tv_usec - t1.tv_usec);
+}
@@ -150,14 +150,11 @@ void drawStarburst(cv::Mat & bgr_frame, const pointContainer &inliers, const poi
 
 	if (inliers.size()) {
 
-		pointContainer::const_iterator edge;
-		for (edge = inliers.begin();
-			edge != inliers.end( ) ;
-			edge++ ) {
-
-			int ind = round(edge->point.y) * step + 3 * round(edge->point.x);
-			if(round(edge->point.y) > bgr_frame.rows ||
-				round(edge->point.x) > bgr_frame.cols) {
+		for (size_t i = 0; i < inliers.size(); i++) {
+
+			int ind = round(inliers.y[i]) * step + 3 * round(inliers.x[i]);
+			if(round(inliers.y[i]) > bgr_frame.rows ||
+				round(inliers.x[i]) > bgr_frame.cols) {
 				cout << "Bad inlier point!\n";
 				exit(1);
 			}
@@ -169,14 +166,11 @@ void drawStarburst(cv::Mat & bgr_frame, const pointContainer &inliers, const poi
 
 	if (outliers.size()) {
 
-		pointContainer::const_iterator edge;
-		for(edge = outliers.begin();
-			edge != outliers.end() ;
-			edge++ ) {
+		for (size_t i = 0; i < outliers.size(); i++) {
 
-			int ind = round(edge->point.y) * step + 3 * round(edge->point.x);
-			if(round(edge->point.y) > bgr_frame.rows ||
-				round(edge->point.x) > bgr_frame.cols) {
+			int ind = round(outliers.y[i]) * step + 3 * round(outliers.x[i]);
+			if(round(outliers.y[i]) > bgr_frame.rows ||
+				round(outliers.x[i]) > bgr_frame.cols) {
 				cout << "Bad outlier point!\n";
 				exit(1);
 			}
@@ -196,13 +190,10 @@ void outputPointValues(cv::Mat &gray, const pointContainer & edge_points) {
 
 		cout << "Pixel values: ";
 
-		pointContainer::const_iterator edge;
-		for (edge = edge_points.begin();
-			edge != edge_points.end( ) ;
-			edge++ ) {
+		for (size_t i = 0; i < edge_points.size(); i++) {
 
-			int ptr = round(edge->point.y) * step + round(edge->point.x);
-			cout << edge->point.x << ", " << edge->point.y << ", " << (int)gray.data[ptr] << endl; 
+			int ptr = round(edge_points.y[i]) * step + round(edge_points.x[i]);
+			cout << edge_points.x[i] << ", " << edge_points.y[i] << ", " << (int)gray.data[ptr] << endl; 
 		}
 	}
 
@@ -390,6 +381,7 @@ int main(int argc, char **argv)
 
 
 		trackerSettings.set(*settingsPanel.getSettings());
+		tracker->setSettings(trackerSettings);
 
 		if(!prog_state.paused) {
 
@@ -532,6 +532,7 @@ int main(int argc, char **argv)
 
 
 		trackerSettings.set(*settingsPanel.getSettings());
+		pupilTracker->setSettings(trackerSettings);
 
 		if(!prog_state.paused) {
 
@@ -1,5 +1,6 @@
 #include "CameraFrame.h"
 #include <string.h>
+#include <time.h>
 
 
 VideoInfo::VideoInfo() {
@@ -24,9 +25,12 @@ CameraFrame::CameraFrame(int _w,
 	bpp			= _bpp;
 	format		= _format;
 	sz			= _sz;
+	data		= NULL;
+	buffer		= NULL;
+	timestamp	= 0;
 
 	if(b_copy_data) {
-		b_own_data	= true;
+		b_own_data	= false;
 	}
 	else {
 		b_own_data	= b_become_parent;
@@ -38,8 +42,8 @@ CameraFrame::CameraFrame(int _w,
 
 			if(b_copy_data) {
 
-				data = new unsigned char[sz];
-				memcpy(data, _data, sz);
+				buffer = BufferPool::getDefault().copy(_data, sz);
+				data = buffer->data;
 
 			} else {
 				data = _data;
@@ -47,8 +51,33 @@ CameraFrame::CameraFrame(int _w,
 		}
 
 	}
+
+}
+
+
+CameraFrame::CameraFrame(int _w, int _h, int _bpp, SharedBuffer *_buffer, Format _format) {
+
+	w			= _w;
+	h			= _h;
+	bpp			= _bpp;
+	format		= _format;
+	b_own_data	= false;
+	buffer		= _buffer;
+	timestamp	= 0;
+
+	if(buffer != NULL) {
+
+		buffer->ref();
+
+		data	= buffer->data;
+		sz		= buffer->sz;
+
+	}
 	else {
-		data = NULL;
+
+		data	= NULL;
+		sz		= 0;
+
 	}
 
 }
@@ -61,13 +90,15 @@ CameraFrame::CameraFrame(const CameraFrame &orig) {
 	bpp		= orig.bpp;
 	format	= orig.format;
 	sz		= orig.sz;
-	b_own_data = true; // set to true regardless of the orig's data
+	timestamp = orig.timestamp;
+	b_own_data = false;
 
 	if(sz != 0) {
-		data = new unsigned char[sz];
-		memcpy(data, orig.data, sz);
+		buffer = orig.share();
+		data = buffer->data;
 	}
 	else {
+		buffer = NULL;
 		data = NULL;
 	}
 
@@ -80,26 +111,22 @@ CameraFrame &CameraFrame::operator= (const CameraFrame & other) {
 	// protect against invalid self-assignment
 	if(this != &other) {
 
-		// 1: allocate new memory and copy the elements
-		unsigned char *new_data = new unsigned char[other.sz];
-
-		memcpy(new_data, other.data, other.sz);
+		// 1: share or copy the data
+		SharedBuffer *new_buffer = other.sz != 0 ? other.share() : NULL;
 
 		// 2: deallocate old memory
-		if(b_own_data) {
-			delete[] data;
-		}
+		release();
 
 		// 3: assign the new memory to the object
-		data = new_data;
+		buffer	= new_buffer;
+		data	= buffer != NULL ? buffer->data : NULL;
 
 		w		= other.w;
 		h		= other.h;
 		bpp		= other.bpp;
 		format	= other.format;
 		sz		= other.sz;
-
-		b_own_data = true; // set to true regardless of the other's data
+		timestamp = other.timestamp;
 
 	}
 
@@ -111,29 +138,33 @@ CameraFrame &CameraFrame::operator= (const CameraFrame & other) {
 
 CameraFrame::~CameraFrame() {
 
-	if(b_own_data) {
-		delete[] data;
-	}
+	release();
 
 }
 
 
 void CameraFrame::create(int _w, int _h, int _bpp, const unsigned char *_data, size_t _sz, Format _format) {
 
-	size_t sz_old = sz;
+	// reuse the buffer only if the size matches and no other frame uses it
+	const bool b_reuse = buffer != NULL && buffer->getRefCount() == 1 && buffer->sz == _sz;
+
+	if(!b_reuse) {
+
+		release();
+
+		buffer = BufferPool::getDefault().acquire(_sz);
+
+	}
 
 	w = _w;
 	h = _h;
 	bpp = _bpp;
 	format = _format;
 	sz = _sz;
+	data = buffer->data;
 
-	// allocate only if sizes differ
-	if(sz_old != sz) {
-		if(b_own_data) {
-			delete[] data;
-		}
-		data = new unsigned char[sz];
+	if(_data != NULL) {
+		memcpy(data, _data, sz);
 	}
 
 }
@@ -141,12 +172,93 @@ void CameraFrame::create(int _w, int _h, int _bpp, const unsigned char *_data, s
 
 void CameraFrame::release() {
 
-	if(b_own_data) {
+	if(buffer != NULL) {
+		buffer->unref();
+	}
+	else if(b_own_data) {
 		delete[] data;
 	}
+
+	buffer = NULL;
+	b_own_data = false;
 	data = NULL;
 	w = h = bpp = sz = 0;
 	format = FORMAT_RGB;
+	timestamp = 0;
+
+}
+
+
+int64_t CameraFrame::getTime() {
+
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
 
 }
 
+
+int CameraFrame::getBytesPerPixel(Format _format) {
+
+	switch(_format) {
+
+		case FORMAT_YUV:
+			return 2;
+
+		case FORMAT_I420:
+			return 1;
+
+		default:
+			return 3;
+
+	}
+
+}
+
+
+size_t CameraFrame::getFrameSize(Format _format, int _w, int _h) {
+
+	switch(_format) {
+
+		case FORMAT_MJPG:
+			return 0;
+
+		case FORMAT_I420:
+			// the chroma planes are rounded up for odd sizes
+			return (size_t)_w * _h + 2 * (size_t)((_w + 1) / 2) * ((_h + 1) / 2);
+
+		default:
+			return (size_t)_w * _h * getBytesPerPixel(_format);
+
+	}
+
+}
+
+
+SharedBuffer *CameraFrame::share() const {
+
+	if(buffer != NULL) {
+		buffer->ref();
+		return buffer;
+	}
+
+	return BufferPool::getDefault().copy(data, sz);
+
+}
+
+
+void CameraFrame::makeWritable() {
+
+	if(buffer == NULL || buffer->getRefCount() == 1) {
+		return;
+	}
+
+	SharedBuffer *copy = BufferPool::getDefault().copy(data, sz);
+
+	buffer->unref();
+
+	buffer	= copy;
+	data	= buffer->data;
+
+}
@@ -3,15 +3,27 @@
 
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <string>
+#include "SharedBuffer.h"
 
 
-/* Video frame formats */
+/*
+ * Video frame formats:
+ *
+ *     FORMAT_YUV   packed YUYV 4:2:2, 2 bytes per pixel
+ *     FORMAT_RGB   24-bit RGB
+ *     FORMAT_BGR   24-bit BGR
+ *     FORMAT_MJPG  a JPEG image
+ *     FORMAT_I420  planar YUV 4:2:0, the luma plane followed by the U
+ *                  and V planes of half the width and height
+ */
 enum Format {
 	FORMAT_YUV,
 	FORMAT_RGB,
 	FORMAT_BGR,
-	FORMAT_MJPG
+	FORMAT_MJPG,
+	FORMAT_I420
 };
 
 
@@ -45,12 +57,19 @@ class VideoInfo {
 
 
 
+/*
+ * A video frame. The data is either owned by the frame, borrowed or
+ * shared with other frames through a SharedBuffer. Copying a frame
+ * that has a buffer only adds a reference, other frames are copied
+ * to a buffer of the BufferPool.
+ */
 class CameraFrame {
 
 	public:
 
 		/*
-		 * Constructor with parameters to initialise the object
+		 * Constructor with parameters to initialise the object. If
+		 * b_copy_data is set, the data is copied to a pooled buffer.
 		 */
 		CameraFrame(int _w					= 0,
 					int _h					= 0,
@@ -63,12 +82,18 @@ class CameraFrame {
 
 
 		/*
-		 * Copy constructor
+		 * A frame sharing the given buffer, adds a reference to it
+		 */
+		CameraFrame(int _w, int _h, int _bpp, SharedBuffer *_buffer, Format _format);
+
+
+		/*
+		 * Copy constructor, shares the buffer if there is one
 		 */
 		CameraFrame(const CameraFrame &orig);
 
 		/*
-		 * Assignment operator
+		 * Assignment operator, shares the buffer if there is one
 		 */
 		CameraFrame & operator= (const CameraFrame & other);
 
@@ -88,6 +113,35 @@ class CameraFrame {
 		 */
 		void release();
 
+		/*
+		 * Get a reference to the data. Adds a reference to the buffer,
+		 * or copies the data to a pooled buffer if the frame has none.
+		 * The caller must unref() the returned buffer.
+		 */
+		SharedBuffer *share() const;
+
+		/*
+		 * Must be called before modifying the data. Copies the data to
+		 * a buffer of its own if the buffer is shared with other frames.
+		 */
+		void makeWritable();
+
+		/* The current time of the clock of the timestamps, in microseconds */
+		static int64_t getTime();
+
+		/*
+		 * The bytes per pixel of the frames of the given format. For
+		 * FORMAT_I420 that of the luma plane, and for FORMAT_MJPG that of
+		 * the decompressed frame.
+		 */
+		static int getBytesPerPixel(Format _format);
+
+		/*
+		 * The size in bytes of a w x h frame of the given format, 0 for
+		 * FORMAT_MJPG
+		 */
+		static size_t getFrameSize(Format _format, int _w, int _h);
+
 
 		int w;					// width
 		int h;					// height
@@ -95,7 +149,9 @@ class CameraFrame {
 		int bpp;				// bytes per pixel
 		size_t sz;				// size in bytes of the image data
 		Format format;			// frame format
-		bool b_own_data;		// does this frame own the data
+		bool b_own_data;		// does this frame own the data, not used with a buffer
+		SharedBuffer *buffer;	// the shared data, NULL if none
+		int64_t timestamp;		// capture time in microseconds, see getTime(). 0 if unknown
 
 };
 
@@ -30,6 +30,41 @@ static void getImageDim(GstBuffer *buffer, int &w, int &h) {
 
 
 
+/*
+ * Shares the data of a GstBuffer with the frames. The GstBuffer is
+ * referenced as long as any frame uses it. v4l2src copies the frames
+ * from the driver's buffers by default ("always-copy"), so holding
+ * the buffers does not stall the camera.
+ */
+class GstSharedBuffer : public SharedBuffer {
+
+	public:
+
+		GstSharedBuffer(GstBuffer *_buffer) :
+			SharedBuffer(GST_BUFFER_DATA(_buffer), GST_BUFFER_SIZE(_buffer)) {
+
+			gst_buffer_ref(_buffer);
+			buffer = _buffer;
+
+		}
+
+	protected:
+
+		void dispose() {
+
+			gst_buffer_unref(buffer);
+			delete this;
+
+		}
+
+	private:
+
+		GstBuffer *buffer;
+
+};
+
+
+
 /*******************************************************************************
  * bus_call() - Bus call handler.
  *
@@ -106,24 +141,33 @@ static gboolean frameGrabbed_public(GstElement * element,
 	// video format
 	const Format format = info.format;
 
+	// the uncompressed frames must be complete
+	if(sz < CameraFrame::getFrameSize(format, w, h)) {
+
+		std::cout	<< "incomplete frame for " << id
+					<< " (" << w << "," << h << "): size " << sz << std::endl;
+
+		return FALSE;
+
+	}
+
+	int bpp = CameraFrame::getBytesPerPixel(format);
+
+	// share the buffer with the frame. Does not copy data.
+	SharedBuffer *shared = new GstSharedBuffer(buffer);
 
-	// FIXME: remove the hat constant and ask the value from the buffer
-	int bpp = 3;
+	CameraFrame frame(w, h, bpp, shared, format);
 
-	// get a pointer to the image data
-	unsigned char *data = buffer->data;
+	// the frame holds a reference now
+	shared->unref();
 
-	// create a header for the data. Does not copy data.
-	CameraFrame frame(w,
-					  h,
-					  bpp,
-					  data,
-					  sz,
-					  format,
-					  false,	// copy data
-					  false);	// do not become parent, i.e. do not destroy data in destructor
+	// the frames of the cameras are paired by the timestamps
+	frame.timestamp = cap_dev->getCaptureTime(buffer);
 
-	// call the frame receiver
+	/*
+	 * Call the frame receiver. Copies of the frame share the buffer
+	 * and keep it alive after the callback.
+	 */
 	receiver->frameReceived(&frame, id);
 
 	// everythin is ok
@@ -149,6 +193,43 @@ CaptureDevice::~CaptureDevice() {
 
 
 
+/*
+ * The buffer timestamps are in the running time of the pipeline, and
+ * the pipelines of the cameras have their own base times. The age of
+ * the buffer is measured with the pipeline clock and subtracted from
+ * the current time, so the results of the cameras are comparable.
+ */
+int64_t CaptureDevice::getCaptureTime(GstBuffer *buffer) {
+
+	const int64_t now = CameraFrame::getTime();
+
+	const GstClockTime ts = GST_BUFFER_TIMESTAMP(buffer);
+
+	if(!GST_CLOCK_TIME_IS_VALID(ts)) {
+		return now;
+	}
+
+	GstClock *clock = gst_element_get_clock(pipeline);
+
+	if(clock == NULL) {
+		return now;
+	}
+
+	const GstClockTime clockNow	= gst_clock_get_time(clock);
+	const GstClockTime captured	= gst_element_get_base_time(pipeline) + ts;
+
+	gst_object_unref(clock);
+
+	if(captured > clockNow) {
+		return now;
+	}
+
+	return now - (int64_t)((clockNow - captured) / GST_USECOND);
+
+}
+
+
+
 /*******************************************************************************
  * CaptureDevice::init - Initialize the capture device
  *
@@ -188,9 +269,17 @@ bool CaptureDevice::init(const std::string &devpath,
 	GstElement * filter0 = gst_element_factory_make ("capsfilter", NULL);
 	{
 		char * format_c;
+		guint32 fourcc = 0;
 		switch(_format) {
 			case FORMAT_YUV: {
 				format_c = (char *)"video/x-raw-yuv";
+				fourcc = GST_MAKE_FOURCC('Y', 'U', 'Y', '2');
+				break;
+			}
+
+			case FORMAT_I420: {
+				format_c = (char *)"video/x-raw-yuv";
+				fourcc = GST_MAKE_FOURCC('I', '4', '2', '0');
 				break;
 			}
 
@@ -222,6 +311,11 @@ bool CaptureDevice::init(const std::string &devpath,
     			"framerate", GST_TYPE_FRACTION, _framerate, 1,
 			(char *)NULL);
 
+		// the layout of the YUV frames, see Format
+		if(fourcc != 0) {
+			gst_caps_set_simple(filtercaps, "format", GST_TYPE_FOURCC, fourcc, (char *)NULL);
+		}
+
 		g_object_set(G_OBJECT(filter0), "caps",  filtercaps, (char *)NULL);
 		gst_caps_unref (filtercaps);
 	}
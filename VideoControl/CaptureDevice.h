@@ -90,6 +90,12 @@ class CaptureDevice {
 		/* Get the id of this device, also user defined */
 		int getID() {return id;}
 
+		/*
+		 * The capture time of the buffer, see CameraFrame::getTime().
+		 * The arrival time if the buffer has no timestamp.
+		 */
+		int64_t getCaptureTime(GstBuffer *buffer);
+
 	private:
 
 		GstElement *pipeline;
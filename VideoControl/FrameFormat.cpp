@@ -0,0 +1,212 @@
+#include "FrameFormat.h"
+#include <stdio.h>
+#include <string.h>
+
+
+static inline unsigned char clamp(int val) {
+
+	return (unsigned char)(val < 0 ? 0 : (val > 255 ? 255 : val));
+
+}
+
+
+/* BT.601, video range */
+static inline void yuvToBGR(int y, int u, int v, unsigned char *bgr) {
+
+	const int c = 298 * (y - 16) + 128;
+	const int d = u - 128;
+	const int e = v - 128;
+
+	bgr[0] = clamp((c + 516 * d) >> 8);
+	bgr[1] = clamp((c - 100 * d - 208 * e) >> 8);
+	bgr[2] = clamp((c + 409 * e) >> 8);
+
+}
+
+
+/* Does the frame hold all of its pixels */
+static bool isComplete(const CameraFrame &frame) {
+
+	return frame.data != NULL && frame.sz >= CameraFrame::getFrameSize(frame.format, frame.w, frame.h);
+
+}
+
+
+const unsigned char *FrameFormat::getLumaPlane(const CameraFrame &frame, int &step) {
+
+	if(frame.format != FORMAT_I420 || !isComplete(frame)) {
+		return NULL;
+	}
+
+	step = frame.w;
+
+	return frame.data;
+
+}
+
+
+bool FrameFormat::getLuma(const CameraFrame &frame,
+						  int x, int y, int _w, int _h,
+						  unsigned char *oput, int stride,
+						  JPEG_Decompressor &jpgd) {
+
+	if(x < 0 || y < 0 || _w <= 0 || _h <= 0 || x + _w > frame.w || y + _h > frame.h) {
+		printf("FrameFormat::getLuma(): The area is not inside the frame\n");
+		return false;
+	}
+
+	if(frame.format == FORMAT_MJPG) {
+		return jpgd.decompressGray(frame.data, frame.sz, x, y, _w, _h, oput, stride);
+	}
+
+	if(!isComplete(frame)) {
+		printf("FrameFormat::getLuma(): The frame is too small\n");
+		return false;
+	}
+
+	switch(frame.format) {
+
+		case FORMAT_YUV: {
+
+			// every other byte is luma
+			for(int row = 0; row < _h; ++row) {
+
+				const unsigned char *src = frame.data + 2 * ((size_t)(y + row) * frame.w + x);
+				unsigned char *dst = oput + (size_t)row * stride;
+
+				for(int col = 0; col < _w; ++col) {
+					dst[col] = src[2 * col];
+				}
+
+			}
+
+			break;
+
+		}
+
+		case FORMAT_I420: {
+
+			for(int row = 0; row < _h; ++row) {
+				memcpy(oput + (size_t)row * stride, frame.data + (size_t)(y + row) * frame.w + x, _w);
+			}
+
+			break;
+
+		}
+
+		case FORMAT_RGB:
+		case FORMAT_BGR: {
+
+			// the weights of cv::cvtColor(), 14-bit fixed point
+			const int wFirst = frame.format == FORMAT_RGB ? 4899 : 1868;
+			const int wLast  = frame.format == FORMAT_RGB ? 1868 : 4899;
+
+			for(int row = 0; row < _h; ++row) {
+
+				const unsigned char *src = frame.data + 3 * ((size_t)(y + row) * frame.w + x);
+				unsigned char *dst = oput + (size_t)row * stride;
+
+				for(int col = 0; col < _w; ++col, src += 3) {
+					dst[col] = (unsigned char)((wFirst * src[0] + 9617 * src[1] + wLast * src[2] + (1 << 13)) >> 14);
+				}
+
+			}
+
+			break;
+
+		}
+
+		default:
+			return false;
+
+	}
+
+	return true;
+
+}
+
+
+bool FrameFormat::toBGR(const CameraFrame &frame, unsigned char *oput) {
+
+	if(frame.format == FORMAT_MJPG || !isComplete(frame)) {
+		printf("FrameFormat::toBGR(): Not an uncompressed frame\n");
+		return false;
+	}
+
+	const int w = frame.w;
+	const int h = frame.h;
+
+	switch(frame.format) {
+
+		case FORMAT_YUV: {
+
+			// a U and a V for every two pixels
+			if(w % 2 != 0) {
+				printf("FrameFormat::toBGR(): The width of a YUYV frame must be even\n");
+				return false;
+			}
+
+			const unsigned char *src = frame.data;
+			const unsigned char *end = frame.data + (size_t)2 * w * h;
+
+			for( ; src < end; src += 4, oput += 6) {
+				yuvToBGR(src[0], src[1], src[3], oput);
+				yuvToBGR(src[2], src[1], src[3], oput + 3);
+			}
+
+			break;
+
+		}
+
+		case FORMAT_I420: {
+
+			const int wChroma = (w + 1) / 2;
+			const int hChroma = (h + 1) / 2;
+
+			const unsigned char *planeY = frame.data;
+			const unsigned char *planeU = planeY + (size_t)w * h;
+			const unsigned char *planeV = planeU + (size_t)wChroma * hChroma;
+
+			for(int row = 0; row < h; ++row) {
+
+				const unsigned char *srcY = planeY + (size_t)row * w;
+				const unsigned char *srcU = planeU + (size_t)(row / 2) * wChroma;
+				const unsigned char *srcV = planeV + (size_t)(row / 2) * wChroma;
+
+				for(int col = 0; col < w; ++col, oput += 3) {
+					yuvToBGR(srcY[col], srcU[col / 2], srcV[col / 2], oput);
+				}
+
+			}
+
+			break;
+
+		}
+
+		case FORMAT_RGB: {
+
+			const unsigned char *src = frame.data;
+			const unsigned char *end = frame.data + (size_t)3 * w * h;
+
+			for( ; src < end; src += 3, oput += 3) {
+				oput[0] = src[2];
+				oput[1] = src[1];
+				oput[2] = src[0];
+			}
+
+			break;
+
+		}
+
+		case FORMAT_BGR:
+			memcpy(oput, frame.data, (size_t)3 * w * h);
+			break;
+
+		default:
+			return false;
+
+	}
+
+	return true;
+
+}
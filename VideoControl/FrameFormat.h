@@ -0,0 +1,49 @@
+#ifndef FRAME_FORMAT_H
+#define FRAME_FORMAT_H
+
+
+#include "CameraFrame.h"
+#include "jpeg.h"
+
+
+/*
+ * Gets the luma and the colours of the frames of any format, see Format,
+ * without converting more than is asked for. The luma of a FORMAT_I420
+ * frame is a plane of its own and can be used as it is.
+ *
+ * The YUV formats use the BT.601 video range. The luma of the RGB and
+ * BGR frames is computed with the integer weights of cv::cvtColor().
+ */
+class FrameFormat {
+
+	public:
+
+		/*
+		 * The luma plane of the frame if it can be used without a copy,
+		 * one byte per pixel and step bytes per row. NULL for the formats
+		 * other than FORMAT_I420.
+		 */
+		static const unsigned char *getLumaPlane(const CameraFrame &frame, int &step);
+
+		/*
+		 * Copy the luma of the area (x, y, _w, _h) of the frame to oput,
+		 * the rows stride bytes apart. MJPG frames are decompressed with
+		 * jpgd, only the area and without the chroma. Fails if the area
+		 * is not inside the frame or the frame is too small or corrupt.
+		 */
+		static bool getLuma(const CameraFrame &frame,
+							int x, int y, int _w, int _h,
+							unsigned char *oput, int stride,
+							JPEG_Decompressor &jpgd);
+
+		/*
+		 * Convert an uncompressed frame to 24-bit BGR, w * h * 3 bytes.
+		 * Fails for FORMAT_MJPG and for frames too small for their size.
+		 */
+		static bool toBGR(const CameraFrame &frame, unsigned char *oput);
+
+};
+
+
+#endif
+
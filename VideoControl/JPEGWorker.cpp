@@ -1,5 +1,4 @@
 #include "JPEGWorker.h"
-#include "jpeg.h"
 #include <iostream>
 
 
@@ -28,12 +27,12 @@ CameraFrame *JPEGWorker::process(CameraFrame *img_compr) {
 	const unsigned char *data_compr = img_compr->data;
 
 
-	// decompressed data, allocate here
-	unsigned char *data_decompr = new unsigned char[bpp*w*h];
+	// decompressed data, from the pool
+	SharedBuffer *buffer = BufferPool::getDefault().acquire(bpp*w*h);
+	unsigned char *data_decompr = buffer->data;
 
 
-	// create the JPEG decompressor and decompress the frame, use the preallocated data
-	JPEG_Decompressor jpgd;
+	// decompress the frame, use the preallocated data
 	bool success = jpgd.decompress(data_compr, img_compr->sz, data_decompr);
 
 	// if unseccesfull, make a white frame
@@ -46,19 +45,11 @@ CameraFrame *JPEGWorker::process(CameraFrame *img_compr) {
 
 	}
 
-	/*
-	 * create a new frame with the decompressed data, do not copy
-	 * the data, use the pointer instead
-	 */
-	CameraFrame *img_raw = new CameraFrame(w,
-										   h,
-										   bpp,
-										   data_decompr,
-										   w*h*bpp,
-										   FORMAT_RGB,
-										   false,		// do not copy, take the pointer instead
-										   true);		// become parent of the data
+	// create a new frame sharing the decompressed data
+	CameraFrame *img_raw = new CameraFrame(w, h, bpp, buffer, FORMAT_RGB);
 
+	// the frame holds a reference now
+	buffer->unref();
 
 	return img_raw;
 
@@ -3,6 +3,7 @@
 
 
 #include "StreamWorker.h"
+#include "jpeg.h"
 
 
 
@@ -17,6 +18,9 @@ class JPEGWorker : public StreamWorker {
 
 		CameraFrame *process(CameraFrame *img_compr);
 
+		/* Used for all frames of the worker */
+		JPEG_Decompressor jpgd;
+
 };
 
 
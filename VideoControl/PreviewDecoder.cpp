@@ -0,0 +1,65 @@
+#include "PreviewDecoder.h"
+#include "FrameFormat.h"
+#include <stdio.h>
+#include <string.h>
+
+
+PreviewDecoder::PreviewDecoder(int _targetW, int _targetH) {
+
+	targetW = _targetW;
+	targetH = _targetH;
+
+}
+
+
+CameraFrame *PreviewDecoder::decode(const CameraFrame &frame) {
+
+	if(frame.format == FORMAT_RGB || frame.format == FORMAT_BGR) {
+		return new CameraFrame(frame);
+	}
+
+	// libjpeg rounds the scaled size up
+	const int scaleDenom = frame.format == FORMAT_MJPG ?
+						   JPEG_Decompressor::getScaleDenom(frame.w, frame.h, targetW, targetH) : 1;
+
+	const int w = (frame.w + scaleDenom - 1) / scaleDenom;
+	const int h = (frame.h + scaleDenom - 1) / scaleDenom;
+
+	SharedBuffer *buffer = BufferPool::getDefault().acquire(3 * w * h);
+
+	Format format = FORMAT_BGR;
+	bool success;
+
+	if(frame.format == FORMAT_MJPG) {
+
+		success = jpgd.decompress(frame.data, frame.sz, buffer->data, scaleDenom);
+
+		// like JPEGWorker
+		format = FORMAT_RGB;
+
+	}
+	else {
+
+		success = FrameFormat::toBGR(frame, buffer->data);
+
+	}
+
+	// if unsuccessfull, make a white frame like JPEGWorker does
+	if(!success) {
+
+		printf("PreviewDecoder::decode(): Could not decode, setting frame to white\n");
+
+		memset(buffer->data, 255, 3 * w * h);
+
+	}
+
+	CameraFrame *decoded = new CameraFrame(w, h, 3, buffer, format);
+
+	// the frame holds a reference now
+	buffer->unref();
+
+	decoded->timestamp = frame.timestamp;
+
+	return decoded;
+
+}
@@ -0,0 +1,43 @@
+#ifndef PREVIEW_DECODER_H
+#define PREVIEW_DECODER_H
+
+
+#include "CameraFrame.h"
+#include "jpeg.h"
+
+
+/*
+ * Decodes the frames for showing them, when they are shown and at about
+ * the size they are shown at. The MJPG frames are decompressed with the
+ * scaled IDCT of libjpeg at 1/2, 1/4 or 1/8 of the size, the smallest
+ * that still covers the target size. The YUV frames are converted to
+ * BGR at the full size and the RGB and BGR frames are shared as they
+ * are. Not thread safe, use an instance per thread.
+ */
+class PreviewDecoder {
+
+	public:
+
+		/* The frames are shown in a _targetW x _targetH widget */
+		PreviewDecoder(int _targetW, int _targetH);
+
+		/*
+		 * Decode the frame. Returns a new frame sharing the data of the
+		 * frame or holding the decoded data, white if the frame could
+		 * not be decoded. The caller must delete it. Its size over the
+		 * size of the frame gives the scale of the coordinates.
+		 */
+		CameraFrame *decode(const CameraFrame &frame);
+
+	private:
+
+		JPEG_Decompressor jpgd;
+
+		int targetW;
+		int targetH;
+
+};
+
+
+#endif
+
@@ -0,0 +1,213 @@
+#include "SharedBuffer.h"
+#include <string.h>
+
+
+/*
+ * A buffer allocated by the BufferPool, given back to it when the last
+ * reference is dropped.
+ */
+class PooledBuffer : public SharedBuffer {
+
+	public:
+
+		PooledBuffer(BufferPool *_pool, int _bucket, size_t _capacity) :
+			SharedBuffer(new unsigned char[_capacity], _capacity) {
+
+			pool		= _pool;
+			bucket		= _bucket;
+			capacity	= _capacity;
+
+		}
+
+		~PooledBuffer() {
+			delete[] data;
+		}
+
+		/* Prepare for reuse */
+		void reset(size_t _sz) {
+			sz		= _sz;
+			refs	= 1;
+		}
+
+		BufferPool *pool;
+
+		/* See BufferPool::getBucket() */
+		int bucket;
+
+		size_t capacity;
+
+	protected:
+
+		void dispose() {
+			pool->recycle(this);
+		}
+
+};
+
+
+SharedBuffer::SharedBuffer(unsigned char *_data, size_t _sz) {
+
+	data	= _data;
+	sz		= _sz;
+	refs	= 1;
+
+}
+
+
+void SharedBuffer::ref() {
+
+	__sync_add_and_fetch(&refs, 1);
+
+}
+
+
+void SharedBuffer::unref() {
+
+	if(__sync_sub_and_fetch(&refs, 1) == 0) {
+		dispose();
+	}
+
+}
+
+
+BufferPool::BufferPool() {
+
+	pthread_mutex_init(&mutex, NULL);
+
+}
+
+
+BufferPool::~BufferPool() {
+
+	for(int i = 0; i < NOF_BUCKETS; ++i) {
+
+		for(size_t j = 0; j < idle[i].size(); ++j) {
+			delete idle[i][j];
+		}
+
+	}
+
+	pthread_mutex_destroy(&mutex);
+
+}
+
+
+int BufferPool::getBucket(size_t sz) {
+
+	int bucket = 0;
+
+	while(((size_t)1 << (bucket + MIN_BUCKET_BITS)) < sz) {
+
+		if(++bucket == NOF_BUCKETS) {
+			return -1;
+		}
+
+	}
+
+	return bucket;
+
+}
+
+
+SharedBuffer *BufferPool::acquire(size_t sz) {
+
+	const int bucket = getBucket(sz);
+
+	__sync_add_and_fetch(&stats.nAcquired, 1);
+
+
+	/*********************************************************
+	 * Reuse a released buffer of the same capacity
+	 *********************************************************/
+	if(bucket >= 0) {
+
+		pthread_mutex_lock(&mutex);
+
+			PooledBuffer *buffer = NULL;
+
+			if(idle[bucket].size() > 0) {
+				buffer = idle[bucket].back();
+				idle[bucket].pop_back();
+			}
+
+		pthread_mutex_unlock(&mutex);
+
+		if(buffer != NULL) {
+			buffer->reset(sz);
+			return buffer;
+		}
+
+	}
+
+
+	/*********************************************************
+	 * None available, allocate. Too large buffers are not
+	 * pooled and are deleted when released.
+	 *********************************************************/
+	__sync_add_and_fetch(&stats.nAllocations, 1);
+
+	const size_t capacity = bucket >= 0 ? (size_t)1 << (bucket + MIN_BUCKET_BITS) : sz;
+
+	PooledBuffer *buffer = new PooledBuffer(this, bucket, capacity);
+	buffer->reset(sz);
+
+	return buffer;
+
+}
+
+
+SharedBuffer *BufferPool::copy(const unsigned char *data, size_t sz) {
+
+	SharedBuffer *buffer = acquire(sz);
+
+	memcpy(buffer->data, data, sz);
+
+	__sync_add_and_fetch(&stats.nBytesCopied, sz);
+
+	return buffer;
+
+}
+
+
+void BufferPool::recycle(PooledBuffer *buffer) {
+
+	if(buffer->bucket >= 0) {
+
+		pthread_mutex_lock(&mutex);
+
+			std::vector<PooledBuffer *> &list = idle[buffer->bucket];
+
+			if((int)list.size() < MAX_IDLE_BUFFERS) {
+
+				list.push_back(buffer);
+				buffer = NULL;
+
+			}
+
+		pthread_mutex_unlock(&mutex);
+
+	}
+
+	// not kept for reuse
+	delete buffer;
+
+}
+
+
+void BufferPool::getStats(Stats &_stats) {
+
+	_stats.nAllocations	= __sync_add_and_fetch(&stats.nAllocations, 0);
+	_stats.nAcquired	= __sync_add_and_fetch(&stats.nAcquired, 0);
+	_stats.nBytesCopied	= __sync_add_and_fetch(&stats.nBytesCopied, 0);
+
+}
+
+
+BufferPool &BufferPool::getDefault() {
+
+	static BufferPool *pool = new BufferPool();
+
+	return *pool;
+
+}
+
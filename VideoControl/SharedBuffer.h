@@ -0,0 +1,129 @@
+#ifndef SHAREDBUFFER_H
+#define SHAREDBUFFER_H
+
+
+#include <stdlib.h>
+#include <vector>
+#include <pthread.h>
+
+
+/*
+ * A reference counted block of frame data. The frames sharing a buffer
+ * must not modify the data, see CameraFrame::makeWritable().
+ *
+ * The buffer is created with one reference. When the last reference is
+ * dropped, dispose() returns the data to where it came from, e.g. to
+ * the BufferPool or to gstreamer.
+ */
+class SharedBuffer {
+
+	public:
+
+		/* Add a reference, thread safe */
+		void ref();
+
+		/* Drop a reference, thread safe. The buffer must not be used after this. */
+		void unref();
+
+		/* The number of references */
+		int getRefCount() const {return refs;}
+
+		/* The data and its size in bytes */
+		unsigned char *data;
+		size_t sz;
+
+	protected:
+
+		SharedBuffer(unsigned char *_data = NULL, size_t _sz = 0);
+
+		virtual ~SharedBuffer() {}
+
+		/* Called when the last reference has been dropped */
+		virtual void dispose() = 0;
+
+		volatile int refs;
+
+};
+
+
+class PooledBuffer;
+
+
+/*
+ * Buffers of power of two capacities. The released buffers are kept
+ * for reuse, so the frames of a stream are not allocated from the heap
+ * once the pool has warmed up.
+ */
+class BufferPool {
+
+	public:
+
+		/* Counters since the pool was created */
+		class Stats {
+
+			public:
+
+				Stats() {
+					nAllocations = nAcquired = nBytesCopied = 0;
+				}
+
+				/* Buffers allocated from the heap */
+				unsigned long nAllocations;
+
+				/* Buffers given by acquire() */
+				unsigned long nAcquired;
+
+				/* Bytes copied by copy() */
+				unsigned long nBytesCopied;
+
+		};
+
+
+		BufferPool();
+
+		/* All buffers of the pool must have been released */
+		~BufferPool();
+
+		/* Get a buffer of sz bytes with one reference */
+		SharedBuffer *acquire(size_t sz);
+
+		/* Get a buffer with a copy of the data, with one reference */
+		SharedBuffer *copy(const unsigned char *data, size_t sz);
+
+		void getStats(Stats &stats);
+
+		/*
+		 * The pool used by the frames. It is never destroyed, because the
+		 * frames may be released by other static objects at exit.
+		 */
+		static BufferPool &getDefault();
+
+	private:
+
+		friend class PooledBuffer;
+
+		/* Called by the buffer when its last reference is dropped */
+		void recycle(PooledBuffer *buffer);
+
+		/* The bucket index for sz bytes, -1 if sz is not pooled */
+		static int getBucket(size_t sz);
+
+		enum {
+			MIN_BUCKET_BITS		= 12,	// 4 kB
+			NOF_BUCKETS			= 15,	// the largest 64 MB
+			MAX_IDLE_BUFFERS	= 16	// per bucket
+		};
+
+		/* The released buffers for each capacity */
+		std::vector<PooledBuffer *> idle[NOF_BUCKETS];
+
+		/* Protects the idle lists */
+		pthread_mutex_t mutex;
+
+		Stats stats;
+
+};
+
+
+#endif
+
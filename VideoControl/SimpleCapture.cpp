@@ -142,16 +142,8 @@ bool SimpleCapture::open(const std::string &path,
 
 void SimpleCapture::frameReceived(const CameraFrame *_frame, int id) {
 
-    // copy the new frame
-    //		frame = new CameraFrame(*_frame);
-    CameraFrame *frame = new CameraFrame(_frame->w,
-                                         _frame->h,
-                                         _frame->bpp,
-                                         _frame->data,
-                                         _frame->sz,
-                                         _frame->format,
-                                         true,			 // copy data
-                                         true);		     // become parent, i.e. destroy data in destructor
+    // share the data of the new frame, copies only if it has no buffer
+    CameraFrame *frame = new CameraFrame(*_frame);
 
 	pthread_mutex_lock(&mutex_frame);
 
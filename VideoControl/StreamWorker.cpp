@@ -1,6 +1,9 @@
 #include "StreamWorker.h"
 
 
+/* The longest time getNextFrame() waits for a frame */
+static const int WAIT_MS = 100;
+
 
 void *stream_worker(void *arg) {
 
@@ -18,10 +21,7 @@ StreamWorker::StreamWorker() {
 	// not runnign  initially
 	b_running = false;
 
-	// create the protectors
-	pthread_mutex_init(&mutex_list, NULL);
-	pthread_cond_init(&cond_list, NULL);
-
+	// create the protector
 	pthread_mutex_init(&mutex_running, NULL);
 
 }
@@ -29,26 +29,14 @@ StreamWorker::StreamWorker() {
 
 StreamWorker::~StreamWorker() {
 
-	// delete all memory pointed by the list elements
-	pthread_mutex_lock(&mutex_list);
-
-		std::list<CameraFrame *>::iterator it = frames.begin();
-
-		while(it != frames.end()) {
-
-			delete *it;
-
-			++it;
-
-		}
-
-	pthread_mutex_unlock(&mutex_list);
-
+	// delete the frames that were not processed
+	CameraFrame *frame = NULL;
+	while(frames.pop(frame)) {
+		delete frame;
+	}
 
-	// destroy the protectors
-	pthread_mutex_destroy(&mutex_list);
-	pthread_cond_destroy(&cond_list);
 
+	// destroy the protector
 	pthread_mutex_destroy(&mutex_running);
 
 }
@@ -69,7 +57,15 @@ bool StreamWorker::init(WorkerCBHandler *_cb_handler, int _max_n_frames, void *_
 		return false;
 	}
 
-	return true;
+	// the capacity is rounded up, max_n_frames is applied by the policy
+	return frames.init(policy.getCapacity(max_n_frames));
+
+}
+
+
+void StreamWorker::setPolicy(QueuePolicy::Type type, int blockMs) {
+
+	policy.set(type, blockMs);
 
 }
 
@@ -125,14 +121,10 @@ void StreamWorker::end() {
 
 
 	/*
-	 * signal the list protector that we are not running anymore.
-	 * It might have gone to a waiting state if the getFrame()
-	 * sees that the list is empty.
+	 * wake the worker, it might be waiting in getNextFrame()
+	 * if the queue is empty.
 	 */
-	{
-		MutexLocker mllist(&mutex_list);
-		pthread_cond_signal(&cond_list);
-	}
+	frames.wake();
 
 	// wait for the thread to finish
 	pthread_join(thread, NULL);
@@ -140,84 +132,92 @@ void StreamWorker::end() {
 }
 
 
-void StreamWorker::add(CameraFrame *_frame) {
+bool StreamWorker::add(CameraFrame *_frame) {
 
-	// protect the list
-	MutexLocker mllist(&mutex_list);
+	/*
+	 * No room for the frame, delete and drop it. getNextFrame() is
+	 * woken by push() if it is waiting.
+	 */
+	if(!policy.admit(frames, max_n_frames) || !frames.push(_frame)) {
 
-	// the buffer is full, delete and drop the incoming frame
-	if((int)frames.size() == max_n_frames) {
+		policy.dropped();
 
 		delete _frame;
 
-	}
-	else {
-
-		// add the frame to the list
-		frames.push_back(_frame);
+		return false;
 
 	}
 
-	// signal that we have a frame, getNextFrame() might be waiting
-	pthread_cond_signal(&cond_list);
+	return true;
 
 }
 
 
-CameraFrame *StreamWorker::getNextFrame() {
+CameraFrame *StreamWorker::takeFrame() {
 
-	// protect the list
-	MutexLocker mllist(&mutex_list);
+	CameraFrame *ret = NULL;
 
-	// if the list is empty, wait for a frame
-	if(frames.size() == 0) {
+	// drop the oldest frames the policy does not keep
+	for(size_t n = policy.trim(frames.size(), max_n_frames); n > 0 && frames.pop(ret); --n) {
 
-		// wait for a new frame, or the end() function to signal
-		pthread_cond_wait(&cond_list, &mutex_list);
+		policy.dropped();
 
-		// check that we are still running...
-		if(!running()) {
+		delete ret;
 
-			// ...nope the end() -function woke us up, return NULL
+	}
 
-			return NULL;
+	if(!frames.pop(ret)) {
+		return NULL;
+	}
+
+	// add() might be waiting for room
+	policy.taken();
+
+	return ret;
+
+}
 
-		}
 
+CameraFrame *StreamWorker::getNextFrame() {
+
+	// return the oldest frame
+	CameraFrame *ret = takeFrame();
+
+	if(ret != NULL) {
+		return ret;
 	}
 
 	/*
-	 * at this point we can be sure that the list contains
-	 * at least one frame. Return the oldest one and erase
-	 * its pointer from the local list
+	 * The queue is empty, wait for a frame or the end() function
+	 * to wake us up. The timeout only guards against end() waking
+	 * us just before we started to wait, run() checks the state.
 	 */
+	frames.wait(WAIT_MS);
 
-	std::list<CameraFrame *>::iterator it = frames.begin();
-	CameraFrame *ret = *it;
-	frames.erase(it);
-
-	return ret;
+	return takeFrame();
 
 }
 
 
 bool StreamWorker::isSpace() {
 
-	// protect the list
-	MutexLocker mllist(&mutex_list);
-
 	return (int)frames.size() < max_n_frames;
 }
 
 
 size_t StreamWorker::getBufferState() {
-	// protect the list
-	MutexLocker mllist(&mutex_list);
 
 	return frames.size();
 }
 
 
+void StreamWorker::getQueueStats(QueuePolicy::Stats &stats) {
+
+	policy.getStats(stats);
+
+}
+
+
 bool StreamWorker::running() {
 
 	MutexLocker mlrunning(&mutex_running);
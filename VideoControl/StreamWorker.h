@@ -2,9 +2,10 @@
 #define STREAMWORKER_H
 
 
-#include <list>
 #include "VideoBuffer.h"
 #include "CameraFrame.h"
+#include "RingQueue.h"
+#include "QueuePolicy.h"
 #include <pthread.h>
 
 
@@ -46,7 +47,7 @@ class StreamWorker {
 		 */
 		void run();
 
-		bool start();
+		virtual bool start();
 
 
 		/*
@@ -55,15 +56,21 @@ class StreamWorker {
 		 * because in case of multiple instances of this class, the user,
 		 * May want to join all threads. 
 		 */
-		void end();
+		virtual void end();
 
 		/*
-		 * Adds the given frame to the list, if there is room for it.
+		 * What add() does when the queue is full, see QueuePolicy. Must
+		 * be called before init(). Drops the newest frames by default.
+		 */
+		void setPolicy(QueuePolicy::Type type, int blockMs = QueuePolicy::DEFAULT_BLOCK_MS);
+
+		/*
+		 * Adds the given frame to the list according to the policy.
 		 * This class becomes the owner of the given frame and therefore
 		 * the caller must not do anything with the frame after calling this
-		 * function.
+		 * function. Returns false if the frame was dropped.
 		 */
-		void add(CameraFrame *_frame);
+		bool add(CameraFrame *_frame);
 
 		/* Query if there is space in this workers queue */
 		bool isSpace();
@@ -71,14 +78,20 @@ class StreamWorker {
 		/* Return the current size of the queue */
 		size_t getBufferState();
 
+		/* The number of frames added and dropped */
+		void getQueueStats(QueuePolicy::Stats &stats);
+
 	private:
 
 		/* returns the current state. The function is mutex protected */
 		bool running();
 
-		/* Get the next frame from the list, the function is mutex protected */
+		/* Get the next frame from the queue, NULL if none arrived or the worker ended */
 		CameraFrame *getNextFrame();
 
+		/* Take the frame the policy gives next, NULL if the queue is empty */
+		CameraFrame *takeFrame();
+
 		/*
 		 * A method to be implemented by the child class. Called in the thread,
 		 * When a frame is ready to be processed
@@ -95,19 +108,18 @@ class StreamWorker {
 
 
 		/************************************************
-		 * list of processable frames
+		 * queue of processable frames
 		 ************************************************/
 
-		// protection and sync for the list
-		pthread_mutex_t mutex_list;
-		pthread_cond_t cond_list;
-
-		// list of processable frames
-		std::list<CameraFrame *> frames;
+		// lock-free, the capturing threads add and this worker takes
+		RingQueue<CameraFrame *> frames;
 
 		/* The maximum number of frames in this worker's queue */
 		int max_n_frames;
 
+		/* What to do when the queue is full */
+		QueuePolicy policy;
+
 
 		/************************************************
 		 * worker's state
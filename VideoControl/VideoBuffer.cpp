@@ -2,7 +2,6 @@
 #include <gst/gst.h>
 #include <gst/video/video.h>
 #include "VideoBuffer.h"
-#include <iostream>
 
 
 
@@ -36,12 +35,14 @@ void MultiImage::release() {
 
 
 
-MultiImageBuffer::MultiImageBuffer(int _max_buff_size, size_t _nimages) {
+MultiImageBuffer::MultiImageBuffer(int _max_buff_size, size_t _nimages, int64_t _max_skew) : stats(_nimages) {
     pthread_mutex_init(&mutex, NULL);
+	pthread_cond_init(&cond, NULL);
 	nimages = _nimages;
 	max_buff_size = _max_buff_size;
+	max_skew = _max_skew;
 
-	b_wait_for_others = false;
+	pending.resize(nimages);
 
 }
 
@@ -61,75 +62,115 @@ MultiImageBuffer::~MultiImageBuffer() {
 
 		images.clear();
 
+		for(size_t i = 0; i < pending.size(); ++i) {
+
+			std::deque<CameraFrame *>::iterator itp = pending[i].begin();
+
+			while(itp != pending[i].end()) {
+				delete *itp;
+				++itp;
+			}
+
+			pending[i].clear();
+
+		}
+
 	pthread_mutex_unlock(&mutex);
 
    	pthread_mutex_destroy(&mutex);
+	pthread_cond_destroy(&cond);
 
 }
 
 
-
-
-/*
- * Add the image to the list. The flowchart below shows how it works for two images.
- *
- *                                __________________
- *                               |    Image in      |
- *                                ------------------
- *
- *           __________________                        ________________________
- *          | waiting for pair |                      | not waiting for a pair |
- *           ------------------                        ------------------------
- *
- *   _________          _____________              _________                  _____________
- *  | is pair |        | is not pair |            | is full |                | is not full |
- *   ---------          -------------              ---------                  -------------
- *
- *   ________             __________        ____________________________     ______________________
- *  | insert |           | replace |       | Release oldest, insert new |   | insert a new element |
- *   --------             ---------         ----------------------------     ----------------------
- *
- */
 void MultiImageBuffer::add(CameraFrame *img, int image_type) {
 
 	// locks the mutex in the constructor and releases in the destructor
 	MutexLocker mutex_locker(&mutex);
 
+	if(image_type < 0 || image_type >= (int)nimages) {
+		delete img;
+		return;
+	}
+
+	if(img->timestamp == 0) {
+		img->timestamp = CameraFrame::getTime();
+	}
+
 
 	/***************************************************
-	 * see if the other images have been arrived
+	 * Queue the image. If the other streams have not
+	 * delivered for a while, drop the oldest.
 	 **************************************************/
-	if(b_wait_for_others) { // waiting for a other images
+	std::deque<CameraFrame *> &queue = pending[image_type];
+
+	queue.push_back(img);
+
+	if((int)queue.size() > max_buff_size) {
+
+		delete queue.front();
+		queue.pop_front();
+
+		++stats.nUnmatched[image_type];
+
+	}
 
-		// points to a valid element, since at least one image is
-		// already waiting for the others
-		std::list<MultiImage>::iterator ite = images.end();
-		--ite;
+	match();
 
-		std::vector<CameraFrame *> &imgs = ite->imgs;
+}
+
+
+void MultiImageBuffer::match() {
+
+	for(;;) {
 
 		/***************************************************
-		 * see if this slot is vacant
+		 * Find the oldest and the newest of the oldest
+		 * images of the streams
 		 **************************************************/
-		bool b_is_vacant = imgs[image_type] == NULL;
+		int oldest = -1;
+		int64_t tsOldest = 0;
+		int64_t tsNewest = 0;
 
-		if(b_is_vacant) { // is vacant
+		for(size_t i = 0; i < nimages; ++i) {
 
-			imgs[image_type] = img;
+			// the stream has no image, wait for it
+			if(pending[i].size() == 0) {
+				return;
+			}
 
-		}
-		else { // is not vacant
+			const int64_t ts = pending[i].front()->timestamp;
+
+			if(oldest < 0 || ts < tsOldest) {
+				oldest = i;
+				tsOldest = ts;
+			}
 
-			delete imgs[image_type];
-			imgs[image_type] = img;
+			if(i == 0 || ts > tsNewest) {
+				tsNewest = ts;
+			}
 
 		}
 
-	}
 
-	else { // not waiting for other images
+		/***************************************************
+		 * No match for the oldest, drop it
+		 **************************************************/
+		if(tsNewest - tsOldest > max_skew) {
+
+			delete pending[oldest].front();
+			pending[oldest].pop_front();
+
+			++stats.nUnmatched[oldest];
 
-		// see if full
+			continue;
+
+		}
+
+
+		/***************************************************
+		 * A complete group. If full, release the oldest.
+		 **************************************************/
 		if((int)images.size() == max_buff_size) {
 
 			// clear resources from the oldest and remove it from the list
@@ -137,39 +178,31 @@ void MultiImageBuffer::add(CameraFrame *img, int image_type) {
 			itf->release();
 
 			images.erase(itf);
-std::cout << "VideoBuffer: the buffer is full, removing the oldest and inserting..." << std::endl;
+
+			// counted instead of printed, the receiver may pause for a while
+			++stats.nDropped;
 
 		}
 
-		// insert new
 		MultiImage ip(nimages);
-		ip.imgs[image_type] = img;
-		images.push_back(ip);
-
-	}
 
+		for(size_t i = 0; i < nimages; ++i) {
+			ip.imgs[i] = pending[i].front();
+			pending[i].pop_front();
+		}
 
-	// points to a valid element, since at least one image is waiting for the others
-	std::list<MultiImage>::iterator ite = images.end();
-	--ite;
+		ip.b_ready = true;
 
-	// see if all images have been placed
-	std::vector<CameraFrame *> &imgs = ite->imgs;
-	std::vector<CameraFrame *>::iterator imgit = imgs.begin();
-	b_wait_for_others = false;
-	while(imgit < imgs.end()) {
+		images.push_back(ip);
 
-		if(*imgit == NULL) {
-			b_wait_for_others = true;
-			break;
-		}
+		++stats.nGroups;
+		stats.skew.add(tsNewest - tsOldest);
 
-		++imgit;
+		// waitFrames() might be waiting
+		pthread_cond_signal(&cond);
 
 	}
 
-	ite->b_ready = !b_wait_for_others;
-
 }
 
 
@@ -190,29 +223,55 @@ bool MultiImageBuffer::getFrames(std::vector<CameraFrame *> &oput) {
 	// get the oldest image group
 	std::list<MultiImage>::iterator itf = images.begin();
 
-	if(itf->b_ready) {
+	std::vector<CameraFrame *> &imgs = itf->imgs;
 
-		std::vector<CameraFrame *> &imgs = itf->imgs;
-		std::vector<CameraFrame *>::iterator itimgs = imgs.begin();
+	for(size_t i = 0; i < imgs.size(); ++i) {
+		oput[i] = imgs[i];
+	}
 
-		while(itimgs != imgs.end()) {
+	// now remove the element from the list
+	images.erase(itf);
 
-			int ind = itimgs - imgs.begin();
-			oput[ind] = imgs[ind];
+	return true;
 
-			++itimgs;
+}
 
-		}
 
-		// now remove the element from the list
-		images.erase(itf);
+bool MultiImageBuffer::waitFrames(std::vector<CameraFrame *> &oput, int millis) {
 
-		return true;
+	{
+		MutexLocker locker(&mutex);
 
-	}
+		if(images.size() == 0) {
+
+			// get the system time
+			struct timespec ts;
+			clock_gettime(CLOCK_REALTIME, &ts);
+
+			// add the requested wait time
+			ts.tv_sec	+= millis / 1000;
+			ts.tv_nsec	+= (millis % 1000) * 1000000;
+
+			// account for overflow
+			if(ts.tv_nsec >= 1000000000) {
+				++ts.tv_sec;
+				ts.tv_nsec -= 1000000000;
+			}
+
+			pthread_cond_timedwait(&cond, &mutex, &ts);
 
+		}
+	}
 
-	return false;
+	return getFrames(oput);
 
 }
 
+
+void MultiImageBuffer::getStats(Stats &_stats) {
+
+	MutexLocker locker(&mutex);
+
+	_stats = stats;
+
+}
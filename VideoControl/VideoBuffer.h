@@ -5,6 +5,7 @@
 #include <opencv2/imgproc/imgproc.hpp>
 #include <vector>
 #include <list>
+#include <deque>
 #include <pthread.h>
 #include <gst/gst.h>
 #include <gst/video/video.h>
@@ -60,42 +61,96 @@ class MultiImage {
 
 
 
+/*
+ * Statistics of delays in microseconds
+ */
+class DelayStats {
+
+	public:
+
+		DelayStats() {
+			n = 0;
+			sum = 0;
+			max = 0;
+		}
+
+		void add(int64_t delay) {
+
+			++n;
+			sum += delay;
+
+			if(delay > max) {
+				max = delay;
+			}
+
+		}
+
+		double getMean() const {return n > 0 ? (double)sum / n : 0.0;}
+
+		unsigned long n;
+		int64_t sum;
+		int64_t max;
+
+};
+
+
 /*
  * This class stores multiple images from multiple streams sent by
- * gstreamer through cb().
+ * gstreamer through cb(). The images of the streams are grouped by
+ * their timestamps, see CameraFrame::timestamp.
  */
 class MultiImageBuffer {
 
 	public:
 
+		/* Counters since the buffer was created */
+		class Stats {
+
+			public:
+
+				Stats(size_t nimages = 0) : nUnmatched(nimages, 0) {
+					nGroups = nDropped = 0;
+				}
+
+				/* Complete groups formed */
+				unsigned long nGroups;
+
+				/* Images dropped without a match, for each stream */
+				std::vector<unsigned long> nUnmatched;
+
+				/* Groups dropped because the buffer was full */
+				unsigned long nDropped;
+
+				/* The difference of the newest and the oldest image of a group */
+				DelayStats skew;
+
+		};
+
+
 		/*
 		 * nimages: Number of images to be put into one element
+		 * max_skew: The largest difference of the timestamps in a group, in microseconds
 		 */
-		MultiImageBuffer(int _max_buff_size, size_t nimages);
+		MultiImageBuffer(int _max_buff_size, size_t nimages, int64_t _max_skew = DEFAULT_MAX_SKEW);
 
 		~MultiImageBuffer();
 
 
 		/*
-		 * Add the image to the list. The flowchart below shows how it works for
-		 * two images.
-		 *
-		 *                                __________________
-		 *                               |    Image in      |
-		 *                                ------------------
-		 *
-		 *           __________________                        ________________________
-		 *          | waiting for pair |                      | not waiting for a pair |
-		 *           ------------------                        ------------------------
+		 * Add the image of the given stream. Takes the ownership of the image.
 		 *
-		 *   _________          _____________              _________                  _____________
-		 *  | is pair |        | is not pair |            | is full |                | is not full |
-		 *   ---------          -------------              ---------                  -------------
-		 *
-		 *   ________             __________        ____________________________     ______________________
-		 *  | insert |           | replace |       | Release oldest, insert new |   | insert a new element |
-		 *   --------             ---------         ----------------------------     ----------------------
+		 * The images of each stream wait in their own queue. When every
+		 * queue has an image, the oldest images are grouped if their
+		 * timestamps are within max_skew. Otherwise the oldest one of
+		 * them can not have a match anymore, because the timestamps of
+		 * a stream grow, and it is dropped. A stall in one stream
+		 * therefore costs only the images of the stall, the pairing
+		 * recovers with the next images.
 		 *
+		 * max_skew should be less than half of the frame interval, so
+		 * that an image is within max_skew of one image of the other
+		 * streams at most. Images without a timestamp are stamped with
+		 * the arrival time.
 		 */
 		void add(CameraFrame *img, int image_type);
 
@@ -108,24 +163,49 @@ class MultiImageBuffer {
 		 */
 		bool getFrames(std::vector<CameraFrame *> &oput);
 
+		/* Same as getFrames(), but waits at most millis for a group */
+		bool waitFrames(std::vector<CameraFrame *> &oput, int millis);
+
 		/* Get the maximum allowed size of the buffer */
 		int getMaxSize() {return max_buff_size;}
 
+		int64_t getMaxSkew() {return max_skew;}
+
+		void getStats(Stats &_stats);
+
+		/* Half of the frame interval at 30 fps */
+		static const int64_t DEFAULT_MAX_SKEW = 16000;
+
 	private:
 
-		/* List of image groups */
+		/*
+		 * Group the oldest images while possible. The mutex must be
+		 * locked before a call to this function.
+		 */
+		void match();
+
+		/* The images waiting for a match, for each stream */
+		std::vector<std::deque<CameraFrame *> > pending;
+
+		/* List of complete image groups */
 		std::list<MultiImage> images;
 
-		/* Protects the images list */
+		/* Protects the lists */
 		pthread_mutex_t mutex;
 
+		/* Signalled when a group is complete */
+		pthread_cond_t cond;
+
 		/* The number of images in a group */
 		size_t nimages;
 
 		/* The maximum size of the buffer */
 		int max_buff_size;
 
-		bool b_wait_for_others;
+		/* The largest difference of the timestamps in a group */
+		int64_t max_skew;
+
+		Stats stats;
 
 };
 
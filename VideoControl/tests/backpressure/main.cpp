@@ -0,0 +1,282 @@
+/*
+ * A load test of the queue policies of the StreamWorker. A simulated
+ * camera feeds a worker whose processing time is below the frame
+ * interval, except during periods of overload, like the tracker when
+ * the machine is busy. For each policy the test gives
+ *
+ *     - the gaps between the capture times of the processed frames,
+ *       the holes in the gaze data
+ *     - the latency from the capture to the start of the processing
+ *
+ * and the same for the earlier behaviour, where the capturing thread
+ * slept a second whenever the queue was full.
+ *
+ * The capture keeps its pace no matter how the worker does. Frames
+ * that the capturing thread can not take in time wait in a small
+ * buffer like the frame pairs of VideoSync, and are lost when it is
+ * full.
+ *
+ * The test runs SPEED_UP times faster than the real camera, the times
+ * are given as if it ran at the real speed.
+ *
+ * Usage: backpressure [nof frames]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+#include <algorithm>
+
+#include "StreamWorker.h"
+
+
+static const int NOF_FRAMES_DEFAULT		= 1200;
+
+/* Camera frame interval and the test speed */
+static const int64_t FRAME_INTERVAL		= 33333;
+static const int SPEED_UP				= 5;
+
+/* The queue size of the workers, like in DualFrameReceiver */
+static const int MAX_BUFFER_SIZE		= 100;
+
+/* The frames waiting for the capturing thread, like in VideoSync */
+static const int MAX_PAIRS				= 4;
+
+/*
+ * The processing takes NORMAL_LOAD frame intervals, and OVERLOAD
+ * intervals for OVERLOAD_FRAMES at every OVERLOAD_PERIOD frames.
+ */
+static const double NORMAL_LOAD			= 0.7;
+static const double OVERLOAD			= 4.0;
+static const int OVERLOAD_PERIOD		= 600;
+static const int OVERLOAD_FRAMES		= 200;
+
+/* The earlier implementation slept this long when a queue was full */
+static const int64_t LEGACY_SLEEP		= 1000000;
+
+/* Gaps longer than this are counted */
+static const int64_t LONG_GAP			= 100000;
+
+
+static void sleepUntil(int64_t t) {
+
+	const int64_t dt = t - CameraFrame::getTime();
+
+	if(dt <= 0) {
+		return;
+	}
+
+	struct timespec ts;
+	ts.tv_sec	= dt / 1000000;
+	ts.tv_nsec	= (dt % 1000000) * 1000;
+
+	nanosleep(&ts, NULL);
+
+}
+
+
+/* Records the capture times of the frames it processes */
+class LoadWorker : public StreamWorker {
+
+	public:
+
+		/* The capture times and the start of the processing, test time */
+		std::vector<int64_t> captured;
+		std::vector<int64_t> started;
+
+	private:
+
+		CameraFrame *process(CameraFrame *img) {
+
+			const int64_t now = CameraFrame::getTime();
+
+			captured.push_back(img->timestamp);
+			started.push_back(now);
+
+			// the frame number is in w
+			const bool bOverload = img->w % OVERLOAD_PERIOD >= OVERLOAD_PERIOD - OVERLOAD_FRAMES;
+			const double load = bOverload ? OVERLOAD : NORMAL_LOAD;
+
+			sleepUntil(now + (int64_t)(load * FRAME_INTERVAL / SPEED_UP));
+
+			// processed, the worker deletes it
+			return NULL;
+
+		}
+
+};
+
+
+class NullHandler : public WorkerCBHandler {
+
+	public:
+
+		bool frameProcessed(CameraFrame *, void *) {return false;}
+
+};
+
+
+class Result {
+
+	public:
+
+		Result() {
+			nCaptured = nLost = 0;
+		}
+
+		/* Frames captured, and lost before the queue */
+		int nCaptured;
+		int nLost;
+
+		QueuePolicy::Stats stats;
+
+		/* In real time */
+		std::vector<int64_t> gaps;
+		std::vector<int64_t> latencies;
+
+};
+
+
+/*
+ * Capture nofFrames at the camera pace and give them to a worker with
+ * the given policy. bLegacy sleeps like the earlier VideoSync did.
+ */
+static Result run(int nofFrames, QueuePolicy::Type type, bool bLegacy) {
+
+	NullHandler handler;
+	LoadWorker worker;
+
+	worker.setPolicy(type);
+	worker.init(&handler, MAX_BUFFER_SIZE, NULL);
+	worker.start();
+
+	Result result;
+
+	const int64_t tStart = CameraFrame::getTime();
+
+	int next = 0;
+
+	while(next < nofFrames) {
+
+		// the frames captured by now
+		const int64_t now = CameraFrame::getTime();
+		int last = std::min((int)((now - tStart) * SPEED_UP / FRAME_INTERVAL), nofFrames - 1);
+
+		if(last < next) {
+			sleepUntil(tStart + (int64_t)next * FRAME_INTERVAL / SPEED_UP);
+			continue;
+		}
+
+		// the oldest are lost if the buffer is full
+		if(last - next + 1 > MAX_PAIRS) {
+			result.nLost += last - next + 1 - MAX_PAIRS;
+			next = last - MAX_PAIRS + 1;
+		}
+
+		for( ; next <= last; ++next) {
+
+			CameraFrame *frame = new CameraFrame(next, 1, 0);
+			frame->timestamp = tStart + (int64_t)next * FRAME_INTERVAL / SPEED_UP;
+
+			worker.add(frame);
+
+		}
+
+		if(bLegacy && worker.getBufferState() >= (size_t)MAX_BUFFER_SIZE) {
+			sleepUntil(CameraFrame::getTime() + LEGACY_SLEEP / SPEED_UP);
+		}
+
+	}
+
+	result.nCaptured = nofFrames;
+
+
+	// let the worker finish the queue
+	while(worker.getBufferState() > 0) {
+		sleepUntil(CameraFrame::getTime() + FRAME_INTERVAL / SPEED_UP);
+	}
+
+	worker.end();
+
+	worker.getQueueStats(result.stats);
+
+	for(size_t i = 0; i < worker.captured.size(); ++i) {
+
+		result.latencies.push_back((worker.started[i] - worker.captured[i]) * SPEED_UP);
+
+		if(i > 0) {
+			result.gaps.push_back((worker.captured[i] - worker.captured[i - 1]) * SPEED_UP);
+		}
+
+	}
+
+	return result;
+
+}
+
+
+static double percentile(std::vector<int64_t> v, int p) {
+
+	if(v.size() == 0) {
+		return 0.0;
+	}
+
+	std::sort(v.begin(), v.end());
+
+	return 1e-3 * v[std::min(v.size() - 1, v.size() * p / 100)];
+
+}
+
+
+static void report(const char *name, const Result &result) {
+
+	int nLongGaps = 0;
+	for(size_t i = 0; i < result.gaps.size(); ++i) {
+		nLongGaps += result.gaps[i] > LONG_GAP;
+	}
+
+	printf("%-12s %9d %6d %7lu %7d %7.0f %7.0f %7.0f %9.0f %7.0f\n",
+		   name,
+		   (int)result.latencies.size(),
+		   result.nLost,
+		   result.stats.nDropped,
+		   nLongGaps,
+		   percentile(result.gaps, 50),
+		   percentile(result.gaps, 99),
+		   percentile(result.gaps, 100),
+		   percentile(result.latencies, 50),
+		   percentile(result.latencies, 99));
+
+}
+
+
+int main(int argc, char **argv) {
+
+	const int nofFrames = argc > 1 ? atoi(argv[1]) : NOF_FRAMES_DEFAULT;
+
+	if(nofFrames <= 0) {
+		printf("Usage: %s [nof frames]\n", argv[0]);
+		return -1;
+	}
+
+	printf("%d frames at 30 fps, overload of %.1f frame intervals for %d of every %d frames\n\n",
+		   nofFrames, OVERLOAD, OVERLOAD_FRAMES, OVERLOAD_PERIOD);
+
+	printf("                         frames             gaps, ms                latency, ms\n");
+	printf("policy       processed   lost dropped   >%dms     p50     p99     max       p50     p99\n", (int)(LONG_GAP / 1000));
+
+	report("sleep 1 s", run(nofFrames, QueuePolicy::POLICY_DROP_NEWEST, true));
+
+	for(int i = 0; i < 4; ++i) {
+
+		const QueuePolicy::Type type = (QueuePolicy::Type)i;
+
+		report(QueuePolicy::getName(type), run(nofFrames, type, false));
+
+	}
+
+	return 0;
+
+}
+
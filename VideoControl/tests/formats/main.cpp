@@ -0,0 +1,484 @@
+/*
+ * Checks FrameFormat with synthetic frames of every format. The frames
+ * show the same image:
+ *
+ *     YUYV, I420  made of the same luma and chroma, the chroma is the
+ *                 same for each 2x2 block so that both can carry it
+ *     BGR, RGB    the YUV image converted with the BT.601 coefficients
+ *     MJPG        the RGB frame compressed like the MJPG cameras do
+ *
+ * For each format
+ *
+ *     - the luma plane is given only for I420, without a copy
+ *     - the luma of the whole frame is the luma of the YUV image, or
+ *       close to it with the RGB and the MJPG frames
+ *     - the luma of the crop area is the same area of the whole frame
+ *     - the conversion to BGR is close to the BGR frame
+ *     - an area outside the frame and a truncated frame are refused
+ *
+ * and the time it takes to get the input of the tracker, the luma of
+ * the crop area, is given.
+ *
+ * Usage: formats [nof frames]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+#include "FrameFormat.h"
+
+
+static const int NOF_FRAMES_DEFAULT	= 200;
+
+static const int WIDTH				= 640;
+static const int HEIGHT				= 480;
+static const int QUALITY			= 90;
+
+/* The crop area of default.xml */
+static const int CROP_AREA_X		= 148;
+static const int CROP_AREA_Y		= 60;
+static const int CROP_AREA_W		= 400;
+static const int CROP_AREA_H		= 320;
+
+/* The allowed differences to the luma and the colours of the image */
+static const int MAX_DIFF_RGB		= 1;
+static const double MAX_MEAN_MJPG	= 2.0;
+static const int MAX_DIFF_BGR		= 2;
+
+
+/* The test image */
+class Image {
+
+	public:
+
+		std::vector<unsigned char> y, u, v;	// luma, and chroma for each 2x2 block
+		std::vector<unsigned char> bgr;
+
+		unsigned char getU(int col, int row) const {return u[(row / 2) * (WIDTH / 2) + col / 2];}
+		unsigned char getV(int col, int row) const {return v[(row / 2) * (WIDTH / 2) + col / 2];}
+
+};
+
+
+static unsigned char toByte(double val) {
+
+	return (unsigned char)std::max(0.0, std::min(255.0, floor(val + 0.5)));
+
+}
+
+
+/*
+ * An eye-like image, a dark pupil and glints on a gradient, with noise
+ * and the chroma varying slowly
+ */
+static void makeImage(Image &img) {
+
+	img.y.resize(WIDTH * HEIGHT);
+	img.u.resize(WIDTH * HEIGHT / 4);
+	img.v.resize(WIDTH * HEIGHT / 4);
+	img.bgr.resize(3 * WIDTH * HEIGHT);
+
+	srand(1);
+
+	for(int row = 0; row < HEIGHT; ++row) {
+
+		for(int col = 0; col < WIDTH; ++col) {
+
+			const double dx = col - WIDTH / 2 + 60;
+			const double dy = row - HEIGHT / 2;
+			const double r = sqrt(dx*dx + dy*dy);
+
+			double val = 200.0 - 0.25 * r;
+
+			if(r < 35.0) {
+				val = 25.0;
+			}
+			else if(r < 90.0) {
+				val = 100.0 + 15.0 * sin(atan2(dy, dx) * 10.0);
+			}
+
+			if((dx - 20.0) * (dx - 20.0) + (dy + 25.0) * (dy + 25.0) < 9.0) {
+				val = 235.0;
+			}
+
+			val += (rand() % 7) - 3;
+
+			img.y[row * WIDTH + col] = toByte(std::max(16.0, std::min(235.0, val)));
+
+		}
+
+	}
+
+	for(int row = 0; row < HEIGHT / 2; ++row) {
+		for(int col = 0; col < WIDTH / 2; ++col) {
+			img.u[row * (WIDTH / 2) + col] = toByte(128.0 + 40.0 * sin(col * 0.02));
+			img.v[row * (WIDTH / 2) + col] = toByte(128.0 + 40.0 * cos(row * 0.03));
+		}
+	}
+
+	// BT.601, video range
+	for(int row = 0; row < HEIGHT; ++row) {
+
+		for(int col = 0; col < WIDTH; ++col) {
+
+			const double c = 1.164 * (img.y[row * WIDTH + col] - 16);
+			const double d = img.getU(col, row) - 128;
+			const double e = img.getV(col, row) - 128;
+
+			unsigned char *p = &img.bgr[3 * (row * WIDTH + col)];
+			p[0] = toByte(c + 2.018 * d);
+			p[1] = toByte(c - 0.391 * d - 0.813 * e);
+			p[2] = toByte(c + 1.596 * e);
+
+		}
+
+	}
+
+}
+
+
+static void makeYUYV(const Image &img, std::vector<unsigned char> &data) {
+
+	data.resize(2 * WIDTH * HEIGHT);
+
+	for(int row = 0; row < HEIGHT; ++row) {
+
+		for(int col = 0; col < WIDTH; col += 2) {
+
+			unsigned char *p = &data[2 * (row * WIDTH + col)];
+			p[0] = img.y[row * WIDTH + col];
+			p[1] = img.getU(col, row);
+			p[2] = img.y[row * WIDTH + col + 1];
+			p[3] = img.getV(col, row);
+
+		}
+
+	}
+
+}
+
+
+static void makeI420(const Image &img, std::vector<unsigned char> &data) {
+
+	data = img.y;
+	data.insert(data.end(), img.u.begin(), img.u.end());
+	data.insert(data.end(), img.v.begin(), img.v.end());
+
+}
+
+
+static void makeRGB(const Image &img, std::vector<unsigned char> &data) {
+
+	data.resize(3 * WIDTH * HEIGHT);
+
+	for(int i = 0; i < WIDTH * HEIGHT; ++i) {
+		data[3 * i + 0] = img.bgr[3 * i + 2];
+		data[3 * i + 1] = img.bgr[3 * i + 1];
+		data[3 * i + 2] = img.bgr[3 * i + 0];
+	}
+
+}
+
+
+/* Compress with 4:2:2 sampling like the MJPG cameras */
+static void makeMJPG(const std::vector<unsigned char> &rgb, std::vector<unsigned char> &jpg) {
+
+	struct jpeg_compress_struct cinfo;
+	struct jpeg_error_mgr jerr;
+
+	cinfo.err = jpeg_std_error(&jerr);
+	jpeg_create_compress(&cinfo);
+
+	unsigned char *data = NULL;
+	unsigned long sz = 0;
+	jpeg_mem_dest(&cinfo, &data, &sz);
+
+	cinfo.image_width		= WIDTH;
+	cinfo.image_height		= HEIGHT;
+	cinfo.input_components	= 3;
+	cinfo.in_color_space	= JCS_RGB;
+
+	jpeg_set_defaults(&cinfo);
+	jpeg_set_quality(&cinfo, QUALITY, TRUE);
+
+	cinfo.comp_info[0].h_samp_factor = 2;
+	cinfo.comp_info[0].v_samp_factor = 1;
+
+	jpeg_start_compress(&cinfo, TRUE);
+
+	while(cinfo.next_scanline < cinfo.image_height) {
+		JSAMPROW row_ptr = (JSAMPROW)&rgb[3 * WIDTH * cinfo.next_scanline];
+		jpeg_write_scanlines(&cinfo, &row_ptr, 1);
+	}
+
+	jpeg_finish_compress(&cinfo);
+	jpeg_destroy_compress(&cinfo);
+
+	jpg.assign(data, data + sz);
+
+	free(data);
+
+}
+
+
+/* The luma of the image as the given format carries it */
+static void getExpectedLuma(const Image &img, Format format, std::vector<unsigned char> &luma) {
+
+	if(format == FORMAT_YUV || format == FORMAT_I420) {
+		luma = img.y;
+		return;
+	}
+
+	// full range, like cv::cvtColor() and the JPEG
+	luma.resize(WIDTH * HEIGHT);
+
+	for(int i = 0; i < WIDTH * HEIGHT; ++i) {
+		const unsigned char *p = &img.bgr[3 * i];
+		luma[i] = toByte(0.114 * p[0] + 0.587 * p[1] + 0.299 * p[2]);
+	}
+
+}
+
+
+class Case {
+
+	public:
+
+		Case(const char *_name, Format _format, const std::vector<unsigned char> &_data) {
+			name	= _name;
+			format	= _format;
+			data	= _data;
+		}
+
+		const char *name;
+		Format format;
+		std::vector<unsigned char> data;
+
+};
+
+
+/* Returns a description of the first failure, or NULL */
+static const char *check(const Case &c, const Image &img, JPEG_Decompressor &jpgd, double &meanDiff) {
+
+	CameraFrame frame(WIDTH, HEIGHT, CameraFrame::getBytesPerPixel(c.format),
+					  (unsigned char *)&c.data[0], c.data.size(), c.format, false, false);
+
+	/*
+	 * Only the luma plane of I420 is given, and without a copy
+	 */
+	int step = 0;
+	const unsigned char *plane = FrameFormat::getLumaPlane(frame, step);
+
+	if(c.format == FORMAT_I420) {
+		if(plane != frame.data || step != WIDTH) {
+			return "the luma plane is not the frame data";
+		}
+	}
+	else if(plane != NULL) {
+		return "a luma plane is given";
+	}
+
+
+	/*
+	 * The whole frame
+	 */
+	std::vector<unsigned char> luma(WIDTH * HEIGHT);
+	if(!FrameFormat::getLuma(frame, 0, 0, WIDTH, HEIGHT, &luma[0], WIDTH, jpgd)) {
+		return "could not get the luma";
+	}
+
+	std::vector<unsigned char> expected;
+	getExpectedLuma(img, c.format, expected);
+
+	int maxDiff = 0;
+	double sumDiff = 0.0;
+
+	for(int i = 0; i < WIDTH * HEIGHT; ++i) {
+		const int diff = abs((int)luma[i] - (int)expected[i]);
+		maxDiff = std::max(maxDiff, diff);
+		sumDiff += diff;
+	}
+
+	meanDiff = sumDiff / (WIDTH * HEIGHT);
+
+	switch(c.format) {
+
+		case FORMAT_YUV:
+		case FORMAT_I420:
+			if(maxDiff != 0) {
+				return "the luma differs";
+			}
+			break;
+
+		case FORMAT_RGB:
+		case FORMAT_BGR:
+			if(maxDiff > MAX_DIFF_RGB) {
+				return "the luma differs";
+			}
+			break;
+
+		default:
+			if(meanDiff > MAX_MEAN_MJPG) {
+				return "the luma differs";
+			}
+			break;
+
+	}
+
+
+	/*
+	 * The crop area, to a buffer with wider rows
+	 */
+	const int stride = CROP_AREA_W + 16;
+	std::vector<unsigned char> crop(stride * CROP_AREA_H, 0);
+
+	if(!FrameFormat::getLuma(frame, CROP_AREA_X, CROP_AREA_Y, CROP_AREA_W, CROP_AREA_H, &crop[0], stride, jpgd)) {
+		return "could not get the luma of the crop area";
+	}
+
+	for(int row = 0; row < CROP_AREA_H; ++row) {
+		if(memcmp(&crop[row * stride], &luma[(CROP_AREA_Y + row) * WIDTH + CROP_AREA_X], CROP_AREA_W) != 0) {
+			return "the crop area differs from the whole frame";
+		}
+	}
+
+
+	/*
+	 * Colours, not for MJPG
+	 */
+	std::vector<unsigned char> bgr(3 * WIDTH * HEIGHT);
+	const bool bConverted = FrameFormat::toBGR(frame, &bgr[0]);
+
+	if(c.format == FORMAT_MJPG) {
+		if(bConverted) {
+			return "an MJPG frame was converted to BGR";
+		}
+	}
+	else {
+
+		if(!bConverted) {
+			return "could not convert to BGR";
+		}
+
+		const int maxBGR = c.format == FORMAT_YUV || c.format == FORMAT_I420 ? MAX_DIFF_BGR : 0;
+
+		for(size_t i = 0; i < bgr.size(); ++i) {
+			if(abs((int)bgr[i] - (int)img.bgr[i]) > maxBGR) {
+				return "the BGR frame differs";
+			}
+		}
+
+	}
+
+
+	/*
+	 * Invalid areas and frames
+	 */
+	if(FrameFormat::getLuma(frame, WIDTH - 8, 0, 16, 16, &crop[0], stride, jpgd)) {
+		return "an area outside the frame was accepted";
+	}
+
+	if(c.format != FORMAT_MJPG) {
+
+		CameraFrame truncated(WIDTH, HEIGHT, frame.bpp, frame.data, frame.sz / 2, c.format, false, false);
+
+		if(FrameFormat::getLuma(truncated, 0, 0, WIDTH, HEIGHT, &luma[0], WIDTH, jpgd) ||
+		   FrameFormat::getLumaPlane(truncated, step) != NULL ||
+		   FrameFormat::toBGR(truncated, &bgr[0])) {
+			return "a truncated frame was accepted";
+		}
+
+	}
+
+	return NULL;
+
+}
+
+
+/* The time to get the luma of the crop area, in microseconds per frame */
+static double timeCropArea(const Case &c, JPEG_Decompressor &jpgd, int nofFrames) {
+
+	CameraFrame frame(WIDTH, HEIGHT, CameraFrame::getBytesPerPixel(c.format),
+					  (unsigned char *)&c.data[0], c.data.size(), c.format, false, false);
+
+	std::vector<unsigned char> crop(CROP_AREA_W * CROP_AREA_H);
+
+	const int64_t t1 = CameraFrame::getTime();
+
+	for(int i = 0; i < nofFrames; ++i) {
+
+		int step;
+		if(FrameFormat::getLumaPlane(frame, step) != NULL) {
+			continue;
+		}
+
+		FrameFormat::getLuma(frame, CROP_AREA_X, CROP_AREA_Y, CROP_AREA_W, CROP_AREA_H, &crop[0], CROP_AREA_W, jpgd);
+
+	}
+
+	return (double)(CameraFrame::getTime() - t1) / nofFrames;
+
+}
+
+
+int main(int argc, char **argv) {
+
+	const int nofFrames = argc > 1 ? atoi(argv[1]) : NOF_FRAMES_DEFAULT;
+
+	if(nofFrames <= 0) {
+		printf("Usage: %s [nof frames]\n", argv[0]);
+		return -1;
+	}
+
+	Image img;
+	makeImage(img);
+
+	std::vector<unsigned char> data;
+	std::vector<Case> cases;
+
+	makeYUYV(img, data);
+	cases.push_back(Case("YUYV", FORMAT_YUV, data));
+
+	makeI420(img, data);
+	cases.push_back(Case("I420", FORMAT_I420, data));
+
+	cases.push_back(Case("BGR", FORMAT_BGR, img.bgr));
+
+	makeRGB(img, data);
+	cases.push_back(Case("RGB", FORMAT_RGB, data));
+
+	std::vector<unsigned char> jpg;
+	makeMJPG(data, jpg);
+	cases.push_back(Case("MJPG", FORMAT_MJPG, jpg));
+
+	printf("%dx%d frames, crop area (%d, %d, %d, %d), %d frames\n\n",
+		   WIDTH, HEIGHT, CROP_AREA_X, CROP_AREA_Y, CROP_AREA_W, CROP_AREA_H, nofFrames);
+
+	printf("format   luma diff   crop area, us\n");
+
+	JPEG_Decompressor jpgd;
+	bool ok = true;
+
+	for(size_t i = 0; i < cases.size(); ++i) {
+
+		double meanDiff = 0.0;
+		const char *failure = check(cases[i], img, jpgd, meanDiff);
+
+		printf("%-8s %9.2f %15.1f\n", cases[i].name, meanDiff, timeCropArea(cases[i], jpgd, nofFrames));
+
+		if(failure != NULL) {
+			printf("    FAILED, %s\n", failure);
+			ok = false;
+		}
+
+	}
+
+	printf("\n%s\n", ok ? "OK" : "FAILED");
+
+	return ok ? 0 : -1;
+
+}
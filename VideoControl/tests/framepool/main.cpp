@@ -0,0 +1,303 @@
+/*
+ * Counts the copies and the allocations of the frame data on the way
+ * from the cameras to the video writer, the tracker and the GUI of
+ * gazetoworld, with the copying frames of the earlier implementation
+ * and with the shared, pooled buffers.
+ *
+ * No cameras are needed. The capture is simulated with buffers that
+ * are shared like the GstBuffers, and each stage keeps a few frames in
+ * its queue like the threads do.
+ *
+ * Usage: framepool [nof frame pairs] [frame bytes] [fps]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <deque>
+
+#include "CameraFrame.h"
+#include "SharedBuffer.h"
+
+
+static const int NOF_PAIRS_DEFAULT	= 2000;
+static const int FRAME_W			= 640;
+static const int FRAME_H			= 480;
+static const int FRAME_BPP			= 3;
+static const int FPS_DEFAULT		= 30;
+
+/* The number of frames in each of the queues */
+static const size_t QUEUE_SIZE		= 4;
+
+
+/* Counters of the copying implementation */
+static unsigned long nCopyAllocations	= 0;
+static unsigned long nCopyBytes			= 0;
+
+/* Counts the wrappers of the captured buffers */
+static unsigned long nWrapperAllocations = 0;
+
+
+/*
+ * Stands for the GstSharedBuffer of the capture
+ */
+class CapturedBuffer : public SharedBuffer {
+
+	public:
+
+		CapturedBuffer(unsigned char *_data, size_t _sz) : SharedBuffer(_data, _sz) {
+			++nWrapperAllocations;
+		}
+
+	protected:
+
+		void dispose() {
+			delete this;
+		}
+
+};
+
+
+static double getMillis(const struct timeval &t1, const struct timeval &t2) {
+	return 1e3 * (t2.tv_sec - t1.tv_sec) + 1e-3 * (t2.tv_usec - t1.tv_usec);
+}
+
+
+/*
+ * A stage keeping the last frames, deletes the oldest when full
+ */
+class Queue {
+
+	public:
+
+		~Queue() {
+			while(frames.size()) {
+				pop();
+			}
+		}
+
+		void push(CameraFrame *f) {
+
+			frames.push_back(f);
+
+			if(frames.size() > QUEUE_SIZE) {
+				pop();
+			}
+
+		}
+
+	private:
+
+		void pop() {
+			delete frames.front();
+			frames.pop_front();
+		}
+
+		std::deque<CameraFrame *> frames;
+
+};
+
+
+/*
+ * A copy as CameraFrame(..., true, true) did it
+ */
+static CameraFrame *copyFrame(const CameraFrame *f) {
+
+	unsigned char *data = new unsigned char[f->sz];
+	memcpy(data, f->data, f->sz);
+
+	++nCopyAllocations;
+	nCopyBytes += f->sz;
+
+	return new CameraFrame(f->w, f->h, f->bpp, data, f->sz, f->format, false, true);
+
+}
+
+
+/*
+ * The earlier path of a frame pair:
+ *   - SimpleCapture copies both frames
+ *   - DualFrameReceiver copies the eye frame, and the scene frame for the GUI
+ *   - VideoWriter copies both frames to its queue
+ *   - GTWorker copies the eye frame once more, the GUI draws on it
+ */
+static void runCopying(const CameraFrame &eye, const CameraFrame &scene, bool bGUI,
+					   Queue &writer, Queue &tracker, Queue &gui) {
+
+	CameraFrame *capEye		= copyFrame(&eye);
+	CameraFrame *capScene	= copyFrame(&scene);
+
+	CameraFrame *workerEye = copyFrame(capEye);
+
+	writer.push(copyFrame(capEye));
+	writer.push(copyFrame(capScene));
+
+	CameraFrame *trackedEye = copyFrame(workerEye);
+	delete workerEye;
+
+	if(bGUI) {
+
+		gui.push(trackedEye);
+		gui.push(copyFrame(capScene));
+
+		// draws in place
+		trackedEye->data[0] ^= 1;
+
+	}
+	else {
+		tracker.push(trackedEye);
+	}
+
+	delete capEye;
+	delete capScene;
+
+}
+
+
+/*
+ * The same path with shared buffers. The GUI makes its frames
+ * writable before drawing.
+ */
+static void runShared(const CameraFrame &eye, const CameraFrame &scene, bool bGUI,
+					  Queue &writer, Queue &tracker, Queue &gui) {
+
+	CameraFrame *capEye		= new CameraFrame(eye);
+	CameraFrame *capScene	= new CameraFrame(scene);
+
+	CameraFrame *workerEye = new CameraFrame(*capEye);
+
+	writer.push(new CameraFrame(*capEye));
+	writer.push(new CameraFrame(*capScene));
+
+	CameraFrame *trackedEye = new CameraFrame(*workerEye);
+	delete workerEye;
+
+	if(bGUI) {
+
+		CameraFrame *guiScene = new CameraFrame(*capScene);
+
+		trackedEye->makeWritable();
+		guiScene->makeWritable();
+		trackedEye->data[0] ^= 1;
+
+		gui.push(trackedEye);
+		gui.push(guiScene);
+
+	}
+	else {
+		tracker.push(trackedEye);
+	}
+
+	delete capEye;
+	delete capScene;
+
+}
+
+
+static void report(const char *name, int nPairs, int fps, double dMillis,
+				   unsigned long nAllocations, unsigned long nBytes) {
+
+	printf("%-24s %9.0f bytes/pair copied  %7.1f allocations/s  %7.3f ms/pair\n",
+		   name,
+		   nBytes / (double)nPairs,
+		   fps * nAllocations / (double)nPairs,
+		   dMillis / nPairs);
+
+}
+
+
+int main(int argc, char **argv) {
+
+	int nPairs = argc > 1 ? atoi(argv[1]) : NOF_PAIRS_DEFAULT;
+	nPairs = nPairs > 0 ? nPairs : 1;
+
+	int sz = argc > 2 ? atoi(argv[2]) : FRAME_W * FRAME_H * FRAME_BPP;
+	sz = sz > 0 ? sz : 1;
+
+	int fps = argc > 3 ? atoi(argv[3]) : FPS_DEFAULT;
+
+	std::vector<unsigned char> src(sz, 128);
+
+	printf("%d frame pairs of %d bytes at %d fps\n", nPairs, sz, fps);
+
+	for(int gui = 0; gui < 2; ++gui) {
+
+		const bool bGUI = gui == 1;
+
+		printf("\nGUI %s\n", bGUI ? "active" : "not active");
+
+
+		/************************************************************
+		 * Copying frames
+		 ************************************************************/
+		{
+			Queue writer, tracker, guiQueue;
+
+			nCopyAllocations = nCopyBytes = 0;
+
+			struct timeval t1, t2;
+			gettimeofday(&t1, NULL);
+
+			for(int i = 0; i < nPairs; ++i) {
+
+				// the capture gives headers of its own buffers
+				CameraFrame eye(FRAME_W, FRAME_H, FRAME_BPP, &src[0], sz, FORMAT_RGB, false, false);
+				CameraFrame scene(FRAME_W, FRAME_H, FRAME_BPP, &src[0], sz, FORMAT_RGB, false, false);
+
+				runCopying(eye, scene, bGUI, writer, tracker, guiQueue);
+
+			}
+
+			gettimeofday(&t2, NULL);
+
+			report("copied frames", nPairs, fps, getMillis(t1, t2), nCopyAllocations, nCopyBytes);
+		}
+
+
+		/************************************************************
+		 * Shared frames
+		 ************************************************************/
+		{
+			BufferPool::Stats before, after;
+			BufferPool::getDefault().getStats(before);
+			nWrapperAllocations = 0;
+
+			Queue writer, tracker, guiQueue;
+
+			struct timeval t1, t2;
+			gettimeofday(&t1, NULL);
+
+			for(int i = 0; i < nPairs; ++i) {
+
+				// the capture gives frames sharing its buffers
+				SharedBuffer *bufferEye		= new CapturedBuffer(&src[0], sz);
+				SharedBuffer *bufferScene	= new CapturedBuffer(&src[0], sz);
+
+				CameraFrame eye(FRAME_W, FRAME_H, FRAME_BPP, bufferEye, FORMAT_RGB);
+				CameraFrame scene(FRAME_W, FRAME_H, FRAME_BPP, bufferScene, FORMAT_RGB);
+
+				bufferEye->unref();
+				bufferScene->unref();
+
+				runShared(eye, scene, bGUI, writer, tracker, guiQueue);
+
+			}
+
+			gettimeofday(&t2, NULL);
+
+			BufferPool::getDefault().getStats(after);
+
+			report("shared frames", nPairs, fps, getMillis(t1, t2),
+				   nWrapperAllocations + after.nAllocations - before.nAllocations,
+				   after.nBytesCopied - before.nBytesCopied);
+		}
+
+	}
+
+	printf("\nThe capture's own buffers are not counted for the copied frames, they are\n"
+		   "counted for the shared frames because the wrappers are allocated.\n");
+
+	return EXIT_SUCCESS;
+
+}
@@ -0,0 +1,464 @@
+/*
+ * Checks the pairing of the eye and the scene frames of MultiImageBuffer
+ * by their capture timestamps. No cameras are needed, the streams are
+ * simulated:
+ *
+ *     - 30 fps, the scene camera 4 ms behind the eye camera, and both
+ *       with a jitter of 2 ms
+ *     - a random delay from the capture to the buffer, and a stall of
+ *       the scene camera after which its frames arrive at once
+ *     - a hiccup of the scene camera and single frames lost by the eye
+ *       camera
+ *
+ * The frames carry their running number in w. Every pair must have
+ * the same number, and every frame without a partner must be counted
+ * as unmatched. For comparison, the number of wrong pairs is given for
+ * the pairing in the arrival order, which the buffer used before.
+ *
+ * Then the same is done with a thread for each camera, the way the
+ * gstreamer threads add the frames.
+ *
+ * Usage: pairing [nof frames]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include <vector>
+#include <deque>
+#include <algorithm>
+
+#include "VideoBuffer.h"
+
+
+static const int NOF_FRAMES_DEFAULT		= 3000;
+
+/* Simulated streams, in microseconds */
+static const int64_t FRAME_INTERVAL		= 33333;
+static const int64_t SCENE_OFFSET		= 4000;
+static const int64_t JITTER				= 2000;
+static const int64_t MAX_LATENCY		= 15000;
+
+/*
+ * The scene camera stalls for STALL_FRAMES at every STALL_PERIOD. The
+ * eye frames of the stall wait in the buffer, so it must be shorter
+ * than MAX_PAIRS frames.
+ */
+static const int STALL_PERIOD			= 500;
+static const int STALL_FRAMES			= 3;
+
+/* The scene camera loses HICCUP_FRAMES at every HICCUP_PERIOD */
+static const int HICCUP_PERIOD			= 700;
+static const int HICCUP_FRAMES			= 10;
+
+/* The eye camera loses a frame at every EYE_LOSS_PERIOD */
+static const int EYE_LOSS_PERIOD		= 97;
+
+/* The size of the buffer, like in VideoSync */
+static const int MAX_PAIRS				= 4;
+
+/* How long the consumer thread waits at a time */
+static const int WAIT_MS				= 100;
+
+/* The threads run this many times faster than the cameras */
+static const int SPEED_UP				= 50;
+
+
+/* A captured frame */
+class Capture {
+
+	public:
+
+		Capture(int _cam, int _number, int64_t _timestamp, int64_t _arrival) {
+			cam			= _cam;
+			number		= _number;
+			timestamp	= _timestamp;
+			arrival		= _arrival;
+		}
+
+		bool operator<(const Capture &other) const {
+			return arrival < other.arrival;
+		}
+
+		int cam;
+		int number;
+		int64_t timestamp;
+		int64_t arrival;
+
+};
+
+
+static int64_t randomDelay(int64_t max) {
+	return (int64_t)(rand() / (RAND_MAX + 1.0) * max);
+}
+
+
+static bool isLost(int cam, int i) {
+
+	if(cam == 0) {
+		return i % EYE_LOSS_PERIOD == EYE_LOSS_PERIOD - 1;
+	}
+
+	return i % HICCUP_PERIOD >= HICCUP_PERIOD - HICCUP_FRAMES;
+
+}
+
+
+/*
+ * Simulate the frames of the two cameras, in the order they arrive.
+ * Gives the number of frames of each camera without a partner.
+ */
+static std::vector<Capture> simulate(int nofFrames, unsigned long nUnmatched[2]) {
+
+	std::vector<Capture> captures;
+
+	nUnmatched[0] = nUnmatched[1] = 0;
+
+	for(int cam = 0; cam < 2; ++cam) {
+
+		int64_t prevArrival = 0;
+
+		for(int i = 0; i < nofFrames; ++i) {
+
+			if(isLost(cam, i)) {
+				continue;
+			}
+
+			if(isLost(1 - cam, i)) {
+				++nUnmatched[cam];
+			}
+
+			// 1 so that no timestamp is 0
+			const int64_t ts = 1 + (i + 1) * FRAME_INTERVAL + cam * SCENE_OFFSET + randomDelay(2 * JITTER) - JITTER;
+
+			int64_t arrival = ts + randomDelay(MAX_LATENCY);
+
+			// the stalled frames arrive with the first one after the stall
+			if(cam == 1 && i % STALL_PERIOD < STALL_FRAMES) {
+				arrival = ts + (STALL_FRAMES - i % STALL_PERIOD) * FRAME_INTERVAL;
+			}
+
+			// a camera delivers in order
+			arrival = std::max(arrival, prevArrival);
+			prevArrival = arrival;
+
+			captures.push_back(Capture(cam, i, ts, arrival));
+
+		}
+
+	}
+
+	std::stable_sort(captures.begin(), captures.end());
+
+	return captures;
+
+}
+
+
+/* The number of wrong pairs when the frames are paired in the arrival order */
+static int pairInArrivalOrder(const std::vector<Capture> &captures) {
+
+	std::deque<int> queues[2];
+
+	int nWrong = 0;
+
+	for(size_t i = 0; i < captures.size(); ++i) {
+
+		queues[captures[i].cam].push_back(captures[i].number);
+
+		if(queues[0].size() > 0 && queues[1].size() > 0) {
+
+			nWrong += queues[0].front() != queues[1].front();
+
+			queues[0].pop_front();
+			queues[1].pop_front();
+
+		}
+
+	}
+
+	return nWrong;
+
+}
+
+
+static CameraFrame *createFrame(const Capture &capture) {
+
+	CameraFrame *frame = new CameraFrame(capture.number, 1, 0);
+	frame->timestamp = capture.timestamp;
+
+	return frame;
+
+}
+
+
+/* Take the pairs and check them. Returns the number of wrong pairs. */
+static int takePairs(MultiImageBuffer &buffer, unsigned long &nPairs) {
+
+	std::vector<CameraFrame *> frames(2);
+
+	int nWrong = 0;
+
+	while(buffer.getFrames(frames)) {
+
+		nWrong += frames[0]->w != frames[1]->w;
+
+		++nPairs;
+
+		delete frames[0];
+		delete frames[1];
+
+	}
+
+	return nWrong;
+
+}
+
+
+static void printStats(const MultiImageBuffer::Stats &stats) {
+
+	printf("    pairs %lu, unmatched %lu + %lu, dropped %lu, skew mean %.0f µs, max %ld µs\n",
+		   stats.nGroups,
+		   stats.nUnmatched[0],
+		   stats.nUnmatched[1],
+		   stats.nDropped,
+		   stats.skew.getMean(),
+		   (long)stats.skew.max);
+
+}
+
+
+/*
+ * Add the frames in the arrival order, one thread. The pairs and the
+ * counters must be exactly as expected.
+ */
+static bool testOrdered(const std::vector<Capture> &captures, const unsigned long nUnmatched[2]) {
+
+	MultiImageBuffer buffer(MAX_PAIRS, 2);
+
+	unsigned long nPairs = 0;
+	int nWrong = 0;
+
+	for(size_t i = 0; i < captures.size(); ++i) {
+
+		buffer.add(createFrame(captures[i]), captures[i].cam);
+
+		nWrong += takePairs(buffer, nPairs);
+
+	}
+
+	MultiImageBuffer::Stats stats;
+	buffer.getStats(stats);
+
+	printStats(stats);
+
+	const unsigned long nExpected = (captures.size() - nUnmatched[0] - nUnmatched[1]) / 2;
+
+	bool ok = true;
+
+	if(nWrong > 0) {
+		printf("    FAILED, %d wrong pairs\n", nWrong);
+		ok = false;
+	}
+
+	if(nPairs != nExpected || stats.nGroups != nExpected || stats.nDropped != 0) {
+		printf("    FAILED, %lu pairs, expected %lu\n", nPairs, nExpected);
+		ok = false;
+	}
+
+	if(stats.nUnmatched[0] != nUnmatched[0] || stats.nUnmatched[1] != nUnmatched[1]) {
+		printf("    FAILED, expected %lu + %lu unmatched\n", nUnmatched[0], nUnmatched[1]);
+		ok = false;
+	}
+
+	if(stats.skew.max > buffer.getMaxSkew()) {
+		printf("    FAILED, skew over %ld µs\n", (long)buffer.getMaxSkew());
+		ok = false;
+	}
+
+	return ok;
+
+}
+
+
+class Producer {
+
+	public:
+
+		MultiImageBuffer *buffer;
+		const std::vector<Capture> *captures;
+		int cam;
+
+		/* The start of the simulation, CLOCK_MONOTONIC */
+		struct timespec start;
+
+		/* Set when all frames are added */
+		int bDone;
+
+};
+
+
+static void *produce(void *arg) {
+
+	Producer *producer = (Producer *)arg;
+
+	const std::vector<Capture> &captures = *producer->captures;
+
+	for(size_t i = 0; i < captures.size(); ++i) {
+
+		if(captures[i].cam != producer->cam) {
+			continue;
+		}
+
+		// wait for the arrival of the frame
+		const int64_t ns = 1000 * captures[i].arrival / SPEED_UP;
+
+		struct timespec ts = producer->start;
+		ts.tv_sec	+= ns / 1000000000L + (ts.tv_nsec + ns % 1000000000L) / 1000000000L;
+		ts.tv_nsec	= (ts.tv_nsec + ns % 1000000000L) % 1000000000L;
+
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+
+		producer->buffer->add(createFrame(captures[i]), producer->cam);
+
+	}
+
+	__atomic_store_n(&producer->bDone, 1, __ATOMIC_RELEASE);
+
+	return NULL;
+
+}
+
+
+/*
+ * Add the frames from a thread for each camera, at the arrival times.
+ * The threads are not exactly in step, so a frame may lose its partner
+ * when the queue of the other camera is full. Every pair must still be right, and every frame must
+ * be paired, counted or, at the end, left in the buffer.
+ */
+static bool testThreaded(const std::vector<Capture> &captures) {
+
+	MultiImageBuffer buffer(MAX_PAIRS, 2);
+
+	Producer producers[2];
+	pthread_t threads[2];
+
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for(int i = 0; i < 2; ++i) {
+
+		producers[i].buffer		= &buffer;
+		producers[i].captures	= &captures;
+		producers[i].cam		= i;
+		producers[i].start		= start;
+		producers[i].bDone		= 0;
+
+		pthread_create(&threads[i], NULL, &produce, &producers[i]);
+
+	}
+
+	unsigned long nSent[2] = {0, 0};
+	for(size_t i = 0; i < captures.size(); ++i) {
+		++nSent[captures[i].cam];
+	}
+
+	std::vector<CameraFrame *> frames(2);
+
+	unsigned long nPairs = 0;
+	int nWrong = 0;
+
+	for(;;) {
+
+		const bool bDone =	__atomic_load_n(&producers[0].bDone, __ATOMIC_ACQUIRE) &&
+							__atomic_load_n(&producers[1].bDone, __ATOMIC_ACQUIRE);
+
+		if(buffer.waitFrames(frames, WAIT_MS)) {
+
+			nWrong += frames[0]->w != frames[1]->w;
+
+			++nPairs;
+
+			delete frames[0];
+			delete frames[1];
+
+			continue;
+
+		}
+
+		// all frames added before the wait, and all pairs taken
+		if(bDone) {
+			break;
+		}
+
+	}
+
+	for(int i = 0; i < 2; ++i) {
+		pthread_join(threads[i], NULL);
+	}
+
+	MultiImageBuffer::Stats stats;
+	buffer.getStats(stats);
+
+	printStats(stats);
+
+	bool ok = true;
+
+	if(nWrong > 0) {
+		printf("    FAILED, %d wrong pairs\n", nWrong);
+		ok = false;
+	}
+
+	if(nPairs + stats.nDropped != stats.nGroups) {
+		printf("    FAILED, %lu pairs taken, %lu formed\n", nPairs, stats.nGroups);
+		ok = false;
+	}
+
+	for(int i = 0; i < 2; ++i) {
+
+		const unsigned long nAccounted = stats.nGroups + stats.nUnmatched[i];
+
+		if(nAccounted > nSent[i] || nSent[i] - nAccounted > (unsigned long)MAX_PAIRS) {
+			printf("    FAILED, camera %d sent %lu frames, %lu accounted for\n", i, nSent[i], nAccounted);
+			ok = false;
+		}
+
+	}
+
+	return ok;
+
+}
+
+
+int main(int argc, char **argv) {
+
+	const int nofFrames = argc > 1 ? atoi(argv[1]) : NOF_FRAMES_DEFAULT;
+
+	if(nofFrames <= 0) {
+		printf("Usage: %s [nof frames]\n", argv[0]);
+		return -1;
+	}
+
+	srand(1);
+
+	unsigned long nUnmatched[2];
+	const std::vector<Capture> captures = simulate(nofFrames, nUnmatched);
+
+	printf("%d frames per camera, %lu + %lu without a partner\n", nofFrames, nUnmatched[0], nUnmatched[1]);
+	printf("Paired in the arrival order: %d wrong pairs\n\n", pairInArrivalOrder(captures));
+
+	bool ok = true;
+
+	printf("Paired by the timestamps, one thread:\n");
+	ok &= testOrdered(captures, nUnmatched);
+
+	printf("Paired by the timestamps, a thread for each camera:\n");
+	ok &= testThreaded(captures);
+
+	printf("\n%s\n", ok ? "OK" : "FAILED");
+
+	return ok ? 0 : -1;
+
+}
+
@@ -0,0 +1,325 @@
+/*
+ * Compares the CPU time of the scene frames of the GUI:
+ *
+ *     before  every frame decompressed at the full size by the scene
+ *             worker, the GUI showing the newest one
+ *     after   the GUI takes the newest frame at most at the preview
+ *             rate and decompresses only that, with PreviewDecoder at
+ *             about the size of the panel
+ *
+ * The camera runs at 30 fps and the GUI loop at 60 Hz like gazetoworld.
+ * The frames are synthetic scene images compressed with the chroma
+ * subsampling of the MJPG cameras. The times are in milliseconds of
+ * CPU per second of video.
+ *
+ * The scaled frames must be of the expected size and close to the full
+ * frame scaled down by averaging.
+ *
+ * Usage: preview [nof decodes]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+#include "PreviewDecoder.h"
+
+
+static const int NOF_DECODES_DEFAULT	= 100;
+
+/* The decodes are timed this many times, the best is taken */
+static const int NOF_RUNS				= 5;
+
+static const int QUALITY				= 85;
+
+/* The camera and the GUI loop, in microseconds */
+static const int64_t FRAME_INTERVAL		= 33333;
+static const int64_t GUI_INTERVAL		= 16667;
+
+/* The preview rate of gazetoworld */
+static const int64_t PREVIEW_INTERVAL	= 66667;
+
+/* The scaled frame may differ this much from the averaged full frame */
+static const double MAX_MEAN_DIFF		= 6.0;
+
+
+class Config {
+
+	public:
+
+		Config(int _w, int _h, int _panelW, int _panelH) {
+			w		= _w;
+			h		= _h;
+			panelW	= _panelW;
+			panelH	= _panelH;
+		}
+
+		int w, h;
+		int panelW, panelH;
+
+};
+
+
+/* Edges and gradients, something like a room, and noise */
+static void drawScene(int w, int h, std::vector<unsigned char> &rgb) {
+
+	rgb.resize(3 * w * h);
+
+	srand(1);
+
+	for(int y = 0; y < h; ++y) {
+
+		for(int x = 0; x < w; ++x) {
+
+			const bool bWindow = x > w / 5 && x < 2 * w / 5 && y > h / 6 && y < h / 2;
+			const bool bTable = y > 2 * h / 3 && x > w / 3;
+
+			double r = 120.0 + 60.0 * sin(x * 0.01);
+			double g = 110.0 + 40.0 * cos(y * 0.013);
+			double b = 100.0 + 0.1 * (x + y) * 640.0 / w;
+
+			if(bWindow) {
+				r = 230.0; g = 235.0; b = 250.0;
+			}
+			else if(bTable) {
+				r = 90.0 + 20.0 * sin(x * 0.2); g = 60.0; b = 30.0;
+			}
+
+			unsigned char *p = &rgb[3 * (y * w + x)];
+			p[0] = (unsigned char)std::max(0.0, std::min(255.0, r + (rand() % 3) - 1));
+			p[1] = (unsigned char)std::max(0.0, std::min(255.0, g + (rand() % 3) - 1));
+			p[2] = (unsigned char)std::max(0.0, std::min(255.0, b + (rand() % 3) - 1));
+
+		}
+
+	}
+
+}
+
+
+/* Compress with 4:2:2 sampling like the MJPG cameras */
+static void compress(int w, int h, const std::vector<unsigned char> &rgb, std::vector<unsigned char> &jpg) {
+
+	struct jpeg_compress_struct cinfo;
+	struct jpeg_error_mgr jerr;
+
+	cinfo.err = jpeg_std_error(&jerr);
+	jpeg_create_compress(&cinfo);
+
+	unsigned char *data = NULL;
+	unsigned long sz = 0;
+	jpeg_mem_dest(&cinfo, &data, &sz);
+
+	cinfo.image_width		= w;
+	cinfo.image_height		= h;
+	cinfo.input_components	= 3;
+	cinfo.in_color_space	= JCS_RGB;
+
+	jpeg_set_defaults(&cinfo);
+	jpeg_set_quality(&cinfo, QUALITY, TRUE);
+
+	cinfo.comp_info[0].h_samp_factor = 2;
+	cinfo.comp_info[0].v_samp_factor = 1;
+
+	jpeg_start_compress(&cinfo, TRUE);
+
+	while(cinfo.next_scanline < cinfo.image_height) {
+		JSAMPROW row_ptr = (JSAMPROW)&rgb[3 * w * cinfo.next_scanline];
+		jpeg_write_scanlines(&cinfo, &row_ptr, 1);
+	}
+
+	jpeg_finish_compress(&cinfo);
+	jpeg_destroy_compress(&cinfo);
+
+	jpg.assign(data, data + sz);
+
+	free(data);
+
+}
+
+
+/*
+ * The share of the camera frames the GUI decodes when it takes the
+ * newest one at most every PREVIEW_INTERVAL
+ */
+static double getPreviewShare() {
+
+	const int64_t duration = 60 * 1000000LL;
+
+	int nShown = 0;
+
+	int64_t tShown = -PREVIEW_INTERVAL;
+	int lastShown = -1;
+
+	for(int64_t t = 0; t < duration; t += GUI_INTERVAL) {
+
+		const int newest = (int)(t / FRAME_INTERVAL);
+
+		if(t - tShown >= PREVIEW_INTERVAL && newest != lastShown) {
+			tShown = t;
+			lastShown = newest;
+			++nShown;
+		}
+
+	}
+
+	return (double)nShown * FRAME_INTERVAL / duration;
+
+}
+
+
+/* Microseconds per decode, the best of NOF_RUNS */
+static double timeDecode(PreviewDecoder &decoder, const CameraFrame &frame, int nofDecodes) {
+
+	int64_t best = 0;
+
+	for(int run = 0; run < NOF_RUNS; ++run) {
+
+		const int64_t t1 = CameraFrame::getTime();
+
+		for(int i = 0; i < nofDecodes; ++i) {
+			delete decoder.decode(frame);
+		}
+
+		const int64_t dt = CameraFrame::getTime() - t1;
+
+		if(run == 0 || dt < best) {
+			best = dt;
+		}
+
+	}
+
+	return (double)best / nofDecodes;
+
+}
+
+
+/*
+ * The scaled frame against the full frame averaged over the scaled
+ * pixels. Returns the mean difference, or a negative value if the size
+ * is wrong.
+ */
+static double compareScaled(const CameraFrame &full, const CameraFrame &scaled) {
+
+	const int denom = (full.w + scaled.w - 1) / scaled.w;
+
+	if(scaled.w != (full.w + denom - 1) / denom || scaled.h != (full.h + denom - 1) / denom) {
+		return -1.0;
+	}
+
+	double sumDiff = 0.0;
+	int n = 0;
+
+	for(int y = 0; y + 1 < scaled.h; ++y) {
+
+		for(int x = 0; x + 1 < scaled.w; ++x) {
+
+			for(int c = 0; c < 3; ++c) {
+
+				double sum = 0.0;
+
+				for(int j = 0; j < denom; ++j) {
+					for(int i = 0; i < denom; ++i) {
+						sum += full.data[3 * ((y * denom + j) * full.w + x * denom + i) + c];
+					}
+				}
+
+				sumDiff += fabs(sum / (denom * denom) - scaled.data[3 * (y * scaled.w + x) + c]);
+				++n;
+
+			}
+
+		}
+
+	}
+
+	return sumDiff / n;
+
+}
+
+
+int main(int argc, char **argv) {
+
+	const int nofDecodes = argc > 1 ? atoi(argv[1]) : NOF_DECODES_DEFAULT;
+
+	if(nofDecodes <= 0) {
+		printf("Usage: %s [nof decodes]\n", argv[0]);
+		return -1;
+	}
+
+	std::vector<Config> configs;
+	configs.push_back(Config(640, 480, 640, 480));
+	configs.push_back(Config(640, 480, 320, 240));
+	configs.push_back(Config(640, 480, 160, 120));
+	configs.push_back(Config(1280, 720, 640, 360));
+	configs.push_back(Config(1280, 720, 320, 180));
+
+	const double share = getPreviewShare();
+	const double fps = 1e6 / FRAME_INTERVAL;
+
+	printf("camera %.0f fps, GUI loop %.0f Hz, preview %.0f fps: %.0f %% of the frames decoded\n\n",
+		   fps, 1e6 / GUI_INTERVAL, 1e6 / PREVIEW_INTERVAL, 100.0 * share);
+
+	printf("scene      panel      scale  full, us  scaled, us  before, ms/s  after, ms/s  speed-up\n");
+
+	bool ok = true;
+
+	for(size_t i = 0; i < configs.size(); ++i) {
+
+		const Config &c = configs[i];
+
+		std::vector<unsigned char> rgb, jpg;
+		drawScene(c.w, c.h, rgb);
+		compress(c.w, c.h, rgb, jpg);
+
+		CameraFrame frame(c.w, c.h, 3, &jpg[0], jpg.size(), FORMAT_MJPG, false, false);
+
+		// the scene worker decoded at the full size
+		PreviewDecoder decoderFull(c.w, c.h);
+		PreviewDecoder decoderPanel(c.panelW, c.panelH);
+
+		const double tFull = timeDecode(decoderFull, frame, nofDecodes);
+		const double tScaled = timeDecode(decoderPanel, frame, nofDecodes);
+
+		CameraFrame *full = decoderFull.decode(frame);
+		CameraFrame *scaled = decoderPanel.decode(frame);
+
+		const double before = 1e-3 * tFull * fps;
+		const double after = 1e-3 * tScaled * fps * share;
+
+		char scene[32], panel[32], scale[32];
+		sprintf(scene, "%dx%d", c.w, c.h);
+		sprintf(panel, "%dx%d", c.panelW, c.panelH);
+		sprintf(scale, "1/%d", (c.w + scaled->w - 1) / scaled->w);
+
+		printf("%-10s %-10s %-6s %8.0f %11.0f %13.1f %12.1f %9.1f\n",
+			   scene, panel, scale, tFull, tScaled, before, after, before / after);
+
+		const double diff = compareScaled(*full, *scaled);
+
+		if(scaled->w < c.panelW || scaled->h < c.panelH) {
+			printf("    FAILED, the frame is smaller than the panel\n");
+			ok = false;
+		}
+		else if(diff < 0.0) {
+			printf("    FAILED, the scaled frame is %dx%d\n", scaled->w, scaled->h);
+			ok = false;
+		}
+		else if(diff > MAX_MEAN_DIFF) {
+			printf("    FAILED, the scaled frame differs by %.1f on average\n", diff);
+			ok = false;
+		}
+
+		delete full;
+		delete scaled;
+
+	}
+
+	printf("\n%s\n", ok ? "OK" : "FAILED");
+
+	return ok ? 0 : -1;
+
+}
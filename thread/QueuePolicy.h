@@ -0,0 +1,305 @@
+#ifndef QUEUE_POLICY_H
+#define QUEUE_POLICY_H
+
+
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "RingQueue.h"
+
+
+/*
+ * What a bounded queue does when a producer adds to it while it is
+ * full:
+ *
+ *     POLICY_BLOCK        the producer waits for room at most the block
+ *                         time, then the new element is dropped
+ *     POLICY_DROP_OLDEST  the oldest elements are dropped
+ *     POLICY_DROP_NEWEST  the new element is dropped
+ *     POLICY_LATEST       only the newest element is kept, the consumer
+ *                         always gets the most recent one
+ *
+ * The consumer of a RingQueue is the only one allowed to take elements,
+ * so the oldest elements are dropped by the consumer, with trim(). The
+ * producers may therefore fill the queue beyond the limit, and the
+ * RingQueue must have room for that, see getCapacity(). While the
+ * consumer is busy, the producers may go up to 1.5 times the limit,
+ * then the new elements are dropped too. The rest of the capacity is
+ * left for the elements added without the policy.
+ *
+ * Usage, the producer:
+ *
+ *     if(!policy.admit(queue, max) || !queue.push(el)) {
+ *         policy.dropped();
+ *         ...release el
+ *     }
+ *
+ * and the consumer:
+ *
+ *     for(size_t n = policy.trim(queue.size(), max); n > 0 && queue.pop(el); --n) {
+ *         policy.dropped();
+ *         ...release el
+ *     }
+ *
+ *     queue.pop(el);
+ *     policy.taken();
+ */
+class QueuePolicy {
+
+public:
+
+    enum Type {
+        POLICY_BLOCK,
+        POLICY_DROP_OLDEST,
+        POLICY_DROP_NEWEST,
+        POLICY_LATEST
+    };
+
+
+    /* Counters since the creation */
+    class Stats {
+
+    public:
+
+        Stats() {
+            nAdded      = 0;
+            nDropped    = 0;
+            nBlocked    = 0;
+        }
+
+        /* Elements offered to the queue */
+        unsigned long nAdded;
+
+        /* Elements dropped by the producers or the consumer */
+        unsigned long nDropped;
+
+        /* Times a producer had to wait for room */
+        unsigned long nBlocked;
+
+    };
+
+
+    QueuePolicy(Type _type = POLICY_DROP_NEWEST, int _blockMs = DEFAULT_BLOCK_MS) {
+
+        type        = _type;
+        blockMs     = _blockMs;
+        nWaiting    = 0;
+
+        pthread_mutex_init(&mutex, NULL);
+        pthread_cond_init(&cond, NULL);
+
+    }
+
+
+    ~QueuePolicy() {
+
+        pthread_mutex_destroy(&mutex);
+        pthread_cond_destroy(&cond);
+
+    }
+
+
+    /* Must be set before the queue is used */
+    void set(Type _type, int _blockMs = DEFAULT_BLOCK_MS) {
+        type    = _type;
+        blockMs = _blockMs;
+    }
+
+    Type getType() const {return type;}
+
+    int getBlockMs() const {return blockMs;}
+
+
+    /*
+     * The capacity of the RingQueue for at most max elements. The
+     * oldest ones are dropped only when the consumer takes the next
+     * element, so there must be room for the elements that arrive
+     * while the consumer is busy.
+     */
+    size_t getCapacity(size_t max) const {
+        return 2 * max;
+    }
+
+
+    /*
+     * Called by the producer before adding an element to the queue.
+     * Returns false if the element must be dropped. Blocks for at most
+     * the block time with POLICY_BLOCK.
+     */
+    template <class T>
+    bool admit(const RingQueue<T> &queue, size_t max) {
+
+        __atomic_add_fetch(&stats.nAdded, 1, __ATOMIC_RELAXED);
+
+        switch(type) {
+
+            case POLICY_DROP_OLDEST:
+            case POLICY_LATEST:
+                return queue.size() < getCapacity(max) * 3 / 4;
+
+            case POLICY_DROP_NEWEST:
+                return queue.size() < max;
+
+            case POLICY_BLOCK:
+                return waitForRoom(queue, max);
+
+        }
+
+        return false;
+
+    }
+
+
+    /*
+     * Called by the consumer before taking an element from the queue
+     * holding n elements. Returns the number of the oldest elements it
+     * must drop first.
+     */
+    size_t trim(size_t n, size_t max) const {
+
+        switch(type) {
+
+            case POLICY_DROP_OLDEST:
+                return n > max ? n - max : 0;
+
+            case POLICY_LATEST:
+                return n > 1 ? n - 1 : 0;
+
+            default:
+                return 0;
+
+        }
+
+    }
+
+
+    /* Count a dropped element. Thread safe. */
+    void dropped(unsigned long n = 1) {
+        __atomic_add_fetch(&stats.nDropped, n, __ATOMIC_RELAXED);
+    }
+
+
+    /*
+     * Called by the consumer after taking elements. Wakes the producers
+     * waiting for room.
+     */
+    void taken() {
+
+        // pairs with the fence in waitForRoom()
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+        if(__atomic_load_n(&nWaiting, __ATOMIC_RELAXED) == 0) {
+            return;
+        }
+
+        pthread_mutex_lock(&mutex);
+        pthread_cond_broadcast(&cond);
+        pthread_mutex_unlock(&mutex);
+
+    }
+
+
+    void getStats(Stats &_stats) const {
+
+        _stats.nAdded   = __atomic_load_n(&stats.nAdded, __ATOMIC_RELAXED);
+        _stats.nDropped = __atomic_load_n(&stats.nDropped, __ATOMIC_RELAXED);
+        _stats.nBlocked = __atomic_load_n(&stats.nBlocked, __ATOMIC_RELAXED);
+
+    }
+
+
+    /* "block", "dropOldest", "dropNewest" or "latest" */
+    static bool parse(const char *str, Type &_type) {
+
+        for(int i = 0; i < NOF_TYPES; ++i) {
+
+            if(strcmp(str, getName((Type)i)) == 0) {
+                _type = (Type)i;
+                return true;
+            }
+
+        }
+
+        return false;
+
+    }
+
+
+    static const char *getName(Type _type) {
+
+        static const char *names[NOF_TYPES] = {"block", "dropOldest", "dropNewest", "latest"};
+
+        return names[_type];
+
+    }
+
+
+    /* How long the producers wait with POLICY_BLOCK by default */
+    enum {DEFAULT_BLOCK_MS = 20};
+
+private:
+
+    /* Not copyable */
+    QueuePolicy(const QueuePolicy &);
+    QueuePolicy &operator=(const QueuePolicy &);
+
+
+    enum {NOF_TYPES = 4};
+
+
+    template <class T>
+    bool waitForRoom(const RingQueue<T> &queue, size_t max) {
+
+        if(queue.size() < max) {
+            return true;
+        }
+
+        __atomic_add_fetch(&stats.nBlocked, 1, __ATOMIC_RELAXED);
+
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+
+        ts.tv_nsec  += (blockMs % 1000) * 1000000L;
+        ts.tv_sec   += blockMs / 1000 + ts.tv_nsec / 1000000000L;
+        ts.tv_nsec  %= 1000000000L;
+
+        pthread_mutex_lock(&mutex);
+
+            __atomic_add_fetch(&nWaiting, 1, __ATOMIC_RELAXED);
+
+            /*
+             * Announce the wait before checking the queue, either the
+             * consumer sees us waiting or we see the room it made.
+             */
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+            int ret = 0;
+            while(queue.size() >= max && ret == 0) {
+                ret = pthread_cond_timedwait(&cond, &mutex, &ts);
+            }
+
+            __atomic_sub_fetch(&nWaiting, 1, __ATOMIC_RELAXED);
+
+        pthread_mutex_unlock(&mutex);
+
+        return queue.size() < max;
+
+    }
+
+
+    Type type;
+    int blockMs;
+
+    Stats stats;
+
+    /* The producers waiting for room */
+    int nWaiting;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+
+};
+
+
+#endif
+
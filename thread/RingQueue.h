@@ -0,0 +1,406 @@
+#ifndef RING_QUEUE_H
+#define RING_QUEUE_H
+
+
+#include <stdlib.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+
+/* Size of a cache line in bytes */
+#define RING_QUEUE_CACHE_LINE 64
+
+
+/*
+ * A bounded lock-free queue for many producers and a single consumer.
+ *
+ * The elements are kept in a ring of slots. Each slot has a sequence
+ * number telling whether it is free for the producer of the position,
+ * or holds an element for the consumer. The producers claim positions
+ * by advancing the tail with compare-and-swap, the consumer owns the
+ * head. Nothing is allocated after init().
+ *
+ * The consumer may block in wait() until a producer adds an element.
+ * The producers wake it only when it actually waits, so adding to a
+ * queue whose consumer is busy costs no system call.
+ *
+ * T must be copyable, the elements are copied in and out of the slots.
+ */
+template <class T>
+class RingQueue {
+
+public:
+
+    RingQueue() {
+
+        slots       = NULL;
+        capacity    = 0;
+        mask        = 0;
+        head        = 0;
+        tail        = 0;
+        event       = 0;
+        bSleeping   = 0;
+
+    }
+
+
+    ~RingQueue() {
+        delete[] slots;
+    }
+
+
+    /*
+     * Allocate room for at least n elements. The capacity is rounded
+     * up to a power of two. Must be called before using the queue, and
+     * only once.
+     */
+    bool init(size_t n) {
+
+        if(n == 0 || slots != NULL) {
+            return false;
+        }
+
+        capacity = 1;
+        while(capacity < n) {
+            capacity <<= 1;
+        }
+
+        mask = capacity - 1;
+
+        slots = new Slot[capacity];
+
+        // slot i is free for the producer of position i
+        for(size_t i = 0; i < capacity; ++i) {
+            slots[i].seq = i;
+        }
+
+        return true;
+
+    }
+
+
+    /*
+     * Add an element. Returns false if the queue is full, in which
+     * case the element is not added. Thread safe.
+     */
+    bool push(const T &el) {
+        return pushBatch(&el, 1);
+    }
+
+
+    /*
+     * Add n elements so that they are consecutive in the queue. Either
+     * all or none of the elements are added. Thread safe.
+     */
+    bool pushBatch(const T *els, size_t n) {
+
+        if(n == 0 || n > capacity) {
+            return false;
+        }
+
+        size_t pos = __atomic_load_n(&tail, __ATOMIC_RELAXED);
+
+        /*********************************************************
+         * Claim the positions pos...pos + n - 1. The consumer
+         * frees the slots in order, so if the last one is free,
+         * all of them are.
+         *********************************************************/
+        for(;;) {
+
+            const size_t last = pos + n - 1;
+            const size_t seq = __atomic_load_n(&slots[last & mask].seq, __ATOMIC_ACQUIRE);
+            const long dif = (long)(seq - last);
+
+            if(dif == 0) {
+
+                // on failure pos is updated to the current tail
+                if(__atomic_compare_exchange_n(&tail, &pos, pos + n, true,
+                                               __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                    break;
+                }
+
+            }
+            else if(dif < 0) {
+
+                // the consumer has not yet taken the element of the previous round
+                return false;
+
+            }
+            else {
+
+                // another producer claimed the position
+                pos = __atomic_load_n(&tail, __ATOMIC_RELAXED);
+
+            }
+
+        }
+
+
+        /*********************************************************
+         * Fill and publish the slots
+         *********************************************************/
+        for(size_t i = 0; i < n; ++i) {
+
+            Slot &slot = slots[(pos + i) & mask];
+
+            slot.el = els[i];
+
+            __atomic_store_n(&slot.seq, pos + i + 1, __ATOMIC_RELEASE);
+
+        }
+
+        notify();
+
+        return true;
+
+    }
+
+
+    /*
+     * Take the oldest element. Returns false if the queue is empty.
+     * Must be called only by the consumer.
+     */
+    bool pop(T &el) {
+        return popBatch(&el, 1) == 1;
+    }
+
+
+    /*
+     * Take at most maxn oldest elements. Returns the number of elements
+     * taken. Must be called only by the consumer.
+     */
+    size_t popBatch(T *els, size_t maxn) {
+
+        // init() not called
+        if(slots == NULL) {
+            return 0;
+        }
+
+        size_t n = 0;
+
+        while(n < maxn) {
+
+            const size_t pos = head + n;
+
+            Slot &slot = slots[pos & mask];
+
+            // not yet published
+            if(__atomic_load_n(&slot.seq, __ATOMIC_ACQUIRE) != pos + 1) {
+                break;
+            }
+
+            els[n] = slot.el;
+
+            // drop the copy held by the slot
+            slot.el = T();
+
+            // free for the producer of the next round
+            __atomic_store_n(&slot.seq, pos + capacity, __ATOMIC_RELEASE);
+
+            ++n;
+
+        }
+
+        __atomic_store_n(&head, head + n, __ATOMIC_RELAXED);
+
+        return n;
+
+    }
+
+
+    /*
+     * The number of elements in the queue. Approximate when called
+     * while the others are adding or taking elements.
+     */
+    size_t size() const {
+
+        const size_t h = __atomic_load_n(&head, __ATOMIC_RELAXED);
+        const size_t t = __atomic_load_n(&tail, __ATOMIC_RELAXED);
+
+        // the positions claimed but not yet published are counted too
+        return t > h ? t - h : 0;
+
+    }
+
+
+    bool empty() const {
+
+        if(slots == NULL) {
+            return true;
+        }
+
+        return __atomic_load_n(&slots[head & mask].seq, __ATOMIC_ACQUIRE) != head + 1;
+
+    }
+
+
+    size_t getCapacity() const {return capacity;}
+
+
+    /*
+     * Block the consumer until the queue is not empty, wake() is called
+     * or millis milliseconds have elapsed. Returns true if the queue is
+     * not empty. Must be called only by the consumer.
+     */
+    bool wait(int millis) {
+
+        // an element often arrives soon, spin a while before sleeping
+        for(int i = 0; i < SPIN_COUNT; ++i) {
+
+            if(!empty()) {
+                return true;
+            }
+
+        }
+
+        const int ev = __atomic_load_n(&event, __ATOMIC_ACQUIRE);
+
+        /*
+         * Announce the sleep before checking the queue. A producer
+         * publishes before it checks bSleeping, so either it sees
+         * us sleeping or we see its element.
+         */
+        __atomic_store_n(&bSleeping, 1, __ATOMIC_SEQ_CST);
+
+        if(empty()) {
+            sleepOnEvent(ev, millis);
+        }
+
+        __atomic_store_n(&bSleeping, 0, __ATOMIC_RELAXED);
+
+        return !empty();
+
+    }
+
+
+    /* Wake the consumer from wait(), e.g. when it should quit. Thread safe. */
+    void wake() {
+
+        __atomic_add_fetch(&event, 1, __ATOMIC_SEQ_CST);
+
+        wakeOnEvent();
+
+    }
+
+private:
+
+    /* Not copyable */
+    RingQueue(const RingQueue &);
+    RingQueue &operator=(const RingQueue &);
+
+
+    /* How many times wait() checks the queue before sleeping */
+    enum {SPIN_COUNT = 256};
+
+
+    class Slot {
+
+    public:
+
+        size_t seq;
+        T el;
+
+    };
+
+
+    /* Wake the consumer if it is sleeping, only one producer does it */
+    void notify() {
+
+        // pairs with the store in wait()
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+        if(__atomic_load_n(&bSleeping, __ATOMIC_RELAXED) != 0 &&
+           __atomic_exchange_n(&bSleeping, 0, __ATOMIC_SEQ_CST) != 0) {
+            wake();
+        }
+
+    }
+
+
+#ifdef __linux__
+
+    void sleepOnEvent(int ev, int millis) {
+
+        struct timespec ts;
+        ts.tv_sec   = millis / 1000;
+        ts.tv_nsec  = (millis % 1000) * 1000000L;
+
+        // returns at once if the event has changed since it was read
+        syscall(SYS_futex, &event, FUTEX_WAIT_PRIVATE, ev, millis < 0 ? NULL : &ts, NULL, 0);
+
+    }
+
+
+    void wakeOnEvent() {
+
+        syscall(SYS_futex, &event, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+
+    }
+
+#else
+
+    /* No futex, poll the event */
+    void sleepOnEvent(int ev, int millis) {
+
+        struct timespec ts;
+        ts.tv_sec   = 0;
+        ts.tv_nsec  = 500000L;
+
+        for(int waited = 0; millis < 0 || waited < 2 * millis; ++waited) {
+
+            if(__atomic_load_n(&event, __ATOMIC_ACQUIRE) != ev) {
+                return;
+            }
+
+            nanosleep(&ts, NULL);
+
+        }
+
+    }
+
+
+    void wakeOnEvent() {}
+
+#endif
+
+
+    Slot *slots;
+
+    size_t capacity;
+    size_t mask;
+
+
+    /*
+     * The producers and the consumer on separate cache lines, so that
+     * they do not invalidate each other's line on every element.
+     */
+    char pad0[RING_QUEUE_CACHE_LINE];
+
+    /* Next position to take, written only by the consumer */
+    size_t head;
+
+    char pad1[RING_QUEUE_CACHE_LINE - sizeof(size_t)];
+
+    /* Next position to claim, shared by the producers */
+    size_t tail;
+
+    char pad2[RING_QUEUE_CACHE_LINE - sizeof(size_t)];
+
+    /* Incremented to wake the consumer, the futex word */
+    int event;
+
+    /* Is the consumer sleeping in wait() */
+    int bSleeping;
+
+    char pad3[RING_QUEUE_CACHE_LINE - 2 * sizeof(int)];
+
+};
+
+
+#endif
+
@@ -0,0 +1,450 @@
+#include "SegmentWriter.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <sstream>
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+
+static const int NOF_SYNC_POLICIES = 3;
+
+
+SegmentWriter::SegmentWriter() : Thread() {
+
+    sync        = SYNC_NONE;
+    current     = NULL;
+    next        = NULL;
+    nextNumber  = 0;
+    bFailed     = false;
+    bStop       = false;
+
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&cond, NULL);
+
+}
+
+
+SegmentWriter::~SegmentWriter() {
+
+    end();
+
+    pthread_mutex_destroy(&mutex);
+    pthread_cond_destroy(&cond);
+
+}
+
+
+int SegmentWriter::addFile(const std::string &name, size_t chunkSz, const std::vector<char> &header) {
+
+    FileInfo info;
+    info.name       = name;
+    info.chunkSz    = chunkSz;
+    info.header     = header;
+
+    files.push_back(info);
+
+    return (int)files.size() - 1;
+
+}
+
+
+bool SegmentWriter::init(const std::string &dir) {
+
+    parentDir = dir;
+
+    pending.resize(files.size());
+    pendingSz.assign(files.size(), 0);
+
+    // the first one is needed now
+    current = openSegment(0);
+    if(current == NULL) {
+        return false;
+    }
+
+    nextNumber  = 1;
+    bFailed     = false;
+    bStop       = false;
+
+    // the helper creates the next one
+    return start();
+
+}
+
+
+uint64_t SegmentWriter::add(int file, const char *data, size_t sz) {
+
+    const uint64_t offset = current->sizes[file] + pendingSz[file];
+
+    struct iovec iov;
+    iov.iov_base    = (void *)data;
+    iov.iov_len     = sz;
+
+    pending[file].push_back(iov);
+    pendingSz[file] += sz;
+
+    return offset;
+
+}
+
+
+bool SegmentWriter::flush() {
+
+    bool ok = true;
+
+    for(size_t i = 0; i < files.size(); ++i) {
+
+        std::vector<struct iovec> &iov = pending[i];
+
+        if(iov.empty()) {
+            continue;
+        }
+
+        const int fd = current->fds[i];
+
+        uint64_t offset = current->sizes[i];
+        const uint64_t end = offset + pendingSz[i];
+
+        /*
+         * Preallocate the next chunk without changing the size of the
+         * file. If the file system cannot, it allocates as the data is
+         * written.
+         */
+        if(end > current->allocated[i]) {
+
+            const uint64_t len = std::max((uint64_t)files[i].chunkSz, end - current->allocated[i]);
+
+            fallocate(fd, FALLOC_FL_KEEP_SIZE, current->allocated[i], len);
+
+            current->allocated[i] += len;
+
+        }
+
+        // as few calls as the system allows
+        for(size_t j = 0; j < iov.size() && ok; j += IOV_MAX) {
+
+            const int n = (int)std::min(iov.size() - j, (size_t)IOV_MAX);
+
+            uint64_t sz = 0;
+            for(int k = 0; k < n; ++k) {
+                sz += iov[j + k].iov_len;
+            }
+
+            ok = writeAll(fd, &iov[j], n, offset);
+
+            offset += sz;
+
+        }
+
+        current->sizes[i] = end;
+
+        iov.clear();
+        pendingSz[i] = 0;
+
+        if(ok && sync == SYNC_BATCH) {
+            fdatasync(fd);
+        }
+
+    }
+
+    return ok;
+
+}
+
+
+bool SegmentWriter::rotate() {
+
+    if(!flush()) {
+        return false;
+    }
+
+    pthread_mutex_lock(&mutex);
+
+    // only if the segments are rotated faster than they are created
+    while(next == NULL && !bFailed) {
+        pthread_cond_wait(&cond, &mutex);
+    }
+
+    if(next == NULL) {
+
+        pthread_mutex_unlock(&mutex);
+
+        printf("SegmentWriter::rotate(): The next segment could not be created\n");
+
+        return false;
+
+    }
+
+    retired.push_back(current);
+    current = next;
+    next = NULL;
+
+    // close the old one and create the next
+    pthread_cond_broadcast(&cond);
+
+    pthread_mutex_unlock(&mutex);
+
+    return true;
+
+}
+
+
+void SegmentWriter::end() {
+
+    // not initialised or already ended
+    if(current == NULL) {
+        return;
+    }
+
+    flush();
+
+    pthread_mutex_lock(&mutex);
+
+    bStop = true;
+    pthread_cond_broadcast(&cond);
+
+    pthread_mutex_unlock(&mutex);
+
+    Thread::end();
+
+
+    // the helper has exited
+    while(!retired.empty()) {
+        closeSegment(retired.front());
+        retired.pop_front();
+    }
+
+    if(next != NULL) {
+        removeSegment(next);
+        next = NULL;
+    }
+
+    closeSegment(current);
+    current = NULL;
+
+}
+
+
+void SegmentWriter::run() {
+
+    pthread_mutex_lock(&mutex);
+
+    while(!bStop) {
+
+        if(!retired.empty()) {
+
+            Segment *seg = retired.front();
+            retired.pop_front();
+
+            pthread_mutex_unlock(&mutex);
+
+            closeSegment(seg);
+
+            pthread_mutex_lock(&mutex);
+
+            continue;
+
+        }
+
+        if(next == NULL && !bFailed) {
+
+            const int n = nextNumber;
+
+            pthread_mutex_unlock(&mutex);
+
+            Segment *seg = openSegment(n);
+
+            pthread_mutex_lock(&mutex);
+
+            if(seg != NULL) {
+                next = seg;
+                ++nextNumber;
+            }
+            else {
+                bFailed = true;
+            }
+
+            // rotate() might be waiting
+            pthread_cond_broadcast(&cond);
+
+            continue;
+
+        }
+
+        pthread_cond_wait(&cond, &mutex);
+
+    }
+
+    pthread_mutex_unlock(&mutex);
+
+}
+
+
+SegmentWriter::Segment *SegmentWriter::openSegment(int n) {
+
+    std::stringstream ss;
+    ss << parentDir << "part" << n << "/";
+
+    Segment *seg = new Segment();
+    seg->dir = ss.str();
+
+    if(mkdir(seg->dir.c_str(), 0777) != 0) {
+        printf("SegmentWriter::openSegment(): Could not create %s\n", seg->dir.c_str());
+        delete seg;
+        return NULL;
+    }
+
+    for(size_t i = 0; i < files.size(); ++i) {
+
+        const std::string path = seg->dir + files[i].name;
+
+        const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+
+        if(fd == -1) {
+            printf("SegmentWriter::openSegment(): Could not create %s\n", path.c_str());
+            removeSegment(seg);
+            return NULL;
+        }
+
+        seg->fds.push_back(fd);
+        seg->sizes.push_back(0);
+        seg->allocated.push_back(files[i].chunkSz);
+
+        fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, files[i].chunkSz);
+
+        const std::vector<char> &header = files[i].header;
+
+        if(!header.empty()) {
+
+            struct iovec iov;
+            iov.iov_base    = (void *)&header[0];
+            iov.iov_len     = header.size();
+
+            if(!writeAll(fd, &iov, 1, 0)) {
+                removeSegment(seg);
+                return NULL;
+            }
+
+            seg->sizes.back() = header.size();
+
+        }
+
+    }
+
+    return seg;
+
+}
+
+
+void SegmentWriter::closeSegment(Segment *seg) {
+
+    for(size_t i = 0; i < seg->fds.size(); ++i) {
+
+        const int fd = seg->fds[i];
+
+        /*
+         * Give back the space that was preallocated but not used. It is
+         * past the end of the file, where punching holes does nothing,
+         * but truncating frees the blocks even without a change of size.
+         */
+        if(seg->allocated[i] > seg->sizes[i] && ftruncate(fd, seg->sizes[i]) != 0) {
+            printf("SegmentWriter::closeSegment(): Could not truncate %s\n", (seg->dir + files[i].name).c_str());
+        }
+
+        if(sync != SYNC_NONE) {
+            fsync(fd);
+        }
+
+        close(fd);
+
+    }
+
+    delete seg;
+
+}
+
+
+void SegmentWriter::removeSegment(Segment *seg) {
+
+    for(size_t i = 0; i < seg->fds.size(); ++i) {
+        close(seg->fds[i]);
+        unlink((seg->dir + files[i].name).c_str());
+    }
+
+    rmdir(seg->dir.c_str());
+
+    delete seg;
+
+}
+
+
+bool SegmentWriter::writeAll(int fd, struct iovec *iov, int iovcnt, uint64_t offset) {
+
+    while(iovcnt > 0) {
+
+        ssize_t n = pwritev(fd, iov, iovcnt, (off_t)offset);
+
+        if(n < 0) {
+
+            if(errno == EINTR) {
+                continue;
+            }
+
+            printf("SegmentWriter::writeAll(): %s\n", strerror(errno));
+
+            return false;
+
+        }
+
+        offset += n;
+
+        // skip what was written, the last vector might be written partly
+        while(iovcnt > 0 && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            ++iov;
+            --iovcnt;
+        }
+
+        if(iovcnt > 0) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+
+    }
+
+    return true;
+
+}
+
+
+bool SegmentWriter::parse(const char *str, SyncPolicy &_sync) {
+
+    for(int i = 0; i < NOF_SYNC_POLICIES; ++i) {
+
+        if(strcmp(str, getName((SyncPolicy)i)) == 0) {
+            _sync = (SyncPolicy)i;
+            return true;
+        }
+
+    }
+
+    return false;
+
+}
+
+
+const char *SegmentWriter::getName(SyncPolicy _sync) {
+
+    static const char *names[NOF_SYNC_POLICIES] = {"none", "segment", "batch"};
+
+    return names[_sync];
+
+}
+
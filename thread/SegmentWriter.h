@@ -0,0 +1,172 @@
+#ifndef SEGMENT_WRITER_H
+#define SEGMENT_WRITER_H
+
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <stdint.h>
+#include <sys/uio.h>
+#include "Thread.h"
+
+
+/*
+ * Writes a set of files that is split into segments, the folders part0,
+ * part1... of a directory, each containing its own copy of every file.
+ *
+ * The writer adds data to the files with add(), which only queues it,
+ * and writes everything queued with flush(), one pwritev() per file.
+ * The files are preallocated with fallocate() a chunk at a time, so the
+ * file system does not allocate for every write. rotate() switches to
+ * the next segment, which a helper thread has already created. The
+ * helper also syncs and closes the files of the finished segments, so
+ * the writer never waits for the file system to open or close files.
+ *
+ * add(), flush() and rotate() must be called from a single thread.
+ */
+class SegmentWriter : public Thread {
+
+public:
+
+    /* When the data is synced to the disk */
+    enum SyncPolicy {
+        SYNC_NONE,      // left to the kernel
+        SYNC_SEGMENT,   // the files of a segment when it is closed
+        SYNC_BATCH      // after every flush()
+    };
+
+
+    SegmentWriter();
+
+    /* Closes the files */
+    ~SegmentWriter();
+
+    /*
+     * Add a file to each segment. Its space is preallocated chunkSz
+     * bytes at a time, and every segment begins with the header. Must be
+     * called before init(). Returns the id of the file for add().
+     */
+    int addFile(const std::string &name, size_t chunkSz, const std::vector<char> &header = std::vector<char>());
+
+    /* Must be called before init(). SYNC_NONE by default. */
+    void setSyncPolicy(SyncPolicy _sync) {sync = _sync;}
+
+    /*
+     * Create the first segment and start the helper thread, which
+     * creates the next. dir must exist and contain the trailing '/'.
+     */
+    bool init(const std::string &dir);
+
+    /*
+     * Queue the data to the end of the file. Returns its offset in the
+     * file of the current segment. The data must stay valid until
+     * flush().
+     */
+    uint64_t add(int file, const char *data, size_t sz);
+
+    /* Write the queued data */
+    bool flush();
+
+    /*
+     * Flush and continue in the next segment. Waits only if the helper
+     * has not created it yet.
+     */
+    bool rotate();
+
+    /* Flush, stop the helper and close the files */
+    void end();
+
+    /* Inherited from Thread, the helper */
+    void run();
+
+    /* "none", "segment" or "batch" */
+    static bool parse(const char *str, SyncPolicy &_sync);
+    static const char *getName(SyncPolicy _sync);
+
+private:
+
+    /* Not copyable */
+    SegmentWriter(const SegmentWriter &);
+    SegmentWriter &operator=(const SegmentWriter &);
+
+
+    /* A file added with addFile() */
+    class FileInfo {
+
+    public:
+
+        std::string name;
+        size_t chunkSz;
+        std::vector<char> header;
+
+    };
+
+
+    /* The open files of a partX folder */
+    class Segment {
+
+    public:
+
+        std::string dir;
+
+        std::vector<int> fds;
+
+        /* Bytes written to the files */
+        std::vector<uint64_t> sizes;
+
+        /* Bytes preallocated for the files */
+        std::vector<uint64_t> allocated;
+
+    };
+
+
+    /* Called by the helper */
+    Segment *openSegment(int n);
+    void closeSegment(Segment *seg);
+
+    /* Remove a segment that was never written to */
+    void removeSegment(Segment *seg);
+
+    /* Write all of the vectors at the offset */
+    bool writeAll(int fd, struct iovec *iov, int iovcnt, uint64_t offset);
+
+
+    std::vector<FileInfo> files;
+
+    SyncPolicy sync;
+
+    std::string parentDir;
+
+
+    /* Written by add() and flush() */
+    Segment *current;
+
+    /* The data add() has queued for each file, and its size */
+    std::vector<std::vector<struct iovec> > pending;
+    std::vector<uint64_t> pendingSz;
+
+
+    /* Protect the segments shared with the helper */
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+
+    /* Created by the helper for rotate(), NULL if not yet */
+    Segment *next;
+
+    /* The number of the next segment the helper creates */
+    int nextNumber;
+
+    /* Finished segments for the helper to close */
+    std::deque<Segment *> retired;
+
+    /* The helper could not create a segment */
+    bool bFailed;
+
+    /* Tell the helper to exit */
+    bool bStop;
+
+};
+
+
+#endif
+
@@ -0,0 +1,448 @@
+/*
+ * Measures the RingQueue against the mutex protected std::list the
+ * workers and the writers used before:
+ *
+ *     - throughput with one and with several producers, in elements
+ *       per second, one at a time and in batches
+ *     - wake-up latency, the time from adding an element to the queue
+ *       until the waiting consumer has taken it
+ *
+ * The consumer checks that the elements of each producer arrive in
+ * order and that none are lost, and the program fails if they do not.
+ *
+ * Usage: ring_queue [nof elements] [nof producers]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include <list>
+#include <vector>
+#include <algorithm>
+
+#include "RingQueue.h"
+
+
+static const long NOF_ELEMENTS_DEFAULT	= 2000000;
+static const int NOF_PRODUCERS_DEFAULT	= 4;
+
+/* The capacity of the queues */
+static const size_t CAPACITY			= 1024;
+
+/* The batch size of the batched run */
+static const size_t BATCH_SIZE			= 16;
+
+/* The number of wake-ups measured, and the pause between them */
+static const int NOF_WAKEUPS			= 2000;
+static const int WAKEUP_PAUSE_US		= 200;
+
+/* How long the consumers wait at a time */
+static const int WAIT_MS				= 4;
+
+
+static double now() {
+
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + 1e-9 * ts.tv_nsec;
+
+}
+
+
+/* An element: the producer and its running number, or the time it was added */
+class Element {
+
+	public:
+
+		Element() {
+			producer	= -1;
+			seq			= 0;
+			t			= 0.0;
+		}
+
+		int producer;
+		long seq;
+		double t;
+
+};
+
+
+/*
+ * The queue of the earlier implementation: the consumer waits on the
+ * condition with a timeout, like VideoWriter::getElement() did.
+ */
+class ListQueue {
+
+	public:
+
+		ListQueue() {
+			pthread_mutex_init(&mutex, NULL);
+			pthread_cond_init(&cond, NULL);
+		}
+
+		~ListQueue() {
+			pthread_mutex_destroy(&mutex);
+			pthread_cond_destroy(&cond);
+		}
+
+		bool push(const Element &el) {
+
+			pthread_mutex_lock(&mutex);
+
+				bool ret = queue.size() < CAPACITY;
+
+				if(ret) {
+					queue.push_back(el);
+				}
+
+				pthread_cond_signal(&cond);
+
+			pthread_mutex_unlock(&mutex);
+
+			return ret;
+
+		}
+
+		bool pushBatch(const Element *els, size_t n) {
+
+			pthread_mutex_lock(&mutex);
+
+				bool ret = queue.size() + n <= CAPACITY;
+
+				for(size_t i = 0; ret && i < n; ++i) {
+					queue.push_back(els[i]);
+				}
+
+				pthread_cond_signal(&cond);
+
+			pthread_mutex_unlock(&mutex);
+
+			return ret;
+
+		}
+
+		size_t popBatch(Element *els, size_t maxn) {
+
+			pthread_mutex_lock(&mutex);
+
+				size_t n = 0;
+
+				while(n < maxn && queue.size() > 0) {
+					els[n++] = queue.front();
+					queue.pop_front();
+				}
+
+			pthread_mutex_unlock(&mutex);
+
+			return n;
+
+		}
+
+		bool wait(int millis) {
+
+			struct timespec ts;
+			clock_gettime(CLOCK_REALTIME, &ts);
+
+			ts.tv_nsec += (millis % 1000) * 1000000L;
+			ts.tv_sec += millis / 1000 + ts.tv_nsec / 1000000000L;
+			ts.tv_nsec %= 1000000000L;
+
+			pthread_mutex_lock(&mutex);
+
+				if(queue.size() == 0) {
+					pthread_cond_timedwait(&cond, &mutex, &ts);
+				}
+
+				bool ret = queue.size() > 0;
+
+			pthread_mutex_unlock(&mutex);
+
+			return ret;
+
+		}
+
+	private:
+
+		pthread_mutex_t mutex;
+		pthread_cond_t cond;
+
+		std::list<Element> queue;
+
+};
+
+
+template <class Q>
+class Run {
+
+	public:
+
+		Q *queue;
+
+		long nofElements;	// per producer
+		size_t batch;		// elements per push and pop
+		int producer;
+
+		/* Set by the wake-up test */
+		volatile int consumed;
+
+};
+
+
+template <class Q>
+static void *produce(void *arg) {
+
+	Run<Q> *run = (Run<Q> *)arg;
+
+	std::vector<Element> els(run->batch);
+
+	struct timespec backoff;
+	backoff.tv_sec	= 0;
+	backoff.tv_nsec	= 50000L;
+
+	for(long i = 0; i < run->nofElements; i += run->batch) {
+
+		for(size_t j = 0; j < run->batch; ++j) {
+			els[j].producer	= run->producer;
+			els[j].seq		= i + j;
+		}
+
+		// the queue is full, let the consumer catch up
+		while(!run->queue->pushBatch(&els[0], run->batch)) {
+			nanosleep(&backoff, NULL);
+		}
+
+	}
+
+	return NULL;
+
+}
+
+
+/*
+ * Runs the producers and consumes in this thread. Returns the elements
+ * per second, or a negative value if the elements did not arrive in
+ * order.
+ */
+template <class Q>
+static double throughput(int nofProducers, long nofElements, size_t batch) {
+
+	Q queue;
+	queue.init(CAPACITY);
+
+	std::vector<Run<Q> > runs(nofProducers);
+	std::vector<pthread_t> threads(nofProducers);
+
+	const double tStart = now();
+
+	for(int i = 0; i < nofProducers; ++i) {
+
+		runs[i].queue		= &queue;
+		runs[i].nofElements	= nofElements;
+		runs[i].batch		= batch;
+		runs[i].producer	= i;
+
+		pthread_create(&threads[i], NULL, &produce<Q>, &runs[i]);
+
+	}
+
+
+	/*********************************************************
+	 * Consume and check the order
+	 *********************************************************/
+	std::vector<long> expected(nofProducers, 0);
+	std::vector<Element> els(batch);
+
+	const long total = nofProducers * nofElements;
+	long count = 0;
+	bool ok = true;
+
+	while(count < total) {
+
+		const size_t n = queue.popBatch(&els[0], batch);
+
+		if(n == 0) {
+			queue.wait(WAIT_MS);
+			continue;
+		}
+
+		for(size_t i = 0; i < n; ++i) {
+
+			const Element &el = els[i];
+
+			if(el.producer < 0 || el.producer >= nofProducers || el.seq != expected[el.producer]) {
+				ok = false;
+			}
+			else {
+				++expected[el.producer];
+			}
+
+		}
+
+		count += n;
+
+	}
+
+	const double dur = now() - tStart;
+
+	for(int i = 0; i < nofProducers; ++i) {
+		pthread_join(threads[i], NULL);
+	}
+
+	return ok ? total / dur : -1.0;
+
+}
+
+
+template <class Q>
+static void *consumeTimed(void *arg) {
+
+	Run<Q> *run = (Run<Q> *)arg;
+
+	std::vector<double> *delays = new std::vector<double>();
+
+	Element el;
+
+	while((int)delays->size() < NOF_WAKEUPS) {
+
+		if(run->queue->popBatch(&el, 1) == 0) {
+			run->queue->wait(WAIT_MS);
+			continue;
+		}
+
+		delays->push_back(now() - el.t);
+
+		__atomic_store_n(&run->consumed, (int)delays->size(), __ATOMIC_RELEASE);
+
+	}
+
+	return delays;
+
+}
+
+
+/*
+ * Adds one element at a time to the queue of a waiting consumer.
+ * Gives the median and the 99th percentile of the delay in µs.
+ */
+template <class Q>
+static void wakeupLatency(double &median, double &p99) {
+
+	Q queue;
+	queue.init(CAPACITY);
+
+	Run<Q> run;
+	run.queue		= &queue;
+	run.consumed	= 0;
+
+	pthread_t thread;
+	pthread_create(&thread, NULL, &consumeTimed<Q>, &run);
+
+	struct timespec pause;
+	pause.tv_sec	= 0;
+	pause.tv_nsec	= WAKEUP_PAUSE_US * 1000L;
+
+	for(int i = 0; i < NOF_WAKEUPS; ++i) {
+
+		// let the consumer go to sleep
+		nanosleep(&pause, NULL);
+
+		Element el;
+		el.t = now();
+
+		queue.pushBatch(&el, 1);
+
+		// wait for it to be taken
+		while(__atomic_load_n(&run.consumed, __ATOMIC_ACQUIRE) <= i) {
+			sched_yield();
+		}
+
+	}
+
+	void *ret = NULL;
+	pthread_join(thread, &ret);
+
+	std::vector<double> *delays = (std::vector<double> *)ret;
+	std::sort(delays->begin(), delays->end());
+
+	median	= 1e6 * (*delays)[delays->size() / 2];
+	p99		= 1e6 * (*delays)[delays->size() * 99 / 100];
+
+	delete delays;
+
+}
+
+
+/* ListQueue has no init() */
+class LockedQueue : public ListQueue {
+
+	public:
+
+		bool init(size_t) {return true;}
+
+};
+
+
+static bool report(const char *name, double opsRing, double opsList) {
+
+	if(opsRing < 0.0 || opsList < 0.0) {
+		printf("%-28s FAILED, the elements were lost or reordered\n", name);
+		return false;
+	}
+
+	printf("%-28s %10.2f %10.2f %8.1fx\n", name, opsRing * 1e-6, opsList * 1e-6, opsRing / opsList);
+
+	return true;
+
+}
+
+
+int main(int argc, char **argv) {
+
+	const long nofElements	= argc > 1 ? atol(argv[1]) : NOF_ELEMENTS_DEFAULT;
+	const int nofProducers	= argc > 2 ? atoi(argv[2]) : NOF_PRODUCERS_DEFAULT;
+
+	if(nofElements <= 0 || nofProducers <= 0 || nofElements % BATCH_SIZE != 0) {
+		printf("Usage: %s [nof elements, a multiple of %d] [nof producers]\n", argv[0], (int)BATCH_SIZE);
+		return -1;
+	}
+
+	bool ok = true;
+
+	printf("Throughput, million elements/s   RingQueue  list+mutex\n");
+
+	ok &= report("1 producer",
+				 throughput<RingQueue<Element> >(1, nofElements, 1),
+				 throughput<LockedQueue>(1, nofElements, 1));
+
+	ok &= report("1 producer, batches of 16",
+				 throughput<RingQueue<Element> >(1, nofElements, BATCH_SIZE),
+				 throughput<LockedQueue>(1, nofElements, BATCH_SIZE));
+
+	char name[64];
+	sprintf(name, "%d producers", nofProducers);
+
+	ok &= report(name,
+				 throughput<RingQueue<Element> >(nofProducers, nofElements / nofProducers, 1),
+				 throughput<LockedQueue>(nofProducers, nofElements / nofProducers, 1));
+
+	sprintf(name, "%d producers, batches of 16", nofProducers);
+
+	ok &= report(name,
+				 throughput<RingQueue<Element> >(nofProducers, nofElements / nofProducers / BATCH_SIZE * BATCH_SIZE, BATCH_SIZE),
+				 throughput<LockedQueue>(nofProducers, nofElements / nofProducers / BATCH_SIZE * BATCH_SIZE, BATCH_SIZE));
+
+
+	double medRing, p99Ring, medList, p99List;
+	wakeupLatency<RingQueue<Element> >(medRing, p99Ring);
+	wakeupLatency<LockedQueue>(medList, p99List);
+
+	printf("\nWake-up latency, µs             RingQueue  list+mutex\n");
+	printf("%-28s %10.1f %10.1f\n", "median", medRing, medList);
+	printf("%-28s %10.1f %10.1f\n", "99th percentile", p99Ring, p99List);
+
+	return ok ? 0 : -1;
+
+}
+
@@ -0,0 +1,486 @@
+/*
+ * Measures the SegmentWriter against the std::ofstream writing that
+ * VideoWriter did before, with synthetic MJPG frames of two cameras, the
+ * results and the side index:
+ *
+ *     ofstream    a write() per element and file, the files of a new
+ *                 part created and the old ones closed on the writing
+ *                 thread
+ *     segments    the elements of a batch queued and written with a
+ *                 pwritev() per file, the files preallocated and the
+ *                 parts created and closed by the helper thread
+ *
+ * Each rate writes SECONDS of recording as fast as it can, starting a
+ * new part every ROTATE_SECONDS. The times are the time the writer is
+ * busy with a batch of elements, their maximum being the longest stall
+ * of the queue. Realtime is how many times faster than the cameras the
+ * recording is written. The written files are checked.
+ *
+ * Usage: segment_writer [directory]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include "SegmentWriter.h"
+
+
+/* Of recording per rate */
+static const int SECONDS			= 6;
+
+/* A new part this often, in seconds of recording. VideoWriter uses 120 s. */
+static const int ROTATE_SECONDS		= 1;
+
+/* The most elements the writer takes from its queue at a time */
+static const size_t BATCH_SIZE		= 64;
+
+/* Different frames written in turn */
+static const int NOF_FRAMES			= 32;
+
+static const size_t RESULTS_SIZE	= 200;
+static const size_t ENTRY_SIZE		= 32;
+
+static const size_t CHUNK_FRAMES	= 16 * 1024 * 1024;
+static const size_t CHUNK_RESULTS	= 1024 * 1024;
+static const size_t CHUNK_INDEX		= 256 * 1024;
+
+/*
+ * The space allocated for a closed file may exceed its size rounded up to
+ * blocks this much, for the blocks of the extent tree. Well below the
+ * smallest chunk, so preallocated space left over shows up.
+ */
+static const uint64_t MAX_ALLOC_SLACK	= 64 * 1024;
+
+
+static const char *FILE_NAMES[4] = {"camera1.mjpg", "camera2.mjpg", "results.res", "index.idx"};
+
+
+class Rate {
+
+	public:
+
+		Rate(int _nofHeadsets, int _fps, int _frameKB) {
+			nofHeadsets	= _nofHeadsets;
+			fps			= _fps;
+			frameKB		= _frameKB;
+		}
+
+		int nofHeadsets;
+		int fps;
+		int frameKB;
+
+};
+
+
+/* An element of the queue of VideoWriter */
+class Element {
+
+	public:
+
+		int file;
+		const char *data;
+		size_t sz;
+
+};
+
+
+class Stats {
+
+	public:
+
+		Stats() {
+			seconds = 0.0;
+			bytes	= 0;
+		}
+
+		std::vector<double> batchTimes;
+		double seconds;
+		uint64_t bytes;
+
+};
+
+
+static double now() {
+
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + 1e-9 * ts.tv_nsec;
+
+}
+
+
+/*
+ * The elements of a recording in the order VideoWriter gets them: each
+ * frame pair followed by its results. Each headset writes its own
+ * recording, here into the same files, which has the same cost.
+ */
+static void makeElements(const Rate &rate, const std::vector<std::vector<char> > &frames,
+						 const std::vector<char> &results, std::vector<Element> &els) {
+
+	const int nofPairs = rate.nofHeadsets * rate.fps * SECONDS;
+
+	els.clear();
+
+	for(int i = 0; i < nofPairs; ++i) {
+
+		for(int file = 0; file < 3; ++file) {
+
+			Element el;
+			el.file	= file;
+			el.data	= file < 2 ? &frames[(2 * i + file) % NOF_FRAMES][0] : &results[0];
+			el.sz	= file < 2 ? frames[(2 * i + file) % NOF_FRAMES].size() : results.size();
+
+			els.push_back(el);
+
+		}
+
+	}
+
+}
+
+
+static std::string getPartDir(const std::string &dir, int part) {
+
+	std::stringstream ss;
+	ss << dir << "part" << part << "/";
+
+	return ss.str();
+
+}
+
+
+/* Like VideoWriter::createNewFiles() did */
+static bool openPart(const std::string &dir, int part, std::ofstream streams[4]) {
+
+	const std::string partDir = getPartDir(dir, part);
+
+	if(mkdir(partDir.c_str(), 0777) != 0) {
+		return false;
+	}
+
+	for(int i = 0; i < 4; ++i) {
+
+		streams[i].close();
+		streams[i].open((partDir + FILE_NAMES[i]).c_str(), std::ofstream::binary);
+
+		if(!streams[i].is_open()) {
+			return false;
+		}
+
+	}
+
+	return true;
+
+}
+
+
+static bool writeStreams(const std::string &dir, const std::vector<Element> &els, int elsPerPart, Stats &stats) {
+
+	std::ofstream streams[4];
+
+	if(!openPart(dir, 0, streams)) {
+		return false;
+	}
+
+	int part = 0;
+	char entry[ENTRY_SIZE];
+	memset(entry, 0, ENTRY_SIZE);
+
+	const double t1 = now();
+
+	for(size_t i = 0; i < els.size(); i += BATCH_SIZE) {
+
+		const double tb = now();
+
+		if((int)(i / elsPerPart) > part) {
+
+			if(!openPart(dir, ++part, streams)) {
+				return false;
+			}
+
+		}
+
+		const size_t end = std::min(els.size(), i + BATCH_SIZE);
+
+		for(size_t j = i; j < end; ++j) {
+
+			streams[els[j].file].write(els[j].data, els[j].sz);
+			streams[3].write(entry, ENTRY_SIZE);
+
+			stats.bytes += els[j].sz + ENTRY_SIZE;
+
+		}
+
+		stats.batchTimes.push_back(now() - tb);
+
+	}
+
+	for(int i = 0; i < 4; ++i) {
+		streams[i].close();
+	}
+
+	stats.seconds = now() - t1;
+
+	return true;
+
+}
+
+
+static bool writeSegments(const std::string &dir, const std::vector<Element> &els, int elsPerPart,
+						  SegmentWriter::SyncPolicy sync, Stats &stats) {
+
+	SegmentWriter writer;
+
+	writer.addFile(FILE_NAMES[0], CHUNK_FRAMES);
+	writer.addFile(FILE_NAMES[1], CHUNK_FRAMES);
+	writer.addFile(FILE_NAMES[2], CHUNK_RESULTS);
+	writer.addFile(FILE_NAMES[3], CHUNK_INDEX);
+
+	writer.setSyncPolicy(sync);
+
+	if(!writer.init(dir)) {
+		return false;
+	}
+
+	int part = 0;
+	std::vector<char> entries(BATCH_SIZE * ENTRY_SIZE, 0);
+
+	const double t1 = now();
+
+	for(size_t i = 0; i < els.size(); i += BATCH_SIZE) {
+
+		const double tb = now();
+
+		if((int)(i / elsPerPart) > part) {
+
+			++part;
+
+			if(!writer.rotate()) {
+				return false;
+			}
+
+		}
+
+		const size_t end = std::min(els.size(), i + BATCH_SIZE);
+
+		for(size_t j = i; j < end; ++j) {
+
+			writer.add(els[j].file, els[j].data, els[j].sz);
+
+			stats.bytes += els[j].sz + ENTRY_SIZE;
+
+		}
+
+		writer.add(3, &entries[0], (end - i) * ENTRY_SIZE);
+
+		if(!writer.flush()) {
+			return false;
+		}
+
+		stats.batchTimes.push_back(now() - tb);
+
+	}
+
+	writer.end();
+
+	stats.seconds = now() - t1;
+
+	return true;
+
+}
+
+
+/*
+ * The sizes of the files, which must add up to what was written, and
+ * remove them. The files must not hold on to more space than they use.
+ */
+static bool checkAndRemove(const std::string &dir, const std::vector<Element> &els, int elsPerPart) {
+
+	std::vector<uint64_t> expected(4, 0);
+	std::vector<uint64_t> actual(4, 0);
+
+	for(size_t i = 0; i < els.size(); ++i) {
+		expected[els[i].file] += els[i].sz;
+		expected[3] += ENTRY_SIZE;
+	}
+
+	const int nofParts = ((int)els.size() + elsPerPart - 1) / elsPerPart;
+
+	bool ok = true;
+
+	for(int part = 0; ; ++part) {
+
+		const std::string partDir = getPartDir(dir, part);
+
+		struct stat myStat;
+		if(stat(partDir.c_str(), &myStat) != 0) {
+
+			if(part != nofParts) {
+				printf("    %d parts, %d expected\n", part, nofParts);
+				ok = false;
+			}
+
+			break;
+
+		}
+
+		for(int i = 0; i < 4; ++i) {
+
+			const std::string path = partDir + FILE_NAMES[i];
+
+			if(stat(path.c_str(), &myStat) == 0) {
+
+				actual[i] += myStat.st_size;
+
+				const uint64_t blockSz   = myStat.st_blksize;
+				const uint64_t used      = (myStat.st_size + blockSz - 1) / blockSz * blockSz;
+				const uint64_t allocated = (uint64_t)myStat.st_blocks * 512;
+
+				if(allocated > used + MAX_ALLOC_SLACK) {
+					printf("    %s: %lu bytes allocated for %lu bytes\n", path.c_str(), (unsigned long)allocated, (unsigned long)myStat.st_size);
+					ok = false;
+				}
+
+			}
+
+			unlink(path.c_str());
+
+		}
+
+		rmdir(partDir.c_str());
+
+	}
+
+	for(int i = 0; i < 4; ++i) {
+
+		if(actual[i] != expected[i]) {
+			printf("    %s: %lu bytes, %lu expected\n", FILE_NAMES[i], (unsigned long)actual[i], (unsigned long)expected[i]);
+			ok = false;
+		}
+
+	}
+
+	return ok;
+
+}
+
+
+static void printStats(const char *name, const Rate &rate, Stats &stats) {
+
+	std::vector<double> &t = stats.batchTimes;
+	std::sort(t.begin(), t.end());
+
+	const double p99 = t[(t.size() * 99) / 100];
+	const double max = t.back();
+
+	char strRate[64];
+	sprintf(strRate, "%d x %d fps x %d kB", rate.nofHeadsets, rate.fps, rate.frameKB);
+
+	printf("%-20s %-22s %8.0f %9.1f %9.2f %9.2f\n",
+		   strRate, name,
+		   stats.bytes / stats.seconds / (1024.0 * 1024.0),
+		   SECONDS / stats.seconds,
+		   1e3 * p99, 1e3 * max);
+
+}
+
+
+int main(int argc, char **argv) {
+
+	const std::string parent = std::string(argc > 1 ? argv[1] : "/tmp") + "/";
+
+	std::string dir = parent + "segment_writerXXXXXX";
+	if(mkdtemp(&dir[0]) == NULL) {
+		printf("Could not create a directory in %s\n", parent.c_str());
+		return -1;
+	}
+	dir += "/";
+
+	std::vector<Rate> rates;
+	rates.push_back(Rate(1, 30, 40));
+	rates.push_back(Rate(2, 30, 40));
+	rates.push_back(Rate(2, 30, 80));
+	rates.push_back(Rate(2, 60, 80));
+
+	printf("%d s of recording per rate, a new part every %d s, batches of %d elements\n\n",
+		   SECONDS, ROTATE_SECONDS, (int)BATCH_SIZE);
+
+	printf("rate                 writer                     MB/s  realtime   p99, ms   max, ms\n");
+
+	srand(1);
+
+	std::vector<char> results(RESULTS_SIZE);
+	for(size_t i = 0; i < results.size(); ++i) {
+		results[i] = (char)rand();
+	}
+
+	bool ok = true;
+
+	for(size_t r = 0; r < rates.size() && ok; ++r) {
+
+		const Rate &rate = rates[r];
+
+		// about the size, the sizes of the MJPG frames vary
+		std::vector<std::vector<char> > frames(NOF_FRAMES);
+		for(int i = 0; i < NOF_FRAMES; ++i) {
+
+			frames[i].resize(rate.frameKB * 1024 * (90 + rand() % 21) / 100);
+
+			for(size_t j = 0; j < frames[i].size(); ++j) {
+				frames[i][j] = (char)rand();
+			}
+
+		}
+
+		std::vector<Element> els;
+		makeElements(rate, frames, results, els);
+
+		const int elsPerPart = 3 * rate.nofHeadsets * rate.fps * ROTATE_SECONDS;
+
+		Stats statsStreams;
+		if(!writeStreams(dir, els, elsPerPart, statsStreams) || !checkAndRemove(dir, els, elsPerPart)) {
+			printf("ofstream FAILED\n");
+			ok = false;
+			break;
+		}
+
+		printStats("ofstream", rate, statsStreams);
+
+		const SegmentWriter::SyncPolicy syncs[2] = {SegmentWriter::SYNC_NONE, SegmentWriter::SYNC_SEGMENT};
+
+		for(int s = 0; s < 2; ++s) {
+
+			Stats stats;
+			if(!writeSegments(dir, els, elsPerPart, syncs[s], stats) || !checkAndRemove(dir, els, elsPerPart)) {
+				printf("segments FAILED\n");
+				ok = false;
+				break;
+			}
+
+			const std::string name = std::string("segments, sync ") + SegmentWriter::getName(syncs[s]);
+
+			printStats(name.c_str(), rate, stats);
+
+		}
+
+		printf("\n");
+
+	}
+
+	rmdir(dir.c_str());
+
+	printf("%s\n", ok ? "OK" : "FAILED");
+
+	return ok ? 0 : -1;
+
+}